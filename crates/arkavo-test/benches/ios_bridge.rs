@@ -0,0 +1,295 @@
+//! Latency and throughput of the iOS bridge, per action and per backend.
+//!
+//! `cargo bench -p arkavo-test --bench ios_bridge` runs every backend the
+//! host can reach and skips the rest:
+//!
+//! - `ffi`: the stub bridge linked on non-Apple hosts, so only the FFI
+//!   crossing and JSON handling are measured.
+//! - `simctl`: the native bridge against booted simulators (macOS).
+//!   `ARKAVO_BENCH_DEVICE` pins the device, `ARKAVO_BENCH_BUNDLE` the app.
+//! - `xctest`: commands over the XCTest runner socket named by
+//!   `ARKAVO_BENCH_XCTEST_SOCKET`. The socket protocol has no screenshot,
+//!   query or state commands, so only gestures and typing are measured.
+//!
+//! `ARKAVO_BENCH_BATCH_SIZES` (default `1,8,32`) and `ARKAVO_BENCH_DEVICES`
+//! (default `1,2,4`) set the batch and parallel-device parameters. On the
+//! simctl backend a device count above the number of booted simulators
+//! clones the first one, and the clones are deleted again afterwards.
+//!
+//! Criterion writes its estimates as JSON under `target/criterion/`; pass
+//! `--save-baseline <name>` and later `--baseline <name>` to compare runs.
+//! The bridge's own per-operation histograms for the whole run are written
+//! next to them, to `target/criterion/ios_bridge_native_metrics.json`.
+
+use arkavo_test::bridge::ios_ffi::RustTestHarness;
+use arkavo_test::bridge::ios_ffi_batch::BridgeAction;
+use arkavo_test::bridge::ios_ffi_metrics::{bridge_metrics, reset_bridge_metrics};
+use arkavo_test::mcp::xctest_unix_bridge::{Command, XCTestUnixBridge};
+use criterion::measurement::WallTime;
+use criterion::{BenchmarkGroup, BenchmarkId, Criterion, Throughput, black_box};
+use serde_json::{Value, json};
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+
+/// How each benchmark thread gets a harness for the backend under test.
+#[derive(Clone)]
+enum Backend {
+    #[cfg_attr(any(target_os = "macos", target_os = "ios"), allow(dead_code))]
+    Ffi,
+    Simctl {
+        device: Option<String>,
+        bundle: String,
+    },
+}
+
+impl Backend {
+    fn name(&self) -> &'static str {
+        match self {
+            Self::Ffi => "ffi",
+            Self::Simctl { .. } => "simctl",
+        }
+    }
+
+    /// One harness per call, since harnesses are not shared across threads.
+    fn harness(&self) -> Option<RustTestHarness> {
+        let mut harness = RustTestHarness::new();
+        match self {
+            // The stub ignores its handle, so any non-null one will do.
+            Self::Ffi => harness.connect_ios_bridge(std::ptr::NonNull::dangling().as_ptr()),
+            Self::Simctl { device, bundle } => {
+                harness.connect_simulator(device.as_deref(), bundle).ok()?
+            }
+        }
+        Some(harness)
+    }
+}
+
+fn available_backends() -> Vec<Backend> {
+    let mut backends = Vec::new();
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    backends.push(Backend::Ffi);
+
+    let simctl = Backend::Simctl {
+        device: std::env::var("ARKAVO_BENCH_DEVICE").ok(),
+        bundle: std::env::var("ARKAVO_BENCH_BUNDLE")
+            .unwrap_or_else(|_| "com.apple.Preferences".to_string()),
+    };
+    if cfg!(target_os = "macos") {
+        if simctl.harness().is_some() {
+            backends.push(simctl);
+        } else {
+            eprintln!("ios_bridge bench: no booted simulator, skipping the simctl backend");
+        }
+    }
+    backends
+}
+
+fn list_parameter(name: &str, default: &[usize]) -> Vec<usize> {
+    std::env::var(name)
+        .ok()
+        .map(|value| {
+            value
+                .split(',')
+                .filter_map(|item| item.trim().parse().ok())
+                .filter(|&n| n > 0)
+                .collect()
+        })
+        .filter(|list: &Vec<usize>| !list.is_empty())
+        .unwrap_or_else(|| default.to_vec())
+}
+
+fn screenshot_path() -> String {
+    std::env::temp_dir()
+        .join(format!("arkavo-bench-{}.png", std::process::id()))
+        .to_string_lossy()
+        .into_owned()
+}
+
+fn action_cases() -> Vec<(&'static str, Value)> {
+    vec![
+        ("tap", json!({"x": 100, "y": 200})),
+        (
+            "swipe",
+            json!({"x1": 100, "y1": 400, "x2": 100, "y2": 200, "duration": 0.1}),
+        ),
+        ("type_text", json!({"text": "benchmark"})),
+        ("screenshot", json!({"path": screenshot_path()})),
+        ("query_ui", json!({"max_depth": 2})),
+    ]
+}
+
+/// Real devices take tens of milliseconds per action, so their groups trade
+/// sample count for a bounded run time.
+fn configure(group: &mut BenchmarkGroup<'_, WallTime>, backend: &Backend) {
+    if !matches!(backend, Backend::Ffi) {
+        group.sample_size(10);
+        group.measurement_time(Duration::from_secs(10));
+    }
+}
+
+fn bench_actions(c: &mut Criterion, backend: &Backend) {
+    let Some(harness) = backend.harness() else {
+        return;
+    };
+    let mut group = c.benchmark_group(format!("{}/action", backend.name()));
+    configure(&mut group, backend);
+    group.throughput(Throughput::Elements(1));
+
+    for (action, params) in action_cases() {
+        let params = params.to_string();
+        group.bench_function(action, |b| {
+            b.iter(|| black_box(harness.execute_action(action, &params)))
+        });
+    }
+    group.bench_function("state", |b| {
+        b.iter(|| black_box(harness.get_current_state()))
+    });
+    group.finish();
+}
+
+fn bench_batches(c: &mut Criterion, backend: &Backend, sizes: &[usize]) {
+    let Some(harness) = backend.harness() else {
+        return;
+    };
+    let mut group = c.benchmark_group(format!("{}/batch", backend.name()));
+    configure(&mut group, backend);
+
+    for &size in sizes {
+        let actions: Vec<BridgeAction> = (0..size)
+            .map(|i| BridgeAction::new("tap", json!({"x": 100 + i % 50, "y": 200})))
+            .collect();
+        group.throughput(Throughput::Elements(size as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(size), &actions, |b, actions| {
+            b.iter(|| black_box(harness.execute_batch(actions, false)))
+        });
+    }
+    group.finish();
+}
+
+/// Every iteration issues one tap per device at once, so the reported
+/// throughput is actions per second across all devices.
+fn bench_parallel(c: &mut Criterion, backend: &Backend, devices: &[usize]) {
+    let mut group = c.benchmark_group(format!("{}/parallel", backend.name()));
+    configure(&mut group, backend);
+
+    for &count in devices {
+        let pool = match backend {
+            Backend::Ffi => None,
+            Backend::Simctl { bundle, .. } => {
+                match arkavo_test::bridge::ios_ffi_pool::BridgePool::create(count, bundle) {
+                    Ok(pool) => Some(std::sync::Arc::new(pool)),
+                    Err(e) => {
+                        eprintln!(
+                            "ios_bridge bench: no pool of {} devices ({}), skipping",
+                            count, e
+                        );
+                        continue;
+                    }
+                }
+            }
+        };
+
+        group.throughput(Throughput::Elements(count as u64));
+        group.bench_function(BenchmarkId::from_parameter(count), |b| {
+            b.iter_custom(|iters| {
+                let started = Instant::now();
+                std::thread::scope(|scope| {
+                    for _ in 0..count {
+                        let pool = pool.clone();
+                        scope.spawn(move || {
+                            let lease = pool.as_ref().map(|pool| pool.acquire(None).unwrap());
+                            let harness = match &lease {
+                                Some(lease) => lease.harness(),
+                                None => backend.harness().unwrap(),
+                            };
+                            for _ in 0..iters {
+                                black_box(harness.execute_action("tap", r#"{"x": 100, "y": 200}"#))
+                                    .ok();
+                            }
+                            drop(harness);
+                        });
+                    }
+                });
+                started.elapsed()
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_xctest(c: &mut Criterion) {
+    let Some(socket) = std::env::var_os("ARKAVO_BENCH_XCTEST_SOCKET") else {
+        return;
+    };
+    let runtime = tokio::runtime::Runtime::new().expect("tokio runtime");
+    let mut bridge = XCTestUnixBridge::with_socket_path(PathBuf::from(socket));
+    if let Err(e) = runtime.block_on(bridge.connect_to_runner()) {
+        eprintln!("ios_bridge bench: skipping the xctest backend: {}", e);
+        return;
+    }
+
+    let mut group = c.benchmark_group("xctest/action");
+    group.sample_size(10);
+    group.measurement_time(Duration::from_secs(10));
+    group.throughput(Throughput::Elements(1));
+
+    let cases: [(&str, fn() -> Command); 3] = [
+        ("tap", || {
+            XCTestUnixBridge::create_coordinate_tap(100.0, 200.0)
+        }),
+        ("swipe", || {
+            XCTestUnixBridge::create_swipe(100.0, 400.0, 100.0, 200.0, Some(0.1))
+        }),
+        ("type_text", || {
+            XCTestUnixBridge::create_type_text("benchmark".to_string(), false)
+        }),
+    ];
+    for (name, command) in cases {
+        group.bench_function(name, |b| {
+            b.iter(|| black_box(runtime.block_on(bridge.send_command(command()))))
+        });
+    }
+    group.finish();
+}
+
+fn write_native_metrics() {
+    let Ok(metrics) = bridge_metrics() else {
+        return;
+    };
+    let directory = std::env::var_os("CARGO_TARGET_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| PathBuf::from("target"))
+        .join("criterion");
+    let path = directory.join("ios_bridge_native_metrics.json");
+    let written = std::fs::create_dir_all(&directory).and_then(|_| {
+        std::fs::write(
+            &path,
+            serde_json::to_vec_pretty(&metrics).unwrap_or_default(),
+        )
+    });
+    if let Err(e) = written {
+        eprintln!(
+            "ios_bridge bench: could not write {}: {}",
+            path.display(),
+            e
+        );
+    }
+}
+
+fn main() {
+    let mut criterion = Criterion::default().configure_from_args();
+    let batch_sizes = list_parameter("ARKAVO_BENCH_BATCH_SIZES", &[1, 8, 32]);
+    let device_counts = list_parameter("ARKAVO_BENCH_DEVICES", &[1, 2, 4]);
+
+    reset_bridge_metrics();
+    for backend in available_backends() {
+        bench_actions(&mut criterion, &backend);
+        bench_batches(&mut criterion, &backend, &batch_sizes);
+        bench_parallel(&mut criterion, &backend, &device_counts);
+    }
+    bench_xctest(&mut criterion);
+
+    criterion.final_summary();
+    write_native_metrics();
+    let _ = std::fs::remove_file(screenshot_path());
+}
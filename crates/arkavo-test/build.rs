@@ -12,11 +12,56 @@ fn main() {
             // Use real implementation on Apple platforms
             cc::Build::new()
                 .file("src/bridge/ios_impl.c")
+                .file("src/bridge/ios_analysis.c")
+                .file("src/bridge/ios_worker.c")
+                .file("src/bridge/ios_builder.c")
+                .file("src/bridge/ios_batch.c")
+                .file("src/bridge/ios_actions.c")
+                .file("src/bridge/ios_params.c")
+                .file("src/bridge/ios_json.c")
+                .file("src/bridge/ios_buffer.c")
+                .file("src/bridge/ios_frame.c")
+                .file("src/bridge/ios_frame_plan.c")
+                .file("src/bridge/ios_stream.c")
+                .file("src/bridge/ios_stream_tiles.c")
+                .file("src/bridge/ios_delta.c")
+                .file("src/bridge/ios_diff.c")
+                .file("src/bridge/ios_pool.c")
+                .file("src/bridge/ios_pool_checkout.c")
+                .file("src/bridge/ios_async.c")
+                .file("src/bridge/ios_snapshot.c")
+                .file("src/bridge/ios_snapshot_format.c")
+                .file("src/bridge/ios_registry.c")
+                .file("src/bridge/ios_metrics.c")
+                .file("src/bridge/ios_hid.c")
+                .file("src/bridge/ios_hid_indigo.m")
+                .file("src/bridge/ios_gesture.c")
+                .file("src/bridge/ios_trace.c")
+                .file("src/bridge/ios_trace_format.c")
+                .file("src/bridge/ios_replay.c")
+                .file("src/bridge/ios_log.c")
+                .file("src/bridge/ios_log_format.c")
+                .file("src/bridge/ios_probe.c")
+                .file("src/bridge/ios_probe_ring.c")
+                .file("src/bridge/ios_backend.c")
+                .file("src/bridge/ios_backend_route.c")
+                .file("src/bridge/ios_runner.c")
+                .file("src/bridge/ios_lifecycle.c")
                 .warnings(true)
                 .compile("ios_bridge");
 
-            // Link with CoreFoundation framework
+            // setup_idb_companion declares build.rs as a rerun trigger, which
+            // replaces cargo's default of rerunning on any change in the
+            // package, so the bridge sources need their own trigger
+            println!("cargo:rerun-if-changed=src/bridge");
+
+            // CoreGraphics and ImageIO decode and re-encode captured frames
             println!("cargo:rustc-link-lib=framework=CoreFoundation");
+            println!("cargo:rustc-link-lib=framework=CoreGraphics");
+            println!("cargo:rustc-link-lib=framework=ImageIO");
+            // Foundation hosts the Objective-C runtime the HID client talks
+            // to CoreSimulator through
+            println!("cargo:rustc-link-lib=framework=Foundation");
 
             // Setup idb_companion embedding for macOS
             if target_os == "macos" {
@@ -24,10 +69,33 @@ fn main() {
             }
         }
         _ => {
-            // Use stub on other platforms
+            // Use stub on other platforms. The screen analysis rules, the
+            // frame plan, the frame diff kernel, the stream's tile hashes,
+            // the JSON tokenizer, the async executor, the state delta, the
+            // log entry decoder, the probe ring reader, the trace format, the
+            // snapshot record format, the latency histograms, the backend
+            // router and the pool checkout have no simulator dependency, so
+            // they are the real ones everywhere.
             cc::Build::new()
                 .file("src/bridge/ios_stub.c")
-                .warnings(false)
+                .file("src/bridge/ios_stub_async.c")
+                .file("src/bridge/ios_analysis.c")
+                .file("src/bridge/ios_async.c")
+                .file("src/bridge/ios_params.c")
+                .file("src/bridge/ios_delta.c")
+                .file("src/bridge/ios_log_format.c")
+                .file("src/bridge/ios_probe_ring.c")
+                .file("src/bridge/ios_trace_format.c")
+                .file("src/bridge/ios_snapshot_format.c")
+                .file("src/bridge/ios_metrics.c")
+                .file("src/bridge/ios_backend_route.c")
+                .file("src/bridge/ios_pool_checkout.c")
+                .file("src/bridge/ios_frame_plan.c")
+                .file("src/bridge/ios_stream_tiles.c")
+                .file("src/bridge/ios_builder.c")
+                .file("src/bridge/ios_diff.c")
+                .file("src/bridge/ios_json.c")
+                .warnings(true)
                 .compile("ios_bridge");
         }
     }
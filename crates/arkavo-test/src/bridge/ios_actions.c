@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "ios_backend.h"
+#include "ios_impl.h"
+#include "ios_stream.h"
+#include "ios_trace.h"
+
+#define IOS_WAIT_DEFAULT_QUIET_MS 500
+#define IOS_WAIT_DEFAULT_TIMEOUT 5.0
+// Each frame is a simctl screenshot, so this is about as often as a change
+// can be noticed at all.
+#define IOS_WAIT_CHANGE_FPS 10.0
+
+static char* take_screenshot(const IOSBridgeCall* call, const char* path) {
+    char* quoted_path = ios_shell_quote(path);
+    if (!quoted_path) {
+        return strdup("{\"success\": false, \"error\": \"Failed to capture screenshot\"}");
+    }
+
+    size_t rest_size = strlen(quoted_path) + 12;
+    char* rest = malloc(rest_size);
+    if (!rest) {
+        free(quoted_path);
+        return strdup("{\"success\": false, \"error\": \"Failed to capture screenshot\"}");
+    }
+    snprintf(rest, rest_size, "screenshot %s", quoted_path);
+    free(quoted_path);
+
+    int status = ios_bridge_call_device_command(call, "io", rest, NULL);
+    free(rest);
+    if (status < 0) {
+        return strdup("{\"success\": false, \"error\": \"Failed to capture screenshot\"}");
+    }
+
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_appendf(&result, "{\"success\": %s, \"path\": ", status == 0 ? "true" : "false");
+    ios_builder_append_json_string(&result, path, strlen(path));
+    ios_builder_append(&result, "}", 1);
+    char* json = ios_builder_finish(&result);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+// Starts a frame stream on the call's device and waits on it: for
+// quiet_ms without change when idle, otherwise for the first frame that
+// differs from the one captured when the wait began. Returns an
+// IOS_STREAM_* code; on IOS_STREAM_FAILED, *error names what went wrong.
+static int wait_on_screen(const IOSBridgeCall* call, int idle, double quiet_ms, double timeout_ms,
+                          const char** error) {
+    IOSStreamConfig config;
+    memset(&config, 0, sizeof(config));
+    // Sampling at least four times per quiet window keeps the settle
+    // decision from lagging the screen by more than a quarter of it.
+    config.fps = idle ? (quiet_ms > 0 ? 4000.0 / quiet_ms : 0) : IOS_WAIT_CHANGE_FPS;
+
+    double deadline = ios_monotonic_ms() + timeout_ms;
+    IOSFrameStream* stream = ios_stream_start_device(call->device_id, &config);
+    if (!stream) {
+        *error = "{\"success\": false, \"error\": \"Failed to start frame stream\"}";
+        return IOS_STREAM_FAILED;
+    }
+
+    uint64_t sequence = 0;
+    int status;
+    if (idle) {
+        status = ios_bridge_stream_wait_settled(stream, (int)quiet_ms, (int)timeout_ms, &sequence);
+    } else {
+        // The stream counts its first frame as a change, which makes it the
+        // baseline rather than an answer.
+        status = ios_bridge_stream_wait_change(stream, 0, (int)timeout_ms, &sequence);
+        if (status == IOS_STREAM_OK) {
+            double remaining = deadline - ios_monotonic_ms();
+            status = ios_bridge_stream_wait_change(stream, sequence, remaining > 0 ? (int)remaining : 0, &sequence);
+        }
+    }
+    ios_bridge_stream_stop(stream);
+    if (status == IOS_STREAM_FAILED) {
+        *error = "{\"success\": false, \"error\": \"Frame stream failed while waiting\"}";
+    }
+    return status;
+}
+
+// "until": "settled" ends the wait as soon as the screen stops changing,
+// with duration as the upper bound, instead of always sleeping it out.
+// Plain waits never get here; see ios_bridge_execute_params.
+static char* perform_wait(const IOSBridgeCall* call, const IOSActionParams* params) {
+    double duration = params->present & IOS_PARAM_DURATION ? params->duration : 1.0;
+    if (duration < 0) duration = 0;
+
+    if (!ios_json_equals(params->source, &params->until, "settled")) {
+        return strdup("{\"success\": false, \"error\": \"Unknown wait condition\"}");
+    }
+
+    double quiet_ms = params->present & IOS_PARAM_QUIET_MS ? params->quiet_ms : IOS_WAIT_DEFAULT_QUIET_MS;
+    double started = ios_monotonic_ms();
+    const char* error = NULL;
+    int status = wait_on_screen(call, 1, quiet_ms, duration * 1000.0, &error);
+    if (status == IOS_STREAM_FAILED) return strdup(error);
+
+    char result[192];
+    snprintf(result, sizeof(result),
+             "{\"success\": true, \"action\": \"wait\", \"until\": \"settled\", \"settled\": %s, \"waited_ms\": %.0f}",
+             status == IOS_STREAM_OK ? "true" : "false", ios_monotonic_ms() - started);
+    return strdup(result);
+}
+
+// Returns as soon as the condition holds, with timeout (seconds) as the
+// bound. A condition that never holds is satisfied: false, not an error.
+static char* perform_wait_for(const IOSBridgeCall* call, const IOSActionParams* params) {
+    if (!(params->present & IOS_PARAM_CONDITION)) {
+        return strdup("{\"success\": false, \"error\": \"No condition parameter found\"}");
+    }
+
+    // Element conditions are routed to the XCUITest runner, since simctl
+    // exposes no accessibility data.
+    const char* condition = NULL;
+    if (ios_json_equals(params->source, &params->condition, "idle")) {
+        condition = "idle";
+    } else if (ios_json_equals(params->source, &params->condition, "screen_changed")) {
+        condition = "screen_changed";
+    } else if (ios_backend_targets_element("wait_for", params)) {
+        return strdup("{\"success\": false, \"error\": \"Element conditions require the XCUITest bridge\"}");
+    } else {
+        return strdup("{\"success\": false, \"error\": \"Unknown wait condition\"}");
+    }
+
+    double timeout = params->present & IOS_PARAM_TIMEOUT ? params->timeout : IOS_WAIT_DEFAULT_TIMEOUT;
+    if (timeout < 0) timeout = 0;
+    double quiet_ms = params->present & IOS_PARAM_QUIET_MS ? params->quiet_ms : IOS_WAIT_DEFAULT_QUIET_MS;
+
+    double started = ios_monotonic_ms();
+    const char* error = NULL;
+    int status = wait_on_screen(call, strcmp(condition, "idle") == 0, quiet_ms, timeout * 1000.0, &error);
+    if (status == IOS_STREAM_FAILED) return strdup(error);
+
+    char result[192];
+    snprintf(result, sizeof(result),
+             "{\"success\": true, \"action\": \"wait_for\", \"condition\": \"%s\", \"satisfied\": %s, "
+             "\"waited_ms\": %.0f}",
+             condition, status == IOS_STREAM_OK ? "true" : "false", ios_monotonic_ms() - started);
+    return strdup(result);
+}
+
+// Action names come from callers, so anything else is timed as "unknown"
+// rather than letting arbitrary names claim histogram slots.
+static const char* metric_action_name(const char* action) {
+    static const char* known[] = {"tap", "swipe", "touch", "type_text", "screenshot", "wait", "wait_for",
+                                  "query_ui", "assert"};
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+        if (strcmp(action, known[i]) == 0) return known[i];
+    }
+    return "unknown";
+}
+
+// The simctl backend: capture and screen waits. Everything else it gets is
+// unknown, since routing sends input and element actions elsewhere.
+char* ios_simctl_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost) {
+    (void)lost;
+    if (strcmp(action, "screenshot") == 0) {
+        char* path = params->present & IOS_PARAM_PATH
+            ? ios_action_params_string(params, &params->path)
+            : strdup("screenshot.png");
+        if (!path) {
+            return strdup("{\"error\": \"Invalid path parameter\"}");
+        }
+
+        char* result = take_screenshot(call, path);
+        free(path);
+        return result;
+    } else if (strcmp(action, "wait") == 0) {
+        return perform_wait(call, params);
+    } else if (strcmp(action, "wait_for") == 0) {
+        return perform_wait_for(call, params);
+    }
+
+    return strdup("{\"error\": \"Unknown action\"}");
+}
+
+static char* execute_call(void* bridge, const char* action, const IOSActionParams* params) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, params) != 0) {
+        return strdup("{\"error\": \"No iOS device specified or found\"}");
+    }
+    double started = ios_monotonic_ms();
+    double wait_ms = 0;
+    char* result = ios_plain_wait_result(action, params, &wait_ms);
+    if (result) {
+        // The handle is given up for the wait and only taken back to trace
+        // it. A batch or replay keeps holding it, as it does for every one
+        // of its actions.
+        ios_bridge_call_end(&call);
+        usleep((useconds_t)(wait_ms * 1000.0));
+        if (ios_bridge_call_begin(&call, bridge, params) != 0) return result;
+    } else {
+        result = ios_backend_execute(&call, action, params);
+    }
+    IOSTracePending* pending = call.impl->trace
+        ? ios_trace_record_begin(&call, action, params, result, started, ios_monotonic_ms() - started)
+        : NULL;
+    ios_bridge_call_end(&call);
+    ios_trace_record_finish(pending);
+    return result;
+}
+
+// Batches and submitted actions come through here too, so every action is
+// timed once, including any wait for the handle's lock.
+char* ios_bridge_execute_params(void* bridge, const char* action, const IOSActionParams* params) {
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "action", metric_action_name(action));
+    char* result = execute_call(bridge, action, params);
+    ios_metrics_end(&span);
+    return result;
+}
+
+char* ios_bridge_execute_action(void* bridge, const char* action, const char* params) {
+    IOSActionParams decoded;
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "params.parse", NULL);
+    int parsed = ios_action_params_parse(params, &decoded);
+    ios_metrics_end(&span);
+    if (parsed != 0) {
+        return strdup("{\"success\": false, \"error\": \"Invalid action params\"}");
+    }
+
+    return ios_bridge_execute_params(bridge, action, &decoded);
+}
@@ -0,0 +1,64 @@
+#include "ios_analysis.h"
+
+#include <string.h>
+
+// CGRect semantics: a negative size extends the other way, and two frames
+// that only share an edge do not intersect.
+static void span(double origin, double size, double* low, double* high) {
+    *low = size < 0 ? origin + size : origin;
+    *high = size < 0 ? origin : origin + size;
+}
+
+static int on_screen(IOSAnalysisRect frame, IOSAnalysisRect screen) {
+    if (frame.width == 0 || frame.height == 0) return 0;
+    double left, right, top, bottom, screen_left, screen_right, screen_top, screen_bottom;
+    span(frame.x, frame.width, &left, &right);
+    span(frame.y, frame.height, &top, &bottom);
+    span(screen.x, screen.width, &screen_left, &screen_right);
+    span(screen.y, screen.height, &screen_top, &screen_bottom);
+    return left < screen_right && screen_left < right && top < screen_bottom && screen_top < bottom;
+}
+
+int ios_analysis_classify(int kind, IOSAnalysisRect frame, IOSAnalysisRect screen) {
+    switch (kind) {
+        case IOS_ANALYSIS_BUTTON:
+        case IOS_ANALYSIS_TEXT_FIELD:
+        case IOS_ANALYSIS_TEXT_VIEW:
+        case IOS_ANALYSIS_SWITCH:
+        case IOS_ANALYSIS_SLIDER:
+            break;
+        default:
+            return IOS_ANALYSIS_SKIP;
+    }
+    if (!on_screen(frame, screen)) return IOS_ANALYSIS_SKIP;
+    if (kind == IOS_ANALYSIS_BUTTON) return IOS_ANALYSIS_TAP;
+    return kind == IOS_ANALYSIS_TEXT_FIELD ? IOS_ANALYSIS_TYPE : IOS_ANALYSIS_LIST;
+}
+
+const char* ios_analysis_verb(int role) {
+    if (role == IOS_ANALYSIS_TAP) return "tap";
+    return role == IOS_ANALYSIS_TYPE ? "type" : NULL;
+}
+
+const char* ios_analysis_target(const char* identifier, const char* label) {
+    if (identifier && *identifier) return identifier;
+    return label ? label : "";
+}
+
+const char* ios_analysis_kind_name(int kind) {
+    switch (kind) {
+        case IOS_ANALYSIS_BUTTON: return "button";
+        case IOS_ANALYSIS_TEXT_FIELD: return "textField";
+        case IOS_ANALYSIS_TEXT_VIEW: return "textView";
+        case IOS_ANALYSIS_SWITCH: return "switch";
+        case IOS_ANALYSIS_SLIDER: return "slider";
+        default: return "other";
+    }
+}
+
+const char* ios_analysis_screen_name(const char* identifier) {
+    if (!identifier) return NULL;
+    if (strcmp(identifier, "Login") == 0) return "LoginScreen";
+    if (strcmp(identifier, "Home") == 0) return "HomeScreen";
+    return NULL;
+}
@@ -0,0 +1,57 @@
+#ifndef ARKAVO_IOS_ANALYSIS_H
+#define ARKAVO_IOS_ANALYSIS_H
+
+// The runner's Objective-C bridge includes this too.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rules behind analyze_screen, which the XCUITest bridge applies to every
+// element of one hierarchy snapshot (ArkavoTestBridge+Analysis.m). They are
+// plain C so the same answers hold wherever the snapshot comes from.
+
+// Element kinds the analysis tells apart; the bridge maps XCUIElementType
+// onto these and everything else is IOS_ANALYSIS_OTHER.
+#define IOS_ANALYSIS_OTHER 0
+#define IOS_ANALYSIS_BUTTON 1
+#define IOS_ANALYSIS_TEXT_FIELD 2
+#define IOS_ANALYSIS_TEXT_VIEW 3
+#define IOS_ANALYSIS_SWITCH 4
+#define IOS_ANALYSIS_SLIDER 5
+#define IOS_ANALYSIS_NAVIGATION_BAR 6
+
+// What an element contributes to the analysis.
+#define IOS_ANALYSIS_SKIP 0
+// Listed among the visible elements.
+#define IOS_ANALYSIS_LIST 1
+// Listed, and offered as a "tap:" or "type:" action.
+#define IOS_ANALYSIS_TAP 2
+#define IOS_ANALYSIS_TYPE 3
+
+// Frames in points, as XCUIElementSnapshot reports them.
+typedef struct {
+    double x;
+    double y;
+    double width;
+    double height;
+} IOSAnalysisRect;
+
+// isHittable asks XCTest to hit-test every element; an on-screen, non-empty
+// frame is the same answer for anything not covered by another view, at no
+// query cost. Only interactive kinds are ever listed.
+int ios_analysis_classify(int kind, IOSAnalysisRect frame, IOSAnalysisRect screen);
+// "tap" or "type" for the matching roles, NULL for the others.
+const char* ios_analysis_verb(int role);
+// The identifier when it is set, else the label, else "".
+const char* ios_analysis_target(const char* identifier, const char* label);
+// The reported "type" of a kind: "button", "textField", ..., "other".
+const char* ios_analysis_kind_name(int kind);
+// Screen named by a navigation bar identifier, or NULL when the bar names
+// none. The first bar in the walk that names a screen wins.
+const char* ios_analysis_screen_name(const char* identifier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ios_impl.h"
+
+#define IOS_ASYNC_ACTION_NAME_MAX 64
+
+typedef struct IOSAsyncRequest {
+    uint64_t id;
+    char action[IOS_ASYNC_ACTION_NAME_MAX];
+    char* params_json;
+    IOSActionParams params;
+    // Set at submit time for requests that never reach the device: rejected
+    // params and plain waits, which complete from the timer list.
+    char* result;
+    double due_ms;
+    IOSBridgeCompletion completion;
+    void* context;
+    struct IOSAsyncRequest* next;
+} IOSAsyncRequest;
+
+struct IOSBridgeExecutor {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    int started;
+    int running;
+    IOSBridgeImpl* bridge;
+    IOSAsyncRequest* head;
+    IOSAsyncRequest* tail;
+    // Sorted by due_ms, earliest first.
+    IOSAsyncRequest* timers;
+};
+
+static uint64_t next_request_id = 0;
+
+static void complete(IOSAsyncRequest* request, char* result) {
+    request->completion(request->context, request->id, result);
+    free(request->params_json);
+    free(request);
+}
+
+static void complete_cancelled(IOSAsyncRequest* request) {
+    free(request->result);
+    complete(request, strdup("{\"success\": false, \"error\": \"Bridge was destroyed before the action ran\"}"));
+}
+
+static void* executor_main(void* arg) {
+    IOSBridgeExecutor* executor = arg;
+
+    pthread_mutex_lock(&executor->lock);
+    while (executor->running) {
+        if (executor->timers && executor->timers->due_ms <= ios_monotonic_ms()) {
+            IOSAsyncRequest* timer = executor->timers;
+            executor->timers = timer->next;
+            pthread_mutex_unlock(&executor->lock);
+            complete(timer, timer->result);
+            pthread_mutex_lock(&executor->lock);
+            continue;
+        }
+
+        if (executor->head) {
+            IOSAsyncRequest* request = executor->head;
+            executor->head = request->next;
+            if (!executor->head) executor->tail = NULL;
+            pthread_mutex_unlock(&executor->lock);
+            char* result = request->result
+                ? request->result
+                : ios_bridge_execute_params(executor->bridge, request->action, &request->params);
+            complete(request, result);
+            pthread_mutex_lock(&executor->lock);
+            continue;
+        }
+
+        if (executor->timers) {
+            struct timespec deadline = ios_wall_deadline(executor->timers->due_ms - ios_monotonic_ms());
+            pthread_cond_timedwait(&executor->wake, &executor->lock, &deadline);
+        } else {
+            pthread_cond_wait(&executor->wake, &executor->lock);
+        }
+    }
+    pthread_mutex_unlock(&executor->lock);
+    return NULL;
+}
+
+IOSBridgeExecutor* ios_executor_create(IOSBridgeImpl* bridge) {
+    IOSBridgeExecutor* executor = calloc(1, sizeof(IOSBridgeExecutor));
+    if (!executor) return NULL;
+
+    pthread_cond_init(&executor->wake, NULL);
+    pthread_mutex_init(&executor->lock, NULL);
+    executor->bridge = bridge;
+    return executor;
+}
+
+void ios_executor_destroy(IOSBridgeExecutor* executor) {
+    if (!executor) return;
+
+    pthread_mutex_lock(&executor->lock);
+    executor->running = 0;
+    pthread_cond_signal(&executor->wake);
+    pthread_mutex_unlock(&executor->lock);
+    if (executor->started) pthread_join(executor->thread, NULL);
+
+    while (executor->head) {
+        IOSAsyncRequest* request = executor->head;
+        executor->head = request->next;
+        complete_cancelled(request);
+    }
+    while (executor->timers) {
+        IOSAsyncRequest* timer = executor->timers;
+        executor->timers = timer->next;
+        complete_cancelled(timer);
+    }
+
+    pthread_mutex_destroy(&executor->lock);
+    pthread_cond_destroy(&executor->wake);
+    free(executor);
+}
+
+char* ios_plain_wait_result(const char* action, const IOSActionParams* params, double* duration_ms) {
+    if (strcmp(action, "wait") != 0 || params->present & IOS_PARAM_UNTIL) return NULL;
+    double duration = params->present & IOS_PARAM_DURATION ? params->duration : 1.0;
+    if (duration < 0) duration = 0;
+    *duration_ms = duration * 1000.0;
+    char result[128];
+    snprintf(result, sizeof(result), "{\"success\": true, \"action\": \"wait\", \"duration\": %.3f}", duration);
+    return strdup(result);
+}
+
+// Plain waits only delay their own completion, so they become timers rather
+// than occupying the executor while other requests queue up behind them.
+static void prepare(IOSAsyncRequest* request) {
+    if (ios_action_params_parse(request->params_json, &request->params) != 0) {
+        request->result = strdup("{\"success\": false, \"error\": \"Invalid action params\"}");
+        return;
+    }
+    double duration_ms = 0;
+    request->result = ios_plain_wait_result(request->action, &request->params, &duration_ms);
+    if (request->result) request->due_ms = ios_monotonic_ms() + duration_ms;
+}
+
+static void enqueue(IOSBridgeExecutor* executor, IOSAsyncRequest* request) {
+    if (request->due_ms > 0) {
+        IOSAsyncRequest** slot = &executor->timers;
+        while (*slot && (*slot)->due_ms <= request->due_ms) slot = &(*slot)->next;
+        request->next = *slot;
+        *slot = request;
+    } else if (executor->tail) {
+        executor->tail->next = request;
+        executor->tail = request;
+    } else {
+        executor->head = executor->tail = request;
+    }
+}
+
+uint64_t ios_bridge_submit_action(void* bridge, const char* action, const char* params,
+                                  IOSBridgeCompletion completion, void* context) {
+    // The executor never changes after creation, so submitting does not wait
+    // on the handle lock held by whatever is running right now.
+    IOSBridgeImpl* impl = ios_bridge_handle(bridge);
+    IOSBridgeExecutor* executor = impl ? impl->executor : NULL;
+    if (!executor || strlen(action) >= IOS_ASYNC_ACTION_NAME_MAX) return 0;
+
+    IOSAsyncRequest* request = calloc(1, sizeof(IOSAsyncRequest));
+    if (!request) return 0;
+    request->params_json = strdup(params ? params : "");
+    if (!request->params_json) {
+        free(request);
+        return 0;
+    }
+    strcpy(request->action, action);
+    request->completion = completion;
+    request->context = context;
+    uint64_t id = __atomic_add_fetch(&next_request_id, 1, __ATOMIC_RELAXED);
+    request->id = id;
+    prepare(request);
+
+    pthread_mutex_lock(&executor->lock);
+    if (!executor->started) {
+        executor->running = 1;
+        if (pthread_create(&executor->thread, NULL, executor_main, executor) != 0) {
+            executor->running = 0;
+            pthread_mutex_unlock(&executor->lock);
+            free(request->result);
+            free(request->params_json);
+            free(request);
+            return 0;
+        }
+        executor->started = 1;
+    }
+    enqueue(executor, request);
+    pthread_cond_signal(&executor->wake);
+    pthread_mutex_unlock(&executor->lock);
+    return id;
+}
@@ -0,0 +1,60 @@
+#include "ios_backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* hid_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost) {
+    char* result = ios_gesture_execute(call, action, params);
+    // Gestures drop the connection when the simulator stops taking events.
+    *lost = result && !call->impl->hid;
+    return result;
+}
+
+// Commands fall back to popen while the resident worker is down, so simctl
+// can always take the call; only its speed suffers.
+static int simctl_prepare(const IOSBridgeCall* call, char* error, size_t error_size) {
+    (void)error;
+    (void)error_size;
+    ios_worker_start(&call->impl->worker);
+    return 0;
+}
+
+// Indexed by IOS_BACKEND_*.
+static const IOSBackend backends[IOS_BACKEND_COUNT] = {
+    {"hid", IOS_BACKEND_CAP_INPUT, ios_gesture_prepare, hid_execute},
+    {"xcuitest", IOS_BACKEND_CAP_INPUT | IOS_BACKEND_CAP_ELEMENTS, ios_runner_prepare, ios_runner_execute},
+    {"simctl", IOS_BACKEND_CAP_CAPTURE | IOS_BACKEND_CAP_LIFECYCLE, simctl_prepare, ios_simctl_execute},
+};
+
+void ios_backend_init(IOSBridgeImpl* impl) {
+    impl->runner_fd = -1;
+    impl->runner_device_id = NULL;
+    memset(impl->backends, 0, sizeof(impl->backends));
+}
+
+char* ios_backend_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params) {
+    return ios_backend_dispatch(backends, ios_backend_route(action, params), call->impl->backends, call, action,
+                                params);
+}
+
+char* ios_bridge_get_backends(void* bridge, int probe) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, NULL) != 0) {
+        return strdup("{\"error\": \"No iOS device specified or found\"}");
+    }
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_append(&out, "{\"backends\": [", 14);
+    for (int index = 0; index < IOS_BACKEND_COUNT; index++) {
+        int connected = index == IOS_BACKEND_HID       ? call.impl->hid != NULL
+                        : index == IOS_BACKEND_XCUITEST ? call.impl->runner_fd >= 0
+                                                        : call.impl->worker.healthy;
+        if (index) ios_builder_append(&out, ", ", 2);
+        ios_backend_append_status(&out, &backends[index], &call.impl->backends[index], &call, probe, connected);
+    }
+    ios_builder_append(&out, "]}", 2);
+    ios_bridge_call_end(&call);
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"error\": \"Memory allocation failed\"}");
+}
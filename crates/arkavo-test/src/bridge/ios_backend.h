@@ -0,0 +1,74 @@
+#ifndef ARKAVO_IOS_BACKEND_H
+#define ARKAVO_IOS_BACKEND_H
+
+#include <stddef.h>
+
+#include "ios_impl.h"
+
+// One handle drives a simulator through several native backends at once,
+// each the fastest at what it does: HID injection for coordinate input, the
+// resident XCUITest runner (ArkavoTestBridge+Host.m) for anything that
+// needs the accessibility tree, and simctl for capture and lifecycle. The
+// table is fixed at compile time; which entry serves an action is decided
+// per call from its route and each backend's health, so ios_bridge_* stay
+// the only entry points.
+#define IOS_BACKEND_CAP_INPUT (1u << 0)
+#define IOS_BACKEND_CAP_ELEMENTS (1u << 1)
+#define IOS_BACKEND_CAP_CAPTURE (1u << 2)
+#define IOS_BACKEND_CAP_LIFECYCLE (1u << 3)
+
+// After this many failures in a row a backend sits out for the cooldown
+// instead of costing every call a doomed connection attempt.
+#define IOS_BACKEND_TRIP_FAILURES 3
+#define IOS_BACKEND_COOLDOWN_MS 5000
+
+typedef struct {
+    const char* name;
+    unsigned int capabilities;
+    // 0 when the backend can take a call for call->device_id now, opening
+    // its connection if needed; otherwise fills error. Nothing has reached
+    // the device yet, so a failure here falls back to the next backend.
+    int (*prepare)(const IOSBridgeCall* call, char* error, size_t error_size);
+    // NULL for actions the backend does not implement. Sets *lost when the
+    // connection broke during the call; the action may have partly run, so
+    // that result is returned rather than retried elsewhere.
+    char* (*execute)(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost);
+} IOSBackend;
+
+// Runs the action on the first healthy backend of its route that prepares.
+char* ios_backend_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params);
+void ios_backend_init(IOSBridgeImpl* impl);
+
+// The routing engine, in ios_backend_route.c, needs no handle: it works on
+// whatever table and health it is given and hands call through to them.
+//
+// Whether the action addresses an accessibility element rather than screen
+// coordinates or pixels, which only the XCUITest runner can resolve.
+int ios_backend_targets_element(const char* action, const IOSActionParams* params);
+// IOS_BACKEND_* indexes to try in order, ending with -1.
+const int* ios_backend_route(const char* action, const IOSActionParams* params);
+// Skips backends cooling down, falls back past those that fail to prepare
+// and keeps health[i] for table[i]. When none runs the action, returns an
+// error result naming every backend tried and the last reason.
+char* ios_backend_dispatch(const IOSBackend* table, const int* route, IOSBackendHealth* health,
+                           const IOSBridgeCall* call, const char* action, const IOSActionParams* params);
+// Appends one entry of the ios_bridge_get_backends list.
+void ios_backend_append_status(IOSStringBuilder* out, const IOSBackend* backend, IOSBackendHealth* health,
+                               const IOSBridgeCall* call, int probe, int connected);
+
+// Per-backend capability and health:
+// {"backends": [{"name", "capabilities": [...], "connected", "available",
+//  "calls", "failures", "consecutive_failures", "mean_ms", "last_error"}]}
+// With probe set, each backend is prepared first, so "available" is current
+// and a backend sitting out its cooldown is retried; otherwise "available"
+// is only false during a cooldown. Freed with ios_bridge_free_string.
+char* ios_bridge_get_backends(void* bridge, int probe);
+
+// The simctl backend's actions (ios_actions.c) and the XCUITest runner
+// client (ios_runner.c).
+char* ios_simctl_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost);
+int ios_runner_prepare(const IOSBridgeCall* call, char* error, size_t error_size);
+char* ios_runner_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost);
+void ios_runner_disconnect(IOSBridgeImpl* impl);
+
+#endif
@@ -0,0 +1,148 @@
+#include "ios_backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Routing, fallback and health accounting over a backend table. The table
+// is a parameter and nothing here touches a device, so the stub build links
+// this file and tests drive it with backends of their own.
+
+static const char* capability_names[] = {"input", "elements", "capture", "lifecycle"};
+
+// Routes list backends fastest first and end with -1. The runner can play
+// coordinate taps and swipes too, at the cost of a round trip through
+// XCUITest, so it backs up HID for input.
+static const int input_route[] = {IOS_BACKEND_HID, IOS_BACKEND_XCUITEST, -1};
+static const int element_route[] = {IOS_BACKEND_XCUITEST, -1};
+static const int screen_route[] = {IOS_BACKEND_SIMCTL, -1};
+
+// Conditions on elements need the accessibility tree; "idle" and
+// "screen_changed" are answered from pixels.
+static const char* element_conditions[] = {
+    "exists", "not_exists", "hittable", "enabled", "selected", "value_equals", "label_equals",
+};
+
+int ios_backend_targets_element(const char* action, const IOSActionParams* params) {
+    if (strcmp(action, "query_ui") == 0 || strcmp(action, "assert") == 0) return 1;
+    if (strcmp(action, "wait_for") == 0 && params->present & IOS_PARAM_CONDITION) {
+        for (size_t i = 0; i < sizeof(element_conditions) / sizeof(element_conditions[0]); i++) {
+            if (ios_json_equals(params->source, &params->condition, element_conditions[i])) return 1;
+        }
+        return 0;
+    }
+    return (params->present & (IOS_PARAM_IDENTIFIER | IOS_PARAM_LABEL)) != 0;
+}
+
+const int* ios_backend_route(const char* action, const IOSActionParams* params) {
+    if (ios_backend_targets_element(action, params)) return element_route;
+    if (strcmp(action, "tap") == 0 || strcmp(action, "swipe") == 0 || strcmp(action, "touch") == 0 ||
+        strcmp(action, "type_text") == 0) {
+        return input_route;
+    }
+    return screen_route;
+}
+
+static void record_failure(IOSBackendHealth* health, const char* error) {
+    health->failures++;
+    health->consecutive_failures++;
+    snprintf(health->last_error, sizeof(health->last_error), "%s", error);
+    if (health->consecutive_failures >= IOS_BACKEND_TRIP_FAILURES) {
+        health->retry_after_ms = ios_monotonic_ms() + IOS_BACKEND_COOLDOWN_MS;
+    }
+}
+
+static int cooling_down(const IOSBackendHealth* health) {
+    return health->retry_after_ms > ios_monotonic_ms();
+}
+
+static char* unroutable(const IOSBackend* table, const char* action, const int* route, const char* reason) {
+    IOSStringBuilder message;
+    ios_builder_init(&message);
+    ios_builder_appendf(&message, "No backend could run %s (tried", action);
+    for (const int* index = route; *index >= 0; index++) {
+        ios_builder_appendf(&message, "%s%s", index == route ? " " : ", ", table[*index].name);
+    }
+    ios_builder_appendf(&message, "): %s", reason);
+    char* text = ios_builder_finish(&message);
+    if (!text) return strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_append(&result, "{\"success\": false, \"error\": ", 28);
+    ios_builder_append_json_string(&result, text, strlen(text));
+    ios_builder_append(&result, "}", 1);
+    free(text);
+    char* json = ios_builder_finish(&result);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+char* ios_backend_dispatch(const IOSBackend* table, const int* route, IOSBackendHealth* health_table,
+                           const IOSBridgeCall* call, const char* action, const IOSActionParams* params) {
+    char reason[IOS_BACKEND_ERROR_MAX * 2] = "no backend implements it";
+
+    for (const int* index = route; *index >= 0; index++) {
+        const IOSBackend* backend = &table[*index];
+        IOSBackendHealth* health = &health_table[*index];
+        if (cooling_down(health)) {
+            snprintf(reason, sizeof(reason), "%s is cooling down after: %s", backend->name, health->last_error);
+            continue;
+        }
+
+        char error[IOS_BACKEND_ERROR_MAX];
+        double started = ios_monotonic_ms();
+        if (backend->prepare(call, error, sizeof(error)) != 0) {
+            record_failure(health, error);
+            snprintf(reason, sizeof(reason), "%s", error);
+            continue;
+        }
+
+        int lost = 0;
+        char* result = backend->execute(call, action, params, &lost);
+        if (!result) continue;
+        health->calls++;
+        health->total_ms += ios_monotonic_ms() - started;
+        if (lost) {
+            record_failure(health, "Connection lost during the call");
+        } else {
+            health->consecutive_failures = 0;
+            health->retry_after_ms = 0;
+        }
+        return result;
+    }
+    return unroutable(table, action, route, reason);
+}
+
+void ios_backend_append_status(IOSStringBuilder* out, const IOSBackend* backend, IOSBackendHealth* health,
+                               const IOSBridgeCall* call, int probe, int connected) {
+    int available = !cooling_down(health);
+    if (probe) {
+        char error[IOS_BACKEND_ERROR_MAX];
+        available = backend->prepare(call, error, sizeof(error)) == 0;
+        if (available) {
+            health->consecutive_failures = 0;
+            health->retry_after_ms = 0;
+        } else {
+            record_failure(health, error);
+        }
+    }
+    ios_builder_appendf(out, "{\"name\": \"%s\", \"capabilities\": [", backend->name);
+    int listed = 0;
+    for (size_t bit = 0; bit < sizeof(capability_names) / sizeof(capability_names[0]); bit++) {
+        if (!(backend->capabilities & (1u << bit))) continue;
+        ios_builder_appendf(out, "%s\"%s\"", listed++ ? ", " : "", capability_names[bit]);
+    }
+    double mean_ms = health->calls ? health->total_ms / (double)health->calls : 0;
+    ios_builder_appendf(out,
+                        "], \"connected\": %s, \"available\": %s, \"calls\": %llu, \"failures\": %llu, "
+                        "\"consecutive_failures\": %u, \"mean_ms\": %.3f, \"last_error\": ",
+                        connected ? "true" : "false", available ? "true" : "false",
+                        (unsigned long long)health->calls, (unsigned long long)health->failures,
+                        health->consecutive_failures, mean_ms);
+    if (health->last_error[0]) {
+        ios_builder_append_json_string(out, health->last_error, strlen(health->last_error));
+    } else {
+        ios_builder_append(out, "null", 4);
+    }
+    ios_builder_append(out, "}", 1);
+}
@@ -0,0 +1,145 @@
+#include "ios_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Action names are short identifiers; anything longer cannot match one.
+#define IOS_BATCH_ACTION_NAME_MAX 64
+
+static int append_action_result(void* bridge, IOSStringBuilder* out, int index,
+                                const char* json, const IOSJsonToken* tokens, int count, int element,
+                                int* succeeded) {
+    int action_value = ios_json_find(json, tokens, count, element, "action");
+    int params_value = ios_json_find(json, tokens, count, element, "params");
+
+    if (index > 0) ios_builder_append(out, ",", 1);
+    ios_builder_appendf(out, "{\"index\": %d, \"action\": ", index);
+
+    char action[IOS_BATCH_ACTION_NAME_MAX];
+    IOSActionParams params;
+    const char* error = NULL;
+    if (action_value < 0 || tokens[action_value].type != IOS_JSON_STRING) {
+        error = "Missing action name";
+    } else if (ios_json_unescape(json, &tokens[action_value], action, sizeof(action)) < 0) {
+        error = "Invalid action name";
+    } else if (ios_action_params_decode(json, tokens, count, params_value, &params) != 0) {
+        error = "Invalid action params";
+    }
+
+    if (error) {
+        if (action_value >= 0 && tokens[action_value].type == IOS_JSON_STRING) {
+            const IOSJsonToken* name = &tokens[action_value];
+            ios_builder_append(out, "\"", 1);
+            ios_builder_append(out, json + name->start, (size_t)(name->end - name->start));
+            ios_builder_append(out, "\"", 1);
+        } else {
+            ios_builder_append(out, "null", 4);
+        }
+        ios_builder_appendf(out, ", \"success\": false, \"duration_ms\": 0, "
+                            "\"result\": {\"error\": \"%s\"}}", error);
+        *succeeded = 0;
+        return 0;
+    }
+
+    double started = ios_monotonic_ms();
+    char* result = ios_bridge_execute_params(bridge, action, &params);
+    double elapsed = ios_monotonic_ms() - started;
+
+    *succeeded = result && ios_result_succeeded(result);
+    ios_builder_append_json_string(out, action, strlen(action));
+    ios_builder_appendf(out, ", \"success\": %s, \"duration_ms\": %.3f, \"result\": %s}",
+                        *succeeded ? "true" : "false", elapsed,
+                        result ? result : "{\"error\": \"Null result from bridge\"}");
+
+    free(result);
+    return 0;
+}
+
+// Writes the batch result, or an error object for a rejected payload, into
+// out. Returns the number of actions executed, or -1 if rejected.
+static int run_batch_locked(void* bridge, const char* actions_json, IOSStringBuilder* out) {
+    ios_builder_init(out);
+
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(actions_json, strlen(actions_json), &tokens);
+    int actions = count > 0 ? 0 : -1;
+    int stop_on_failure = 0;
+
+    if (actions == 0 && tokens[0].type == IOS_JSON_OBJECT) {
+        actions = ios_json_find(actions_json, tokens, count, 0, "actions");
+        int stop = ios_json_find(actions_json, tokens, count, 0, "stop_on_failure");
+        if (stop >= 0) ios_json_bool(actions_json, &tokens[stop], &stop_on_failure);
+    }
+
+    if (actions < 0 || tokens[actions].type != IOS_JSON_ARRAY) {
+        free(tokens);
+        ios_builder_appendf(out, "{\"success\": false, \"error\": \"Batch requires an actions array\"}");
+        return -1;
+    }
+
+    ios_builder_append(out, "{\"results\": [", 13);
+
+    double started = ios_monotonic_ms();
+    int total = tokens[actions].size;
+    int executed = 0;
+    int all_succeeded = 1;
+    int stopped = 0;
+
+    int element = actions + 1;
+    for (int i = 0; i < total && !stopped; i++) {
+        int succeeded = 0;
+        if (append_action_result(bridge, out, executed, actions_json, tokens, count, element, &succeeded) != 0) break;
+
+        executed++;
+        if (!succeeded) {
+            all_succeeded = 0;
+            if (stop_on_failure) stopped = 1;
+        }
+        element = ios_json_skip(tokens, count, element);
+    }
+    free(tokens);
+
+    ios_builder_appendf(out,
+                        "], \"success\": %s, \"executed\": %d, \"total\": %d, "
+                        "\"stopped_early\": %s, \"total_ms\": %.3f}",
+                        all_succeeded && executed == total ? "true" : "false",
+                        executed, total, stopped ? "true" : "false",
+                        ios_monotonic_ms() - started);
+    return executed;
+}
+
+// The handle stays locked for the whole batch so actions from other threads
+// cannot interleave with it. Without any device the actions still run and
+// each reports the missing device.
+static int run_batch(void* bridge, const char* actions_json, IOSStringBuilder* out) {
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    int executed = run_batch_locked(impl, actions_json, out);
+    if (impl) ios_bridge_unlock(impl);
+    return executed;
+}
+
+int ios_bridge_execute_batch(void* bridge, const char* actions_json, char** results_out) {
+    IOSStringBuilder out;
+    int executed = run_batch(bridge, actions_json, &out);
+
+    *results_out = ios_builder_finish(&out);
+    if (!*results_out) {
+        *results_out = strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+        return -1;
+    }
+    return executed;
+}
+
+int ios_bridge_execute_batch_buffer(void* bridge, const char* actions_json, IOSBridgeBuffer* out) {
+    memset(out, 0, sizeof(*out));
+
+    IOSStringBuilder builder;
+    int executed = run_batch(bridge, actions_json, &builder);
+    size_t length = builder.length;
+
+    char* data = ios_builder_finish(&builder);
+    if (!data) return -1;
+
+    ios_buffer_adopt(out, data, length);
+    return executed;
+}
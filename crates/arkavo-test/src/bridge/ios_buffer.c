@@ -0,0 +1,21 @@
+#include "ios_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void ios_buffer_adopt(IOSBridgeBuffer* buffer, char* data, size_t length) {
+    buffer->data = data;
+    buffer->length = length;
+    buffer->context = data;
+    buffer->release = free;
+}
+
+int ios_bridge_execute_action_buffer(void* bridge, const char* action, const char* params, IOSBridgeBuffer* out) {
+    memset(out, 0, sizeof(*out));
+
+    char* result = ios_bridge_execute_action(bridge, action, params);
+    if (!result) return -1;
+
+    ios_buffer_adopt(out, result, strlen(result));
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "ios_builder.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ios_builder_init(IOSStringBuilder* builder) {
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->failed = 0;
+}
+
+static int builder_reserve(IOSStringBuilder* builder, size_t extra) {
+    if (builder->failed) return -1;
+    if (builder->length + extra + 1 <= builder->capacity) return 0;
+
+    size_t capacity = builder->capacity ? builder->capacity : 256;
+    while (capacity < builder->length + extra + 1) capacity *= 2;
+
+    char* grown = realloc(builder->data, capacity);
+    if (!grown) {
+        builder->failed = 1;
+        return -1;
+    }
+    builder->data = grown;
+    builder->capacity = capacity;
+    return 0;
+}
+
+void ios_builder_append(IOSStringBuilder* builder, const char* data, size_t length) {
+    if (builder_reserve(builder, length) != 0) return;
+    memcpy(builder->data + builder->length, data, length);
+    builder->length += length;
+    builder->data[builder->length] = '\0';
+}
+
+void ios_builder_appendf(IOSStringBuilder* builder, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list measure;
+    va_copy(measure, args);
+    int needed = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+
+    if (needed < 0 || builder_reserve(builder, (size_t)needed) != 0) {
+        builder->failed = 1;
+        va_end(args);
+        return;
+    }
+
+    vsnprintf(builder->data + builder->length, (size_t)needed + 1, format, args);
+    builder->length += (size_t)needed;
+    va_end(args);
+}
+
+void ios_builder_append_json_string(IOSStringBuilder* builder, const char* value, size_t length) {
+    ios_builder_append(builder, "\"", 1);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)value[i];
+        switch (c) {
+            case '"': ios_builder_append(builder, "\\\"", 2); break;
+            case '\\': ios_builder_append(builder, "\\\\", 2); break;
+            case '\n': ios_builder_append(builder, "\\n", 2); break;
+            case '\r': ios_builder_append(builder, "\\r", 2); break;
+            case '\t': ios_builder_append(builder, "\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    ios_builder_appendf(builder, "\\u%04x", c);
+                } else {
+                    ios_builder_append(builder, (const char*)&value[i], 1);
+                }
+        }
+    }
+    ios_builder_append(builder, "\"", 1);
+}
+
+char* ios_builder_finish(IOSStringBuilder* builder) {
+    if (builder->failed) {
+        free(builder->data);
+        ios_builder_init(builder);
+        return NULL;
+    }
+    if (!builder->data) return strdup("");
+
+    char* data = builder->data;
+    ios_builder_init(builder);
+    return data;
+}
+
+char* ios_shell_quote(const char* value) {
+    size_t quotes = 0;
+    for (const char* p = value; *p; p++) {
+        if (*p == '\'') quotes++;
+    }
+
+    size_t length = strlen(value);
+    char* quoted = malloc(length + quotes * 3 + 3);
+    if (!quoted) return NULL;
+
+    char* out = quoted;
+    *out++ = '\'';
+    for (const char* p = value; *p; p++) {
+        if (*p == '\'') {
+            memcpy(out, "'\\''", 4);
+            out += 4;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out++ = '\'';
+    *out = '\0';
+    return quoted;
+}
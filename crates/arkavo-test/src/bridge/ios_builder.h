@@ -0,0 +1,28 @@
+#ifndef ARKAVO_IOS_BUILDER_H
+#define ARKAVO_IOS_BUILDER_H
+
+#include <stddef.h>
+
+// Growable string for building JSON replies. Appends after a failed
+// allocation are dropped and remembered, so callers check once at the end.
+// Kept apart from ios_impl.h because the runner's Objective-C bridge
+// compiles it too, for the shared metrics.
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} IOSStringBuilder;
+
+void ios_builder_init(IOSStringBuilder* builder);
+void ios_builder_append(IOSStringBuilder* builder, const char* data, size_t length);
+void ios_builder_appendf(IOSStringBuilder* builder, const char* format, ...);
+void ios_builder_append_json_string(IOSStringBuilder* builder, const char* value, size_t length);
+// Hands ownership of the built string to the caller, or NULL if any append
+// failed to allocate.
+char* ios_builder_finish(IOSStringBuilder* builder);
+
+// Single-quotes a value for /bin/sh. The caller frees the result.
+char* ios_shell_quote(const char* value);
+
+#endif
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ios_impl.h"
+
+static uint64_t hash_state(const char* state) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)state; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void append_node(IOSStringBuilder* out, const char* fingerprint, const char* state) {
+    ios_builder_append(out, "{\"fingerprint\": ", 16);
+    ios_builder_append_json_string(out, fingerprint, strlen(fingerprint));
+    ios_builder_append(out, ", \"parent\": null", 16);
+
+    // The state is already a JSON object, so its members are spliced in
+    // rather than re-parsed.
+    const char* members = state + 1;
+    while (*members == ' ' || *members == '\n' || *members == '\t') members++;
+    if (*members != '}') ios_builder_append(out, ", ", 2);
+    ios_builder_append(out, members, strlen(members));
+}
+
+static void append_node_list(IOSStringBuilder* out, const char* name, int present,
+                             const char* fingerprint, const char* state) {
+    ios_builder_appendf(out, ", \"%s\": [", name);
+    if (present) append_node(out, fingerprint, state);
+    ios_builder_append(out, "]", 1);
+}
+
+char* ios_delta_advance(IOSDeltaBaseline* baseline, const char* fingerprint, const char* state) {
+    if (!state || state[0] != '{') return strdup("{\"error\": \"Failed to read current state\"}");
+    char* next_fingerprint = strdup(fingerprint);
+    if (!next_fingerprint) return strdup("{\"error\": \"Memory allocation failed\"}");
+
+    uint64_t hash = hash_state(state);
+    int has_baseline = baseline->fingerprint != NULL;
+    int same_node = has_baseline && strcmp(baseline->fingerprint, fingerprint) == 0;
+    int changed = !same_node || hash != baseline->hash;
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_appendf(&out, "{\"state_hash\": \"%016llx\", \"previous_hash\": ", (unsigned long long)hash);
+    if (has_baseline) {
+        ios_builder_appendf(&out, "\"%016llx\"", (unsigned long long)baseline->hash);
+    } else {
+        ios_builder_append(&out, "null", 4);
+    }
+    ios_builder_appendf(&out, ", \"changed\": %s", changed ? "true" : "false");
+
+    append_node_list(&out, "inserted", !same_node, fingerprint, state);
+    ios_builder_append(&out, ", \"removed\": [", 14);
+    if (has_baseline && !same_node) {
+        ios_builder_append_json_string(&out, baseline->fingerprint, strlen(baseline->fingerprint));
+    }
+    ios_builder_append(&out, "]", 1);
+    append_node_list(&out, "updated", same_node && changed, fingerprint, state);
+    ios_builder_append(&out, "}", 1);
+
+    free(baseline->fingerprint);
+    baseline->fingerprint = next_fingerprint;
+    baseline->hash = hash;
+
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"error\": \"Memory allocation failed\"}");
+}
+
+void ios_delta_reset(IOSDeltaBaseline* baseline) {
+    free(baseline->fingerprint);
+    baseline->fingerprint = NULL;
+    baseline->hash = 0;
+}
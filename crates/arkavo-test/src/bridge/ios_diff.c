@@ -0,0 +1,300 @@
+#include "ios_diff.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IOS_DIFF_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IOS_DIFF_SSE2 1
+#endif
+
+#define IOS_DIFF_DEFAULT_TILE 16
+#define IOS_DIFF_DEFAULT_THRESHOLD 16
+#define IOS_DIFF_GRID 8
+#define IOS_DIFF_CELLS (IOS_DIFF_GRID * IOS_DIFF_GRID)
+
+static IOSDiffOptions effective_options(const IOSDiffOptions* options) {
+    IOSDiffOptions effective = {0};
+    if (options) effective = *options;
+    if (effective.tile_size <= 0) effective.tile_size = IOS_DIFF_DEFAULT_TILE;
+    if (effective.pixel_threshold <= 0) effective.pixel_threshold = IOS_DIFF_DEFAULT_THRESHOLD;
+    if (effective.pixel_threshold > 255) effective.pixel_threshold = 255;
+    if (effective.min_changed_pixels <= 0) effective.min_changed_pixels = 1;
+    return effective;
+}
+
+static int valid_frame(const uint8_t* pixels, int bytes_per_row, int width, int height) {
+    return pixels && width > 0 && height > 0 && bytes_per_row / 4 >= width;
+}
+
+// Pixels in a run where some channel, alpha included, moved by at least
+// threshold. The vector paths test four pixels per step: a pixel's 32-bit
+// lane is non-zero exactly when one of its bytes is over.
+static int count_changed(const uint8_t* a, const uint8_t* b, int pixels, int threshold) {
+    int count = 0;
+    int i = 0;
+#if defined(IOS_DIFF_NEON)
+    uint8x16_t limit = vdupq_n_u8((uint8_t)threshold);
+    uint32x4_t total = vdupq_n_u32(0);
+    for (; i + 4 <= pixels; i += 4) {
+        uint8x16_t over = vcgeq_u8(vabdq_u8(vld1q_u8(a + i * 4), vld1q_u8(b + i * 4)), limit);
+        uint32x4_t lanes = vreinterpretq_u32_u8(over);
+        // Changed lanes test as all ones, which subtracts as +1.
+        total = vsubq_u32(total, vtstq_u32(lanes, lanes));
+    }
+    count = (int)vaddvq_u32(total);
+#elif defined(IOS_DIFF_SSE2)
+    __m128i below = _mm_set1_epi8((char)(threshold - 1));
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i * 4));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i * 4));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        __m128i same = _mm_cmpeq_epi32(_mm_subs_epu8(diff, below), zero);
+        count += 4 - __builtin_popcount((unsigned)_mm_movemask_ps(_mm_castsi128_ps(same)));
+    }
+#endif
+    for (; i < pixels; i++) {
+        const uint8_t* pa = a + i * 4;
+        const uint8_t* pb = b + i * 4;
+        for (int c = 0; c < 4; c++) {
+            if (abs(pa[c] - pb[c]) >= threshold) {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+// BT.601 luma in 8-bit fixed point. The weights sum to 256, so white stays
+// 255 and nothing overflows a 16-bit lane.
+static void luma_row(const uint8_t* row, int pixels, uint8_t* out) {
+    int i = 0;
+#if defined(IOS_DIFF_NEON)
+    uint8x8_t wb = vdup_n_u8(29), wg = vdup_n_u8(150), wr = vdup_n_u8(77);
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t bgra = vld4q_u8(row + i * 4);
+        uint16x8_t low = vmull_u8(vget_low_u8(bgra.val[0]), wb);
+        low = vmlal_u8(low, vget_low_u8(bgra.val[1]), wg);
+        low = vmlal_u8(low, vget_low_u8(bgra.val[2]), wr);
+        uint16x8_t high = vmull_u8(vget_high_u8(bgra.val[0]), wb);
+        high = vmlal_u8(high, vget_high_u8(bgra.val[1]), wg);
+        high = vmlal_u8(high, vget_high_u8(bgra.val[2]), wr);
+        vst1q_u8(out + i, vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8)));
+    }
+#endif
+    for (; i < pixels; i++) {
+        const uint8_t* p = row + i * 4;
+        out[i] = (uint8_t)((p[0] * 29 + p[1] * 150 + p[2] * 77) >> 8);
+    }
+}
+
+int ios_diff_tile_count(int width, int height, int tile_size) {
+    if (width <= 0 || height <= 0) return 0;
+    if (tile_size <= 0) tile_size = IOS_DIFF_DEFAULT_TILE;
+    return ((width + tile_size - 1) / tile_size) * ((height + tile_size - 1) / tile_size);
+}
+
+static uint64_t cell_hash(const uint32_t* sums, const uint32_t* counts) {
+    uint32_t averages[IOS_DIFF_CELLS];
+    uint32_t total = 0;
+    int filled = 0;
+    for (int cell = 0; cell < IOS_DIFF_CELLS; cell++) {
+        if (!counts[cell]) continue;
+        averages[cell] = sums[cell] / counts[cell];
+        total += averages[cell];
+        filled++;
+    }
+    if (!filled) return 0;
+
+    // Comparing cell * filled against the total keeps the mean exact.
+    uint64_t hash = 0;
+    for (int cell = 0; cell < IOS_DIFF_CELLS; cell++) {
+        if (counts[cell] && averages[cell] * (uint32_t)filled > total) hash |= 1ULL << cell;
+    }
+    return hash;
+}
+
+int ios_diff_tile_hashes(const uint8_t* pixels, int bytes_per_row, int width, int height, int tile_size,
+                         uint64_t* hashes) {
+    if (!valid_frame(pixels, bytes_per_row, width, height) || !hashes) return IOS_DIFF_INVALID;
+    if (tile_size <= 0) tile_size = IOS_DIFF_DEFAULT_TILE;
+    int columns = (width + tile_size - 1) / tile_size;
+
+    // cell_of maps each x to its tile's first cell plus its grid column, so
+    // the per-pixel work is one add; a band of tile rows accumulates into
+    // sums until its last row, then becomes one row of hashes.
+    uint8_t* luma = malloc((size_t)width);
+    uint32_t* cell_of = malloc(sizeof(uint32_t) * (size_t)width);
+    uint32_t* sums = malloc(sizeof(uint32_t) * IOS_DIFF_CELLS * (size_t)columns);
+    uint32_t* counts = malloc(sizeof(uint32_t) * IOS_DIFF_CELLS * (size_t)columns);
+    if (!luma || !cell_of || !sums || !counts) {
+        free(luma);
+        free(cell_of);
+        free(sums);
+        free(counts);
+        return IOS_DIFF_NO_MEMORY;
+    }
+
+    for (int x = 0; x < width; x++) {
+        int column = x / tile_size;
+        int span = width - column * tile_size < tile_size ? width - column * tile_size : tile_size;
+        int grid_x = (x - column * tile_size) * IOS_DIFF_GRID / span;
+        cell_of[x] = (uint32_t)(column * IOS_DIFF_CELLS + grid_x);
+    }
+
+    for (int band = 0; band * tile_size < height; band++) {
+        int top = band * tile_size;
+        int rows = height - top < tile_size ? height - top : tile_size;
+        memset(sums, 0, sizeof(uint32_t) * IOS_DIFF_CELLS * (size_t)columns);
+        memset(counts, 0, sizeof(uint32_t) * IOS_DIFF_CELLS * (size_t)columns);
+
+        for (int y = 0; y < rows; y++) {
+            luma_row(pixels + (size_t)(top + y) * (size_t)bytes_per_row, width, luma);
+            uint32_t grid_row = (uint32_t)(y * IOS_DIFF_GRID / rows * IOS_DIFF_GRID);
+            for (int x = 0; x < width; x++) {
+                sums[cell_of[x] + grid_row] += luma[x];
+                counts[cell_of[x] + grid_row]++;
+            }
+        }
+        for (int column = 0; column < columns; column++) {
+            hashes[band * columns + column] =
+                cell_hash(sums + column * IOS_DIFF_CELLS, counts + column * IOS_DIFF_CELLS);
+        }
+    }
+
+    free(luma);
+    free(cell_of);
+    free(sums);
+    free(counts);
+    return IOS_DIFF_OK;
+}
+
+int ios_diff_hash_changes(const uint64_t* a, const uint64_t* b, int count, int max_distance,
+                          uint8_t* changed) {
+    if (!a || !b || count < 0) return IOS_DIFF_INVALID;
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        int over = __builtin_popcountll(a[i] ^ b[i]) > max_distance;
+        if (changed) changed[i] = (uint8_t)over;
+        total += over;
+    }
+    return total;
+}
+
+// Groups changed tiles that touch, corners included, so one moved control
+// is one region rather than a box per tile. stack and marked are scratch
+// of one entry per tile; marked doubles as the visited set.
+static int collect_regions(const uint32_t* tile_changes, int columns, int rows, int tile_size, int width,
+                           int height, int min_changed, int* stack, uint8_t* marked, IOSDiffRegion* regions,
+                           int max_regions) {
+    int count = columns * rows;
+    int found = 0;
+    for (int i = 0; i < count; i++) marked[i] = tile_changes[i] >= (uint32_t)min_changed;
+
+    for (int start = 0; start < count; start++) {
+        if (marked[start] != 1) continue;
+        int min_column = start % columns, max_column = min_column;
+        int min_row = start / columns, max_row = min_row;
+        int tiles = 0;
+        int depth = 0;
+        stack[depth++] = start;
+        marked[start] = 2;
+
+        while (depth > 0) {
+            int tile = stack[--depth];
+            int column = tile % columns, row = tile / columns;
+            tiles++;
+            if (column < min_column) min_column = column;
+            if (column > max_column) max_column = column;
+            if (row > max_row) max_row = row;
+            if (row < min_row) min_row = row;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nc = column + dx, nr = row + dy;
+                    if (nc < 0 || nr < 0 || nc >= columns || nr >= rows) continue;
+                    int next = nr * columns + nc;
+                    if (marked[next] != 1) continue;
+                    // Each tile is pushed once, so the stack never outgrows
+                    // the tile count.
+                    marked[next] = 2;
+                    stack[depth++] = next;
+                }
+            }
+        }
+
+        if (found < max_regions) {
+            IOSDiffRegion* region = &regions[found];
+            region->x = min_column * tile_size;
+            region->y = min_row * tile_size;
+            int right = (max_column + 1) * tile_size;
+            int bottom = (max_row + 1) * tile_size;
+            region->width = (right < width ? right : width) - region->x;
+            region->height = (bottom < height ? bottom : height) - region->y;
+            region->changed_tiles = tiles;
+        }
+        found++;
+    }
+    return found;
+}
+
+int ios_diff_frames(const uint8_t* a, int a_bytes_per_row, const uint8_t* b, int b_bytes_per_row,
+                    int width, int height, const IOSDiffOptions* options, IOSDiffRegion* regions,
+                    int max_regions, IOSDiffSummary* summary) {
+    if (!valid_frame(a, a_bytes_per_row, width, height) || !valid_frame(b, b_bytes_per_row, width, height) ||
+        !summary || max_regions < 0 || (max_regions > 0 && !regions)) {
+        return IOS_DIFF_INVALID;
+    }
+    IOSDiffOptions effective = effective_options(options);
+    int tile = effective.tile_size;
+    int columns = (width + tile - 1) / tile;
+    int rows = (height + tile - 1) / tile;
+    int count = columns * rows;
+
+    uint32_t* tile_changes = calloc((size_t)count, sizeof(uint32_t));
+    int* stack = malloc(sizeof(int) * (size_t)count);
+    uint8_t* marked = malloc((size_t)count);
+    if (!tile_changes || !stack || !marked) {
+        free(tile_changes);
+        free(stack);
+        free(marked);
+        return IOS_DIFF_NO_MEMORY;
+    }
+
+    // Rows are compared in order, each read once, so both frames stream
+    // through the cache instead of being walked tile by tile.
+    uint64_t changed_pixels = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row_a = a + (size_t)y * (size_t)a_bytes_per_row;
+        const uint8_t* row_b = b + (size_t)y * (size_t)b_bytes_per_row;
+        uint32_t* changes = tile_changes + (y / tile) * columns;
+        for (int column = 0; column < columns; column++) {
+            int x = column * tile;
+            int span = width - x < tile ? width - x : tile;
+            int changed = count_changed(row_a + (size_t)x * 4, row_b + (size_t)x * 4, span,
+                                        effective.pixel_threshold);
+            changes[column] += (uint32_t)changed;
+            changed_pixels += (uint64_t)changed;
+        }
+    }
+
+    int changed_tiles = 0;
+    for (int i = 0; i < count; i++) changed_tiles += tile_changes[i] >= (uint32_t)effective.min_changed_pixels;
+
+    summary->changed_tiles = changed_tiles;
+    summary->total_tiles = count;
+    summary->changed_pixels = changed_pixels;
+    summary->region_count = changed_tiles ? collect_regions(tile_changes, columns, rows, tile, width, height,
+                                                            effective.min_changed_pixels, stack, marked,
+                                                            regions, max_regions)
+                                          : 0;
+
+    free(tile_changes);
+    free(stack);
+    free(marked);
+    return IOS_DIFF_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef ARKAVO_IOS_DIFF_H
+#define ARKAVO_IOS_DIFF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Comparison kernel for raw 8-bit BGRA frames, the layout ios_frame.c
+// captures into. It has no simulator dependency, so it builds on every
+// platform and works on frames from any source of the same layout.
+
+#define IOS_DIFF_OK 0
+#define IOS_DIFF_INVALID -1
+#define IOS_DIFF_NO_MEMORY -2
+
+// Zero or negative fields fall back to defaults: 16-pixel tiles, a pixel
+// changing once any channel moves by at least 16, and any changed pixel
+// marking its tile. A threshold of 1 counts every change.
+typedef struct {
+    int tile_size;
+    int pixel_threshold;
+    int min_changed_pixels;
+} IOSDiffOptions;
+
+// Bounding box of one group of touching changed tiles, in pixels, clipped
+// to the frame.
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+    int changed_tiles;
+} IOSDiffRegion;
+
+typedef struct {
+    int changed_tiles;
+    int total_tiles;
+    uint64_t changed_pixels;
+    // Regions found; more than max_regions when some did not fit.
+    int region_count;
+} IOSDiffSummary;
+
+// Compares two frames of the same size, tile by tile, writing up to
+// max_regions regions in row-major order of their first tile. Returns an
+// IOS_DIFF_* code.
+int ios_diff_frames(const uint8_t* a, int a_bytes_per_row, const uint8_t* b, int b_bytes_per_row,
+                    int width, int height, const IOSDiffOptions* options, IOSDiffRegion* regions,
+                    int max_regions, IOSDiffSummary* summary);
+
+// Tiles in a width x height frame, or 0 when either is not positive.
+int ios_diff_tile_count(int width, int height, int tile_size);
+
+// One 64-bit average hash per tile: the tile's luma on an 8x8 grid, one bit
+// per cell brighter than the tile's mean. Similar tiles have hashes a few
+// bits apart, so re-rendering and compression noise do not read as change.
+// hashes holds ios_diff_tile_count(width, height, tile_size) entries.
+int ios_diff_tile_hashes(const uint8_t* pixels, int bytes_per_row, int width, int height, int tile_size,
+                         uint64_t* hashes);
+
+// Tiles whose hashes differ in more than max_distance bits. changed, when
+// not NULL, receives 1 or 0 per tile.
+int ios_diff_hash_changes(const uint64_t* a, const uint64_t* b, int count, int max_distance,
+                          uint8_t* changed);
+
+#endif
@@ -1,7 +1,8 @@
+use crate::execution::snapshot_store::{Blob, SnapshotStore};
 use crate::{Result, TestError};
 use std::collections::HashMap;
 use std::ffi::{CStr, CString};
-use std::os::raw::{c_char, c_void};
+use std::os::raw::{c_char, c_int, c_void};
 
 #[repr(C)]
 pub struct IOSBridge {
@@ -11,21 +12,76 @@ pub struct IOSBridge {
 #[derive(Debug)]
 pub struct RustTestHarness {
     bridge: Option<*mut IOSBridge>,
-    snapshots: HashMap<String, Vec<u8>>,
+    owns_bridge: bool,
+    snapshots: HashMap<String, Blob>,
+    store: SnapshotStore,
 }
 
 impl RustTestHarness {
     pub fn new() -> Self {
         Self {
             bridge: None,
+            owns_bridge: false,
             snapshots: HashMap::new(),
+            store: SnapshotStore::shared(),
         }
     }
 
     pub fn connect_ios_bridge(&mut self, bridge: *mut IOSBridge) {
+        self.disconnect();
         self.bridge = Some(bridge);
     }
 
+    /// Create a bridge owned by this harness. The native side keeps a resident
+    /// device-control worker for the lifetime of the handle, so repeated actions
+    /// avoid per-call process startup. Without a device id the first booted
+    /// simulator is used.
+    pub fn connect_simulator(&mut self, device_id: Option<&str>, bundle_id: &str) -> Result<()> {
+        let device_cstr = device_id
+            .map(CString::new)
+            .transpose()
+            .map_err(|e| TestError::Bridge(format!("Invalid device id: {}", e)))?;
+        let bundle_cstr = CString::new(bundle_id)
+            .map_err(|e| TestError::Bridge(format!("Invalid bundle id: {}", e)))?;
+
+        let bridge = unsafe {
+            ios_bridge_create(
+                device_cstr
+                    .as_ref()
+                    .map_or(std::ptr::null(), |device| device.as_ptr()),
+                bundle_cstr.as_ptr(),
+            )
+        };
+
+        if bridge.is_null() {
+            return Err(TestError::Bridge(
+                "Failed to create iOS bridge - no simulator specified or booted".to_string(),
+            ));
+        }
+
+        self.disconnect();
+        self.bridge = Some(bridge);
+        self.owns_bridge = true;
+        Ok(())
+    }
+
+    pub fn is_connected(&self) -> bool {
+        self.bridge.is_some()
+    }
+
+    pub(crate) fn raw_bridge(&self) -> Option<*mut IOSBridge> {
+        self.bridge
+    }
+
+    pub fn disconnect(&mut self) {
+        if let Some(bridge) = self.bridge.take() {
+            if self.owns_bridge {
+                unsafe { ios_bridge_destroy(bridge) };
+            }
+        }
+        self.owns_bridge = false;
+    }
+
     pub fn execute_action(&self, action: &str, params: &str) -> Result<String> {
         if self.bridge.is_none() {
             return Ok(serde_json::json!({
@@ -42,29 +98,8 @@ impl RustTestHarness {
             .to_string());
         }
 
-        let action_cstr = CString::new(action)
-            .map_err(|e| TestError::Bridge(format!("Invalid action string: {}", e)))?;
-        let params_cstr = CString::new(params)
-            .map_err(|e| TestError::Bridge(format!("Invalid params string: {}", e)))?;
-
-        unsafe {
-            let result_ptr = ios_bridge_execute_action(
-                self.bridge.unwrap(),
-                action_cstr.as_ptr(),
-                params_cstr.as_ptr(),
-            );
-
-            if result_ptr.is_null() {
-                return Err(TestError::Bridge("Null result from iOS bridge".to_string()));
-            }
-
-            let result_cstr = CStr::from_ptr(result_ptr);
-            let result = result_cstr.to_string_lossy().to_string();
-
-            ios_bridge_free_string(result_ptr);
-
-            Ok(result)
-        }
+        let result = self.execute_action_buffer(action, params)?;
+        Ok(String::from_utf8_lossy(result.as_bytes()).into_owned())
     }
 
     pub fn get_current_state(&self) -> Result<String> {
@@ -143,7 +178,9 @@ impl RustTestHarness {
 
     pub fn checkpoint(&mut self, name: &str) -> Result<()> {
         let snapshot = self.create_snapshot()?;
-        self.snapshots.insert(name.to_string(), snapshot);
+        if let Some(replaced) = self.snapshots.insert(name.to_string(), snapshot) {
+            self.release_snapshot(&replaced);
+        }
         Ok(())
     }
 
@@ -152,7 +189,7 @@ impl RustTestHarness {
             .snapshots
             .get(name)
             .ok_or_else(|| TestError::Bridge(format!("Snapshot not found: {}", name)))?
-            .clone();
+            .read()?;
 
         self.restore_snapshot(&snapshot)?;
         Ok(())
@@ -169,25 +206,12 @@ impl RustTestHarness {
         Ok(())
     }
 
-    fn create_snapshot(&self) -> Result<Vec<u8>> {
+    fn create_snapshot(&self) -> Result<Blob> {
         if self.bridge.is_none() {
-            return Ok(vec![]);
+            return self.store.put(&[]);
         }
 
-        unsafe {
-            let mut size: usize = 0;
-            let snapshot_ptr = ios_bridge_create_snapshot(self.bridge.unwrap(), &mut size);
-
-            if snapshot_ptr.is_null() {
-                return Err(TestError::Bridge("Failed to create snapshot".to_string()));
-            }
-
-            let snapshot = std::slice::from_raw_parts(snapshot_ptr as *const u8, size).to_vec();
-
-            ios_bridge_free_data(snapshot_ptr);
-
-            Ok(snapshot)
-        }
+        self.store.put(&self.snapshot_bytes()?)
     }
 
     fn restore_snapshot(&self, data: &[u8]) -> Result<()> {
@@ -195,24 +219,45 @@ impl RustTestHarness {
             return Ok(());
         }
 
-        unsafe {
+        let status = unsafe {
             ios_bridge_restore_snapshot(
                 self.bridge.unwrap(),
                 data.as_ptr() as *const c_void,
                 data.len(),
-            );
+            )
+        };
+        if status != 0 {
+            return Err(TestError::Bridge(
+                "Failed to restore the app's data container".to_string(),
+            ));
         }
 
         Ok(())
     }
+
+    /// Native snapshots keep a clone of the app's data on disk. Branches
+    /// share their parent's blob, so a clone is only deleted once no
+    /// remaining snapshot refers to it.
+    fn release_snapshot(&self, snapshot: &Blob) {
+        let Some(bridge) = self.bridge else {
+            return;
+        };
+        if snapshot.is_empty() || self.snapshots.values().any(|other| other == snapshot) {
+            return;
+        }
+        let Ok(data) = snapshot.read() else {
+            return;
+        };
+        unsafe {
+            ios_bridge_delete_snapshot(bridge, data.as_ptr() as *const c_void, data.len());
+        }
+    }
 }
 
 unsafe extern "C" {
-    fn ios_bridge_execute_action(
-        bridge: *mut IOSBridge,
-        action: *const c_char,
-        params: *const c_char,
-    ) -> *mut c_char;
+    fn ios_bridge_create(device_id: *const c_char, bundle_id: *const c_char) -> *mut IOSBridge;
+
+    fn ios_bridge_destroy(bridge: *mut IOSBridge);
 
     fn ios_bridge_get_current_state(bridge: *mut IOSBridge) -> *mut c_char;
 
@@ -223,13 +268,19 @@ unsafe extern "C" {
         data: *const c_char,
     ) -> *mut c_char;
 
-    fn ios_bridge_create_snapshot(bridge: *mut IOSBridge, size: *mut usize) -> *mut c_void;
+    fn ios_bridge_restore_snapshot(
+        bridge: *mut IOSBridge,
+        data: *const c_void,
+        size: usize,
+    ) -> c_int;
 
-    fn ios_bridge_restore_snapshot(bridge: *mut IOSBridge, data: *const c_void, size: usize);
+    fn ios_bridge_delete_snapshot(
+        bridge: *mut IOSBridge,
+        data: *const c_void,
+        size: usize,
+    ) -> c_int;
 
     fn ios_bridge_free_string(s: *mut c_char);
-
-    fn ios_bridge_free_data(data: *mut c_void);
 }
 
 impl Default for RustTestHarness {
@@ -238,5 +289,21 @@ impl Default for RustTestHarness {
     }
 }
 
+impl Drop for RustTestHarness {
+    fn drop(&mut self) {
+        let snapshots: Vec<Blob> = std::mem::take(&mut self.snapshots).into_values().collect();
+        for (index, snapshot) in snapshots.iter().enumerate() {
+            if !snapshots[..index].contains(snapshot) {
+                self.release_snapshot(snapshot);
+            }
+        }
+        self.disconnect();
+    }
+}
+
+// Native handles lock themselves for the duration of every call and take
+// per-call device overrides without mutating shared state, while the XCUITest
+// bridge marshals onto the main thread. Shared references can therefore call
+// into the same bridge from several threads at once.
 unsafe impl Send for RustTestHarness {}
 unsafe impl Sync for RustTestHarness {}
@@ -0,0 +1,212 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use crate::{Result, TestError};
+use std::ffi::{CStr, CString};
+use std::future::Future;
+use std::os::raw::{c_char, c_void};
+use std::pin::Pin;
+use std::task::{Context, Poll};
+use tokio::sync::oneshot;
+
+type Completion = extern "C" fn(context: *mut c_void, request_id: u64, result: *mut c_char);
+
+/// An action running on the bridge's executor. Awaiting it parks the task
+/// rather than a runtime thread. Dropping it does not cancel the action; the
+/// result is simply discarded.
+pub struct PendingAction {
+    id: u64,
+    receiver: oneshot::Receiver<Result<String>>,
+}
+
+impl PendingAction {
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+}
+
+impl Future for PendingAction {
+    type Output = Result<String>;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        Pin::new(&mut self.receiver).poll(cx).map(|received| {
+            received.unwrap_or_else(|_| {
+                Err(TestError::Bridge(
+                    "Bridge dropped the action without completing it".to_string(),
+                ))
+            })
+        })
+    }
+}
+
+extern "C" fn complete(context: *mut c_void, _request_id: u64, result: *mut c_char) {
+    let sender = unsafe { Box::from_raw(context as *mut oneshot::Sender<Result<String>>) };
+    let reply = if result.is_null() {
+        Err(TestError::Bridge("Null result from iOS bridge".to_string()))
+    } else {
+        let text = unsafe { CStr::from_ptr(result) }
+            .to_string_lossy()
+            .into_owned();
+        unsafe { ios_bridge_free_string(result) };
+        Ok(text)
+    };
+    let _ = sender.send(reply);
+}
+
+impl RustTestHarness {
+    /// Queue an action and return immediately. Actions on one bridge run in
+    /// submission order, except plain `wait`s, which complete on a timer
+    /// without holding up the actions submitted after them.
+    pub fn submit_action(&self, action: &str, params: &str) -> Result<PendingAction> {
+        let bridge = self.connected_bridge()?;
+        let action = CString::new(action)
+            .map_err(|_| TestError::Bridge("Action contains a NUL byte".to_string()))?;
+        let params = CString::new(params)
+            .map_err(|_| TestError::Bridge("Params contain a NUL byte".to_string()))?;
+
+        let (sender, receiver) = oneshot::channel();
+        let context = Box::into_raw(Box::new(sender)) as *mut c_void;
+        let id = unsafe {
+            ios_bridge_submit_action(bridge, action.as_ptr(), params.as_ptr(), complete, context)
+        };
+        if id == 0 {
+            // Rejected requests never reach the completion, so the sender is
+            // reclaimed here.
+            drop(unsafe { Box::from_raw(context as *mut oneshot::Sender<Result<String>>) });
+            return Err(TestError::Bridge(format!(
+                "Bridge rejected action {}",
+                action.to_string_lossy()
+            )));
+        }
+        Ok(PendingAction { id, receiver })
+    }
+
+    pub async fn execute_action_async(&self, action: &str, params: &str) -> Result<String> {
+        self.submit_action(action, params)?.await
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_submit_action(
+        bridge: *mut IOSBridge,
+        action: *const c_char,
+        params: *const c_char,
+        completion: Completion,
+        context: *mut c_void,
+    ) -> u64;
+    fn ios_bridge_free_string(s: *mut c_char);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn submitting_requires_a_bridge() {
+        assert!(RustTestHarness::new().submit_action("tap", "{}").is_err());
+    }
+
+    // The stub build links the real executor, on a handle with no device
+    // behind it that echoes each action's name back.
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    mod executor {
+        use super::*;
+        use std::time::{Duration, Instant};
+        use tokio::sync::oneshot::error::TryRecvError;
+
+        unsafe extern "C" {
+            fn ios_stub_bridge_create() -> *mut IOSBridge;
+            fn ios_stub_bridge_destroy(bridge: *mut IOSBridge);
+        }
+
+        struct StubBridge {
+            harness: RustTestHarness,
+            bridge: *mut IOSBridge,
+        }
+
+        impl StubBridge {
+            fn new() -> Self {
+                let bridge = unsafe { ios_stub_bridge_create() };
+                assert!(!bridge.is_null());
+                let mut harness = RustTestHarness::new();
+                harness.connect_ios_bridge(bridge);
+                StubBridge { harness, bridge }
+            }
+        }
+
+        impl Drop for StubBridge {
+            fn drop(&mut self) {
+                self.harness.disconnect();
+                unsafe { ios_stub_bridge_destroy(self.bridge) };
+            }
+        }
+
+        #[tokio::test]
+        async fn actions_complete_in_submission_order() {
+            let stub = StubBridge::new();
+            let mut pending: Vec<PendingAction> = ["tap", "swipe", "type_text", "touch"]
+                .iter()
+                .map(|action| stub.harness.submit_action(action, "{}").unwrap())
+                .collect();
+
+            // Ids are process-wide, so other tests' requests may fall between
+            // these, but never out of order.
+            assert!(pending.windows(2).all(|pair| pair[0].id() < pair[1].id()));
+
+            let last = pending.pop().unwrap().await.unwrap();
+            assert!(last.contains(r#""action": "touch""#));
+            for (earlier, action) in pending.iter_mut().zip(["tap", "swipe", "type_text"]) {
+                let reply = earlier.receiver.try_recv().unwrap().unwrap();
+                assert!(reply.contains(&format!(r#""action": "{action}""#)));
+            }
+        }
+
+        #[tokio::test]
+        async fn plain_wait_completes_after_later_actions() {
+            let stub = StubBridge::new();
+            let started = Instant::now();
+            let mut wait = stub
+                .harness
+                .submit_action("wait", r#"{"duration": 0.2}"#)
+                .unwrap();
+            let tap = stub.harness.submit_action("tap", "{}").unwrap();
+
+            assert!(tap.await.unwrap().contains(r#""action": "tap""#));
+            assert!(matches!(wait.receiver.try_recv(), Err(TryRecvError::Empty)));
+
+            let reply = (&mut wait).await.unwrap();
+            assert!(started.elapsed() >= Duration::from_millis(200));
+            assert!(reply.contains(r#""duration": 0.200"#));
+        }
+
+        #[tokio::test]
+        async fn destroying_the_bridge_fails_actions_still_waiting() {
+            let mut stub = StubBridge::new();
+            let wait = stub
+                .harness
+                .submit_action("wait", r#"{"duration": 30}"#)
+                .unwrap();
+            let started = Instant::now();
+            stub.harness.disconnect();
+            unsafe { ios_stub_bridge_destroy(stub.bridge) };
+            stub.bridge = std::ptr::null_mut();
+
+            let reply = wait.await.unwrap();
+            assert!(reply.contains("Bridge was destroyed before the action ran"));
+            assert!(started.elapsed() < Duration::from_secs(5));
+        }
+
+        #[tokio::test]
+        async fn bad_requests_are_answered_without_running() {
+            let stub = StubBridge::new();
+            let reply = stub
+                .harness
+                .execute_action_async("tap", "[1,")
+                .await
+                .unwrap();
+            assert!(reply.contains("Invalid action params"));
+
+            let long_name = "a".repeat(64);
+            assert!(stub.harness.submit_action(&long_name, "{}").is_err());
+            assert!(stub.harness.submit_action("tap\0", "{}").is_err());
+        }
+    }
+}
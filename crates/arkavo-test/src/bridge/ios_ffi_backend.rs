@@ -0,0 +1,501 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::Result;
+use serde::Deserialize;
+use std::os::raw::{c_char, c_int};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum BackendCapability {
+    /// Taps, swipes, touches and typing at screen coordinates.
+    Input,
+    /// Queries, waits and input that address accessibility elements.
+    Elements,
+    /// Screenshots and screen-change waits.
+    Capture,
+    /// App and simulator launch and shutdown.
+    Lifecycle,
+    #[serde(other)]
+    Unknown,
+}
+
+/// One native backend of a bridge handle: "hid", "xcuitest" or "simctl".
+/// Each action goes to the first healthy backend of its route, so these
+/// show which one is doing the work and why another was passed over.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct BackendStatus {
+    pub name: String,
+    pub capabilities: Vec<BackendCapability>,
+    pub connected: bool,
+    /// False while the backend sits out a cooldown after repeated failures.
+    pub available: bool,
+    pub calls: u64,
+    pub failures: u64,
+    pub consecutive_failures: u32,
+    pub mean_ms: f64,
+    pub last_error: Option<String>,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+struct BackendReport {
+    backends: Vec<BackendStatus>,
+}
+
+impl RustTestHarness {
+    /// Capability and health of every backend. With `probe`, each one is
+    /// connected first, so `available` is current rather than last known.
+    pub fn backends(&self, probe: bool) -> Result<Vec<BackendStatus>> {
+        let bridge = self.connected_bridge()?;
+        let report: BackendReport = unsafe {
+            take_reply(
+                ios_bridge_get_backends(bridge, c_int::from(probe)),
+                "backend report",
+            )?
+        };
+        Ok(report.backends)
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_get_backends(bridge: *mut IOSBridge, probe: c_int) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::cell::RefCell;
+    use std::ffi::{CStr, CString};
+    use std::os::raw::c_void;
+    use std::ptr;
+
+    #[repr(C)]
+    #[derive(Clone, Copy, Default)]
+    struct JsonToken {
+        kind: c_int,
+        start: c_int,
+        end: c_int,
+        size: c_int,
+        parent: c_int,
+    }
+
+    #[repr(C)]
+    struct ActionParams {
+        present: u32,
+        numbers: [f64; 10],
+        source: *const c_char,
+        tokens: [JsonToken; 9],
+    }
+
+    #[repr(C)]
+    #[derive(Clone, Copy)]
+    struct Health {
+        calls: u64,
+        failures: u64,
+        consecutive_failures: u32,
+        total_ms: f64,
+        retry_after_ms: f64,
+        last_error: [c_char; 256],
+    }
+
+    impl Default for Health {
+        fn default() -> Self {
+            Health {
+                calls: 0,
+                failures: 0,
+                consecutive_failures: 0,
+                total_ms: 0.0,
+                retry_after_ms: 0.0,
+                last_error: [0; 256],
+            }
+        }
+    }
+
+    impl Health {
+        fn last_error(&self) -> String {
+            unsafe { CStr::from_ptr(self.last_error.as_ptr()) }
+                .to_string_lossy()
+                .into_owned()
+        }
+    }
+
+    type PrepareFn = extern "C" fn(*const c_void, *mut c_char, usize) -> c_int;
+    type ExecuteFn =
+        extern "C" fn(*const c_void, *const c_char, *const ActionParams, *mut c_int) -> *mut c_char;
+
+    #[repr(C)]
+    struct Backend {
+        name: *const c_char,
+        capabilities: u32,
+        prepare: PrepareFn,
+        execute: ExecuteFn,
+    }
+
+    #[repr(C)]
+    struct StringBuilder {
+        data: *mut c_char,
+        length: usize,
+        capacity: usize,
+        failed: c_int,
+    }
+
+    unsafe extern "C" {
+        fn ios_action_params_parse(json: *const c_char, params: *mut ActionParams) -> c_int;
+        fn ios_backend_route(action: *const c_char, params: *const ActionParams) -> *const c_int;
+        fn ios_backend_dispatch(
+            table: *const Backend,
+            route: *const c_int,
+            health: *mut Health,
+            call: *const c_void,
+            action: *const c_char,
+            params: *const ActionParams,
+        ) -> *mut c_char;
+        fn ios_backend_append_status(
+            out: *mut StringBuilder,
+            backend: *const Backend,
+            health: *mut Health,
+            call: *const c_void,
+            probe: c_int,
+            connected: c_int,
+        );
+        fn ios_action_params_string(
+            params: *const ActionParams,
+            member: *const JsonToken,
+        ) -> *mut c_char;
+        fn ios_bridge_free_string(value: *mut c_char);
+        fn ios_builder_init(builder: *mut StringBuilder);
+        fn ios_builder_finish(builder: *mut StringBuilder) -> *mut c_char;
+        fn strdup(value: *const c_char) -> *mut c_char;
+    }
+
+    const HID: usize = 0;
+    const XCUITEST: usize = 1;
+    const SIMCTL: usize = 2;
+    const TRIP_FAILURES: usize = 3;
+
+    /// What each fake backend does on its next call. The router runs the
+    /// backends on the calling thread, so every test scripts its own.
+    #[derive(Default)]
+    struct Script {
+        prepare_error: [Option<&'static str>; 3],
+        unimplemented: [bool; 3],
+        lost: [bool; 3],
+        prepared: Vec<usize>,
+        executed: Vec<usize>,
+    }
+
+    thread_local! {
+        static SCRIPT: RefCell<Script> = RefCell::new(Script::default());
+    }
+
+    fn script(edit: impl FnOnce(&mut Script)) {
+        SCRIPT.with(|script| edit(&mut script.borrow_mut()));
+    }
+
+    extern "C" fn fake_prepare<const N: usize>(
+        _call: *const c_void,
+        error: *mut c_char,
+        error_size: usize,
+    ) -> c_int {
+        let failure = SCRIPT.with(|script| {
+            let mut script = script.borrow_mut();
+            script.prepared.push(N);
+            script.prepare_error[N]
+        });
+        let Some(message) = failure else { return 0 };
+        let length = message.len().min(error_size - 1);
+        unsafe {
+            ptr::copy_nonoverlapping(message.as_ptr().cast(), error, length);
+            *error.add(length) = 0;
+        }
+        -1
+    }
+
+    extern "C" fn fake_execute<const N: usize>(
+        _call: *const c_void,
+        _action: *const c_char,
+        _params: *const ActionParams,
+        lost: *mut c_int,
+    ) -> *mut c_char {
+        let (unimplemented, dropped) = SCRIPT.with(|script| {
+            let mut script = script.borrow_mut();
+            script.executed.push(N);
+            (script.unimplemented[N], script.lost[N])
+        });
+        if unimplemented {
+            return ptr::null_mut();
+        }
+        unsafe { *lost = c_int::from(dropped) };
+        let reply = CString::new(format!(r#"{{"served_by": {N}}}"#)).unwrap();
+        unsafe { strdup(reply.as_ptr()) }
+    }
+
+    const NAMES: [&CStr; 3] = [c"hid", c"xcuitest", c"simctl"];
+
+    fn table() -> [Backend; 3] {
+        let entry =
+            |index: usize, capabilities: u32, prepare: PrepareFn, execute: ExecuteFn| Backend {
+                name: NAMES[index].as_ptr(),
+                capabilities,
+                prepare,
+                execute,
+            };
+        [
+            entry(HID, 1, fake_prepare::<0>, fake_execute::<0>),
+            entry(XCUITEST, 1 | 2, fake_prepare::<1>, fake_execute::<1>),
+            entry(SIMCTL, 4 | 8, fake_prepare::<2>, fake_execute::<2>),
+        ]
+    }
+
+    /// Parses params the way the bridge does and runs action through the
+    /// real router, returning the reply.
+    fn dispatch(health: &mut [Health; 3], action: &str, params: &str) -> serde_json::Value {
+        let action = CString::new(action).unwrap();
+        let params_json = CString::new(params).unwrap();
+        let mut params = ActionParams {
+            present: 0,
+            numbers: [0.0; 10],
+            source: ptr::null(),
+            tokens: [JsonToken::default(); 9],
+        };
+        let table = table();
+        unsafe {
+            assert_eq!(
+                ios_action_params_parse(params_json.as_ptr(), &mut params),
+                0
+            );
+            let route = ios_backend_route(action.as_ptr(), &params);
+            let reply = ios_backend_dispatch(
+                table.as_ptr(),
+                route,
+                health.as_mut_ptr(),
+                ptr::null(),
+                action.as_ptr(),
+                &params,
+            );
+            take_reply(reply, "dispatch reply").unwrap()
+        }
+    }
+
+    fn executed() -> Vec<usize> {
+        SCRIPT.with(|script| std::mem::take(&mut script.borrow_mut().executed))
+    }
+
+    fn status(health: &mut Health, index: usize, probe: bool) -> BackendStatus {
+        let table = table();
+        let mut out = StringBuilder {
+            data: ptr::null_mut(),
+            length: 0,
+            capacity: 0,
+            failed: 0,
+        };
+        unsafe {
+            ios_builder_init(&mut out);
+            ios_backend_append_status(
+                &mut out,
+                &table[index],
+                health,
+                ptr::null(),
+                c_int::from(probe),
+                1,
+            );
+            take_reply(ios_builder_finish(&mut out), "backend status").unwrap()
+        }
+    }
+
+    #[test]
+    fn actions_route_by_what_they_address() {
+        let mut health = [Health::default(); 3];
+        let cases = [
+            ("tap", r#"{"x": 10, "y": 20}"#, HID),
+            ("type_text", r#"{"text": "hi"}"#, HID),
+            ("tap", r#"{"identifier": "login"}"#, XCUITEST),
+            ("swipe", r#"{"label": "Next"}"#, XCUITEST),
+            ("query_ui", "{}", XCUITEST),
+            (
+                "wait_for",
+                r#"{"condition": "exists", "identifier": "x"}"#,
+                XCUITEST,
+            ),
+            ("wait_for", r#"{"condition": "idle"}"#, SIMCTL),
+            ("screenshot", "{}", SIMCTL),
+        ];
+        for (action, params, backend) in cases {
+            let reply = dispatch(&mut health, action, params);
+            assert_eq!(reply["served_by"], backend, "{action} {params}");
+            assert_eq!(executed(), vec![backend], "{action} {params}");
+        }
+        assert_eq!(health[HID].calls, 2);
+        assert_eq!(health[XCUITEST].calls, 4);
+        assert_eq!(health[SIMCTL].calls, 2);
+        assert!(health.iter().all(|backend| backend.failures == 0));
+    }
+
+    #[test]
+    fn input_falls_back_to_the_runner_when_hid_cannot_prepare() {
+        let mut health = [Health::default(); 3];
+        script(|script| script.prepare_error[HID] = Some("HID connection refused"));
+        let reply = dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        assert_eq!(reply["served_by"], XCUITEST);
+        // HID never ran: a failed prepare reaches nothing on the device.
+        assert_eq!(executed(), vec![XCUITEST]);
+        assert_eq!(health[HID].calls, 0);
+        assert_eq!(health[HID].failures, 1);
+        assert_eq!(health[HID].consecutive_failures, 1);
+        assert_eq!(health[HID].last_error(), "HID connection refused");
+        assert_eq!(health[HID].retry_after_ms, 0.0);
+        assert_eq!(health[XCUITEST].calls, 1);
+    }
+
+    #[test]
+    fn repeated_failures_bench_a_backend_until_it_succeeds_again() {
+        let mut health = [Health::default(); 3];
+        script(|script| script.prepare_error[HID] = Some("HID down"));
+        for _ in 0..TRIP_FAILURES {
+            dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        }
+        assert!(health[HID].retry_after_ms > 0.0);
+
+        // Benched, HID is not even prepared although it would now succeed.
+        script(|script| {
+            script.prepare_error[HID] = None;
+            script.prepared.clear();
+        });
+        executed();
+        let reply = dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        assert_eq!(reply["served_by"], XCUITEST);
+        SCRIPT.with(|script| assert_eq!(script.borrow().prepared, vec![XCUITEST]));
+
+        // Once the cooldown is over, one success clears the streak.
+        health[HID].retry_after_ms = 0.0;
+        let reply = dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        assert_eq!(reply["served_by"], HID);
+        assert_eq!(health[HID].consecutive_failures, 0);
+        assert_eq!(health[HID].failures, TRIP_FAILURES as u64);
+    }
+
+    #[test]
+    fn a_lost_connection_keeps_the_result_and_counts_a_failure() {
+        let mut health = [Health::default(); 3];
+        script(|script| script.lost[HID] = true);
+        let reply = dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        // The tap may have landed, so it is not replayed on the runner.
+        assert_eq!(reply["served_by"], HID);
+        assert_eq!(executed(), vec![HID]);
+        assert_eq!(health[HID].calls, 1);
+        assert_eq!(health[HID].failures, 1);
+        assert_eq!(health[HID].last_error(), "Connection lost during the call");
+    }
+
+    #[test]
+    fn unroutable_actions_name_every_backend_tried() {
+        let mut health = [Health::default(); 3];
+        script(|script| {
+            script.prepare_error[HID] = Some("HID down");
+            script.prepare_error[XCUITEST] = Some("Runner not installed");
+        });
+        let reply = dispatch(&mut health, "tap", r#"{"x": 1, "y": 2}"#);
+        assert_eq!(reply["success"], false);
+        assert_eq!(
+            reply["error"],
+            "No backend could run tap (tried hid, xcuitest): Runner not installed"
+        );
+
+        // A backend that prepares but lacks the action passes it on.
+        script(|script| script.unimplemented[SIMCTL] = true);
+        let reply = dispatch(&mut health, "rotate", "{}");
+        assert_eq!(
+            reply["error"],
+            "No backend could run rotate (tried simctl): no backend implements it"
+        );
+        assert_eq!(health[SIMCTL].failures, 0);
+
+        // A benched backend reports why it was benched.
+        health[XCUITEST].retry_after_ms = f64::MAX;
+        let reply = dispatch(&mut health, "query_ui", "{}");
+        assert_eq!(
+            reply["error"],
+            "No backend could run query_ui (tried xcuitest): xcuitest is cooling down after: \
+             Runner not installed"
+        );
+    }
+
+    #[test]
+    fn status_reports_health_and_probing_refreshes_it() {
+        let mut health = Health {
+            calls: 4,
+            total_ms: 10.0,
+            ..Health::default()
+        };
+        let report = status(&mut health, XCUITEST, false);
+        assert_eq!(report.name, "xcuitest");
+        assert_eq!(
+            report.capabilities,
+            vec![BackendCapability::Input, BackendCapability::Elements]
+        );
+        assert!(report.connected && report.available);
+        assert_eq!((report.calls, report.mean_ms), (4, 2.5));
+        assert_eq!(report.last_error, None);
+
+        health.retry_after_ms = f64::MAX;
+        assert!(!status(&mut health, XCUITEST, false).available);
+
+        // A probe prepares the backend, so one sitting out is retried.
+        let report = status(&mut health, XCUITEST, true);
+        assert!(report.available);
+        assert_eq!(health.retry_after_ms, 0.0);
+
+        script(|script| script.prepare_error[SIMCTL] = Some("simctl \"missing\""));
+        let report = status(&mut Health::default(), SIMCTL, true);
+        assert!(!report.available);
+        assert_eq!(report.failures, 1);
+        assert_eq!(report.last_error.as_deref(), Some("simctl \"missing\""));
+        assert_eq!(
+            report.capabilities,
+            vec![BackendCapability::Capture, BackendCapability::Lifecycle]
+        );
+    }
+
+    #[test]
+    fn text_is_handed_to_backends_whole_or_not_at_all() {
+        // tokens[0] is the params object and tokens[1] its "text" member.
+        let text = |json: &str| {
+            let json = CString::new(json).unwrap();
+            let mut params = ActionParams {
+                present: 0,
+                numbers: [0.0; 10],
+                source: ptr::null(),
+                tokens: [JsonToken::default(); 9],
+            };
+            unsafe {
+                assert_eq!(ios_action_params_parse(json.as_ptr(), &mut params), 0);
+                let value = ios_action_params_string(&params, &params.tokens[1]);
+                if value.is_null() {
+                    return None;
+                }
+                let copy = CStr::from_ptr(value).to_string_lossy().into_owned();
+                ios_bridge_free_string(value);
+                Some(copy)
+            }
+        };
+        assert_eq!(
+            text(r#"{"text": "café \"quoted\"\n"}"#).as_deref(),
+            Some("café \"quoted\"\n")
+        );
+        assert_eq!(text(r#"{"text": ""}"#).as_deref(), Some(""));
+        assert_eq!(text("{}"), None);
+        // A C string would stop at the NUL and type only "secret".
+        assert_eq!(text(r#"{"text": "secret\u0000suffix"}"#), None);
+        assert_eq!(text(r#"{"text": "\u0000"}"#), None);
+    }
+
+    #[test]
+    fn unknown_capabilities_still_parse() {
+        let status: BackendStatus = serde_json::from_str(
+            r#"{"name": "simctl", "capabilities": ["capture", "teleport"], "connected": false,
+                "available": true, "calls": 0, "failures": 0, "consecutive_failures": 0,
+                "mean_ms": 0, "last_error": null}"#,
+        )
+        .unwrap();
+        assert_eq!(status.capabilities[1], BackendCapability::Unknown);
+    }
+}
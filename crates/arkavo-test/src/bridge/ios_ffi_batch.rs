@@ -0,0 +1,137 @@
+use super::ios_ffi::RustTestHarness;
+use crate::{Result, TestError};
+use serde::{Deserialize, Serialize};
+use serde_json::Value;
+use std::ffi::CString;
+
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct BridgeAction {
+    pub action: String,
+    #[serde(default)]
+    pub params: Value,
+}
+
+impl BridgeAction {
+    pub fn new(action: &str, params: Value) -> Self {
+        Self {
+            action: action.to_string(),
+            params,
+        }
+    }
+
+    /// Parse a single action object or an array of them, as embedded in a
+    /// Gherkin doc string. Anything else is not an action payload.
+    pub fn parse_list(payload: &str) -> Option<Vec<BridgeAction>> {
+        match serde_json::from_str::<Value>(payload.trim()).ok()? {
+            Value::Array(items) => items
+                .into_iter()
+                .map(|item| serde_json::from_value(item).ok())
+                .collect(),
+            object @ Value::Object(_) => serde_json::from_value(object).ok().map(|a| vec![a]),
+            _ => None,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct BatchActionResult {
+    pub index: usize,
+    pub action: Option<String>,
+    pub success: bool,
+    pub duration_ms: f64,
+    pub result: Value,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct BatchResult {
+    pub success: bool,
+    pub executed: usize,
+    pub total: usize,
+    pub stopped_early: bool,
+    pub total_ms: f64,
+    pub results: Vec<BatchActionResult>,
+}
+
+impl RustTestHarness {
+    /// Execute a sequence of actions in one native call. Per-action results and
+    /// timings come back together, so a scenario crosses the FFI boundary once
+    /// instead of once per step.
+    pub fn execute_batch(
+        &self,
+        actions: &[BridgeAction],
+        stop_on_failure: bool,
+    ) -> Result<BatchResult> {
+        let payload = serde_json::json!({
+            "stop_on_failure": stop_on_failure,
+            "actions": actions,
+        })
+        .to_string();
+        let payload_cstr = CString::new(payload)
+            .map_err(|e| TestError::Bridge(format!("Invalid batch payload: {}", e)))?;
+
+        let (executed, output) = self.execute_batch_buffer(&payload_cstr)?;
+        if executed < 0 {
+            return Err(TestError::Bridge(format!(
+                "Batch rejected: {}",
+                String::from_utf8_lossy(output.as_bytes())
+            )));
+        }
+
+        output.parse()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+
+    #[test]
+    fn parses_single_action_and_arrays() {
+        let single = BridgeAction::parse_list(r#"{"action": "tap", "params": {"x": 1}}"#);
+        assert_eq!(
+            single,
+            Some(vec![BridgeAction::new("tap", json!({"x": 1}))])
+        );
+
+        let list = BridgeAction::parse_list(
+            r#"[{"action": "tap", "params": {"x": 1}}, {"action": "type_text"}]"#,
+        )
+        .unwrap();
+        assert_eq!(list.len(), 2);
+        assert_eq!(list[1].params, Value::Null);
+    }
+
+    #[test]
+    fn rejects_non_action_payloads() {
+        assert!(BridgeAction::parse_list("plain doc string").is_none());
+        assert!(BridgeAction::parse_list(r#"{"name": "not an action"}"#).is_none());
+        assert!(BridgeAction::parse_list(r#"[{"action": "tap"}, 3]"#).is_none());
+    }
+
+    unsafe extern "C" {
+        fn ios_result_succeeded(result: *const std::os::raw::c_char) -> std::os::raw::c_int;
+    }
+
+    fn succeeded(result: &str) -> bool {
+        let result = CString::new(result).unwrap();
+        unsafe { ios_result_succeeded(result.as_ptr()) != 0 }
+    }
+
+    // Step outcomes decide stop_on_failure, so only the reply's own
+    // members may count, in whatever order they were serialized.
+    #[test]
+    fn step_outcome_reads_only_top_level_members() {
+        assert!(succeeded(
+            r#"{"element": {"error": "stale", "success": false}, "note": "\"error\"", "success": true}"#
+        ));
+        assert!(!succeeded(
+            r#"{"result": {"success": true}, "success": false}"#
+        ));
+        assert!(succeeded(r#"{"value": "no error here"}"#));
+        assert!(!succeeded(
+            r#"{"detail": {"a": 1}, "error": "Element not found"}"#
+        ));
+        assert!(!succeeded("not json"));
+    }
+}
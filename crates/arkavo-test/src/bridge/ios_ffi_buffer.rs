@@ -0,0 +1,283 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use crate::{Result, TestError};
+use serde::Deserialize;
+use serde::de::DeserializeOwned;
+use std::ffi::{CStr, CString};
+use std::os::raw::{c_char, c_int, c_void};
+
+#[repr(C)]
+struct RawBridgeBuffer {
+    data: *const u8,
+    length: usize,
+    context: *mut c_void,
+    release: Option<unsafe extern "C" fn(*mut c_void)>,
+}
+
+/// Result bytes lent by the native bridge. They are read in place and handed
+/// back to the bridge on drop, so large results are not copied just to cross
+/// the FFI boundary.
+pub struct BridgeBuffer {
+    raw: RawBridgeBuffer,
+}
+
+impl BridgeBuffer {
+    fn fill(lend: impl FnOnce(*mut RawBridgeBuffer) -> c_int) -> (c_int, Self) {
+        let mut buffer = Self {
+            raw: RawBridgeBuffer {
+                data: std::ptr::null(),
+                length: 0,
+                context: std::ptr::null_mut(),
+                release: None,
+            },
+        };
+        let status = lend(&mut buffer.raw);
+        (status, buffer)
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        if self.raw.data.is_null() {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.raw.data, self.raw.length) }
+    }
+
+    pub fn as_str(&self) -> Result<&str> {
+        std::str::from_utf8(self.as_bytes())
+            .map_err(|e| TestError::Bridge(format!("Bridge result is not UTF-8: {}", e)))
+    }
+
+    /// Deserialize straight from the lent bytes.
+    pub fn parse<T: DeserializeOwned>(&self) -> Result<T> {
+        Ok(serde_json::from_slice(self.as_bytes())?)
+    }
+
+    pub fn len(&self) -> usize {
+        self.as_bytes().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Drop for BridgeBuffer {
+    fn drop(&mut self) {
+        if let Some(release) = self.raw.release.take() {
+            unsafe { release(self.raw.context) };
+        }
+    }
+}
+
+impl std::fmt::Debug for BridgeBuffer {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("BridgeBuffer")
+            .field("length", &self.len())
+            .finish()
+    }
+}
+
+// The native release routines (free, CFRelease) may run on any thread.
+unsafe impl Send for BridgeBuffer {}
+unsafe impl Sync for BridgeBuffer {}
+
+#[derive(Deserialize)]
+#[serde(untagged)]
+enum BridgeReply<T> {
+    Value(T),
+    Failure { error: serde_json::Value },
+}
+
+/// Parse a bridge result that is either `T` or an `{"error": ...}` object.
+pub(super) fn parse_reply<T: DeserializeOwned>(json: &[u8]) -> Result<T> {
+    match serde_json::from_slice(json)? {
+        BridgeReply::Value(value) => Ok(value),
+        BridgeReply::Failure { error } => Err(TestError::Bridge(match error {
+            serde_json::Value::String(message) => message,
+            other => other.to_string(),
+        })),
+    }
+}
+
+/// Parse and free a string the bridge allocated for the caller.
+///
+/// # Safety
+/// `reply` must be null or a string returned by the bridge that has not
+/// been freed yet.
+pub(super) unsafe fn take_reply<T: DeserializeOwned>(reply: *mut c_char, what: &str) -> Result<T> {
+    if reply.is_null() {
+        return Err(TestError::Bridge(format!("Null {} from iOS bridge", what)));
+    }
+    let parsed = parse_reply(unsafe { CStr::from_ptr(reply) }.to_bytes());
+    unsafe { ios_bridge_free_string(reply) };
+    parsed
+}
+
+/// Reservation target for bulk native output: the bridge is told the final
+/// size up front and writes directly into the vector's allocation.
+pub(super) struct ReservedBytes {
+    data: Vec<u8>,
+    reserved: usize,
+}
+
+pub(super) type ReserveFn = unsafe extern "C" fn(*mut c_void, usize) -> *mut c_void;
+
+unsafe extern "C" fn reserve_bytes(context: *mut c_void, size: usize) -> *mut c_void {
+    let sink = unsafe { &mut *(context as *mut ReservedBytes) };
+    sink.data.clear();
+    sink.data.reserve_exact(size);
+    sink.reserved = size;
+    sink.data.as_mut_ptr() as *mut c_void
+}
+
+impl ReservedBytes {
+    /// Run a native call that fills memory through the reserve callback. The
+    /// bytes are only kept when the call reports success (zero).
+    pub(super) fn fill(write: impl FnOnce(ReserveFn, *mut c_void) -> c_int) -> (c_int, Vec<u8>) {
+        let mut sink = ReservedBytes {
+            data: Vec::new(),
+            reserved: 0,
+        };
+
+        let status = write(
+            reserve_bytes,
+            &mut sink as *mut ReservedBytes as *mut c_void,
+        );
+        if status != 0 {
+            return (status, Vec::new());
+        }
+
+        // The bridge has initialized every reserved byte once it reports success.
+        unsafe { sink.data.set_len(sink.reserved) };
+        (status, sink.data)
+    }
+}
+
+impl RustTestHarness {
+    pub(super) fn connected_bridge(&self) -> Result<*mut IOSBridge> {
+        self.raw_bridge().ok_or_else(|| {
+            TestError::Bridge(
+                "iOS bridge is not connected. Please ensure you're running on macOS with a booted iOS simulator."
+                    .to_string(),
+            )
+        })
+    }
+
+    /// Execute an action and borrow the bridge's result buffer instead of
+    /// copying it into an owned string.
+    pub fn execute_action_buffer(&self, action: &str, params: &str) -> Result<BridgeBuffer> {
+        let bridge = self.connected_bridge()?;
+        let action_cstr = CString::new(action)
+            .map_err(|e| TestError::Bridge(format!("Invalid action string: {}", e)))?;
+        let params_cstr = CString::new(params)
+            .map_err(|e| TestError::Bridge(format!("Invalid params string: {}", e)))?;
+
+        let (status, buffer) = BridgeBuffer::fill(|raw| unsafe {
+            ios_bridge_execute_action_buffer(
+                bridge,
+                action_cstr.as_ptr(),
+                params_cstr.as_ptr(),
+                raw,
+            )
+        });
+
+        if status != 0 {
+            return Err(TestError::Bridge("Null result from iOS bridge".to_string()));
+        }
+        Ok(buffer)
+    }
+
+    /// Run a serialized batch, returning the executed count (negative when the
+    /// payload was rejected) with the lent result.
+    pub(super) fn execute_batch_buffer(&self, payload: &CStr) -> Result<(c_int, BridgeBuffer)> {
+        let bridge = self.connected_bridge()?;
+        let (executed, buffer) = BridgeBuffer::fill(|raw| unsafe {
+            ios_bridge_execute_batch_buffer(bridge, payload.as_ptr(), raw)
+        });
+
+        if buffer.raw.data.is_null() {
+            return Err(TestError::Bridge(
+                "Null batch result from iOS bridge".to_string(),
+            ));
+        }
+        Ok((executed, buffer))
+    }
+
+    /// Snapshot bytes written by the bridge directly into an owned vector,
+    /// ready to move into a snapshot store without another copy.
+    pub(super) fn snapshot_bytes(&self) -> Result<Vec<u8>> {
+        let bridge = self.connected_bridge()?;
+        let (status, data) = ReservedBytes::fill(|reserve, context| unsafe {
+            ios_bridge_create_snapshot_into(bridge, reserve, context)
+        });
+
+        if status != 0 {
+            return Err(TestError::Bridge("Failed to create snapshot".to_string()));
+        }
+        Ok(data)
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_execute_action_buffer(
+        bridge: *mut IOSBridge,
+        action: *const c_char,
+        params: *const c_char,
+        out: *mut RawBridgeBuffer,
+    ) -> c_int;
+
+    fn ios_bridge_execute_batch_buffer(
+        bridge: *mut IOSBridge,
+        actions_json: *const c_char,
+        out: *mut RawBridgeBuffer,
+    ) -> c_int;
+
+    fn ios_bridge_free_string(s: *mut c_char);
+
+    fn ios_bridge_create_snapshot_into(
+        bridge: *mut IOSBridge,
+        reserve: ReserveFn,
+        context: *mut c_void,
+    ) -> c_int;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::Value;
+    use std::ptr::NonNull;
+
+    // Off Apple platforms the stub bridge never dereferences the handle, so any
+    // non-null pointer stands in for a connected simulator.
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    fn connected_harness() -> RustTestHarness {
+        let mut harness = RustTestHarness::new();
+        harness.connect_ios_bridge(NonNull::<IOSBridge>::dangling().as_ptr());
+        harness
+    }
+
+    #[test]
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    fn lent_results_parse_in_place() {
+        let harness = connected_harness();
+        let buffer = harness.execute_action_buffer("tap", "{}").unwrap();
+        assert!(!buffer.is_empty());
+        let value: Value = buffer.parse().unwrap();
+        assert!(value.is_object());
+        assert_eq!(buffer.as_str().unwrap().len(), buffer.len());
+    }
+
+    #[test]
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    fn snapshots_fill_the_reserved_vector() {
+        let harness = connected_harness();
+        let bytes = harness.snapshot_bytes().unwrap();
+        assert!(!bytes.is_empty());
+        assert!(bytes.capacity() >= bytes.len());
+    }
+
+    #[test]
+    fn disconnected_harness_rejects_buffer_calls() {
+        let harness = RustTestHarness::new();
+        assert!(harness.execute_action_buffer("tap", "{}").is_err());
+    }
+}
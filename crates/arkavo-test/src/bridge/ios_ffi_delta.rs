@@ -0,0 +1,164 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::Result;
+use serde::Deserialize;
+use std::os::raw::c_char;
+
+/// One element of the UI state. The fingerprint stays the same while the
+/// element keeps its place in the hierarchy, so attribute changes arrive as
+/// updates rather than a removal plus an insertion.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct DeltaNode {
+    pub fingerprint: String,
+    pub parent: Option<String>,
+    #[serde(flatten)]
+    pub attributes: serde_json::Map<String, serde_json::Value>,
+}
+
+/// Changes since the previous `get_state_delta` call on the same bridge. The
+/// first call reports every node as inserted.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct StateDelta {
+    pub state_hash: String,
+    pub previous_hash: Option<String>,
+    pub changed: bool,
+    pub inserted: Vec<DeltaNode>,
+    pub removed: Vec<String>,
+    pub updated: Vec<DeltaNode>,
+}
+
+impl StateDelta {
+    pub fn is_empty(&self) -> bool {
+        self.inserted.is_empty() && self.removed.is_empty() && self.updated.is_empty()
+    }
+}
+
+impl RustTestHarness {
+    /// Only the nodes that changed since the last call, plus a hash of the
+    /// whole state for a cheap "did anything change?" check.
+    pub fn get_state_delta(&self) -> Result<StateDelta> {
+        let bridge = self.connected_bridge()?;
+        unsafe { take_reply(ios_bridge_get_state_delta(bridge), "state delta") }
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_get_state_delta(bridge: *mut IOSBridge) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::bridge::ios_ffi_buffer::take_reply;
+    use std::ffi::CString;
+
+    #[repr(C)]
+    struct DeltaBaseline {
+        fingerprint: *mut c_char,
+        hash: u64,
+    }
+
+    unsafe extern "C" {
+        fn ios_delta_advance(
+            baseline: *mut DeltaBaseline,
+            fingerprint: *const c_char,
+            state: *const c_char,
+        ) -> *mut c_char;
+        fn ios_delta_reset(baseline: *mut DeltaBaseline);
+    }
+
+    // The baseline a bridge keeps between get_state_delta calls, driven
+    // directly so the tests choose the states it sees.
+    struct Tracker(DeltaBaseline);
+
+    impl Tracker {
+        fn new() -> Self {
+            Tracker(DeltaBaseline {
+                fingerprint: std::ptr::null_mut(),
+                hash: 0,
+            })
+        }
+
+        fn advance(&mut self, fingerprint: &str, state: &str) -> Result<StateDelta> {
+            let fingerprint = CString::new(fingerprint).unwrap();
+            let state = CString::new(state).unwrap();
+            unsafe {
+                take_reply(
+                    ios_delta_advance(&mut self.0, fingerprint.as_ptr(), state.as_ptr()),
+                    "state delta",
+                )
+            }
+        }
+    }
+
+    impl Drop for Tracker {
+        fn drop(&mut self) {
+            unsafe { ios_delta_reset(&mut self.0) };
+        }
+    }
+
+    #[test]
+    fn successive_states_insert_then_update_then_settle() {
+        let mut tracker = Tracker::new();
+        let first = tracker
+            .advance("device:A", r#"{"device_id": "A", "state": "booted"}"#)
+            .unwrap();
+        assert_eq!(first.previous_hash, None);
+        assert!(first.changed && first.removed.is_empty() && first.updated.is_empty());
+        assert_eq!(first.inserted[0].fingerprint, "device:A");
+        assert_eq!(first.inserted[0].parent, None);
+        assert_eq!(first.inserted[0].attributes["state"], "booted");
+
+        let updated = tracker
+            .advance("device:A", r#"{"device_id": "A", "state": "shutdown"}"#)
+            .unwrap();
+        assert_eq!(updated.previous_hash, Some(first.state_hash));
+        assert!(updated.changed && updated.inserted.is_empty());
+        assert_eq!(updated.updated[0].attributes["state"], "shutdown");
+
+        let settled = tracker
+            .advance("device:A", r#"{"device_id": "A", "state": "shutdown"}"#)
+            .unwrap();
+        assert!(!settled.changed && settled.is_empty());
+        assert_eq!(settled.state_hash, updated.state_hash);
+    }
+
+    #[test]
+    fn another_device_replaces_the_node() {
+        let mut tracker = Tracker::new();
+        let quoted = r#"device:"A"\1"#;
+        tracker.advance(quoted, r#"{"state": "booted"}"#).unwrap();
+        let delta = tracker
+            .advance("device:B", r#"{"state": "booted"}"#)
+            .unwrap();
+        assert!(delta.changed && delta.updated.is_empty());
+        assert_eq!(delta.removed, vec![quoted.to_string()]);
+        assert_eq!(delta.inserted[0].fingerprint, "device:B");
+    }
+
+    #[test]
+    fn empty_and_padded_states_still_splice_into_nodes() {
+        let mut tracker = Tracker::new();
+        let empty = tracker.advance("device:A", "{}").unwrap();
+        assert!(empty.inserted[0].attributes.is_empty());
+        let padded = tracker
+            .advance("device:A", "{\n\t \"state\": \"booted\" }")
+            .unwrap();
+        assert_eq!(padded.updated[0].attributes["state"], "booted");
+    }
+
+    #[test]
+    fn unreadable_states_leave_the_baseline_alone() {
+        let mut tracker = Tracker::new();
+        let first = tracker
+            .advance("device:A", r#"{"state": "booted"}"#)
+            .unwrap();
+        let error = tracker.advance("device:A", "[1, 2]").unwrap_err();
+        assert!(error.to_string().contains("Failed to read current state"));
+        let next = tracker
+            .advance("device:A", r#"{"state": "booted"}"#)
+            .unwrap();
+        assert_eq!(next.previous_hash, Some(first.state_hash));
+        assert!(!next.changed);
+    }
+}
@@ -0,0 +1,381 @@
+use super::ios_ffi_frame::{CapturedFrame, FrameFormat, FrameRegion};
+use crate::{Result, TestError};
+use std::os::raw::c_int;
+
+/// Regions kept on the first pass; a diff with more runs again with room
+/// for all of them.
+const INITIAL_REGIONS: usize = 64;
+
+/// A pixel changes once any channel moves by at least `pixel_threshold`, and
+/// a tile once `min_changed_pixels` of its pixels do. A threshold of 1
+/// compares exactly.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DiffOptions {
+    pub tile_size: u32,
+    pub pixel_threshold: u8,
+    pub min_changed_pixels: u32,
+}
+
+impl Default for DiffOptions {
+    fn default() -> Self {
+        Self {
+            tile_size: 16,
+            pixel_threshold: 16,
+            min_changed_pixels: 1,
+        }
+    }
+}
+
+/// Bounding box of touching changed tiles, in the frame's own pixels; for
+/// a scaled capture, divide by the scale for device pixels.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DiffRegion {
+    pub region: FrameRegion,
+    pub changed_tiles: u32,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct FrameDiff {
+    pub changed_tiles: u32,
+    pub total_tiles: u32,
+    pub changed_pixels: u64,
+    /// In row-major order of each region's first tile.
+    pub regions: Vec<DiffRegion>,
+}
+
+impl FrameDiff {
+    pub fn is_unchanged(&self) -> bool {
+        self.changed_tiles == 0
+    }
+
+    /// Smallest box holding every changed region.
+    pub fn bounds(&self) -> Option<FrameRegion> {
+        let mut regions = self.regions.iter().map(|r| r.region);
+        let first = regions.next()?;
+        let (mut left, mut top) = (first.x, first.y);
+        let (mut right, mut bottom) = (first.x + first.width, first.y + first.height);
+        for r in regions {
+            left = left.min(r.x);
+            top = top.min(r.y);
+            right = right.max(r.x + r.width);
+            bottom = bottom.max(r.y + r.height);
+        }
+        Some(FrameRegion {
+            x: left,
+            y: top,
+            width: right - left,
+            height: bottom - top,
+        })
+    }
+}
+
+/// Perceptual hash per tile of one frame. Hashes taken moments apart stay
+/// within a few bits of each other unless the tile's content really moved.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TileHashes {
+    pub width: u32,
+    pub height: u32,
+    pub tile_size: u32,
+    pub hashes: Vec<u64>,
+}
+
+impl TileHashes {
+    /// Tiles whose hashes differ from `other` in more than `max_distance`
+    /// bits; 64-bit hashes of unrelated content differ in about 32.
+    pub fn changed_tiles(&self, other: &TileHashes, max_distance: u32) -> Result<usize> {
+        if (self.width, self.height, self.tile_size) != (other.width, other.height, other.tile_size)
+        {
+            return Err(TestError::Bridge(format!(
+                "Tile hashes of {}x{} at {}px cannot be compared with {}x{} at {}px",
+                self.width, self.height, self.tile_size, other.width, other.height, other.tile_size
+            )));
+        }
+        let count = to_c_int(self.hashes.len(), "tile count")?;
+        let max_distance = to_c_int(max_distance as usize, "hash distance")?;
+        let changed = unsafe {
+            ios_diff_hash_changes(
+                self.hashes.as_ptr(),
+                other.hashes.as_ptr(),
+                count,
+                max_distance,
+                std::ptr::null_mut(),
+            )
+        };
+        Ok(changed.max(0) as usize)
+    }
+}
+
+#[repr(C)]
+struct RawDiffOptions {
+    tile_size: c_int,
+    pixel_threshold: c_int,
+    min_changed_pixels: c_int,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+struct RawDiffRegion {
+    x: c_int,
+    y: c_int,
+    width: c_int,
+    height: c_int,
+    changed_tiles: c_int,
+}
+
+#[repr(C)]
+#[derive(Default)]
+struct RawDiffSummary {
+    changed_tiles: c_int,
+    total_tiles: c_int,
+    changed_pixels: u64,
+    region_count: c_int,
+}
+
+fn to_c_int(value: usize, field: &str) -> Result<c_int> {
+    c_int::try_from(value)
+        .map_err(|_| TestError::Bridge(format!("Diff {} out of range: {}", field, value)))
+}
+
+/// Checks that `frame` holds every pixel its header describes before the
+/// kernel reads it.
+fn raw_layout(frame: &CapturedFrame) -> Result<(c_int, c_int, c_int)> {
+    if frame.format != FrameFormat::RawBgra {
+        return Err(TestError::Bridge(format!(
+            "Only raw BGRA frames can be compared, got {:?}",
+            frame.format
+        )));
+    }
+    let row = frame.width as usize * 4;
+    let needed = match frame.height as usize {
+        0 => 0,
+        rows => (rows - 1) * frame.bytes_per_row + row,
+    };
+    if frame.width == 0 || frame.bytes_per_row < row || frame.data.len() < needed {
+        return Err(TestError::Bridge(format!(
+            "Frame of {}x{} with {} bytes per row does not fit its {} bytes",
+            frame.width,
+            frame.height,
+            frame.bytes_per_row,
+            frame.data.len()
+        )));
+    }
+    Ok((
+        to_c_int(frame.bytes_per_row, "row stride")?,
+        to_c_int(frame.width as usize, "width")?,
+        to_c_int(frame.height as usize, "height")?,
+    ))
+}
+
+fn kernel_error(status: c_int) -> TestError {
+    match status {
+        -2 => TestError::Bridge("Out of memory while comparing frames".to_string()),
+        _ => TestError::Bridge("Frames could not be compared".to_string()),
+    }
+}
+
+impl CapturedFrame {
+    /// Compares this frame with a later one of the same size in a single
+    /// native pass, returning the boxes of what changed.
+    pub fn diff(&self, after: &CapturedFrame, options: &DiffOptions) -> Result<FrameDiff> {
+        let (stride, width, height) = raw_layout(self)?;
+        let (after_stride, after_width, after_height) = raw_layout(after)?;
+        if (width, height) != (after_width, after_height) {
+            return Err(TestError::Bridge(format!(
+                "Cannot compare a {}x{} frame with a {}x{} one",
+                width, height, after_width, after_height
+            )));
+        }
+        let raw_options = RawDiffOptions {
+            tile_size: to_c_int(options.tile_size as usize, "tile size")?,
+            pixel_threshold: c_int::from(options.pixel_threshold),
+            min_changed_pixels: to_c_int(options.min_changed_pixels as usize, "pixel count")?,
+        };
+
+        let mut regions = vec![RawDiffRegion::default(); INITIAL_REGIONS];
+        loop {
+            let mut summary = RawDiffSummary::default();
+            let status = unsafe {
+                ios_diff_frames(
+                    self.data.as_ptr(),
+                    stride,
+                    after.data.as_ptr(),
+                    after_stride,
+                    width,
+                    height,
+                    &raw_options,
+                    regions.as_mut_ptr(),
+                    to_c_int(regions.len(), "region count")?,
+                    &mut summary,
+                )
+            };
+            if status != 0 {
+                return Err(kernel_error(status));
+            }
+            let found = summary.region_count.max(0) as usize;
+            if found > regions.len() {
+                regions.resize(found, RawDiffRegion::default());
+                continue;
+            }
+            regions.truncate(found);
+            return Ok(FrameDiff {
+                changed_tiles: summary.changed_tiles.max(0) as u32,
+                total_tiles: summary.total_tiles.max(0) as u32,
+                changed_pixels: summary.changed_pixels,
+                regions: regions
+                    .iter()
+                    .map(|r| DiffRegion {
+                        region: FrameRegion {
+                            x: r.x.max(0) as u32,
+                            y: r.y.max(0) as u32,
+                            width: r.width.max(0) as u32,
+                            height: r.height.max(0) as u32,
+                        },
+                        changed_tiles: r.changed_tiles.max(0) as u32,
+                    })
+                    .collect(),
+            });
+        }
+    }
+
+    /// Perceptual hashes of this frame's `tile_size` pixel tiles.
+    pub fn tile_hashes(&self, tile_size: u32) -> Result<TileHashes> {
+        let (stride, width, height) = raw_layout(self)?;
+        let tile = to_c_int(tile_size.max(1) as usize, "tile size")?;
+        let count = unsafe { ios_diff_tile_count(width, height, tile) }.max(0) as usize;
+        let mut hashes = vec![0u64; count];
+        let status = unsafe {
+            ios_diff_tile_hashes(
+                self.data.as_ptr(),
+                stride,
+                width,
+                height,
+                tile,
+                hashes.as_mut_ptr(),
+            )
+        };
+        if status != 0 {
+            return Err(kernel_error(status));
+        }
+        Ok(TileHashes {
+            width: self.width,
+            height: self.height,
+            tile_size: tile_size.max(1),
+            hashes,
+        })
+    }
+}
+
+unsafe extern "C" {
+    fn ios_diff_frames(
+        a: *const u8,
+        a_bytes_per_row: c_int,
+        b: *const u8,
+        b_bytes_per_row: c_int,
+        width: c_int,
+        height: c_int,
+        options: *const RawDiffOptions,
+        regions: *mut RawDiffRegion,
+        max_regions: c_int,
+        summary: *mut RawDiffSummary,
+    ) -> c_int;
+    fn ios_diff_tile_count(width: c_int, height: c_int, tile_size: c_int) -> c_int;
+    fn ios_diff_tile_hashes(
+        pixels: *const u8,
+        bytes_per_row: c_int,
+        width: c_int,
+        height: c_int,
+        tile_size: c_int,
+        hashes: *mut u64,
+    ) -> c_int;
+    fn ios_diff_hash_changes(
+        a: *const u64,
+        b: *const u64,
+        count: c_int,
+        max_distance: c_int,
+        changed: *mut u8,
+    ) -> c_int;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn frame(width: u32, height: u32, fill: impl Fn(u32, u32) -> [u8; 4]) -> CapturedFrame {
+        let bytes_per_row = width as usize * 4 + 8;
+        let mut data = vec![0u8; bytes_per_row * height as usize];
+        for y in 0..height {
+            for x in 0..width {
+                let offset = y as usize * bytes_per_row + x as usize * 4;
+                data[offset..offset + 4].copy_from_slice(&fill(x, y));
+            }
+        }
+        CapturedFrame {
+            format: FrameFormat::RawBgra,
+            width,
+            height,
+            bytes_per_row,
+            captured_ms: 0.0,
+            data,
+        }
+    }
+
+    fn region(x: u32, y: u32, width: u32, height: u32) -> FrameRegion {
+        FrameRegion {
+            x,
+            y,
+            width,
+            height,
+        }
+    }
+
+    #[test]
+    fn reports_boxes_of_changed_tiles() {
+        let before = frame(100, 80, |_, _| [20, 20, 20, 255]);
+        let after = frame(100, 80, |x, y| match (x, y) {
+            (5..=30, 3..=19) => [200, 20, 20, 255],
+            (99, 79) => [20, 20, 90, 255],
+            (50, 40) => [24, 20, 20, 255],
+            _ => [20, 20, 20, 255],
+        });
+
+        let diff = before.diff(&after, &DiffOptions::default()).unwrap();
+        assert_eq!(diff.changed_pixels, 26 * 17 + 1);
+        assert_eq!(diff.total_tiles, 7 * 5);
+        let boxes: Vec<_> = diff.regions.iter().map(|r| r.region).collect();
+        assert_eq!(boxes, vec![region(0, 0, 32, 32), region(96, 64, 4, 16)]);
+        assert_eq!(diff.bounds(), Some(region(0, 0, 100, 80)));
+        let same = before.diff(&before, &DiffOptions::default()).unwrap();
+        assert!(same.is_unchanged());
+
+        let exact = DiffOptions {
+            pixel_threshold: 1,
+            ..DiffOptions::default()
+        };
+        assert_eq!(before.diff(&after, &exact).unwrap().regions.len(), 3);
+        assert!(before.diff(&frame(99, 80, |_, _| [0; 4]), &exact).is_err());
+    }
+
+    #[test]
+    fn tile_hashes_ignore_small_shifts() {
+        let gradient = frame(64, 64, |x, y| {
+            let v = (x * 2 + y) as u8;
+            [v, v, v, 255]
+        });
+        let brighter = frame(64, 64, |x, y| {
+            let v = (x * 2 + y) as u8 + 6;
+            [v, v, v, 255]
+        });
+        let flipped = frame(64, 64, |x, y| {
+            let v = ((63 - x) * 2 + y) as u8;
+            [v, v, v, 255]
+        });
+
+        let base = gradient.tile_hashes(32).unwrap();
+        let changed =
+            |other: &CapturedFrame, tile| base.changed_tiles(&other.tile_hashes(tile)?, 4);
+        assert_eq!(base.hashes.len(), 4);
+        assert_eq!(changed(&brighter, 32).unwrap(), 0);
+        assert_eq!(changed(&flipped, 32).unwrap(), 4);
+        assert!(changed(&gradient, 16).is_err());
+    }
+}
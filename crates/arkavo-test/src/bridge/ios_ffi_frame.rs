@@ -0,0 +1,390 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::{ReserveFn, ReservedBytes};
+use crate::{Result, TestError};
+use std::os::raw::{c_int, c_void};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FrameFormat {
+    /// Premultiplied 8-bit BGRA, rows top to bottom.
+    RawBgra,
+    Png,
+    Jpeg,
+}
+
+impl FrameFormat {
+    fn code(self) -> c_int {
+        match self {
+            FrameFormat::RawBgra => 0,
+            FrameFormat::Png => 1,
+            FrameFormat::Jpeg => 2,
+        }
+    }
+
+    fn from_code(code: c_int) -> Option<Self> {
+        match code {
+            0 => Some(FrameFormat::RawBgra),
+            1 => Some(FrameFormat::Png),
+            2 => Some(FrameFormat::Jpeg),
+            _ => None,
+        }
+    }
+}
+
+/// Screen region in device pixels, clipped to the screen by the bridge.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FrameRegion {
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct FrameRequest {
+    pub format: FrameFormat,
+    pub region: Option<FrameRegion>,
+    /// Downscale factor in (0, 1], applied after cropping.
+    pub scale: f64,
+    /// JPEG quality 1-100; None keeps the encoder default.
+    pub jpeg_quality: Option<u8>,
+}
+
+impl FrameRequest {
+    pub fn new(format: FrameFormat) -> Self {
+        Self {
+            format,
+            region: None,
+            scale: 1.0,
+            jpeg_quality: None,
+        }
+    }
+
+    pub fn cropped(mut self, region: FrameRegion) -> Self {
+        self.region = Some(region);
+        self
+    }
+
+    pub fn scaled(mut self, scale: f64) -> Self {
+        self.scale = scale;
+        self
+    }
+
+    pub fn with_jpeg_quality(mut self, quality: u8) -> Self {
+        self.jpeg_quality = Some(quality);
+        self
+    }
+}
+
+impl Default for FrameRequest {
+    fn default() -> Self {
+        Self::new(FrameFormat::RawBgra)
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct CapturedFrame {
+    pub format: FrameFormat,
+    pub width: u32,
+    pub height: u32,
+    /// Row stride for raw frames; zero for encoded ones.
+    pub bytes_per_row: usize,
+    /// Monotonic capture time in milliseconds, comparable across frames.
+    pub captured_ms: f64,
+    pub data: Vec<u8>,
+}
+
+impl CapturedFrame {
+    /// BGRA value at (x, y) for raw frames.
+    pub fn pixel(&self, x: u32, y: u32) -> Option<[u8; 4]> {
+        if self.format != FrameFormat::RawBgra || x >= self.width || y >= self.height {
+            return None;
+        }
+        let offset = y as usize * self.bytes_per_row + x as usize * 4;
+        self.data
+            .get(offset..offset + 4)
+            .map(|p| [p[0], p[1], p[2], p[3]])
+    }
+}
+
+#[repr(C)]
+struct RawFrameRequest {
+    format: c_int,
+    crop_x: c_int,
+    crop_y: c_int,
+    crop_width: c_int,
+    crop_height: c_int,
+    scale: f64,
+    jpeg_quality: c_int,
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub(super) struct RawFrameInfo {
+    format: c_int,
+    width: c_int,
+    height: c_int,
+    bytes_per_row: c_int,
+    captured_ms: f64,
+}
+
+impl RawFrameInfo {
+    pub(super) fn into_frame(self, fallback: FrameFormat, data: Vec<u8>) -> CapturedFrame {
+        CapturedFrame {
+            format: FrameFormat::from_code(self.format).unwrap_or(fallback),
+            width: self.width.max(0) as u32,
+            height: self.height.max(0) as u32,
+            bytes_per_row: self.bytes_per_row.max(0) as usize,
+            captured_ms: self.captured_ms,
+            data,
+        }
+    }
+}
+
+fn to_c_int(value: u32, field: &str) -> Result<c_int> {
+    c_int::try_from(value)
+        .map_err(|_| TestError::Bridge(format!("Frame {} out of range: {}", field, value)))
+}
+
+impl RustTestHarness {
+    /// Capture the screen straight into memory. Raw frames are decoded,
+    /// cropped and scaled by the bridge in one pass into the returned vector,
+    /// so no PNG is written to or read back from disk.
+    pub fn capture_frame(&self, request: &FrameRequest) -> Result<CapturedFrame> {
+        if !(request.scale > 0.0 && request.scale <= 1.0) {
+            return Err(TestError::Bridge(format!(
+                "Frame scale must be in (0, 1], got {}",
+                request.scale
+            )));
+        }
+
+        let region = request.region.unwrap_or(FrameRegion {
+            x: 0,
+            y: 0,
+            width: 0,
+            height: 0,
+        });
+        let raw_request = RawFrameRequest {
+            format: request.format.code(),
+            crop_x: to_c_int(region.x, "x")?,
+            crop_y: to_c_int(region.y, "y")?,
+            crop_width: to_c_int(region.width, "width")?,
+            crop_height: to_c_int(region.height, "height")?,
+            scale: request.scale,
+            jpeg_quality: request.jpeg_quality.map_or(0, c_int::from),
+        };
+
+        let bridge = self.connected_bridge()?;
+        let mut info = RawFrameInfo::default();
+        let (status, data) = ReservedBytes::fill(|reserve, context| unsafe {
+            ios_bridge_capture_frame(bridge, &raw_request, reserve, context, &mut info)
+        });
+
+        let message = match status {
+            0 => None,
+            -2 => Some("Failed to decode captured frame"),
+            -3 => Some("Frame request does not fit the screen"),
+            -4 => Some("Out of memory while capturing frame"),
+            _ => Some("Failed to capture frame from simulator"),
+        };
+        if let Some(message) = message {
+            return Err(TestError::Bridge(message.to_string()));
+        }
+
+        Ok(info.into_frame(request.format, data))
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_capture_frame(
+        bridge: *mut IOSBridge,
+        request: *const RawFrameRequest,
+        reserve: ReserveFn,
+        context: *mut c_void,
+        info: *mut RawFrameInfo,
+    ) -> c_int;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::ffi::CStr;
+    use std::os::raw::c_char;
+
+    #[repr(C)]
+    struct FramePlan {
+        passthrough: c_int,
+        command: *const c_char,
+        source_x: c_int,
+        source_y: c_int,
+        source_width: c_int,
+        source_height: c_int,
+        width: c_int,
+        height: c_int,
+    }
+
+    unsafe extern "C" {
+        fn ios_frame_plan(request: *const RawFrameRequest, plan: *mut FramePlan) -> c_int;
+        fn ios_frame_plan_region(
+            request: *const RawFrameRequest,
+            screen_width: c_int,
+            screen_height: c_int,
+            plan: *mut FramePlan,
+        ) -> c_int;
+    }
+
+    fn request(format: FrameFormat, crop: [c_int; 4], scale: f64) -> RawFrameRequest {
+        RawFrameRequest {
+            format: format.code(),
+            crop_x: crop[0],
+            crop_y: crop[1],
+            crop_width: crop[2],
+            crop_height: crop[3],
+            scale,
+            jpeg_quality: 0,
+        }
+    }
+
+    fn empty_plan() -> FramePlan {
+        FramePlan {
+            passthrough: -1,
+            command: std::ptr::null(),
+            source_x: -1,
+            source_y: -1,
+            source_width: -1,
+            source_height: -1,
+            width: -1,
+            height: -1,
+        }
+    }
+
+    // (passthrough, screenshot type) for a request simctl can serve.
+    fn plan(request: &RawFrameRequest) -> Option<(bool, String)> {
+        let mut plan = empty_plan();
+        if unsafe { ios_frame_plan(request, &mut plan) } != 0 {
+            return None;
+        }
+        let command = unsafe { CStr::from_ptr(plan.command) }.to_str().unwrap();
+        let kind = command.strip_prefix("screenshot --type=").unwrap();
+        Some((
+            plan.passthrough == 1,
+            kind.trim_end_matches(" -").to_string(),
+        ))
+    }
+
+    // ([x, y, width, height] decoded, [width, height] delivered) on a
+    // 1170x2532 screen.
+    fn region(crop: [c_int; 4], scale: f64) -> Option<([c_int; 4], [c_int; 2])> {
+        let request = request(FrameFormat::RawBgra, crop, scale);
+        let mut plan = empty_plan();
+        if unsafe { ios_frame_plan_region(&request, 1170, 2532, &mut plan) } != 0 {
+            return None;
+        }
+        Some((
+            [
+                plan.source_x,
+                plan.source_y,
+                plan.source_width,
+                plan.source_height,
+            ],
+            [plan.width, plan.height],
+        ))
+    }
+
+    #[test]
+    fn only_untouched_encodings_pass_through() {
+        let whole = [0; 4];
+        let png = |p| Some((p, "png".to_string()));
+        assert_eq!(plan(&request(FrameFormat::Png, whole, 0.0)), png(true));
+        assert_eq!(plan(&request(FrameFormat::Png, whole, 1.0)), png(true));
+        assert_eq!(
+            plan(&request(FrameFormat::Jpeg, whole, 0.0)),
+            Some((true, "jpeg".to_string()))
+        );
+        assert_eq!(plan(&request(FrameFormat::RawBgra, whole, 0.0)), png(false));
+        assert_eq!(plan(&request(FrameFormat::Png, whole, 0.5)), png(false));
+        assert_eq!(
+            plan(&request(FrameFormat::Png, [0, 0, 4, 4], 0.0)),
+            png(false)
+        );
+        // A crop only counts once it has an area.
+        assert_eq!(
+            plan(&request(FrameFormat::Png, [5, 5, 0, 4], 0.0)),
+            png(true)
+        );
+
+        // Any quality but the default is a re-encode of the PNG.
+        let mut custom = request(FrameFormat::Jpeg, whole, 0.0);
+        custom.jpeg_quality = 60;
+        assert_eq!(plan(&custom), png(false));
+    }
+
+    #[test]
+    fn unknown_formats_and_scales_are_rejected() {
+        let mut unknown = request(FrameFormat::Png, [0; 4], 0.0);
+        for format in [-1, 3] {
+            unknown.format = format;
+            assert_eq!(plan(&unknown), None, "format {}", format);
+        }
+        for scale in [-0.1, 1.0001, f64::NAN, f64::INFINITY] {
+            assert_eq!(
+                plan(&request(FrameFormat::RawBgra, [0; 4], scale)),
+                None,
+                "scale {}",
+                scale
+            );
+        }
+    }
+
+    #[test]
+    fn crops_are_clipped_to_the_screen_before_scaling() {
+        assert_eq!(
+            region([0; 4], 0.0),
+            Some(([0, 0, 1170, 2532], [1170, 2532]))
+        );
+        assert_eq!(
+            region([-10, -20, 100, 50], 0.0),
+            Some(([0, 0, 90, 30], [90, 30]))
+        );
+        assert_eq!(
+            region([1100, 2500, 200, 200], 0.0),
+            Some(([1100, 2500, 70, 32], [70, 32]))
+        );
+        // Widths that would overflow when added to the origin still clip.
+        assert_eq!(
+            region([10, 10, c_int::MAX, c_int::MAX], 0.0),
+            Some(([10, 10, 1160, 2522], [1160, 2522]))
+        );
+        assert_eq!(region([1170, 0, 10, 10], 0.0), None);
+        assert_eq!(region([-10, 0, 10, 10], 0.0), None);
+
+        // Halves round away from zero, and nothing shrinks below a pixel.
+        assert_eq!(region([0; 4], 0.25).unwrap().1, [293, 633]);
+        assert_eq!(region([0, 0, 3, 1], 0.1).unwrap().1, [1, 1]);
+    }
+
+    #[test]
+    fn pixels_are_addressed_by_row_stride() {
+        let frame = CapturedFrame {
+            format: FrameFormat::RawBgra,
+            width: 2,
+            height: 2,
+            bytes_per_row: 12,
+            captured_ms: 0.0,
+            data: (0..24).collect(),
+        };
+        assert_eq!(frame.pixel(1, 1), Some([16, 17, 18, 19]));
+        assert_eq!(frame.pixel(2, 0), None);
+        let encoded = CapturedFrame {
+            format: FrameFormat::Png,
+            ..frame
+        };
+        assert_eq!(encoded.pixel(0, 0), None);
+    }
+
+    #[test]
+    fn rejects_out_of_range_scale() {
+        let harness = RustTestHarness::new();
+        let request = FrameRequest::default().scaled(1.5);
+        assert!(harness.capture_frame(&request).is_err());
+    }
+}
@@ -0,0 +1,179 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::{Result, TestError};
+use serde::{Deserialize, Serialize};
+use std::ffi::CString;
+use std::os::raw::c_char;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum LaunchMethod {
+    /// The running app applied a deep link in process.
+    Warm,
+    /// The app was launched, or relaunched, to get there.
+    Cold,
+}
+
+/// What an app lifecycle request asks for. Apps that speak the warm-reset
+/// protocol (ArkavoReference's LaunchCommand) take it in process; others
+/// are relaunched with it as launch arguments.
+#[derive(Debug, Clone, Default, PartialEq, Serialize)]
+pub struct LaunchOptions {
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub screen: Option<String>,
+    /// Signed in once the request is applied.
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub user: Option<String>,
+    /// The app's URL scheme, "arkavo-reference" unless set.
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub scheme: Option<String>,
+    /// How long a warm reset may take before the app is relaunched instead.
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub timeout_ms: Option<u64>,
+}
+
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct LaunchReport {
+    pub action: String,
+    pub method: LaunchMethod,
+    /// From the request to the app confirming it, or to simctl returning.
+    pub elapsed_ms: f64,
+    /// The app reported rendering the requested state.
+    pub confirmed: bool,
+    /// Time simctl took to start the process, for cold launches.
+    pub launch_ms: Option<f64>,
+    pub pid: Option<u32>,
+    /// Why a warm reset fell back to relaunching.
+    pub fallback: Option<String>,
+}
+
+impl RustTestHarness {
+    /// Launches the bridge's app, leaving a running copy alone.
+    pub fn launch_app(&self, options: &LaunchOptions) -> Result<LaunchReport> {
+        self.app_lifecycle("launch", options)
+    }
+
+    pub fn relaunch_app(&self, options: &LaunchOptions) -> Result<LaunchReport> {
+        self.app_lifecycle("relaunch", options)
+    }
+
+    /// Fresh app state, on `options.screen` if set, preferably without a
+    /// cold launch; the report says which it took.
+    pub fn reset_app(&self, options: &LaunchOptions) -> Result<LaunchReport> {
+        self.app_lifecycle("reset", options)
+    }
+
+    /// Moves to `screen` keeping the app's state, like `reset_app`.
+    pub fn navigate_app(&self, screen: &str, options: &LaunchOptions) -> Result<LaunchReport> {
+        let options = LaunchOptions {
+            screen: Some(screen.to_string()),
+            ..options.clone()
+        };
+        self.app_lifecycle("navigate", &options)
+    }
+
+    fn app_lifecycle(&self, action: &str, options: &LaunchOptions) -> Result<LaunchReport> {
+        let bridge = self.connected_bridge()?;
+        let action_cstr = CString::new(action)
+            .map_err(|e| TestError::Bridge(format!("Invalid action string: {}", e)))?;
+        let data_cstr = CString::new(serde_json::to_string(options)?)
+            .map_err(|e| TestError::Bridge(format!("Invalid launch options: {}", e)))?;
+        unsafe {
+            take_reply(
+                ios_bridge_mutate_state(
+                    bridge,
+                    c"app".as_ptr(),
+                    action_cstr.as_ptr(),
+                    data_cstr.as_ptr(),
+                ),
+                "lifecycle result",
+            )
+        }
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_mutate_state(
+        bridge: *mut IOSBridge,
+        entity: *const c_char,
+        action: *const c_char,
+        data: *const c_char,
+    ) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::bridge::ios_ffi_probe::ring::{COMMAND, Reader, RingFile, TOUCH_DOWN};
+
+    // Warm resets are confirmed by the command record the app writes to
+    // its probe ring; these drive the real wait against ring files.
+    #[test]
+    fn confirmation_needs_the_token_after_the_mark() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 16, 1);
+        ring.publish(
+            3,
+            TOUCH_DOWN,
+            |sequence| if sequence == 2 { 7.0 } else { 0.0 },
+        );
+        ring.publish(4, COMMAND, |_| 7.0);
+        ring.publish(5, COMMAND, |_| 9.0);
+        let reader = Reader::open(&ring.path);
+
+        let (status, ack, relaunched) = reader.wait_command(0, 7.0, 0.0);
+        assert_eq!(
+            (status, ack.sequence, ack.value, relaunched),
+            (1, 4, 7.0, false)
+        );
+        assert_eq!(reader.wait_command(3, 9.0, 0.0).1.sequence, 5);
+        // Already answered before the mark, so this is some earlier request.
+        assert_eq!(reader.wait_command(4, 7.0, 0.0).0, 0);
+        assert_eq!(reader.wait_command(0, 8.0, 0.0).0, 0);
+    }
+
+    #[test]
+    fn relaunched_app_confirms_from_its_new_session() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 16, 1);
+        ring.publish(5, TOUCH_DOWN, |_| 0.0);
+        let reader = Reader::open(&ring.path);
+        assert_eq!(reader.wait_command(5, 11.0, 0.0).0, 0);
+
+        ring.relaunch(2);
+        ring.publish(1, COMMAND, |_| 11.0);
+        let (status, ack, relaunched) = reader.wait_command(5, 11.0, 0.0);
+        assert_eq!((status, ack.sequence, relaunched), (1, 1, true));
+    }
+
+    #[test]
+    fn apps_without_a_ring_cannot_confirm() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 4, 1);
+        let reader = Reader::open(&ring.path);
+        assert_eq!(reader.wait_command(0, 7.0, 0.0).0, -1);
+
+        // Once the ring exists, missing the ack is a timeout instead. The
+        // ack is overwritten here before the wait reads it.
+        ring.publish(1, COMMAND, |_| 7.0);
+        ring.publish(5, TOUCH_DOWN, |_| 0.0);
+        assert_eq!(reader.wait_command(0, 7.0, 0.0).0, 0);
+    }
+
+    #[test]
+    fn options_leave_out_unset_fields() {
+        let options = LaunchOptions {
+            screen: Some("forms".to_string()),
+            timeout_ms: Some(500),
+            ..LaunchOptions::default()
+        };
+        assert_eq!(
+            serde_json::to_string(&options).unwrap(),
+            r#"{"screen":"forms","timeout_ms":500}"#
+        );
+        assert_eq!(
+            serde_json::to_string(&LaunchOptions::default()).unwrap(),
+            "{}"
+        );
+    }
+}
@@ -0,0 +1,324 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::{Result, TestError};
+use serde::{Deserialize, Serialize};
+use std::ffi::CString;
+use std::os::raw::{c_char, c_int};
+use std::time::Duration;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "snake_case")]
+pub enum LogLevel {
+    Default,
+    Info,
+    Debug,
+}
+
+/// Which unified-log entries the tap keeps. `subsystem` and `process` are
+/// exact matches; `predicate` is extra NSPredicate text ANDed with them.
+#[derive(Debug, Clone, PartialEq, Serialize)]
+pub struct LogTapConfig {
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub subsystem: Option<String>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub process: Option<String>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub predicate: Option<String>,
+    pub level: LogLevel,
+    /// Entries held before the oldest are dropped.
+    pub capacity: usize,
+}
+
+impl Default for LogTapConfig {
+    fn default() -> Self {
+        Self {
+            subsystem: None,
+            process: None,
+            predicate: None,
+            level: LogLevel::Info,
+            capacity: 4096,
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct LogEntry {
+    pub sequence: u64,
+    /// On the bridge's monotonic clock, like frame capture times, so an
+    /// entry can be placed between the actions around it.
+    pub mono_ms: f64,
+    /// As the simulator printed it, with its time zone.
+    pub timestamp: String,
+    pub level: String,
+    pub process: String,
+    pub pid: i64,
+    pub subsystem: String,
+    pub category: String,
+    pub message: String,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct LogBatch {
+    pub entries: Vec<LogEntry>,
+    /// Pass to the next read to continue after these entries.
+    pub cursor: u64,
+    /// Entries the ring lost before they could be read.
+    pub dropped: u64,
+    /// False once the log stream ended, e.g. because the simulator shut down.
+    pub running: bool,
+    pub now_ms: f64,
+}
+
+#[repr(C)]
+pub struct RawLogTap {
+    _private: [u8; 0],
+}
+
+/// A live tap on the simulator's unified log. Entries collect in a bounded
+/// ring on a native thread; reads are cursor-based, so each one only returns
+/// what arrived since the last. Dropping the tap stops the log stream.
+pub struct LogTap {
+    raw: *mut RawLogTap,
+}
+
+// The native tap guards its ring with a mutex and is never tied to the
+// thread that started it.
+unsafe impl Send for LogTap {}
+unsafe impl Sync for LogTap {}
+
+impl LogTap {
+    /// Up to `max_entries` entries after `cursor` (0 for everything held),
+    /// waiting up to `timeout` for the first one. An empty batch is a timeout.
+    pub fn read(&self, cursor: u64, max_entries: usize, timeout: Duration) -> Result<LogBatch> {
+        let max_entries = c_int::try_from(max_entries).unwrap_or(c_int::MAX);
+        let timeout_ms = timeout.as_millis().min(c_int::MAX as u128) as c_int;
+        unsafe {
+            take_reply(
+                ios_bridge_read_logs(self.raw, cursor, max_entries, timeout_ms),
+                "log read",
+            )
+        }
+    }
+}
+
+impl Drop for LogTap {
+    fn drop(&mut self) {
+        unsafe { ios_bridge_log_stop(self.raw) };
+    }
+}
+
+impl RustTestHarness {
+    pub fn start_log_tap(&self, config: &LogTapConfig) -> Result<LogTap> {
+        if config.capacity == 0 {
+            return Err(TestError::Bridge(
+                "Log tap capacity must be at least 1".to_string(),
+            ));
+        }
+        let options = CString::new(serde_json::to_string(config)?)
+            .map_err(|e| TestError::Bridge(format!("Invalid log tap options: {}", e)))?;
+
+        let bridge = self.connected_bridge()?;
+        let raw = unsafe { ios_bridge_log_start(bridge, options.as_ptr()) };
+        if raw.is_null() {
+            return Err(TestError::Bridge("Failed to start log tap".to_string()));
+        }
+        Ok(LogTap { raw })
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_log_start(bridge: *mut IOSBridge, options: *const c_char) -> *mut RawLogTap;
+    fn ios_bridge_log_stop(tap: *mut RawLogTap);
+    fn ios_bridge_read_logs(
+        tap: *mut RawLogTap,
+        cursor: u64,
+        max_entries: c_int,
+        timeout_ms: c_int,
+    ) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+    use std::ffi::CStr;
+
+    #[repr(C)]
+    #[derive(Clone, Copy, Default)]
+    struct JsonToken {
+        kind: c_int,
+        start: c_int,
+        end: c_int,
+        size: c_int,
+        parent: c_int,
+    }
+
+    #[repr(C)]
+    struct JsonParser {
+        pos: usize,
+        next: c_int,
+        parent: c_int,
+    }
+
+    const JSON_ERROR_INVALID: c_int = -2;
+    const JSON_ERROR_PARTIAL: c_int = -3;
+
+    unsafe extern "C" {
+        fn ios_log_entry_from_ndjson(
+            line: *const c_char,
+            length: usize,
+            sequence: u64,
+            clock_offset_ms: f64,
+            received_ms: f64,
+        ) -> *mut c_char;
+        fn ios_json_init(parser: *mut JsonParser);
+        fn ios_json_parse(
+            parser: *mut JsonParser,
+            json: *const c_char,
+            length: usize,
+            tokens: *mut JsonToken,
+            token_count: u32,
+        ) -> c_int;
+        fn ios_json_unescape(
+            json: *const c_char,
+            token: *const JsonToken,
+            out: *mut c_char,
+            out_size: usize,
+        ) -> c_int;
+        fn ios_bridge_free_string(s: *mut c_char);
+    }
+
+    // Entries go out inside read batches, so each must be JSON on its own.
+    fn entry(line: &[u8]) -> Option<LogEntry> {
+        let raw = unsafe {
+            ios_log_entry_from_ndjson(line.as_ptr() as *const c_char, line.len(), 7, 1000.0, 42.0)
+        };
+        if raw.is_null() {
+            return None;
+        }
+        let text = unsafe { CStr::from_ptr(raw) }.to_bytes().to_vec();
+        unsafe { ios_bridge_free_string(raw) };
+        Some(serde_json::from_slice(&text).expect("entry is valid JSON"))
+    }
+
+    fn tokenize(json: &[u8]) -> (c_int, Vec<JsonToken>) {
+        let mut parser = JsonParser {
+            pos: 0,
+            next: 0,
+            parent: 0,
+        };
+        let mut tokens = vec![JsonToken::default(); 32];
+        unsafe { ios_json_init(&mut parser) };
+        let count = unsafe {
+            ios_json_parse(
+                &mut parser,
+                json.as_ptr() as *const c_char,
+                json.len(),
+                tokens.as_mut_ptr(),
+                tokens.len() as u32,
+            )
+        };
+        (count, tokens)
+    }
+
+    const EVENT: &[u8] = br#"{"eventType": "logEvent", "timestamp": "1970-01-01 00:00:01.250000+0000", "messageType": "Error", "processImagePath": "\/Applications\/App.app\/App", "processID": 42, "subsystem": "com.arkavo.app", "category": "net", "eventMessage": "tap \"OK\"\nthen \u00e9"}"#;
+
+    #[test]
+    fn log_stream_events_become_entries() {
+        let event = entry(EVENT).unwrap();
+        assert_eq!(event.sequence, 7);
+        assert_eq!(event.mono_ms, 250.0);
+        assert_eq!(event.level, "error");
+        assert_eq!(event.process, "App");
+        assert_eq!(event.pid, 42);
+        assert_eq!(event.message, "tap \"OK\"\nthen \u{e9}");
+
+        let zoned = br#"{"eventType": "logEvent", "timestamp": "1970-01-01 00:00:00.000000-0130"}"#;
+        assert_eq!(entry(zoned).unwrap().mono_ms, 5_400_000.0 - 1000.0);
+    }
+
+    #[test]
+    fn unusable_fields_fall_back() {
+        let sparse = entry(
+            br#"{"eventType": "logEvent", "timestamp": "yesterday", "processID": "42",
+                "eventMessage": null}"#,
+        )
+        .unwrap();
+        assert_eq!(sparse.mono_ms, 42.0);
+        assert_eq!(sparse.pid, 0);
+        assert_eq!(sparse.message, "");
+        assert_eq!(sparse.process, "");
+    }
+
+    #[test]
+    fn only_whole_log_events_are_kept() {
+        assert!(entry(br#"{"eventType": "activityCreateEvent"}"#).is_none());
+        assert!(entry(br#"{"nested": {"eventType": "logEvent"}}"#).is_none());
+        assert!(entry(br#"["logEvent"]"#).is_none());
+        assert!(entry(b"Filtering the log data using \"subsystem\"").is_none());
+        for end in 0..EVENT.len() {
+            assert!(entry(&EVENT[..end]).is_none(), "prefix of {end} bytes");
+        }
+
+        // A raw newline or an unknown escape is not JSON, and splicing it
+        // into a batch would break the whole batch.
+        assert!(entry(b"{\"eventType\": \"logEvent\", \"eventMessage\": \"a\nb\"}").is_none());
+        assert!(entry(br#"{"eventType": "logEvent", "eventMessage": "\x41"}"#).is_none());
+        // Input ends at a NUL, whatever length the caller passed.
+        let mut cut = EVENT[..40].to_vec();
+        cut.extend_from_slice(b"\0\"}");
+        assert!(entry(&cut).is_none());
+    }
+
+    #[test]
+    fn truncated_documents_are_partial_not_invalid() {
+        let document = br#"{"a": "x\"\u00e9", "b": [1, true, null]}"#;
+        assert_eq!(tokenize(document).0, 8);
+        for end in 1..document.len() {
+            assert_eq!(
+                tokenize(&document[..end]).0,
+                JSON_ERROR_PARTIAL,
+                "prefix of {end} bytes"
+            );
+        }
+        assert_eq!(tokenize(br#"{"a": "\u00g9"}"#).0, JSON_ERROR_INVALID);
+        assert_eq!(tokenize(br#"{"a" 1}"#).0, JSON_ERROR_INVALID);
+    }
+
+    #[test]
+    fn unescaping_keeps_embedded_nuls_and_pairs_surrogates() {
+        let unescape = |json: &[u8]| {
+            let (count, tokens) = tokenize(json);
+            assert_eq!(count, 1);
+            let mut out = vec![0u8; json.len() + 1];
+            let length = unsafe {
+                ios_json_unescape(
+                    json.as_ptr() as *const c_char,
+                    &tokens[0],
+                    out.as_mut_ptr() as *mut c_char,
+                    out.len(),
+                )
+            };
+            (length >= 0).then(|| out[..length as usize].to_vec())
+        };
+        assert_eq!(
+            unescape(br#""a\u0000b\ud83d\ude00\/""#).unwrap(),
+            b"a\0b\xf0\x9f\x98\x80/".to_vec()
+        );
+        assert!(unescape(br#""\ud83d alone""#).is_none());
+        assert!(unescape(br#""\ude00""#).is_none());
+    }
+
+    #[test]
+    fn config_serializes_with_bridge_names() {
+        let config = LogTapConfig {
+            subsystem: Some("com.arkavo.app".to_string()),
+            level: LogLevel::Debug,
+            ..LogTapConfig::default()
+        };
+        assert_eq!(
+            serde_json::to_value(config).unwrap(),
+            json!({"subsystem": "com.arkavo.app", "level": "debug", "capacity": 4096})
+        );
+    }
+}
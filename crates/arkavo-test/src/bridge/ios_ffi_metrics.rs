@@ -0,0 +1,184 @@
+use super::ios_ffi::IOSBridge;
+use super::ios_ffi_buffer::take_reply;
+use crate::Result;
+use serde::{Deserialize, Serialize};
+use std::os::raw::c_char;
+use std::ptr;
+
+/// Latency distribution of one bridge operation, such as `action.tap`,
+/// `snapshot.restore` or `simctl.terminate`. Percentiles are bucket midpoints
+/// of log-linear buckets, 16 to a power of two, so they are within 1/32 to
+/// 1/64 of the true value; min and max are exact.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct OperationLatency {
+    pub name: String,
+    pub count: u64,
+    pub total_ms: f64,
+    pub min_ms: f64,
+    pub max_ms: f64,
+    pub mean_ms: f64,
+    pub p50_ms: f64,
+    pub p90_ms: f64,
+    pub p99_ms: f64,
+}
+
+/// Every operation the bridge has timed since start-up or the last reset,
+/// sorted by name.
+#[derive(Debug, Clone, Default, PartialEq, Serialize, Deserialize)]
+pub struct BridgeMetrics {
+    pub metrics: Vec<OperationLatency>,
+}
+
+impl BridgeMetrics {
+    pub fn get(&self, name: &str) -> Option<&OperationLatency> {
+        self.metrics.iter().find(|metric| metric.name == name)
+    }
+
+    /// Operations whose name starts with `prefix`, e.g. `"action."`.
+    pub fn with_prefix<'a>(
+        &'a self,
+        prefix: &'a str,
+    ) -> impl Iterator<Item = &'a OperationLatency> {
+        self.metrics
+            .iter()
+            .filter(move |metric| metric.name.starts_with(prefix))
+    }
+}
+
+/// The histograms are shared by every bridge in the process, so reading them
+/// needs no connected harness.
+pub fn bridge_metrics() -> Result<BridgeMetrics> {
+    unsafe { take_reply(ios_bridge_get_metrics(ptr::null_mut()), "metrics") }
+}
+
+pub fn reset_bridge_metrics() {
+    unsafe { ios_bridge_reset_metrics(ptr::null_mut()) }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_get_metrics(bridge: *mut IOSBridge) -> *mut c_char;
+    fn ios_bridge_reset_metrics(bridge: *mut IOSBridge);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::ffi::CString;
+    use std::thread;
+
+    #[repr(C)]
+    struct Span {
+        name: [c_char; 48],
+        started_ms: f64,
+        signpost: u64,
+    }
+
+    unsafe extern "C" {
+        fn ios_metrics_record(name: *const c_char, elapsed_ms: f64);
+        fn ios_metrics_begin(span: *mut Span, kind: *const c_char, detail: *const c_char);
+        fn ios_metrics_end(span: *mut Span) -> f64;
+    }
+
+    fn record(name: &str, elapsed_ms: f64) {
+        let name = CString::new(name).unwrap();
+        unsafe { ios_metrics_record(name.as_ptr(), elapsed_ms) };
+    }
+
+    fn within_a_bucket(reported: f64, exact: f64) -> bool {
+        (reported - exact).abs() <= exact / 32.0
+    }
+
+    // The histograms are process-wide and a reset clears every name, so
+    // this is the only test that records into them.
+    #[test]
+    fn histograms_record_summarize_and_reset() {
+        reset_bridge_metrics();
+        for ms in 1..=100 {
+            record("test.linear", ms as f64);
+        }
+        // Below 32us every microsecond has a bucket of its own.
+        for us in [3.0, 7.0, 7.0, 31.0] {
+            record("test.small", us / 1000.0);
+        }
+        record("test.single", 123.456);
+        record("test.clamped", -5.0);
+        record("test.clamped", 1e9);
+        let long_name = format!("test.{}", "x".repeat(60));
+        record(&long_name, 1.0);
+
+        let mut span = Span {
+            name: [0; 48],
+            started_ms: 0.0,
+            signpost: 0,
+        };
+        unsafe { ios_metrics_begin(&mut span, c"test".as_ptr(), c"span".as_ptr()) };
+        let elapsed = unsafe { ios_metrics_end(&mut span) };
+
+        let writers: Vec<_> = (0..4)
+            .map(|_| thread::spawn(|| (0..1000).for_each(|_| record("test.threads", 2.0))))
+            .collect();
+        writers.into_iter().for_each(|w| w.join().unwrap());
+
+        let metrics = bridge_metrics().unwrap();
+        let names: Vec<&str> = metrics
+            .with_prefix("test.")
+            .map(|m| m.name.as_str())
+            .collect();
+        let mut sorted = names.clone();
+        sorted.sort();
+        assert_eq!(names, sorted);
+
+        let linear = metrics.get("test.linear").unwrap();
+        assert_eq!(linear.count, 100);
+        assert_eq!((linear.min_ms, linear.max_ms), (1.0, 100.0));
+        assert!((linear.total_ms - 5050.0).abs() < 1e-6);
+        assert!((linear.mean_ms - 50.5).abs() < 1e-6);
+        assert!(within_a_bucket(linear.p50_ms, 50.0), "{}", linear.p50_ms);
+        assert!(within_a_bucket(linear.p90_ms, 90.0), "{}", linear.p90_ms);
+        assert!(within_a_bucket(linear.p99_ms, 99.0), "{}", linear.p99_ms);
+        assert!(linear.p99_ms <= linear.max_ms);
+
+        let small = metrics.get("test.small").unwrap();
+        assert_eq!((small.p50_ms, small.p90_ms), (0.007, 0.031));
+
+        // One sample is every percentile, exactly, despite the bucket width.
+        let single = metrics.get("test.single").unwrap();
+        assert_eq!((single.p50_ms, single.p99_ms), (123.456, 123.456));
+
+        // Negative times count as zero. Times past the ~19 hours the buckets
+        // cover all land in the top one, so only min and max stay exact.
+        let clamped = metrics.get("test.clamped").unwrap();
+        assert_eq!(
+            (clamped.min_ms, clamped.max_ms, clamped.p50_ms),
+            (0.0, 1e9, 0.0)
+        );
+        assert!(clamped.p99_ms > 18.0 * 3_600_000.0 && clamped.p99_ms < 20.0 * 3_600_000.0);
+
+        let truncated = metrics.with_prefix("test.xxx").next().unwrap();
+        assert_eq!(truncated.name.len(), 47);
+        assert!(long_name.starts_with(&truncated.name));
+
+        let span = metrics.get("test.span").unwrap();
+        assert_eq!(span.count, 1);
+        assert!((span.total_ms - elapsed).abs() < 0.001);
+
+        assert_eq!(metrics.get("test.threads").unwrap().count, 4000);
+
+        // Reset keeps the names, so recorders racing it keep valid slots.
+        reset_bridge_metrics();
+        let metrics = bridge_metrics().unwrap();
+        let linear = metrics.get("test.linear").unwrap();
+        assert_eq!(linear.count, 0);
+        assert_eq!(
+            (linear.min_ms, linear.max_ms, linear.p99_ms),
+            (0.0, 0.0, 0.0)
+        );
+        record("test.linear", 4.0);
+        let linear = bridge_metrics()
+            .unwrap()
+            .get("test.linear")
+            .unwrap()
+            .clone();
+        assert_eq!((linear.count, linear.min_ms, linear.p50_ms), (1, 4.0, 4.0));
+    }
+}
@@ -0,0 +1,285 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use crate::{Result, TestError};
+use std::ffi::CString;
+use std::os::raw::{c_char, c_int};
+use std::sync::Arc;
+use std::time::Duration;
+
+#[repr(C)]
+pub struct RawBridgePool {
+    _private: [u8; 0],
+}
+
+#[repr(C)]
+struct RawDeviceFilter {
+    runtime: *const c_char,
+    device_type: *const c_char,
+    booted_only: c_int,
+    least_loaded: c_int,
+}
+
+/// Restricts which pooled simulators a checkout may use. Both fields match
+/// substrings, so `runtime: Some("iOS-17")` or `model: Some("iPad")` select a
+/// family; `model` matches the device type identifier or the device name.
+#[derive(Debug, Clone, Default)]
+pub struct DeviceFilter {
+    pub runtime: Option<String>,
+    pub model: Option<String>,
+}
+
+/// A fixed set of simulators, one bridge each. Already booted simulators are
+/// borrowed; the rest are created from the first booted one and deleted again
+/// when the pool is dropped.
+pub struct BridgePool {
+    raw: *mut RawBridgePool,
+}
+
+// Checkouts are serialized by the native pool's mutex, and each bridge is
+// handed to one lease at a time.
+unsafe impl Send for BridgePool {}
+unsafe impl Sync for BridgePool {}
+
+impl BridgePool {
+    /// Blocks until `size` simulators are booted, so call it from a blocking
+    /// context.
+    pub fn create(size: usize, bundle_id: &str) -> Result<Self> {
+        let bundle_id = CString::new(bundle_id)
+            .map_err(|_| TestError::Bridge("Bundle id contains a NUL byte".to_string()))?;
+        let size = c_int::try_from(size)
+            .map_err(|_| TestError::Bridge(format!("Pool size {} is too large", size)))?;
+
+        let raw = unsafe { ios_bridge_pool_create(size, bundle_id.as_ptr()) };
+        if raw.is_null() {
+            return Err(TestError::Bridge(format!(
+                "Failed to bring up a pool of {} simulators",
+                size
+            )));
+        }
+        Ok(Self { raw })
+    }
+
+    pub fn size(&self) -> usize {
+        unsafe { ios_bridge_pool_size(self.raw) as usize }
+    }
+
+    /// Check out a free bridge, waiting up to `timeout` (forever when `None`)
+    /// for another lease to be dropped.
+    pub fn acquire(self: &Arc<Self>, timeout: Option<Duration>) -> Result<BridgeLease> {
+        let bridge = unsafe { ios_bridge_pool_acquire(self.raw, timeout_ms(timeout)) };
+        self.lease(bridge)
+    }
+
+    /// Check out a free bridge whose simulator matches `filter`. Fails at
+    /// once when no member of the pool matches.
+    pub fn acquire_matching(
+        self: &Arc<Self>,
+        filter: &DeviceFilter,
+        timeout: Option<Duration>,
+    ) -> Result<BridgeLease> {
+        let runtime = optional_cstring(filter.runtime.as_deref())?;
+        let model = optional_cstring(filter.model.as_deref())?;
+        let raw = RawDeviceFilter {
+            runtime: runtime.as_ref().map_or(std::ptr::null(), |s| s.as_ptr()),
+            device_type: model.as_ref().map_or(std::ptr::null(), |s| s.as_ptr()),
+            booted_only: 0,
+            least_loaded: 0,
+        };
+        let bridge =
+            unsafe { ios_bridge_pool_acquire_matching(self.raw, &raw, timeout_ms(timeout)) };
+        self.lease(bridge)
+    }
+
+    fn lease(self: &Arc<Self>, bridge: *mut IOSBridge) -> Result<BridgeLease> {
+        if bridge.is_null() {
+            return Err(TestError::Bridge(
+                "Timed out waiting for a free simulator".to_string(),
+            ));
+        }
+        Ok(BridgeLease {
+            pool: Arc::clone(self),
+            bridge,
+        })
+    }
+}
+
+fn timeout_ms(timeout: Option<Duration>) -> c_int {
+    timeout.map_or(-1, |t| t.as_millis().min(c_int::MAX as u128) as c_int)
+}
+
+fn optional_cstring(value: Option<&str>) -> Result<Option<CString>> {
+    value
+        .map(CString::new)
+        .transpose()
+        .map_err(|_| TestError::Bridge("Device filter contains a NUL byte".to_string()))
+}
+
+impl Drop for BridgePool {
+    fn drop(&mut self) {
+        unsafe { ios_bridge_pool_destroy(self.raw) };
+    }
+}
+
+/// Exclusive use of one pooled bridge, returned to the pool on drop.
+pub struct BridgeLease {
+    pool: Arc<BridgePool>,
+    bridge: *mut IOSBridge,
+}
+
+// Only the lease holder drives the bridge, from whichever thread holds it.
+unsafe impl Send for BridgeLease {}
+
+impl BridgeLease {
+    /// A harness driving the leased bridge. It does not own the bridge and
+    /// must be dropped before the lease.
+    pub fn harness(&self) -> RustTestHarness {
+        let mut harness = RustTestHarness::new();
+        harness.connect_ios_bridge(self.bridge);
+        harness
+    }
+}
+
+impl Drop for BridgeLease {
+    fn drop(&mut self) {
+        unsafe { ios_bridge_pool_release(self.pool.raw, self.bridge) };
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_pool_create(size: c_int, bundle_id: *const c_char) -> *mut RawBridgePool;
+    fn ios_bridge_pool_destroy(pool: *mut RawBridgePool);
+    fn ios_bridge_pool_size(pool: *const RawBridgePool) -> c_int;
+    fn ios_bridge_pool_acquire(pool: *mut RawBridgePool, timeout_ms: c_int) -> *mut IOSBridge;
+    fn ios_bridge_pool_acquire_matching(
+        pool: *mut RawBridgePool,
+        filter: *const RawDeviceFilter,
+        timeout_ms: c_int,
+    ) -> *mut IOSBridge;
+    fn ios_bridge_pool_release(pool: *mut RawBridgePool, bridge: *mut IOSBridge);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::os::raw::c_void;
+    use std::ptr;
+    use std::thread;
+    use std::time::Instant;
+
+    unsafe extern "C" {
+        fn ios_pool_checkout_create(count: c_int) -> *mut c_void;
+        fn ios_pool_checkout_destroy(checkout: *mut c_void);
+        fn ios_pool_checkout_acquire(
+            checkout: *mut c_void,
+            eligible: *const c_int,
+            timeout_ms: c_int,
+        ) -> c_int;
+        fn ios_pool_checkout_release(checkout: *mut c_void, index: c_int);
+    }
+
+    /// The checkout the pool lends its bridges through, which is all of the
+    /// pool that runs without simulators.
+    struct Checkout(*mut c_void);
+
+    // The native checkout serializes on its own mutex.
+    unsafe impl Send for Checkout {}
+    unsafe impl Sync for Checkout {}
+
+    impl Checkout {
+        fn new(count: c_int) -> Self {
+            let raw = unsafe { ios_pool_checkout_create(count) };
+            assert!(!raw.is_null());
+            Checkout(raw)
+        }
+
+        fn acquire(&self, eligible: Option<&[c_int]>, timeout_ms: c_int) -> c_int {
+            let eligible = eligible.map_or(ptr::null(), |members| members.as_ptr());
+            unsafe { ios_pool_checkout_acquire(self.0, eligible, timeout_ms) }
+        }
+
+        fn release(&self, index: c_int) {
+            unsafe { ios_pool_checkout_release(self.0, index) }
+        }
+    }
+
+    impl Drop for Checkout {
+        fn drop(&mut self) {
+            unsafe { ios_pool_checkout_destroy(self.0) }
+        }
+    }
+
+    #[test]
+    fn rejects_bundle_ids_with_nul_bytes() {
+        assert!(BridgePool::create(1, "com.example\0app").is_err());
+    }
+
+    #[cfg(not(any(target_os = "macos", target_os = "ios")))]
+    #[test]
+    fn no_pool_without_simulators() {
+        let error = BridgePool::create(2, "com.example.app").err().unwrap();
+        assert!(error.to_string().contains("pool of 2"));
+    }
+
+    #[test]
+    fn each_member_is_lent_to_one_holder_at_a_time() {
+        let checkout = Checkout::new(3);
+        let mut held: Vec<c_int> = (0..3).map(|_| checkout.acquire(None, 0)).collect();
+        held.sort();
+        assert_eq!(held, vec![0, 1, 2]);
+        assert_eq!(checkout.acquire(None, 0), -1);
+
+        checkout.release(1);
+        assert_eq!(checkout.acquire(None, 0), 1);
+        // Indexes outside the pool are not members and change nothing.
+        checkout.release(-1);
+        checkout.release(3);
+        assert_eq!(checkout.acquire(None, 0), -1);
+    }
+
+    #[test]
+    fn filtered_checkouts_wait_for_a_matching_member() {
+        let checkout = Checkout::new(3);
+        let only_middle = [0, 1, 0];
+        assert_eq!(checkout.acquire(Some(&only_middle), 0), 1);
+
+        // Idle members that do not match are no use to the caller.
+        let started = Instant::now();
+        assert_eq!(checkout.acquire(Some(&only_middle), 30), -1);
+        assert!(started.elapsed() >= Duration::from_millis(25));
+        assert_eq!(checkout.acquire(None, 0), 0);
+
+        // With nothing eligible there is nothing to wait for, even forever.
+        assert_eq!(checkout.acquire(Some(&[0, 0, 0]), -1), -1);
+        assert_eq!(Checkout::new(0).acquire(None, -1), -1);
+    }
+
+    #[test]
+    fn a_release_wakes_a_waiting_checkout() {
+        let checkout = Arc::new(Checkout::new(2));
+        assert_eq!(checkout.acquire(None, 0), 0);
+        assert_eq!(checkout.acquire(None, 0), 1);
+
+        // One waiter wants member 0 only, the other any member; releasing
+        // member 1 must not strand the first.
+        let waiters: Vec<_> = [Some([1, 0]), None]
+            .into_iter()
+            .map(|eligible| {
+                let checkout = Arc::clone(&checkout);
+                thread::spawn(move || checkout.acquire(eligible.as_ref().map(|e| &e[..]), -1))
+            })
+            .collect();
+        thread::sleep(Duration::from_millis(20));
+        checkout.release(1);
+        thread::sleep(Duration::from_millis(20));
+        checkout.release(0);
+
+        let mut got: Vec<c_int> = waiters.into_iter().map(|w| w.join().unwrap()).collect();
+        got.sort();
+        assert_eq!(got, vec![0, 1]);
+    }
+
+    #[test]
+    fn oversized_pools_are_refused() {
+        assert!(unsafe { ios_pool_checkout_create(33) }.is_null());
+        assert!(unsafe { ios_pool_checkout_create(-1) }.is_null());
+    }
+}
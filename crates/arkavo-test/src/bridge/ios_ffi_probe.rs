@@ -0,0 +1,380 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::{Result, TestError};
+use serde::Deserialize;
+use std::ffi::CString;
+use std::os::raw::{c_char, c_int};
+use std::time::Duration;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum ProbeEventKind {
+    TouchDown,
+    TouchUp,
+    /// The first frame the app rendered after a touch ended.
+    Render,
+    /// The first frame the app rendered after a lifecycle command.
+    Command,
+    #[serde(other)]
+    Unknown,
+}
+
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct ProbeEvent {
+    pub sequence: u64,
+    pub kind: ProbeEventKind,
+    /// On the bridge's monotonic clock, like frame capture and log times.
+    pub mono_ms: f64,
+    /// In points, where the app saw the touch.
+    pub x: f64,
+    pub y: f64,
+    /// For render events, the sequence of the touch they follow; for
+    /// command events, the command's token.
+    pub value: f64,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ProbeBatch {
+    pub events: Vec<ProbeEvent>,
+    /// Pass to the next read to continue after these events.
+    pub cursor: u64,
+    /// Events the app's ring overwrote before they could be read.
+    pub dropped: u64,
+    /// The app relaunched; sequences restarted and `cursor` follows them.
+    pub reset: bool,
+    pub now_ms: f64,
+}
+
+/// What the app reported for a tap, found under `"probe"` in tap results
+/// once a probe is attached. Unconfirmed taps never reached the app.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct TapConfirmation {
+    pub confirmed: bool,
+    pub x: Option<f64>,
+    pub y: Option<f64>,
+    pub offset_x: Option<f64>,
+    pub offset_y: Option<f64>,
+    /// From sending the touch to the app receiving it.
+    pub input_ms: Option<f64>,
+    pub hold_ms: Option<f64>,
+    /// From the touch ending to the next rendered frame.
+    pub render_ms: Option<f64>,
+}
+
+impl RustTestHarness {
+    /// Read input and render events from an app built with the probe
+    /// channel (ArkavoReference's ProbeChannel), `bundle_id` or the bridge's
+    /// own app. The app may launch later; events flow once it does.
+    pub fn attach_probe(&self, bundle_id: Option<&str>) -> Result<()> {
+        let bundle_cstr = bundle_id
+            .map(CString::new)
+            .transpose()
+            .map_err(|e| TestError::Bridge(format!("Invalid bundle id: {}", e)))?;
+        let bridge = self.connected_bridge()?;
+        let bundle_ptr = bundle_cstr
+            .as_ref()
+            .map_or(std::ptr::null(), |s| s.as_ptr());
+        if unsafe { ios_bridge_probe_attach(bridge, bundle_ptr) } != 0 {
+            return Err(TestError::Bridge(
+                "Failed to locate the app's data container for its probe".to_string(),
+            ));
+        }
+        Ok(())
+    }
+
+    pub fn detach_probe(&self) -> Result<()> {
+        let bridge = self.connected_bridge()?;
+        unsafe { ios_bridge_probe_detach(bridge) };
+        Ok(())
+    }
+
+    /// Up to `max_events` events after `cursor` (0 for everything held),
+    /// waiting up to `timeout` for the first one. An empty batch is a timeout.
+    pub fn read_probe(
+        &self,
+        cursor: u64,
+        max_events: usize,
+        timeout: Duration,
+    ) -> Result<ProbeBatch> {
+        let bridge = self.connected_bridge()?;
+        let max_events = c_int::try_from(max_events).unwrap_or(c_int::MAX);
+        let timeout_ms = timeout.as_millis().min(c_int::MAX as u128) as c_int;
+        unsafe {
+            take_reply(
+                ios_bridge_probe_read(bridge, cursor, max_events, timeout_ms),
+                "probe read",
+            )
+        }
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_probe_attach(bridge: *mut IOSBridge, bundle_id: *const c_char) -> c_int;
+    fn ios_bridge_probe_detach(bridge: *mut IOSBridge);
+    fn ios_bridge_probe_read(
+        bridge: *mut IOSBridge,
+        cursor: u64,
+        max_events: c_int,
+        timeout_ms: c_int,
+    ) -> *mut c_char;
+}
+
+#[cfg(test)]
+pub(super) mod ring {
+    use std::ffi::CString;
+    use std::os::raw::{c_char, c_int, c_void};
+    use std::path::{Path, PathBuf};
+
+    pub const TOUCH_DOWN: u16 = 1;
+    pub const COMMAND: u16 = 4;
+    const HEADER_SIZE: usize = 64;
+    const RECORD_SIZE: usize = 48;
+
+    #[repr(C)]
+    #[derive(Clone, Copy, Debug, Default, PartialEq)]
+    pub struct RawEvent {
+        pub sequence: u64,
+        pub kind: c_int,
+        pub mono_ms: f64,
+        pub x: f64,
+        pub y: f64,
+        pub value: f64,
+    }
+
+    unsafe extern "C" {
+        fn ios_probe_open(path: *const c_char) -> *mut c_void;
+        fn ios_probe_close(probe: *mut c_void);
+        fn ios_probe_read(
+            probe: *mut c_void,
+            cursor: *mut u64,
+            events: *mut RawEvent,
+            max: c_int,
+            dropped: *mut u64,
+            reset: *mut c_int,
+        ) -> c_int;
+        fn ios_probe_mapped(probe: *mut c_void) -> c_int;
+        fn ios_probe_wait_command(
+            probe: *mut c_void,
+            mark: u64,
+            token: f64,
+            deadline_ms: f64,
+            ack: *mut RawEvent,
+            relaunched: *mut c_int,
+        ) -> c_int;
+    }
+
+    /// A ring file written the way ProbeChannel.swift writes it, for the
+    /// real reader to map.
+    pub struct RingFile {
+        pub path: PathBuf,
+        capacity: u32,
+        session: u64,
+        pub records: Vec<(u64, u16, f64)>,
+    }
+
+    impl RingFile {
+        pub fn new(dir: &Path, capacity: u32, session: u64) -> Self {
+            RingFile {
+                path: dir.join("arkavo-probe.ring"),
+                capacity,
+                session,
+                records: Vec::new(),
+            }
+        }
+
+        /// Appends events up to `published` and rewrites the file; `value`
+        /// gives each event's value from its sequence.
+        pub fn publish(&mut self, published: u64, kind: u16, value: impl Fn(u64) -> f64) {
+            let first = self.records.len() as u64 + 1;
+            self.records
+                .extend((first..=published).map(|sequence| (sequence, kind, value(sequence))));
+            self.write(published);
+        }
+
+        pub fn relaunch(&mut self, session: u64) {
+            self.session = session;
+            self.records.clear();
+        }
+
+        pub fn write(&self, published: u64) {
+            let mut bytes = vec![0u8; HEADER_SIZE + self.capacity as usize * RECORD_SIZE];
+            bytes[0..4].copy_from_slice(b"ARKP");
+            bytes[4..8].copy_from_slice(&1u32.to_ne_bytes());
+            bytes[8..12].copy_from_slice(&self.capacity.to_ne_bytes());
+            bytes[12..16].copy_from_slice(&(RECORD_SIZE as u32).to_ne_bytes());
+            bytes[16..24].copy_from_slice(&published.to_ne_bytes());
+            bytes[24..32].copy_from_slice(&self.session.to_ne_bytes());
+            // Later records overwrite the slots of earlier ones, as in the app.
+            for &(sequence, kind, value) in &self.records {
+                let at =
+                    HEADER_SIZE + ((sequence - 1) % self.capacity as u64) as usize * RECORD_SIZE;
+                let record = &mut bytes[at..at + RECORD_SIZE];
+                record[0..8].copy_from_slice(&sequence.to_ne_bytes());
+                record[8..10].copy_from_slice(&kind.to_ne_bytes());
+                record[16..24].copy_from_slice(&(sequence as f64 * 10.0).to_ne_bytes());
+                record[40..48].copy_from_slice(&value.to_ne_bytes());
+            }
+            std::fs::write(&self.path, bytes).unwrap();
+        }
+    }
+
+    pub struct Reader(*mut c_void);
+
+    impl Reader {
+        pub fn open(path: &Path) -> Self {
+            let path = CString::new(path.to_str().unwrap()).unwrap();
+            let probe = unsafe { ios_probe_open(path.as_ptr()) };
+            assert!(!probe.is_null());
+            Reader(probe)
+        }
+
+        /// The events read, the dropped count and whether a relaunch reset
+        /// the cursor; None while no valid ring is mapped.
+        pub fn read(&self, cursor: &mut u64, max: usize) -> Option<(Vec<u64>, u64, bool)> {
+            let mut events = vec![RawEvent::default(); max];
+            let (mut dropped, mut reset) = (0, 0);
+            let count = unsafe {
+                ios_probe_read(
+                    self.0,
+                    cursor,
+                    events.as_mut_ptr(),
+                    max as c_int,
+                    &mut dropped,
+                    &mut reset,
+                )
+            };
+            let sequences = events[..usize::try_from(count).ok()?]
+                .iter()
+                .map(|event| event.sequence)
+                .collect();
+            Some((sequences, dropped, reset != 0))
+        }
+
+        pub fn mapped(&self) -> bool {
+            unsafe { ios_probe_mapped(self.0) != 0 }
+        }
+
+        pub fn wait_command(
+            &self,
+            mark: u64,
+            token: f64,
+            deadline_ms: f64,
+        ) -> (c_int, RawEvent, bool) {
+            let mut ack = RawEvent::default();
+            let mut relaunched = 0;
+            let status = unsafe {
+                ios_probe_wait_command(self.0, mark, token, deadline_ms, &mut ack, &mut relaunched)
+            };
+            (status, ack, relaunched != 0)
+        }
+    }
+
+    impl Drop for Reader {
+        fn drop(&mut self) {
+            unsafe { ios_probe_close(self.0) };
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::ring::{Reader, RingFile, TOUCH_DOWN};
+    use super::*;
+
+    #[test]
+    fn wrapped_ring_reports_what_it_overwrote() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 4, 1);
+        ring.publish(10, TOUCH_DOWN, |_| 0.0);
+        let reader = Reader::open(&ring.path);
+
+        // The slot after the newest may be mid-write, so of four slots only
+        // the newest three count.
+        let mut cursor = 0;
+        assert_eq!(
+            reader.read(&mut cursor, 16),
+            Some((vec![8, 9, 10], 7, false))
+        );
+        assert_eq!(cursor, 10);
+        assert_eq!(reader.read(&mut cursor, 16), Some((vec![], 0, false)));
+
+        ring.publish(13, TOUCH_DOWN, |_| 0.0);
+        assert_eq!(reader.read(&mut cursor, 2), Some((vec![11, 12], 0, false)));
+        assert_eq!(reader.read(&mut cursor, 2), Some((vec![13], 0, false)));
+
+        let mut ahead = 99;
+        assert_eq!(reader.read(&mut ahead, 16), Some((vec![], 0, false)));
+        assert_eq!(ahead, 13);
+    }
+
+    #[test]
+    fn stale_slots_count_as_dropped() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 8, 1);
+        ring.publish(3, TOUCH_DOWN, |_| 0.0);
+        // Published says 5, but slot 4 still holds nothing the writer
+        // finished, as after a torn write.
+        ring.records.push((5, TOUCH_DOWN, 0.0));
+        ring.write(5);
+
+        let reader = Reader::open(&ring.path);
+        let mut cursor = 0;
+        assert_eq!(
+            reader.read(&mut cursor, 16),
+            Some((vec![1, 2, 3, 5], 1, false))
+        );
+        assert_eq!(cursor, 5);
+    }
+
+    #[test]
+    fn relaunch_restarts_the_sequence() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 8, 1);
+        ring.publish(6, TOUCH_DOWN, |_| 0.0);
+        let reader = Reader::open(&ring.path);
+        let mut cursor = 0;
+        reader.read(&mut cursor, 16).unwrap();
+
+        ring.relaunch(2);
+        ring.publish(2, TOUCH_DOWN, |_| 0.0);
+        assert_eq!(reader.read(&mut cursor, 16), Some((vec![1, 2], 0, true)));
+        assert_eq!(reader.read(&mut cursor, 16), Some((vec![], 0, false)));
+    }
+
+    #[test]
+    fn malformed_rings_are_never_mapped() {
+        let dir = tempfile::tempdir().unwrap();
+        let mut ring = RingFile::new(dir.path(), 4, 1);
+        let reader = Reader::open(&ring.path);
+        assert!(!reader.mapped());
+        assert_eq!(reader.read(&mut 0, 4), None);
+
+        ring.publish(2, TOUCH_DOWN, |_| 0.0);
+        let good = std::fs::read(&ring.path).unwrap();
+        let corrupt = |edit: &dyn Fn(&mut Vec<u8>)| {
+            let mut bytes = good.clone();
+            edit(&mut bytes);
+            std::fs::write(&ring.path, bytes).unwrap();
+            Reader::open(&ring.path).mapped()
+        };
+        assert!(!corrupt(&|bytes| bytes[0] = b'X'));
+        assert!(!corrupt(&|bytes| bytes[4] = 2));
+        assert!(!corrupt(
+            &|bytes| bytes[8..12].copy_from_slice(&1u32.to_ne_bytes())
+        ));
+        assert!(!corrupt(&|bytes| bytes[12] = 40));
+        assert!(!corrupt(&|bytes| bytes.truncate(bytes.len() - 1)));
+        assert!(!corrupt(&|bytes| bytes.truncate(10)));
+
+        // A reader opened before the app wrote its ring picks it up.
+        std::fs::write(&ring.path, &good).unwrap();
+        assert!(reader.mapped());
+        assert_eq!(reader.read(&mut 0, 4).unwrap().0, vec![1, 2]);
+    }
+
+    #[test]
+    fn tap_confirmations_leave_out_what_the_app_never_saw() {
+        let missed: TapConfirmation = serde_json::from_str(r#"{"confirmed": false}"#).unwrap();
+        assert!(!missed.confirmed && missed.x.is_none() && missed.render_ms.is_none());
+    }
+}
@@ -0,0 +1,193 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::take_reply;
+use crate::Result;
+use serde::Deserialize;
+use std::os::raw::c_char;
+
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct VisibleElement {
+    #[serde(rename = "type")]
+    pub element_type: String,
+    pub identifier: String,
+    pub label: String,
+    #[serde(default)]
+    pub value: String,
+    pub enabled: bool,
+}
+
+/// Everything the explorer needs about the current screen, classified by the
+/// bridge in a single pass over one hierarchy snapshot.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct ScreenAnalysis {
+    pub screen: String,
+    /// Entries such as `tap:<identifier>`, `type:<identifier>` and `swipe:up`.
+    pub available_actions: Vec<String>,
+    pub visible_elements: Vec<VisibleElement>,
+    pub element_count: usize,
+}
+
+impl RustTestHarness {
+    pub fn analyze_screen(&self) -> Result<ScreenAnalysis> {
+        let bridge = self.connected_bridge()?;
+        unsafe { take_reply(ios_bridge_analyze_screen(bridge), "screen analysis") }
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_analyze_screen(bridge: *mut IOSBridge) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::{CStr, CString};
+    use std::os::raw::{c_char, c_int};
+
+    const OTHER: c_int = 0;
+    const BUTTON: c_int = 1;
+    const TEXT_FIELD: c_int = 2;
+    const TEXT_VIEW: c_int = 3;
+    const SWITCH: c_int = 4;
+    const SLIDER: c_int = 5;
+    const NAVIGATION_BAR: c_int = 6;
+
+    const SKIP: c_int = 0;
+    const LIST: c_int = 1;
+    const TAP: c_int = 2;
+    const TYPE: c_int = 3;
+
+    #[repr(C)]
+    #[derive(Clone, Copy)]
+    struct Rect {
+        x: f64,
+        y: f64,
+        width: f64,
+        height: f64,
+    }
+
+    unsafe extern "C" {
+        fn ios_analysis_classify(kind: c_int, frame: Rect, screen: Rect) -> c_int;
+        fn ios_analysis_verb(role: c_int) -> *const c_char;
+        fn ios_analysis_target(identifier: *const c_char, label: *const c_char) -> *const c_char;
+        fn ios_analysis_kind_name(kind: c_int) -> *const c_char;
+        fn ios_analysis_screen_name(identifier: *const c_char) -> *const c_char;
+    }
+
+    const SCREEN: Rect = Rect {
+        x: 0.0,
+        y: 0.0,
+        width: 390.0,
+        height: 844.0,
+    };
+
+    fn rect(x: f64, y: f64, width: f64, height: f64) -> Rect {
+        Rect {
+            x,
+            y,
+            width,
+            height,
+        }
+    }
+
+    fn classify(kind: c_int, frame: Rect) -> c_int {
+        unsafe { ios_analysis_classify(kind, frame, SCREEN) }
+    }
+
+    fn text(value: *const c_char) -> Option<String> {
+        (!value.is_null()).then(|| {
+            unsafe { CStr::from_ptr(value) }
+                .to_str()
+                .unwrap()
+                .to_string()
+        })
+    }
+
+    #[test]
+    fn only_interactive_kinds_are_listed() {
+        let button = rect(20.0, 100.0, 120.0, 44.0);
+        let roles: Vec<_> = [
+            OTHER,
+            BUTTON,
+            TEXT_FIELD,
+            TEXT_VIEW,
+            SWITCH,
+            SLIDER,
+            NAVIGATION_BAR,
+            99,
+        ]
+        .iter()
+        .map(|&kind| classify(kind, button))
+        .collect();
+        assert_eq!(roles, [SKIP, TAP, TYPE, LIST, LIST, LIST, SKIP, SKIP]);
+
+        let verbs: Vec<_> = [SKIP, LIST, TAP, TYPE]
+            .iter()
+            .map(|&role| text(unsafe { ios_analysis_verb(role) }))
+            .collect();
+        assert_eq!(verbs, [None, None, Some("tap".into()), Some("type".into())]);
+    }
+
+    #[test]
+    fn frames_must_overlap_the_screen() {
+        let on = |frame| classify(BUTTON, frame) == TAP;
+        assert!(on(rect(389.5, 843.5, 10.0, 10.0)));
+        assert!(on(rect(-100.0, -100.0, 1000.0, 2000.0)));
+        // Negative sizes extend back from the origin, as CGRect's do.
+        assert!(on(rect(400.0, 20.0, -20.0, 10.0)));
+
+        assert!(!on(rect(20.0, 100.0, 0.0, 44.0)));
+        assert!(!on(rect(20.0, 100.0, 120.0, 0.0)));
+        // Sharing an edge with the screen is not overlapping it.
+        assert!(!on(rect(390.0, 100.0, 50.0, 44.0)));
+        assert!(!on(rect(20.0, -44.0, 120.0, 44.0)));
+        assert!(!on(rect(f64::NAN, 100.0, 120.0, 44.0)));
+    }
+
+    #[test]
+    fn names_match_what_the_bridge_reports() {
+        let kinds: Vec<_> = [BUTTON, TEXT_FIELD, TEXT_VIEW, SWITCH, SLIDER, OTHER, 99]
+            .iter()
+            .map(|&kind| text(unsafe { ios_analysis_kind_name(kind) }).unwrap())
+            .collect();
+        assert_eq!(
+            kinds,
+            [
+                "button",
+                "textField",
+                "textView",
+                "switch",
+                "slider",
+                "other",
+                "other"
+            ]
+        );
+
+        let screen = |identifier: Option<&str>| {
+            let identifier = identifier.map(|value| CString::new(value).unwrap());
+            let pointer = identifier
+                .as_ref()
+                .map_or(std::ptr::null(), |value| value.as_ptr());
+            text(unsafe { ios_analysis_screen_name(pointer) })
+        };
+        assert_eq!(screen(Some("Login")), Some("LoginScreen".into()));
+        assert_eq!(screen(Some("Home")), Some("HomeScreen".into()));
+        assert_eq!(screen(Some("login")), None);
+        assert_eq!(screen(Some("")), None);
+        assert_eq!(screen(None), None);
+    }
+
+    #[test]
+    fn actions_target_the_identifier_then_the_label() {
+        let target = |identifier: Option<&str>, label: Option<&str>| {
+            let identifier = identifier.map(|value| CString::new(value).unwrap());
+            let label = label.map(|value| CString::new(value).unwrap());
+            let pointer =
+                |value: &Option<CString>| value.as_ref().map_or(std::ptr::null(), |v| v.as_ptr());
+            text(unsafe { ios_analysis_target(pointer(&identifier), pointer(&label)) }).unwrap()
+        };
+        assert_eq!(target(Some("login"), Some("Log In")), "login");
+        assert_eq!(target(Some(""), Some("Log In")), "Log In");
+        assert_eq!(target(None, Some("Log In")), "Log In");
+        assert_eq!(target(None, None), "");
+    }
+}
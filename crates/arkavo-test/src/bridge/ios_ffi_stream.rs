@@ -0,0 +1,353 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_buffer::{ReserveFn, ReservedBytes};
+use super::ios_ffi_frame::{CapturedFrame, FrameFormat, RawFrameInfo};
+use crate::{Result, TestError};
+use std::os::raw::{c_int, c_void};
+use std::time::Duration;
+
+const STREAM_OK: c_int = 0;
+const STREAM_TIMEOUT: c_int = 1;
+
+/// Frames are captured as raw BGRA at `scale`, hashed in `tile_size` pixel
+/// tiles, and count as a screen change once `min_changed_tiles` differ from
+/// the previous frame.
+#[derive(Debug, Clone, PartialEq)]
+pub struct StreamConfig {
+    /// Upper bound on the capture rate, capped at 30. Each frame is a
+    /// simctl screenshot, so the rate reached is usually lower; frames
+    /// report it as `measured_fps`.
+    pub fps: f64,
+    /// Ring slots kept by the bridge; consumers only ever see the newest.
+    pub capacity: usize,
+    pub scale: f64,
+    pub tile_size: u32,
+    pub min_changed_tiles: u32,
+}
+
+impl Default for StreamConfig {
+    fn default() -> Self {
+        Self {
+            fps: 4.0,
+            capacity: 4,
+            scale: 0.25,
+            tile_size: 16,
+            min_changed_tiles: 1,
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct StreamFrame {
+    pub frame: CapturedFrame,
+    /// Increases by one per captured frame, starting at 1.
+    pub sequence: u64,
+    pub changed_tiles: u32,
+    pub total_tiles: u32,
+    pub changed: bool,
+    /// Capture rate over recent frames; 0 for the first frame.
+    pub measured_fps: f64,
+}
+
+#[repr(C)]
+struct RawStreamConfig {
+    fps: f64,
+    capacity: c_int,
+    scale: f64,
+    tile_size: c_int,
+    min_changed_tiles: c_int,
+}
+
+#[repr(C)]
+#[derive(Default)]
+struct RawStreamFrameInfo {
+    frame: RawFrameInfo,
+    sequence: u64,
+    changed_tiles: c_int,
+    total_tiles: c_int,
+    changed: c_int,
+    measured_fps: f64,
+}
+
+#[repr(C)]
+pub struct RawFrameStream {
+    _private: [u8; 0],
+}
+
+/// A background capture of the simulator screen. The stream owns its own
+/// simctl worker, so actions on the harness keep running while it captures;
+/// dropping it stops the capture thread.
+pub struct FrameStream {
+    raw: *mut RawFrameStream,
+}
+
+// The native stream guards its state with a mutex and is never tied to the
+// thread that started it.
+unsafe impl Send for FrameStream {}
+unsafe impl Sync for FrameStream {}
+
+fn millis(duration: Duration) -> c_int {
+    duration.as_millis().min(c_int::MAX as u128) as c_int
+}
+
+fn wait_outcome(status: c_int) -> Result<bool> {
+    match status {
+        STREAM_OK => Ok(true),
+        STREAM_TIMEOUT => Ok(false),
+        _ => Err(TestError::Bridge(
+            "Frame stream stopped after repeated capture failures".to_string(),
+        )),
+    }
+}
+
+impl FrameStream {
+    /// Newest frame with a sequence above `after`, or None if none arrives
+    /// within `timeout`. Pass 0 to take whatever is newest.
+    pub fn next_frame(&self, after: u64, timeout: Duration) -> Result<Option<StreamFrame>> {
+        let mut info = RawStreamFrameInfo::default();
+        let (status, data) = ReservedBytes::fill(|reserve, context| unsafe {
+            ios_bridge_stream_next(
+                self.raw,
+                after,
+                millis(timeout),
+                reserve,
+                context,
+                &mut info,
+            )
+        });
+        if !wait_outcome(status)? {
+            return Ok(None);
+        }
+
+        Ok(Some(StreamFrame {
+            sequence: info.sequence,
+            changed_tiles: info.changed_tiles.max(0) as u32,
+            total_tiles: info.total_tiles.max(0) as u32,
+            changed: info.changed != 0,
+            measured_fps: info.measured_fps,
+            frame: info.frame.into_frame(FrameFormat::RawBgra, data),
+        }))
+    }
+
+    /// Sequence of the newest changed frame once one is newer than `after`,
+    /// or None on timeout.
+    pub fn wait_for_change(&self, after: u64, timeout: Duration) -> Result<Option<u64>> {
+        let mut sequence = 0;
+        let status = unsafe {
+            ios_bridge_stream_wait_change(self.raw, after, millis(timeout), &mut sequence)
+        };
+        Ok(wait_outcome(status)?.then_some(sequence))
+    }
+
+    /// Returns once captured frames have been unchanged for `quiet`, with the
+    /// newest sequence, or None if the screen is still moving at `timeout`.
+    pub fn wait_until_settled(&self, quiet: Duration, timeout: Duration) -> Result<Option<u64>> {
+        let mut sequence = 0;
+        let status = unsafe {
+            ios_bridge_stream_wait_settled(self.raw, millis(quiet), millis(timeout), &mut sequence)
+        };
+        Ok(wait_outcome(status)?.then_some(sequence))
+    }
+}
+
+impl Drop for FrameStream {
+    fn drop(&mut self) {
+        unsafe { ios_bridge_stream_stop(self.raw) };
+    }
+}
+
+impl RustTestHarness {
+    pub fn start_frame_stream(&self, config: &StreamConfig) -> Result<FrameStream> {
+        if !(config.fps > 0.0) || !(config.scale > 0.0 && config.scale <= 1.0) {
+            return Err(TestError::Bridge(format!(
+                "Frame stream needs fps > 0 and scale in (0, 1], got {} and {}",
+                config.fps, config.scale
+            )));
+        }
+
+        let raw_config = RawStreamConfig {
+            fps: config.fps,
+            capacity: c_int::try_from(config.capacity).unwrap_or(c_int::MAX),
+            scale: config.scale,
+            tile_size: c_int::try_from(config.tile_size).unwrap_or(c_int::MAX),
+            min_changed_tiles: c_int::try_from(config.min_changed_tiles).unwrap_or(c_int::MAX),
+        };
+
+        let bridge = self.connected_bridge()?;
+        let raw = unsafe { ios_bridge_stream_start(bridge, &raw_config) };
+        if raw.is_null() {
+            return Err(TestError::Bridge(
+                "Failed to start frame stream".to_string(),
+            ));
+        }
+        Ok(FrameStream { raw })
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_stream_start(
+        bridge: *mut IOSBridge,
+        config: *const RawStreamConfig,
+    ) -> *mut RawFrameStream;
+    fn ios_bridge_stream_stop(stream: *mut RawFrameStream);
+    fn ios_bridge_stream_next(
+        stream: *mut RawFrameStream,
+        after_sequence: u64,
+        timeout_ms: c_int,
+        reserve: ReserveFn,
+        context: *mut c_void,
+        info: *mut RawStreamFrameInfo,
+    ) -> c_int;
+    fn ios_bridge_stream_wait_change(
+        stream: *mut RawFrameStream,
+        after_sequence: u64,
+        timeout_ms: c_int,
+        sequence_out: *mut u64,
+    ) -> c_int;
+    fn ios_bridge_stream_wait_settled(
+        stream: *mut RawFrameStream,
+        quiet_ms: c_int,
+        timeout_ms: c_int,
+        sequence_out: *mut u64,
+    ) -> c_int;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[repr(C)]
+    struct StreamTiles {
+        current: *mut u64,
+        previous: *mut u64,
+        count: c_int,
+    }
+
+    #[repr(C)]
+    struct FrameInfo {
+        format: c_int,
+        width: c_int,
+        height: c_int,
+        bytes_per_row: c_int,
+        captured_ms: f64,
+    }
+
+    unsafe extern "C" {
+        fn ios_stream_tiles_update(
+            tiles: *mut StreamTiles,
+            pixels: *const u8,
+            frame: *const FrameInfo,
+            tile_size: c_int,
+            changed: *mut c_int,
+        ) -> c_int;
+        fn ios_stream_tiles_free(tiles: *mut StreamTiles);
+    }
+
+    /// The capture thread's view of successive frames.
+    struct Tiles(StreamTiles);
+
+    impl Tiles {
+        fn new() -> Self {
+            Tiles(StreamTiles {
+                current: std::ptr::null_mut(),
+                previous: std::ptr::null_mut(),
+                count: 0,
+            })
+        }
+
+        // (total tiles, changed tiles) after hashing a width x height frame
+        // whose rows are stride bytes apart.
+        fn update(
+            &mut self,
+            pixels: &[u8],
+            width: usize,
+            height: usize,
+            stride: usize,
+        ) -> (c_int, c_int) {
+            assert!(pixels.len() >= stride * height);
+            let frame = FrameInfo {
+                format: 0,
+                width: width as c_int,
+                height: height as c_int,
+                bytes_per_row: stride as c_int,
+                captured_ms: 0.0,
+            };
+            let mut changed = -1;
+            let total = unsafe {
+                ios_stream_tiles_update(&mut self.0, pixels.as_ptr(), &frame, 16, &mut changed)
+            };
+            (total, changed)
+        }
+    }
+
+    impl Drop for Tiles {
+        fn drop(&mut self) {
+            unsafe { ios_stream_tiles_free(&mut self.0) };
+        }
+    }
+
+    #[test]
+    fn only_touched_tiles_count_as_changed() {
+        // 40x20 makes a 3x2 grid whose right and bottom tiles are partial.
+        let (width, height, stride) = (40, 20, 40 * 4 + 16);
+        let mut pixels = vec![0x20u8; stride * height];
+        let mut tiles = Tiles::new();
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 6));
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 0));
+
+        // Row padding is never hashed.
+        for row in 0..height {
+            pixels[row * stride + width * 4..(row + 1) * stride].fill(0xff);
+        }
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 0));
+
+        // The last pixel of the partial corner tile, then one byte in each of
+        // two tiles of the top row.
+        pixels[19 * stride + 39 * 4 + 3] ^= 1;
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 1));
+        pixels[2] ^= 1;
+        pixels[16 * 4] ^= 1;
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 2));
+        assert_eq!(tiles.update(&pixels, width, height, stride), (6, 0));
+    }
+
+    #[test]
+    fn hashes_see_pixel_order_and_grid_changes() {
+        let (width, height, stride) = (16, 16, 16 * 4);
+        let mut pixels: Vec<u8> = (0..stride * height).map(|i| (i % 251) as u8).collect();
+        let mut tiles = Tiles::new();
+        tiles.update(&pixels, width, height, stride);
+
+        // Swapping two pixels keeps every byte but moves them.
+        let (a, b) = (3 * stride, 3 * stride + 4);
+        for i in 0..4 {
+            pixels.swap(a + i, b + i);
+        }
+        assert_eq!(tiles.update(&pixels, width, height, stride), (1, 1));
+
+        // A smaller frame on the same grid hashes fewer pixels per tile.
+        assert_eq!(tiles.update(&pixels, width, 8, stride), (1, 1));
+        // A new grid is a new screen, so every tile is reported, even when
+        // the frame matches one seen before.
+        assert_eq!(tiles.update(&vec![0; 40 * 4 * 20], 40, 20, 40 * 4), (6, 6));
+        assert_eq!(tiles.update(&pixels, width, 8, stride), (1, 1));
+        assert_eq!(tiles.update(&pixels, 0, 16, stride), (-1, 0));
+        assert_eq!(tiles.update(&pixels, width, 8, stride), (1, 0));
+    }
+
+    #[test]
+    fn timeouts_are_not_errors() {
+        assert!(wait_outcome(STREAM_OK).unwrap());
+        assert!(!wait_outcome(STREAM_TIMEOUT).unwrap());
+        assert!(wait_outcome(-1).is_err());
+    }
+
+    #[test]
+    fn rejects_invalid_config() {
+        let harness = RustTestHarness::new();
+        let config = StreamConfig {
+            fps: 0.0,
+            ..StreamConfig::default()
+        };
+        assert!(harness.start_frame_stream(&config).is_err());
+    }
+}
@@ -0,0 +1,365 @@
+use super::ios_ffi::{IOSBridge, RustTestHarness};
+use super::ios_ffi_batch::BridgeAction;
+use super::ios_ffi_buffer::take_reply;
+use crate::{Result, TestError};
+use serde::{Deserialize, Serialize};
+use serde_json::Value;
+use std::ffi::CString;
+use std::os::raw::{c_char, c_int};
+use std::path::Path;
+
+/// Tuning for `replay_trace`. Defaults check every step against its
+/// recorded screen, allowing up to three seconds and two changed cells of
+/// the 8x16 screen signature.
+#[derive(Debug, Clone, PartialEq, Serialize)]
+pub struct ReplayOptions {
+    pub checkpoints: bool,
+    pub checkpoint_timeout_ms: u64,
+    pub tolerance: u32,
+}
+
+impl Default for ReplayOptions {
+    fn default() -> Self {
+        Self {
+            checkpoints: true,
+            checkpoint_timeout_ms: 3000,
+            tolerance: 2,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum Checkpoint {
+    Skipped,
+    Matched,
+    Diverged,
+    Failed,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum ReplayOutcome {
+    Completed,
+    Diverged,
+    ActionFailed,
+    CheckpointFailed,
+    InvalidTrace,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ReplayStep {
+    pub index: usize,
+    pub action: String,
+    pub success: bool,
+    pub duration_ms: f64,
+    pub checkpoint: Checkpoint,
+    pub changed_cells: u32,
+    pub checkpoint_ms: f64,
+    pub result: Value,
+}
+
+/// The step whose screen never matched the recording. Its action still ran;
+/// the caller resolves the next step's target against the live screen.
+#[derive(Debug, Clone, Deserialize)]
+pub struct Divergence {
+    pub index: usize,
+    #[serde(flatten)]
+    pub action: BridgeAction,
+    pub changed_cells: u32,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ReplayReport {
+    pub outcome: ReplayOutcome,
+    pub success: bool,
+    pub replayed: usize,
+    pub total: usize,
+    /// How long the steps took while recording, planner time included.
+    pub recorded_ms: f64,
+    pub total_ms: f64,
+    pub steps: Vec<ReplayStep>,
+    pub divergence: Option<Divergence>,
+}
+
+fn path_cstring(path: &Path) -> Result<CString> {
+    let path = path
+        .to_str()
+        .ok_or_else(|| TestError::Bridge(format!("Trace path is not UTF-8: {}", path.display())))?;
+    CString::new(path).map_err(|e| TestError::Bridge(format!("Invalid trace path: {}", e)))
+}
+
+impl RustTestHarness {
+    /// Record every input action this bridge executes into a trace at `path`,
+    /// replacing any file there, until `stop_trace`.
+    pub fn start_trace(&self, path: &Path) -> Result<()> {
+        let bridge = self.connected_bridge()?;
+        let path_cstr = path_cstring(path)?;
+        if unsafe { ios_bridge_trace_start(bridge, path_cstr.as_ptr()) } != 0 {
+            return Err(TestError::Bridge(format!(
+                "Failed to start recording into {}",
+                path.display()
+            )));
+        }
+        Ok(())
+    }
+
+    pub fn stop_trace(&self) -> Result<()> {
+        let bridge = self.connected_bridge()?;
+        if unsafe { ios_bridge_trace_stop(bridge) } != 0 {
+            return Err(TestError::Bridge(
+                "Trace was not recording or could not be completely written".to_string(),
+            ));
+        }
+        Ok(())
+    }
+
+    /// Replay a recorded trace at device speed: each step runs as soon as
+    /// the screen matches the one recorded after the step before. Stops at
+    /// the first divergence, which the report carries for re-resolution.
+    pub fn replay_trace(&self, path: &Path, options: &ReplayOptions) -> Result<ReplayReport> {
+        let bridge = self.connected_bridge()?;
+        let path_cstr = path_cstring(path)?;
+        let options_cstr = CString::new(serde_json::to_string(options)?)
+            .map_err(|e| TestError::Bridge(format!("Invalid replay options: {}", e)))?;
+        unsafe {
+            take_reply(
+                ios_bridge_replay_trace(bridge, path_cstr.as_ptr(), options_cstr.as_ptr()),
+                "trace replay",
+            )
+        }
+    }
+}
+
+unsafe extern "C" {
+    fn ios_bridge_trace_start(bridge: *mut IOSBridge, path: *const c_char) -> c_int;
+    fn ios_bridge_trace_stop(bridge: *mut IOSBridge) -> c_int;
+    fn ios_bridge_replay_trace(
+        bridge: *mut IOSBridge,
+        path: *const c_char,
+        options: *const c_char,
+    ) -> *mut c_char;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+    use std::os::raw::c_uint;
+
+    const HEADER_SIZE: usize = 16;
+    const CELLS: usize = 8 * 16;
+    const SIGNATURE: c_uint = 0x0001;
+
+    #[repr(C)]
+    struct TraceRecord {
+        action: *const c_char,
+        action_length: usize,
+        params: *const c_char,
+        params_length: usize,
+        flags: c_uint,
+        offset_ms: f64,
+        duration_ms: f64,
+        signature: [u32; CELLS],
+    }
+
+    #[repr(C)]
+    struct FrameInfo {
+        format: c_int,
+        width: c_int,
+        height: c_int,
+        bytes_per_row: c_int,
+        captured_ms: f64,
+    }
+
+    unsafe extern "C" {
+        fn ios_trace_header_encode(out: *mut u8);
+        fn ios_trace_record_size(record: *const TraceRecord) -> usize;
+        fn ios_trace_record_encode(record: *const TraceRecord, out: *mut u8);
+        fn ios_trace_validate(data: *const u8, size: usize) -> c_int;
+        fn ios_trace_next(
+            data: *const u8,
+            size: usize,
+            offset: *mut usize,
+            record: *mut TraceRecord,
+        ) -> c_int;
+        fn ios_trace_signature(pixels: *const u8, frame: *const FrameInfo, signature: *mut u32);
+        fn ios_trace_signature_distance(a: *const u32, b: *const u32) -> c_int;
+    }
+
+    fn record(action: &str, params: &str, offset_ms: f64, cell: u32) -> TraceRecord {
+        let mut signature = [0; CELLS];
+        signature[5] = cell;
+        TraceRecord {
+            action: action.as_ptr().cast(),
+            action_length: action.len(),
+            params: params.as_ptr().cast(),
+            params_length: params.len(),
+            flags: SIGNATURE,
+            offset_ms,
+            duration_ms: 12.5,
+            signature,
+        }
+    }
+
+    fn trace(records: &[TraceRecord]) -> Vec<u8> {
+        let mut bytes = vec![0; HEADER_SIZE];
+        unsafe { ios_trace_header_encode(bytes.as_mut_ptr()) };
+        for record in records {
+            let size = unsafe { ios_trace_record_size(record) };
+            assert!(size > 0);
+            let start = bytes.len();
+            bytes.resize(start + size, 0);
+            unsafe { ios_trace_record_encode(record, bytes[start..].as_mut_ptr()) };
+        }
+        bytes
+    }
+
+    // (action, params, offset_ms, signature cell 5) for each record, and the
+    // status that stopped the walk.
+    fn walk(bytes: &[u8]) -> (Vec<(String, String, f64, u32)>, c_int) {
+        assert_eq!(
+            unsafe { ios_trace_validate(bytes.as_ptr(), bytes.len()) },
+            0
+        );
+        let mut offset = HEADER_SIZE;
+        let mut records = Vec::new();
+        loop {
+            let mut record = record("", "", 0.0, 0);
+            let status =
+                unsafe { ios_trace_next(bytes.as_ptr(), bytes.len(), &mut offset, &mut record) };
+            if status != 1 {
+                return (records, status);
+            }
+            let text = |at: *const c_char, length| unsafe {
+                let bytes = std::slice::from_raw_parts(at.cast::<u8>(), length);
+                String::from_utf8(bytes.to_vec()).unwrap()
+            };
+            assert_eq!(record.flags, SIGNATURE);
+            assert_eq!(record.duration_ms, 12.5);
+            records.push((
+                text(record.action, record.action_length),
+                text(record.params, record.params_length),
+                record.offset_ms,
+                record.signature[5],
+            ));
+        }
+    }
+
+    #[test]
+    fn records_round_trip_and_a_cut_off_tail_ends_the_trace() {
+        let bytes = trace(&[
+            record("tap", r#"{"x": 10.5, "y": 20}"#, 0.0, 7),
+            record("type_text", r#"{"text": "hi"}"#, 94.25, 0xdead_beef),
+        ]);
+        let (records, status) = walk(&bytes);
+        assert_eq!(status, 0);
+        assert_eq!(
+            records,
+            vec![
+                ("tap".into(), r#"{"x": 10.5, "y": 20}"#.into(), 0.0, 7),
+                (
+                    "type_text".into(),
+                    r#"{"text": "hi"}"#.into(),
+                    94.25,
+                    0xdead_beef
+                ),
+            ]
+        );
+
+        // Every cut inside the second record still yields the first.
+        let first_end = HEADER_SIZE + 32 + CELLS * 4 + 3 + 20;
+        for cut in first_end..bytes.len() {
+            let (records, status) = walk(&bytes[..cut]);
+            assert_eq!((records.len(), status), (1, 0), "cut at {}", cut);
+        }
+    }
+
+    #[test]
+    fn inconsistent_records_are_malformed() {
+        let mut bytes = trace(&[record("tap", "{}", 0.0, 1), record("swipe", "{}", 5.0, 2)]);
+        let second = HEADER_SIZE + 32 + CELLS * 4 + 3 + 2;
+        // A size that disagrees with the lengths inside the record.
+        bytes[second] += 1;
+        let (records, status) = walk(&bytes);
+        assert_eq!((records.len(), status), (1, -1));
+
+        bytes[second] -= 1;
+        // A params length so large the sum would wrap.
+        bytes[second + 8..second + 12].copy_from_slice(&u32::MAX.to_le_bytes());
+        assert_eq!(walk(&bytes).1, -1);
+
+        let too_long = "a".repeat(usize::from(u16::MAX) + 1);
+        assert_eq!(
+            unsafe { ios_trace_record_size(&record(&too_long, "{}", 0.0, 0)) },
+            0
+        );
+    }
+
+    #[test]
+    fn foreign_headers_are_rejected() {
+        let valid = trace(&[]);
+        let validate = |bytes: &[u8]| unsafe { ios_trace_validate(bytes.as_ptr(), bytes.len()) };
+        assert_eq!(validate(&valid), 0);
+        assert_eq!(validate(&valid[..HEADER_SIZE - 1]), -1);
+        // Magic, version, then each grid dimension.
+        for at in [0, 4, 6, 8] {
+            let mut bytes = valid.clone();
+            bytes[at] ^= 0x10;
+            assert_eq!(validate(&bytes), -1, "byte {}", at);
+        }
+    }
+
+    #[test]
+    fn signatures_change_only_in_the_touched_cell() {
+        // 16x32 pixels map two by two onto the 8x16 grid; rows carry
+        // padding the signature must not read.
+        let (width, height, stride) = (16usize, 32usize, 16 * 4 + 12);
+        let frame = FrameInfo {
+            format: 1,
+            width: width as c_int,
+            height: height as c_int,
+            bytes_per_row: stride as c_int,
+            captured_ms: 0.0,
+        };
+        let mut pixels = vec![0x40u8; stride * height];
+        let sign = |pixels: &[u8]| {
+            let mut signature = [0u32; CELLS];
+            unsafe { ios_trace_signature(pixels.as_ptr(), &frame, signature.as_mut_ptr()) };
+            signature
+        };
+        let distance = |a: &[u32; CELLS], b: &[u32; CELLS]| unsafe {
+            ios_trace_signature_distance(a.as_ptr(), b.as_ptr())
+        };
+        let base = sign(&pixels);
+
+        for row in 0..height {
+            pixels[row * stride + width * 4..(row + 1) * stride].fill(0xff);
+        }
+        assert_eq!(distance(&base, &sign(&pixels)), 0);
+
+        // Pixel (5, 9) lies in column 2, row 4.
+        pixels[9 * stride + 5 * 4 + 1] = 0x41;
+        let touched = sign(&pixels);
+        assert_eq!(distance(&base, &touched), 1);
+        assert_ne!(touched[4 * 8 + 2], base[4 * 8 + 2]);
+
+        pixels[31 * stride + 15 * 4] = 0;
+        assert_eq!(distance(&base, &sign(&pixels)), 2);
+
+        // An empty frame signs without reading any pixel.
+        let empty = FrameInfo { width: 0, ..frame };
+        let mut signature = [0u32; CELLS];
+        unsafe { ios_trace_signature(std::ptr::null(), &empty, signature.as_mut_ptr()) };
+        assert!(signature.iter().all(|&cell| cell == signature[0]));
+    }
+
+    #[test]
+    fn options_serialize_with_bridge_names() {
+        let options = serde_json::to_value(ReplayOptions::default()).unwrap();
+        assert_eq!(
+            options,
+            json!({"checkpoints": true, "checkpoint_timeout_ms": 3000, "tolerance": 2})
+        );
+    }
+}
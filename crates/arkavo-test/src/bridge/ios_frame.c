@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreGraphics/CoreGraphics.h>
+#include <ImageIO/ImageIO.h>
+
+#include "ios_impl.h"
+
+#define IOS_FRAME_DEFAULT_JPEG_QUALITY 85
+
+static CFStringRef type_identifier(int format) {
+    return format == IOS_FRAME_JPEG ? CFSTR("public.jpeg") : CFSTR("public.png");
+}
+
+static int copy_out(const void* data, size_t length, IOSBridgeReserve reserve, void* context) {
+    void* target = reserve(context, length);
+    if (!target) return IOS_FRAME_ERROR_MEMORY;
+    memcpy(target, data, length);
+    return 0;
+}
+
+// When simctl already produces the requested encoding there is nothing to
+// decode; only the header is read for the dimensions.
+static int deliver_encoded(CGImageSourceRef source, const IOSCommandOutput* output,
+                           IOSBridgeReserve reserve, void* context, IOSFrameInfo* info) {
+    CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+    if (properties) {
+        CFNumberRef width = CFDictionaryGetValue(properties, kCGImagePropertyPixelWidth);
+        CFNumberRef height = CFDictionaryGetValue(properties, kCGImagePropertyPixelHeight);
+        if (width) CFNumberGetValue(width, kCFNumberIntType, &info->width);
+        if (height) CFNumberGetValue(height, kCFNumberIntType, &info->height);
+        CFRelease(properties);
+    }
+    return copy_out(output->data, output->length, reserve, context);
+}
+
+static CGContextRef create_bgra_context(void* pixels, size_t width, size_t height) {
+    CGColorSpaceRef space = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    if (!space) return NULL;
+    // Premultiplied-first with little-endian byte order is BGRA in memory.
+    CGContextRef bitmap = CGBitmapContextCreate(pixels, width, height, 8, width * 4, space,
+                                                (CGBitmapInfo)kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(space);
+    if (bitmap) CGContextSetInterpolationQuality(bitmap, kCGInterpolationMedium);
+    return bitmap;
+}
+
+static int deliver_raw(CGImageRef image, size_t width, size_t height,
+                       IOSBridgeReserve reserve, void* context, IOSFrameInfo* info) {
+    // Drawing straight into the caller's memory makes scaling, cropping and
+    // pixel-format conversion a single pass with no intermediate bitmap.
+    void* pixels = reserve(context, width * height * 4);
+    if (!pixels) return IOS_FRAME_ERROR_MEMORY;
+
+    CGContextRef bitmap = create_bgra_context(pixels, width, height);
+    if (!bitmap) return IOS_FRAME_ERROR_MEMORY;
+    CGContextDrawImage(bitmap, CGRectMake(0, 0, (CGFloat)width, (CGFloat)height), image);
+    CGContextRelease(bitmap);
+
+    info->bytes_per_row = (int)(width * 4);
+    return 0;
+}
+
+static int deliver_reencoded(CGImageRef image, size_t width, size_t height, const IOSFrameRequest* request,
+                             IOSBridgeReserve reserve, void* context) {
+    CGImageRef scaled = NULL;
+    if (width != CGImageGetWidth(image) || height != CGImageGetHeight(image)) {
+        CGContextRef bitmap = create_bgra_context(NULL, width, height);
+        if (!bitmap) return IOS_FRAME_ERROR_MEMORY;
+        CGContextDrawImage(bitmap, CGRectMake(0, 0, (CGFloat)width, (CGFloat)height), image);
+        scaled = CGBitmapContextCreateImage(bitmap);
+        CGContextRelease(bitmap);
+        if (!scaled) return IOS_FRAME_ERROR_MEMORY;
+    }
+
+    CFMutableDataRef encoded = CFDataCreateMutable(NULL, 0);
+    CGImageDestinationRef destination = encoded
+        ? CGImageDestinationCreateWithData(encoded, type_identifier(request->format), 1, NULL)
+        : NULL;
+    int status = IOS_FRAME_ERROR_MEMORY;
+
+    if (destination) {
+        CFDictionaryRef options = NULL;
+        if (request->format == IOS_FRAME_JPEG) {
+            int quality = request->jpeg_quality > 0 ? request->jpeg_quality : IOS_FRAME_DEFAULT_JPEG_QUALITY;
+            double compression = (quality > 100 ? 100 : quality) / 100.0;
+            CFNumberRef value = CFNumberCreate(NULL, kCFNumberDoubleType, &compression);
+            const void* keys[] = { kCGImageDestinationLossyCompressionQuality };
+            const void* values[] = { value };
+            options = CFDictionaryCreate(NULL, keys, values, 1, &kCFTypeDictionaryKeyCallBacks,
+                                         &kCFTypeDictionaryValueCallBacks);
+            CFRelease(value);
+        }
+
+        CGImageDestinationAddImage(destination, scaled ? scaled : image, options);
+        if (CGImageDestinationFinalize(destination)) {
+            status = copy_out(CFDataGetBytePtr(encoded), (size_t)CFDataGetLength(encoded), reserve, context);
+        }
+        if (options) CFRelease(options);
+        CFRelease(destination);
+    }
+
+    if (encoded) CFRelease(encoded);
+    if (scaled) CGImageRelease(scaled);
+    return status;
+}
+
+static int deliver_decoded(CGImageSourceRef source, const IOSFrameRequest* request, IOSFramePlan* plan,
+                           IOSBridgeReserve reserve, void* context, IOSFrameInfo* info) {
+    CGImageRef image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+    if (!image) return IOS_FRAME_ERROR_DECODE;
+
+    int screen_width = (int)CGImageGetWidth(image);
+    int screen_height = (int)CGImageGetHeight(image);
+    if (ios_frame_plan_region(request, screen_width, screen_height, plan) != 0) {
+        CGImageRelease(image);
+        return IOS_FRAME_ERROR_REQUEST;
+    }
+    if (plan->source_width != screen_width || plan->source_height != screen_height) {
+        CGImageRef cropped = CGImageCreateWithImageInRect(
+            image, CGRectMake(plan->source_x, plan->source_y, plan->source_width, plan->source_height));
+        CGImageRelease(image);
+        if (!cropped) return IOS_FRAME_ERROR_REQUEST;
+        image = cropped;
+    }
+
+    size_t width = (size_t)plan->width;
+    size_t height = (size_t)plan->height;
+    int status = request->format == IOS_FRAME_RAW_BGRA
+        ? deliver_raw(image, width, height, reserve, context, info)
+        : deliver_reencoded(image, width, height, request, reserve, context);
+    CGImageRelease(image);
+
+    info->width = plan->width;
+    info->height = plan->height;
+    return status;
+}
+
+int ios_frame_capture(IOSWorker* worker, const char* device_id, const IOSFrameRequest* request,
+                      IOSBridgeReserve reserve, void* context, IOSFrameInfo* info) {
+    memset(info, 0, sizeof(*info));
+    IOSFramePlan plan;
+    if (ios_frame_plan(request, &plan) != 0) return IOS_FRAME_ERROR_REQUEST;
+
+    IOSCommandOutput output;
+    int status = ios_worker_run_device_command(worker, device_id, "io", plan.command, &output);
+    info->captured_ms = ios_monotonic_ms();
+    if (status != 0 || !output.data || output.length == 0) {
+        ios_command_output_free(&output);
+        return IOS_FRAME_ERROR_CAPTURE;
+    }
+
+    CFDataRef encoded = CFDataCreateWithBytesNoCopy(NULL, (const UInt8*)output.data, (CFIndex)output.length,
+                                                    kCFAllocatorNull);
+    CGImageSourceRef source = encoded ? CGImageSourceCreateWithData(encoded, NULL) : NULL;
+    if (!source) {
+        if (encoded) CFRelease(encoded);
+        ios_command_output_free(&output);
+        return IOS_FRAME_ERROR_DECODE;
+    }
+
+    info->format = request->format;
+    status = plan.passthrough
+        ? deliver_encoded(source, &output, reserve, context, info)
+        : deliver_decoded(source, request, &plan, reserve, context, info);
+
+    CFRelease(source);
+    CFRelease(encoded);
+    ios_command_output_free(&output);
+    return status;
+}
+
+int ios_bridge_capture_frame(void* bridge, const IOSFrameRequest* request, IOSBridgeReserve reserve,
+                             void* context, IOSFrameInfo* info) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, NULL) != 0) {
+        memset(info, 0, sizeof(*info));
+        return IOS_FRAME_ERROR_CAPTURE;
+    }
+
+    int status = ios_frame_capture(&call.impl->worker, call.device_id, request, reserve, context, info);
+    ios_bridge_call_end(&call);
+    return status;
+}
@@ -0,0 +1,54 @@
+#include <math.h>
+#include <string.h>
+
+#include "ios_impl.h"
+
+// Request checks and geometry for ios_frame.c, kept apart from the decoding
+// so they build and are tested where CoreGraphics is not available.
+
+static int wants_crop(const IOSFrameRequest* request) {
+    return request->crop_width > 0 && request->crop_height > 0;
+}
+
+static int wants_scale(const IOSFrameRequest* request) {
+    return request->scale > 0 && request->scale != 1.0;
+}
+
+int ios_frame_plan(const IOSFrameRequest* request, IOSFramePlan* plan) {
+    memset(plan, 0, sizeof(*plan));
+    if (request->format < IOS_FRAME_RAW_BGRA || request->format > IOS_FRAME_JPEG) return IOS_FRAME_ERROR_REQUEST;
+    // Written so NaN fails too.
+    if (!(request->scale >= 0 && request->scale <= 1.0)) return IOS_FRAME_ERROR_REQUEST;
+
+    // simctl encodes JPEG itself, so untouched JPEG frames at the default
+    // quality skip a decode and re-encode; everything else starts from PNG.
+    plan->passthrough = request->format != IOS_FRAME_RAW_BGRA && !wants_crop(request) && !wants_scale(request) &&
+                        !(request->format == IOS_FRAME_JPEG && request->jpeg_quality > 0);
+    plan->command = plan->passthrough && request->format == IOS_FRAME_JPEG
+        ? "screenshot --type=jpeg -"
+        : "screenshot --type=png -";
+    return 0;
+}
+
+int ios_frame_plan_region(const IOSFrameRequest* request, int screen_width, int screen_height,
+                          IOSFramePlan* plan) {
+    // Widened so a crop near INT_MAX cannot overflow the clip.
+    long long left = 0, top = 0, right = screen_width, bottom = screen_height;
+    if (wants_crop(request)) {
+        long long x = request->crop_x, y = request->crop_y;
+        if (x > left) left = x;
+        if (y > top) top = y;
+        if (x + request->crop_width < right) right = x + request->crop_width;
+        if (y + request->crop_height < bottom) bottom = y + request->crop_height;
+    }
+    if (right <= left || bottom <= top) return IOS_FRAME_ERROR_REQUEST;
+
+    plan->source_x = (int)left;
+    plan->source_y = (int)top;
+    plan->source_width = (int)(right - left);
+    plan->source_height = (int)(bottom - top);
+    double scale = wants_scale(request) ? request->scale : 1.0;
+    plan->width = (int)fmax(1.0, round(plan->source_width * scale));
+    plan->height = (int)fmax(1.0, round(plan->source_height * scale));
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include "ios_impl.h"
+#include "ios_probe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IOS_GESTURE_ERROR_MAX 256
+
+static const char simctl_suffix[] = "/usr/bin/simctl";
+
+// SimulatorKit lives in the Xcode that simctl resolves to, so the worker's
+// xcrun lookup (which already honours DEVELOPER_DIR) names the right one.
+static int developer_dir(IOSWorker* worker, char* out, size_t size) {
+    size_t suffix = sizeof(simctl_suffix) - 1;
+    if (ios_worker_start(worker) == 0) {
+        size_t length = strlen(worker->simctl_path);
+        if (length > suffix && length - suffix < size &&
+            strcmp(worker->simctl_path + length - suffix, simctl_suffix) == 0) {
+            memcpy(out, worker->simctl_path, length - suffix);
+            out[length - suffix] = '\0';
+            return 0;
+        }
+    }
+
+    const char* configured = getenv("DEVELOPER_DIR");
+    if (!configured || !*configured || strlen(configured) >= size) return -1;
+    strcpy(out, configured);
+    return 0;
+}
+
+void ios_gesture_disconnect(IOSBridgeImpl* impl) {
+    ios_hid_client_close(impl->hid);
+    free(impl->hid_device_id);
+    impl->hid = NULL;
+    impl->hid_device_id = NULL;
+}
+
+// One connection per bridge, reopened only when a call retargets another
+// device, so steady-state gestures pay nothing but the messages themselves.
+static IOSHidClient* call_hid(const IOSBridgeCall* call, char* error, size_t error_size) {
+    IOSBridgeImpl* impl = call->impl;
+    if (impl->hid && strcmp(impl->hid_device_id, call->device_id) == 0) return impl->hid;
+    ios_gesture_disconnect(impl);
+
+    char directory[1024];
+    if (developer_dir(&impl->worker, directory, sizeof(directory)) != 0) {
+        snprintf(error, error_size, "Xcode developer directory not found");
+        return NULL;
+    }
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "hid.connect", NULL);
+    IOSHidClient* hid = ios_hid_client_open(directory, call->device_id, error, error_size);
+    ios_metrics_end(&span);
+    if (!hid) return NULL;
+
+    impl->hid_device_id = strdup(call->device_id);
+    if (!impl->hid_device_id) {
+        ios_hid_client_close(hid);
+        snprintf(error, error_size, "Memory allocation failed");
+        return NULL;
+    }
+    impl->hid = hid;
+    return hid;
+}
+
+int ios_gesture_prepare(const IOSBridgeCall* call, char* error, size_t error_size) {
+    return call_hid(call, error, error_size) ? 0 : -1;
+}
+
+static char* error_result(const char* message) {
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_appendf(&result, "{\"success\": false, \"error\": ");
+    ios_builder_append_json_string(&result, message, strlen(message));
+    ios_builder_append(&result, "}", 1);
+    char* json = ios_builder_finish(&result);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+// Returns NULL when the gesture played, or the error result to report.
+static char* play(const IOSBridgeCall* call, const IOSTouchKeyframe* keyframes, size_t count,
+                  IOSTouchTimeline* timeline) {
+    if (ios_touch_timeline_build(keyframes, count, timeline) != 0) {
+        return strdup("{\"success\": false, \"error\": \"Invalid touch timeline\"}");
+    }
+
+    char error[IOS_GESTURE_ERROR_MAX];
+    IOSHidClient* hid = call_hid(call, error, sizeof(error));
+    if (!hid) return error_result(error);
+
+    if (ios_touch_timeline_play(timeline, ios_hid_client_send, hid) != 0) {
+        // The simulator may have been shut down or rebooted under the
+        // connection, so the next gesture starts from a fresh one.
+        ios_gesture_disconnect(call->impl);
+        return strdup("{\"success\": false, \"error\": \"Simulator rejected the touch events\"}");
+    }
+    return NULL;
+}
+
+static void append_point(IOSStringBuilder* builder, const char* name, IOSTouchPoint point) {
+    ios_builder_appendf(builder, "\"%s\": {\"x\": %.10g, \"y\": %.10g}", name, point.x, point.y);
+}
+
+static char* finish(IOSStringBuilder* result, const IOSTouchTimeline* timeline) {
+    double duration_ms = timeline->count ? timeline->samples[timeline->count - 1].at_ms : 0;
+    ios_builder_appendf(result, ", \"samples\": %zu, \"duration_ms\": %.1f}", timeline->count, duration_ms);
+    char* json = ios_builder_finish(result);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+static double param_ms(const IOSActionParams* params, unsigned int flag, double seconds, double fallback) {
+    double value = params->present & flag ? seconds : fallback;
+    return value > 0 ? value * 1000.0 : 0;
+}
+
+// A duration turns the tap into a press held for that long.
+static char* perform_tap(const IOSBridgeCall* call, const IOSActionParams* params) {
+    IOSTouchKeyframe keyframes[2];
+    memset(keyframes, 0, sizeof(keyframes));
+    keyframes[0].fingers = 1;
+    keyframes[0].points[0].x = params->present & IOS_PARAM_X ? params->x : 100;
+    keyframes[0].points[0].y = params->present & IOS_PARAM_Y ? params->y : 100;
+    keyframes[1].at_ms = param_ms(params, IOS_PARAM_DURATION, params->duration, 0);
+
+    // Events already in the probe ring belong to earlier input.
+    IOSProbe* probe = call->impl->probe;
+    uint64_t mark = probe ? ios_probe_published(probe) : 0;
+    double sent_ms = ios_monotonic_ms();
+
+    IOSTouchTimeline timeline;
+    char* failed = play(call, keyframes, 2, &timeline);
+    if (failed) {
+        ios_touch_timeline_free(&timeline);
+        return failed;
+    }
+
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_appendf(&result, "{\"success\": true, \"action\": \"tap\", ");
+    append_point(&result, "coordinates", keyframes[0].points[0]);
+    if (probe) {
+        ios_probe_append_confirmation(probe, mark, sent_ms, keyframes[0].points[0].x, keyframes[0].points[0].y,
+                                      &result);
+    }
+    char* json = finish(&result, &timeline);
+    ios_touch_timeline_free(&timeline);
+    return json;
+}
+
+// A hold presses at the start point before moving, which is what drag and
+// drop and reordering gestures wait for.
+static char* perform_swipe(const IOSBridgeCall* call, const IOSActionParams* params) {
+    IOSTouchPoint from = {
+        params->present & IOS_PARAM_X1 ? params->x1 : 100,
+        params->present & IOS_PARAM_Y1 ? params->y1 : 100,
+    };
+    IOSTouchPoint to = {
+        params->present & IOS_PARAM_X2 ? params->x2 : 200,
+        params->present & IOS_PARAM_Y2 ? params->y2 : 200,
+    };
+    double hold_ms = param_ms(params, IOS_PARAM_HOLD, params->hold, 0);
+    double move_ms = param_ms(params, IOS_PARAM_DURATION, params->duration, 0.5);
+
+    IOSTouchKeyframe keyframes[3];
+    memset(keyframes, 0, sizeof(keyframes));
+    keyframes[0].fingers = 1;
+    keyframes[0].points[0] = from;
+    keyframes[1] = keyframes[0];
+    keyframes[1].at_ms = hold_ms;
+    keyframes[2] = keyframes[0];
+    keyframes[2].at_ms = hold_ms + move_ms;
+    keyframes[2].points[0] = to;
+
+    IOSTouchTimeline timeline;
+    char* failed = play(call, keyframes, 3, &timeline);
+    if (failed) {
+        ios_touch_timeline_free(&timeline);
+        return failed;
+    }
+
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_appendf(&result, "{\"success\": true, \"action\": \"swipe\", ");
+    append_point(&result, "from", from);
+    ios_builder_appendf(&result, ", ");
+    append_point(&result, "to", to);
+    char* json = finish(&result, &timeline);
+    ios_touch_timeline_free(&timeline);
+    return json;
+}
+
+static char* perform_touch(const IOSBridgeCall* call, const IOSActionParams* params) {
+    if (!(params->present & IOS_PARAM_TOUCHES)) {
+        return strdup("{\"success\": false, \"error\": \"No touches parameter found\"}");
+    }
+
+    IOSTouchKeyframe* keyframes = malloc(IOS_HID_MAX_KEYFRAMES * sizeof(IOSTouchKeyframe));
+    if (!keyframes) return strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+    int count = ios_touch_keyframes_parse(params->source, &params->touches, keyframes, IOS_HID_MAX_KEYFRAMES);
+    if (count < 0) {
+        free(keyframes);
+        return strdup("{\"success\": false, \"error\": \"Invalid touches parameter\"}");
+    }
+
+    IOSTouchTimeline timeline;
+    char* failed = play(call, keyframes, (size_t)count, &timeline);
+    free(keyframes);
+    if (failed) {
+        ios_touch_timeline_free(&timeline);
+        return failed;
+    }
+
+    IOSStringBuilder result;
+    ios_builder_init(&result);
+    ios_builder_appendf(&result, "{\"success\": true, \"action\": \"touch\", \"keyframes\": %d", count);
+    char* json = finish(&result, &timeline);
+    ios_touch_timeline_free(&timeline);
+    return json;
+}
+
+// Command-V on the simulated hardware keyboard. Keys already down are
+// released whatever happens, so a failure never leaves Command held.
+static int paste_chord(IOSHidClient* hid) {
+    static const unsigned int chord[] = {IOS_HID_KEY_LEFT_GUI, IOS_HID_KEY_V};
+    int pressed = 0;
+    int status = 0;
+    while (pressed < 2 && status == 0) {
+        status = ios_hid_client_key(hid, chord[pressed], 1);
+        if (status == 0) pressed++;
+    }
+    while (pressed > 0) {
+        if (ios_hid_client_key(hid, chord[--pressed], 0) != 0) status = -1;
+    }
+    return status;
+}
+
+// simctl has no keyboard input, so text is put on the device pasteboard
+// through the resident worker and pasted into the focused field. That costs
+// one simctl call whatever the length, and takes any UTF-8, including text
+// no key sequence could produce. The pasteboard keeps the text afterwards.
+static char* perform_type_text(const IOSBridgeCall* call, const IOSActionParams* params) {
+    if (!(params->present & IOS_PARAM_TEXT)) {
+        return strdup("{\"error\": \"No text parameter found\"}");
+    }
+
+    char* text = ios_action_params_string(params, &params->text);
+    if (!text) return strdup("{\"error\": \"Text must be a string without NUL characters\"}");
+
+    // Connecting first leaves the pasteboard alone when input cannot follow.
+    char error[IOS_GESTURE_ERROR_MAX];
+    IOSHidClient* hid = call_hid(call, error, sizeof(error));
+    if (!hid) {
+        free(text);
+        return error_result(error);
+    }
+
+    char* device = ios_shell_quote(call->device_id);
+    size_t args_size = device ? strlen(device) + 8 : 0;
+    char* args = device ? malloc(args_size) : NULL;
+    if (!args) {
+        free(text);
+        free(device);
+        return strdup("{\"error\": \"Memory allocation failed\"}");
+    }
+    snprintf(args, args_size, "pbcopy %s", device);
+    free(device);
+
+    size_t length = strlen(text);
+    int status = ios_worker_run_simctl_input(&call->impl->worker, args, text, NULL);
+    free(args);
+    free(text);
+    if (status != 0) {
+        return strdup("{\"success\": false, \"error\": \"Failed to set the device pasteboard\"}");
+    }
+
+    if (paste_chord(hid) != 0) {
+        ios_gesture_disconnect(call->impl);
+        return strdup("{\"success\": false, \"error\": \"Simulator rejected the key events\"}");
+    }
+
+    char result[128];
+    snprintf(result, sizeof(result),
+             "{\"success\": true, \"action\": \"type_text\", \"method\": \"paste\", \"bytes\": %zu}", length);
+    return strdup(result);
+}
+
+char* ios_gesture_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params) {
+    if (strcmp(action, "tap") == 0) return perform_tap(call, params);
+    if (strcmp(action, "type_text") == 0) return perform_type_text(call, params);
+    if (strcmp(action, "swipe") == 0) return perform_swipe(call, params);
+    if (strcmp(action, "touch") == 0) return perform_touch(call, params);
+    return NULL;
+}
@@ -0,0 +1,166 @@
+#include "ios_impl.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int timeline_push(IOSTouchTimeline* timeline, double at_ms, IOSTouchPhase phase, int fingers,
+                         const IOSTouchPoint* points) {
+    if (timeline->count == timeline->capacity) {
+        if (timeline->capacity == IOS_HID_MAX_SAMPLES) return -1;
+        size_t capacity = timeline->capacity ? timeline->capacity * 2 : 16;
+        if (capacity > IOS_HID_MAX_SAMPLES) capacity = IOS_HID_MAX_SAMPLES;
+        IOSTouchSample* grown = realloc(timeline->samples, capacity * sizeof(IOSTouchSample));
+        if (!grown) return -1;
+        timeline->samples = grown;
+        timeline->capacity = capacity;
+    }
+
+    IOSTouchSample* sample = &timeline->samples[timeline->count++];
+    memset(sample, 0, sizeof(*sample));
+    sample->at_ms = at_ms;
+    sample->phase = phase;
+    sample->fingers = fingers;
+    memcpy(sample->points, points, (size_t)fingers * sizeof(IOSTouchPoint));
+    return 0;
+}
+
+// Held fingers produce no samples: the next keyframe is scheduled at its own
+// time either way, and repeating a position would only add HID traffic.
+static int timeline_move(IOSTouchTimeline* timeline, const IOSTouchKeyframe* from, const IOSTouchKeyframe* to) {
+    if (memcmp(from->points, to->points, (size_t)to->fingers * sizeof(IOSTouchPoint)) == 0) return 0;
+
+    double span = to->at_ms - from->at_ms;
+    int steps = span > IOS_HID_STEP_MS ? (int)ceil(span / IOS_HID_STEP_MS) : 1;
+    if (steps > IOS_HID_MAX_SAMPLES) return -1;
+    for (int step = 1; step <= steps; step++) {
+        double t = (double)step / steps;
+        IOSTouchPoint points[IOS_HID_MAX_FINGERS];
+        for (int finger = 0; finger < to->fingers; finger++) {
+            points[finger].x = from->points[finger].x + (to->points[finger].x - from->points[finger].x) * t;
+            points[finger].y = from->points[finger].y + (to->points[finger].y - from->points[finger].y) * t;
+        }
+        if (timeline_push(timeline, from->at_ms + span * t, IOS_TOUCH_MOVE, to->fingers, points) != 0) return -1;
+    }
+    return 0;
+}
+
+static int timeline_append(IOSTouchTimeline* timeline, const IOSTouchKeyframe* previous,
+                           const IOSTouchKeyframe* keyframe) {
+    if (previous->fingers == 0) {
+        if (keyframe->fingers == 0) return 0;
+        return timeline_push(timeline, keyframe->at_ms, IOS_TOUCH_DOWN, keyframe->fingers, keyframe->points);
+    }
+    if (keyframe->fingers == 0) {
+        return timeline_push(timeline, keyframe->at_ms, IOS_TOUCH_UP, previous->fingers, previous->points);
+    }
+    if (keyframe->fingers != previous->fingers) return -1;
+    return timeline_move(timeline, previous, keyframe);
+}
+
+int ios_touch_timeline_build(const IOSTouchKeyframe* keyframes, size_t count, IOSTouchTimeline* timeline) {
+    memset(timeline, 0, sizeof(*timeline));
+
+    IOSTouchKeyframe previous;
+    memset(&previous, 0, sizeof(previous));
+    for (size_t i = 0; i < count; i++) {
+        const IOSTouchKeyframe* keyframe = &keyframes[i];
+        int valid = keyframe->fingers >= 0 && keyframe->fingers <= IOS_HID_MAX_FINGERS &&
+                    isfinite(keyframe->at_ms) && keyframe->at_ms >= previous.at_ms;
+        if (!valid || timeline_append(timeline, &previous, keyframe) != 0) {
+            ios_touch_timeline_free(timeline);
+            return -1;
+        }
+        previous = *keyframe;
+    }
+
+    if (previous.fingers > 0 &&
+        timeline_push(timeline, previous.at_ms, IOS_TOUCH_UP, previous.fingers, previous.points) != 0) {
+        ios_touch_timeline_free(timeline);
+        return -1;
+    }
+    return 0;
+}
+
+void ios_touch_timeline_free(IOSTouchTimeline* timeline) {
+    free(timeline->samples);
+    memset(timeline, 0, sizeof(*timeline));
+}
+
+static int parse_point(const char* json, const IOSJsonToken* tokens, int count, int index, IOSTouchPoint* point) {
+    if (tokens[index].type != IOS_JSON_ARRAY || tokens[index].size != 2 || index + 2 >= count) return -1;
+    if (ios_json_number(json, &tokens[index + 1], &point->x) != 0) return -1;
+    if (ios_json_number(json, &tokens[index + 2], &point->y) != 0) return -1;
+    return isfinite(point->x) && isfinite(point->y) ? 0 : -1;
+}
+
+static int parse_keyframe(const char* json, const IOSJsonToken* tokens, int count, int object,
+                          IOSTouchKeyframe* keyframe) {
+    if (tokens[object].type != IOS_JSON_OBJECT) return -1;
+    memset(keyframe, 0, sizeof(*keyframe));
+
+    int at = ios_json_find(json, tokens, count, object, "t");
+    if (at >= 0 && ios_json_number(json, &tokens[at], &keyframe->at_ms) != 0) return -1;
+
+    int points = ios_json_find(json, tokens, count, object, "points");
+    if (points < 0) return 0;
+    if (tokens[points].type != IOS_JSON_ARRAY || tokens[points].size > IOS_HID_MAX_FINGERS) return -1;
+
+    int index = points + 1;
+    for (int finger = 0; finger < tokens[points].size; finger++) {
+        if (index >= count || parse_point(json, tokens, count, index, &keyframe->points[finger]) != 0) return -1;
+        index = ios_json_skip(tokens, count, index);
+    }
+    keyframe->fingers = tokens[points].size;
+    return 0;
+}
+
+// The array is tokenized again on its own, since action params only keep the
+// outer token of nested values.
+int ios_touch_keyframes_parse(const char* json, const IOSJsonToken* array, IOSTouchKeyframe* keyframes,
+                              size_t capacity) {
+    if (array->type != IOS_JSON_ARRAY) return -1;
+
+    const char* source = json + array->start;
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(source, (size_t)(array->end - array->start), &tokens);
+    if (count <= 0) return -1;
+
+    int parsed = tokens[0].size <= (int)capacity ? tokens[0].size : -1;
+    int index = 1;
+    for (int i = 0; i < parsed; i++) {
+        if (index >= count || parse_keyframe(source, tokens, count, index, &keyframes[i]) != 0) {
+            parsed = -1;
+            break;
+        }
+        index = ios_json_skip(tokens, count, index);
+    }
+    free(tokens);
+    return parsed;
+}
+
+static void sleep_until(double deadline_ms) {
+    double remaining = deadline_ms - ios_monotonic_ms();
+    if (remaining > 0) usleep((useconds_t)(remaining * 1000.0));
+}
+
+int ios_touch_timeline_play(const IOSTouchTimeline* timeline, IOSTouchSend send, void* context) {
+    double started = ios_monotonic_ms();
+    const IOSTouchSample* touching = NULL;
+
+    for (size_t i = 0; i < timeline->count; i++) {
+        const IOSTouchSample* sample = &timeline->samples[i];
+        sleep_until(started + sample->at_ms);
+        if (send(context, sample) != 0) {
+            if (touching) {
+                IOSTouchSample lift = *touching;
+                lift.phase = IOS_TOUCH_UP;
+                send(context, &lift);
+            }
+            return -1;
+        }
+        touching = sample->phase == IOS_TOUCH_UP ? NULL : sample;
+    }
+    return 0;
+}
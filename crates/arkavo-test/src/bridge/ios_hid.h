@@ -0,0 +1,91 @@
+#ifndef ARKAVO_IOS_HID_H
+#define ARKAVO_IOS_HID_H
+
+#include <stddef.h>
+
+#include "ios_json.h"
+
+// Gestures are compiled into timelines of touch samples and played back
+// in-process through CoreSimulator's HID client, so a gesture costs no
+// process launch and coordinates keep their fractional points.
+
+// SimulatorKit encodes at most a two-finger touch per message.
+#define IOS_HID_MAX_FINGERS 2
+// Moves between keyframes are resampled at about 120 Hz, the touch rate of
+// ProMotion devices, so swipes read as continuous to gesture recognizers.
+#define IOS_HID_STEP_MS 8.0
+// Bounds a timeline to about half a minute of continuous movement.
+#define IOS_HID_MAX_SAMPLES 4096
+#define IOS_HID_MAX_KEYFRAMES 256
+
+// USB HID keyboard usages (usage page 0x07).
+#define IOS_HID_KEY_V 0x19
+#define IOS_HID_KEY_LEFT_GUI 0xE3
+
+typedef enum {
+    IOS_TOUCH_DOWN,
+    IOS_TOUCH_MOVE,
+    IOS_TOUCH_UP
+} IOSTouchPhase;
+
+// Screen coordinates in points, the same space XCUITest and idb use.
+typedef struct {
+    double x;
+    double y;
+} IOSTouchPoint;
+
+// The fingers touching the screen at_ms into the gesture; none means every
+// finger has lifted.
+typedef struct {
+    double at_ms;
+    int fingers;
+    IOSTouchPoint points[IOS_HID_MAX_FINGERS];
+} IOSTouchKeyframe;
+
+// An up sample carries the positions the fingers lifted from.
+typedef struct {
+    double at_ms;
+    IOSTouchPhase phase;
+    int fingers;
+    IOSTouchPoint points[IOS_HID_MAX_FINGERS];
+} IOSTouchSample;
+
+typedef struct {
+    IOSTouchSample* samples;
+    size_t count;
+    size_t capacity;
+} IOSTouchTimeline;
+
+// Returns 0, or -1 when keyframes go back in time, change the number of
+// fingers without lifting first, or need more than IOS_HID_MAX_SAMPLES.
+// Fingers still down after the last keyframe are lifted there, so a
+// timeline never leaves a touch stuck on the device.
+int ios_touch_timeline_build(const IOSTouchKeyframe* keyframes, size_t count, IOSTouchTimeline* timeline);
+void ios_touch_timeline_free(IOSTouchTimeline* timeline);
+
+// Decodes [{"t": ms, "points": [[x, y], ...]}, ...] from the array token
+// into keyframes[capacity]. Returns the keyframe count, or -1.
+int ios_touch_keyframes_parse(const char* json, const IOSJsonToken* array, IOSTouchKeyframe* keyframes,
+                              size_t capacity);
+
+// Delivers one sample; returns 0 on success.
+typedef int (*IOSTouchSend)(void* context, const IOSTouchSample* sample);
+
+// Sends each sample at its offset from the start of playback. Samples are
+// scheduled against the start rather than the previous send, so a slow send
+// delays one sample instead of stretching the rest of the gesture. If a send
+// fails with fingers down, they are lifted before returning -1.
+int ios_touch_timeline_play(const IOSTouchTimeline* timeline, IOSTouchSend send, void* context);
+
+// A HID connection to one simulator, owned by one bridge and used under its
+// lock. developer_dir is the Xcode developer directory SimulatorKit is loaded
+// from. On failure returns NULL and writes the reason to error.
+typedef struct IOSHidClient IOSHidClient;
+IOSHidClient* ios_hid_client_open(const char* developer_dir, const char* udid, char* error, size_t error_size);
+// An IOSTouchSend for an IOSHidClient.
+int ios_hid_client_send(void* client, const IOSTouchSample* sample);
+// Presses (down != 0) or releases one key, by USB HID keyboard usage.
+int ios_hid_client_key(IOSHidClient* client, unsigned int usage, int down);
+void ios_hid_client_close(IOSHidClient* client);
+
+#endif
@@ -0,0 +1,273 @@
+// Touch injection through SimulatorKit's legacy HID client, the channel
+// Simulator.app and idb_companion use for mouse input. Both frameworks are
+// private, so they are resolved at run time and every lookup failure is
+// reported instead of assumed away. Built without ARC, like the rest of the
+// bridge's C sources; the few objects owned here are released explicitly.
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#include <dlfcn.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <objc/runtime.h>
+
+#include "ios_hid.h"
+
+// Message layout as SimulatorKit expects it, matching the Indigo headers idb
+// ships for the same client. Only the touch event is used here.
+#pragma pack(push, 4)
+typedef struct {
+    unsigned int field1;
+    unsigned int field2;
+    unsigned int field3;
+    double xRatio;
+    double yRatio;
+    double field6;
+    double field7;
+    double field8;
+    unsigned int field9;
+    unsigned int field10;
+    unsigned int field11;
+    unsigned int field12;
+    unsigned int field13;
+    double field14;
+    double field15;
+    double field16;
+    double field17;
+    double field18;
+} IndigoTouch;
+
+typedef struct {
+    unsigned int field1;
+    unsigned long long timestamp;
+    unsigned int field3;
+    IndigoTouch touch;
+} IndigoPayload;
+
+typedef struct {
+    mach_msg_header_t header;
+    unsigned int innerSize;
+    unsigned char eventType;
+    IndigoPayload payload;
+} IndigoMessage;
+#pragma pack(pop)
+
+#define INDIGO_EVENT_TOUCH 2
+// NSEventType values, which SimulatorKit takes without linking AppKit.
+#define INDIGO_MOUSE_DOWN 1
+#define INDIGO_MOUSE_UP 2
+#define INDIGO_TARGET_MAIN_SCREEN 0x32
+#define INDIGO_SEND_TIMEOUT_NS (1000 * NSEC_PER_MSEC)
+
+typedef IndigoMessage* (*IndigoMouseMessage)(CGPoint* point, CGPoint* second, unsigned int target,
+                                             NSUInteger event_type, BOOL unknown);
+// direction is 1 for key down and 2 for key up.
+typedef IndigoMessage* (*IndigoKeyMessage)(unsigned int usage, unsigned int direction);
+
+@protocol ArkavoSimServiceContext <NSObject>
++ (id)sharedServiceContextForDeveloperDir:(NSString*)developerDir error:(NSError**)error;
+- (id)defaultDeviceSetWithError:(NSError**)error;
+@end
+
+@protocol ArkavoSimDeviceSet <NSObject>
+- (NSDictionary<NSUUID*, id>*)devicesByUDID;
+@end
+
+@protocol ArkavoSimDevice <NSObject>
+- (id)deviceType;
+@end
+
+@protocol ArkavoSimDeviceType <NSObject>
+- (CGSize)mainScreenSize;
+- (float)mainScreenScale;
+@end
+
+@protocol ArkavoLegacyHIDClient <NSObject>
+- (instancetype)initWithDevice:(id)device error:(NSError**)error;
+- (void)sendWithMessage:(IndigoMessage*)message
+           freeWhenDone:(BOOL)freeWhenDone
+        completionQueue:(dispatch_queue_t)queue
+             completion:(void (^)(NSError* error))completion;
+@end
+
+struct IOSHidClient {
+    id<ArkavoLegacyHIDClient> client;
+    IndigoMouseMessage mouse_message;
+    // NULL when this SimulatorKit cannot synthesize keyboard input.
+    IndigoKeyMessage key_message;
+    // Indigo positions are fractions of the screen, not points.
+    double width_points;
+    double height_points;
+};
+
+static void describe(char* error, size_t error_size, NSString* reason, NSError* cause) {
+    NSString* message = cause ? [NSString stringWithFormat:@"%@: %@", reason, cause.localizedDescription] : reason;
+    snprintf(error, error_size, "%s", message.UTF8String);
+}
+
+// SimulatorKit moved between Xcode releases; both known homes are tried.
+static void* open_simulator_kit(NSString* developerDir) {
+    NSArray<NSString*>* relative = @[
+        @"Library/PrivateFrameworks/SimulatorKit.framework/SimulatorKit",
+        @"../SharedFrameworks/SimulatorKit.framework/SimulatorKit",
+    ];
+    for (NSString* path in relative) {
+        NSString* full = [[developerDir stringByAppendingPathComponent:path] stringByStandardizingPath];
+        void* handle = dlopen(full.fileSystemRepresentation, RTLD_NOW | RTLD_GLOBAL);
+        if (handle) return handle;
+    }
+    return NULL;
+}
+
+static id find_device(NSString* developerDir, const char* udid, char* error, size_t error_size) {
+    if (!dlopen("/Library/Developer/PrivateFrameworks/CoreSimulator.framework/CoreSimulator",
+                RTLD_NOW | RTLD_GLOBAL)) {
+        describe(error, error_size, @"CoreSimulator.framework could not be loaded", nil);
+        return nil;
+    }
+    Class contextClass = objc_lookUpClass("SimServiceContext");
+    if (!contextClass) {
+        describe(error, error_size, @"CoreSimulator has no SimServiceContext", nil);
+        return nil;
+    }
+
+    NSError* cause = nil;
+    id context = [(Class<ArkavoSimServiceContext>)contextClass sharedServiceContextForDeveloperDir:developerDir
+                                                                                             error:&cause];
+    id deviceSet = [context defaultDeviceSetWithError:&cause];
+    if (!deviceSet) {
+        describe(error, error_size, @"No CoreSimulator device set", cause);
+        return nil;
+    }
+
+    NSUUID* key = [[NSUUID alloc] initWithUUIDString:@(udid)];
+    id device = key ? [(id<ArkavoSimDeviceSet>)deviceSet devicesByUDID][key] : nil;
+    [key release];
+    if (!device) describe(error, error_size, [NSString stringWithFormat:@"No simulator with UDID %s", udid], nil);
+    return device;
+}
+
+IOSHidClient* ios_hid_client_open(const char* developer_dir, const char* udid, char* error, size_t error_size) {
+    @autoreleasepool {
+        NSString* developerDir = @(developer_dir);
+        id device = find_device(developerDir, udid, error, error_size);
+        if (!device) return NULL;
+
+        if (!open_simulator_kit(developerDir)) {
+            describe(error, error_size, @"SimulatorKit.framework could not be loaded", nil);
+            return NULL;
+        }
+        Class clientClass = objc_lookUpClass("SimulatorKit.SimDeviceLegacyHIDClient");
+        IndigoMouseMessage mouse_message = (IndigoMouseMessage)dlsym(RTLD_DEFAULT, "IndigoHIDMessageForMouseNSEvent");
+        if (!clientClass || !mouse_message) {
+            describe(error, error_size, @"This Xcode's SimulatorKit has no legacy HID client", nil);
+            return NULL;
+        }
+
+        id deviceType = [(id<ArkavoSimDevice>)device deviceType];
+        CGSize pixels = [(id<ArkavoSimDeviceType>)deviceType mainScreenSize];
+        float scale = [(id<ArkavoSimDeviceType>)deviceType mainScreenScale];
+        if (pixels.width <= 0 || pixels.height <= 0 || scale <= 0) {
+            describe(error, error_size, @"Simulator reported no screen size", nil);
+            return NULL;
+        }
+
+        NSError* cause = nil;
+        id<ArkavoLegacyHIDClient> client = [[clientClass alloc] initWithDevice:device error:&cause];
+        if (!client) {
+            describe(error, error_size, @"HID client could not attach to the simulator", cause);
+            return NULL;
+        }
+
+        IOSHidClient* hid = calloc(1, sizeof(IOSHidClient));
+        if (!hid) {
+            [client release];
+            describe(error, error_size, @"Memory allocation failed", nil);
+            return NULL;
+        }
+        hid->client = client;
+        hid->mouse_message = mouse_message;
+        hid->key_message = (IndigoKeyMessage)dlsym(RTLD_DEFAULT, "IndigoHIDMessageForKeyboardArbitrary");
+        hid->width_points = pixels.width / scale;
+        hid->height_points = pixels.height / scale;
+        return hid;
+    }
+}
+
+// A touch is two payloads; the second is a copy of the first with the
+// fields SimulatorKit uses to tell the pair apart. The payload size is
+// taken from SimulatorKit's own message rather than assumed.
+static IndigoMessage* touch_message(IOSHidClient* hid, const IOSTouchSample* sample) {
+    CGPoint points[IOS_HID_MAX_FINGERS];
+    for (int finger = 0; finger < sample->fingers; finger++) {
+        points[finger] = CGPointMake(sample->points[finger].x / hid->width_points,
+                                     sample->points[finger].y / hid->height_points);
+    }
+    // Moves are sent as repeated downs, as Simulator.app does while dragging.
+    NSUInteger type = sample->phase == IOS_TOUCH_UP ? INDIGO_MOUSE_UP : INDIGO_MOUSE_DOWN;
+    IndigoMessage* prototype = hid->mouse_message(&points[0], sample->fingers > 1 ? &points[1] : NULL,
+                                                 INDIGO_TARGET_MAIN_SCREEN, type, NO);
+    if (!prototype) return NULL;
+
+    size_t stride = prototype->innerSize;
+    if (stride < sizeof(IndigoPayload)) {
+        free(prototype);
+        return NULL;
+    }
+    IndigoMessage* message = calloc(1, offsetof(IndigoMessage, payload) + 2 * stride);
+    if (!message) {
+        free(prototype);
+        return NULL;
+    }
+    message->innerSize = (unsigned int)stride;
+    message->eventType = INDIGO_EVENT_TOUCH;
+    message->payload.field1 = 0x0000000b;
+    message->payload.timestamp = mach_absolute_time();
+    message->payload.touch = prototype->payload.touch;
+    message->payload.touch.xRatio = points[0].x;
+    message->payload.touch.yRatio = points[0].y;
+    free(prototype);
+
+    IndigoPayload* second = (IndigoPayload*)((char*)&message->payload + stride);
+    memcpy(second, &message->payload, stride);
+    second->touch.field1 = 0x00000001;
+    second->touch.field2 = 0x00000002;
+    return message;
+}
+
+// Waits for SimulatorKit to accept each message, so a dead simulator fails
+// the gesture instead of silently swallowing it. Takes ownership of message.
+static int send_message(IOSHidClient* hid, IndigoMessage* message) {
+    __block int status = 0;
+    dispatch_semaphore_t sent = dispatch_semaphore_create(0);
+    [hid->client sendWithMessage:message
+                    freeWhenDone:YES
+                 completionQueue:dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0)
+                      completion:^(NSError* error) {
+                          status = error ? -1 : 0;
+                          dispatch_semaphore_signal(sent);
+                      }];
+    long timed_out = dispatch_semaphore_wait(sent, dispatch_time(DISPATCH_TIME_NOW, INDIGO_SEND_TIMEOUT_NS));
+    // The copied completion block holds its own reference, so a late
+    // completion can still signal after this one is dropped.
+    dispatch_release(sent);
+    return timed_out ? -1 : status;
+}
+
+int ios_hid_client_send(void* client, const IOSTouchSample* sample) {
+    IOSHidClient* hid = client;
+    IndigoMessage* message = touch_message(hid, sample);
+    return message ? send_message(hid, message) : -1;
+}
+
+int ios_hid_client_key(IOSHidClient* client, unsigned int usage, int down) {
+    if (!client->key_message) return -1;
+    IndigoMessage* message = client->key_message(usage, down ? 1 : 2);
+    return message ? send_message(client, message) : -1;
+}
+
+void ios_hid_client_close(IOSHidClient* client) {
+    if (!client) return;
+    [client->client release];
+    free(client);
+}
@@ -0,0 +1,361 @@
+#ifndef ARKAVO_IOS_IMPL_H
+#define ARKAVO_IOS_IMPL_H
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "ios_builder.h"
+#include "ios_hid.h"
+#include "ios_json.h"
+#include "ios_metrics.h"
+#include "ios_registry.h"
+
+// Resident helper shell fed over a pipe. Keeping one per bridge avoids paying
+// for /bin/sh startup and xcrun tool lookup on every action. It does not
+// remove the per-action process: the shell still execs a fresh simctl for
+// each command, which is most of what a simctl action costs. Input and
+// element actions skip it by going to HID or the resident XCUITest runner
+// (ios_backend.h); capture and lifecycle have no long-lived channel yet.
+typedef struct {
+    pid_t pid;
+    int in_fd;
+    int out_fd;
+    int healthy;
+    time_t retry_after;
+    char nonce[17];
+    char simctl_path[1024];
+} IOSWorker;
+
+typedef struct {
+    char* data;
+    size_t length;
+} IOSCommandOutput;
+
+typedef struct IOSBridgeExecutor IOSBridgeExecutor;
+
+// The node and hash the next state delta is taken against; zeroed before
+// the first one.
+typedef struct {
+    char* fingerprint;
+    uint64_t hash;
+} IOSDeltaBaseline;
+
+// Every backend a handle can route actions to; see ios_backend.h.
+#define IOS_BACKEND_HID 0
+#define IOS_BACKEND_XCUITEST 1
+#define IOS_BACKEND_SIMCTL 2
+#define IOS_BACKEND_COUNT 3
+#define IOS_BACKEND_ERROR_MAX 256
+
+typedef struct {
+    uint64_t calls;
+    uint64_t failures;
+    unsigned int consecutive_failures;
+    double total_ms;
+    // Skipped by routing until then, once failures have piled up.
+    double retry_after_ms;
+    char last_error[IOS_BACKEND_ERROR_MAX];
+} IOSBackendHealth;
+typedef struct IOSTraceRecorder IOSTraceRecorder;
+typedef struct IOSProbe IOSProbe;
+
+// Threading contract: any entry point may be called from any thread. Each
+// handle serializes its calls on a recursive lock, so a batch holds it across
+// its actions and calls on different handles run in parallel. device_id and
+// bundle_id never change after creation; everything else is guarded by lock.
+// Destroying a handle while another thread is still using it is undefined.
+typedef struct {
+    char* device_id;
+    char* bundle_id;
+    void* xctest_session;
+    pthread_mutex_t lock;
+    IOSWorker worker;
+    // Runs submitted actions; its thread starts with the first submission.
+    IOSBridgeExecutor* executor;
+    // Baseline for ios_bridge_get_state_delta.
+    IOSDeltaBaseline delta;
+    // Touch injection for hid_device_id, connected by the first gesture.
+    IOSHidClient* hid;
+    char* hid_device_id;
+    // Set while recording; see ios_trace.h.
+    IOSTraceRecorder* trace;
+    // Set once a probe is attached; see ios_probe.h.
+    IOSProbe* probe;
+    // The bridge app's own probe, opened by the first lifecycle call to
+    // confirm warm resets whether or not a probe is attached.
+    IOSProbe* lifecycle_probe;
+    // Set once the app went a whole launch without confirming; it does not
+    // speak the protocol, so later calls relaunch without waiting on it.
+    int lifecycle_unconfirmed;
+    // Connection to runner_device_id's resident XCUITest runner, or -1.
+    int runner_fd;
+    char* runner_device_id;
+    IOSBackendHealth backends[IOS_BACKEND_COUNT];
+} IOSBridgeImpl;
+
+// One call against a locked handle. A device_id param retargets only this
+// call, so concurrent callers never observe each other's overrides.
+typedef struct {
+    IOSBridgeImpl* impl;
+    const char* device_id;
+    char* device_id_override;
+} IOSBridgeCall;
+
+// Result bytes lent across the FFI boundary. data stays valid until the
+// caller invokes release(context); length excludes the NUL terminator.
+typedef struct {
+    const char* data;
+    size_t length;
+    void* context;
+    void (*release)(void* context);
+} IOSBridgeBuffer;
+
+// Called once with the final size. Returns memory the bridge fills with
+// exactly that many bytes, or NULL to abort.
+typedef void* (*IOSBridgeReserve)(void* context, size_t size);
+
+#define IOS_FRAME_RAW_BGRA 0
+#define IOS_FRAME_PNG 1
+#define IOS_FRAME_JPEG 2
+
+#define IOS_FRAME_ERROR_CAPTURE -1
+#define IOS_FRAME_ERROR_DECODE -2
+#define IOS_FRAME_ERROR_REQUEST -3
+#define IOS_FRAME_ERROR_MEMORY -4
+
+// A zero crop_width or crop_height captures the whole screen. scale is
+// applied after cropping; 0 and 1 both mean native resolution.
+typedef struct {
+    int format;
+    int crop_x;
+    int crop_y;
+    int crop_width;
+    int crop_height;
+    double scale;
+    int jpeg_quality;
+} IOSFrameRequest;
+
+// bytes_per_row is only meaningful for raw frames.
+typedef struct {
+    int format;
+    int width;
+    int height;
+    int bytes_per_row;
+    double captured_ms;
+} IOSFrameInfo;
+
+// What ios_frame_capture does for a request, worked out without touching
+// CoreGraphics (ios_frame_plan.c). passthrough hands simctl's own encoding
+// over untouched; the source rectangle is the screen region to decode and
+// width x height the size it is delivered at.
+typedef struct {
+    int passthrough;
+    const char* command;
+    int source_x;
+    int source_y;
+    int source_width;
+    int source_height;
+    int width;
+    int height;
+} IOSFramePlan;
+
+#define IOS_PARAM_X (1u << 0)
+#define IOS_PARAM_Y (1u << 1)
+#define IOS_PARAM_X1 (1u << 2)
+#define IOS_PARAM_Y1 (1u << 3)
+#define IOS_PARAM_X2 (1u << 4)
+#define IOS_PARAM_Y2 (1u << 5)
+#define IOS_PARAM_DURATION (1u << 6)
+#define IOS_PARAM_TEXT (1u << 7)
+#define IOS_PARAM_PATH (1u << 8)
+#define IOS_PARAM_DEVICE_ID (1u << 9)
+#define IOS_PARAM_UNTIL (1u << 10)
+#define IOS_PARAM_QUIET_MS (1u << 11)
+#define IOS_PARAM_HOLD (1u << 12)
+#define IOS_PARAM_TOUCHES (1u << 13)
+#define IOS_PARAM_CONDITION (1u << 14)
+#define IOS_PARAM_TIMEOUT (1u << 15)
+#define IOS_PARAM_IDENTIFIER (1u << 16)
+#define IOS_PARAM_LABEL (1u << 17)
+
+// Action parameters decoded in one pass over the params object. String
+// members stay as tokens into source and are only unescaped by the action
+// that needs them.
+typedef struct {
+    unsigned int present;
+    double x;
+    double y;
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+    double duration;
+    double quiet_ms;
+    double hold;
+    double timeout;
+    const char* source;
+    // The params object itself, untyped when there was none.
+    IOSJsonToken object;
+    IOSJsonToken text;
+    IOSJsonToken path;
+    IOSJsonToken device_id;
+    IOSJsonToken until;
+    IOSJsonToken condition;
+    IOSJsonToken touches;
+    IOSJsonToken identifier;
+    IOSJsonToken label;
+} IOSActionParams;
+
+void* ios_bridge_create(const char* device_id, const char* bundle_id);
+void ios_bridge_destroy(void* bridge);
+char* ios_bridge_get_current_state(void* bridge);
+char* ios_bridge_get_state_delta(void* bridge);
+// The delta from baseline to state, a JSON object standing for the single
+// node fingerprint, in the shape ios_bridge_get_state_delta returns; the
+// baseline then moves to state. ios_delta.c.
+char* ios_delta_advance(IOSDeltaBaseline* baseline, const char* fingerprint, const char* state);
+void ios_delta_reset(IOSDeltaBaseline* baseline);
+char* ios_bridge_analyze_screen(void* bridge);
+char* ios_bridge_execute_action(void* bridge, const char* action, const char* params);
+int ios_bridge_execute_batch(void* bridge, const char* actions_json, char** results_out);
+int ios_bridge_execute_action_buffer(void* bridge, const char* action, const char* params, IOSBridgeBuffer* out);
+int ios_bridge_execute_batch_buffer(void* bridge, const char* actions_json, IOSBridgeBuffer* out);
+// Snapshots clone the app's data container (copy-on-write on APFS), and
+// restoring swaps the clone back in; both relaunch the app. The returned
+// bytes are an ios_snapshot_format.h record naming the clone, which stays on
+// disk until ios_bridge_delete_snapshot. All three return 0 on success.
+int ios_bridge_create_snapshot_into(void* bridge, IOSBridgeReserve reserve, void* context);
+void* ios_bridge_create_snapshot(void* bridge, size_t* size);
+int ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size);
+int ios_bridge_delete_snapshot(void* bridge, const void* data, size_t size);
+// Captures the screen into memory reserved by the caller. Returns 0 or a
+// negative IOS_FRAME_ERROR_* code.
+int ios_bridge_capture_frame(void* bridge, const IOSFrameRequest* request, IOSBridgeReserve reserve,
+                             void* context, IOSFrameInfo* info);
+int ios_frame_capture(IOSWorker* worker, const char* device_id, const IOSFrameRequest* request,
+                      IOSBridgeReserve reserve, void* context, IOSFrameInfo* info);
+// Checks the request and picks the simctl screenshot command. Returns 0 or
+// IOS_FRAME_ERROR_REQUEST.
+int ios_frame_plan(const IOSFrameRequest* request, IOSFramePlan* plan);
+// Fits the plan to a screen of screen_width x screen_height pixels. Returns
+// 0, or IOS_FRAME_ERROR_REQUEST when the crop misses the screen.
+int ios_frame_plan_region(const IOSFrameRequest* request, int screen_width, int screen_height,
+                          IOSFramePlan* plan);
+char* ios_bridge_execute_params(void* bridge, const char* action, const IOSActionParams* params);
+// The reply to a plain "wait" (no until), with its length in *duration_ms,
+// or NULL for any other action. Such waits touch no device, so neither the
+// synchronous nor the submitted path holds anything while they run.
+char* ios_plain_wait_result(const char* action, const IOSActionParams* params, double* duration_ms);
+// Plays tap, swipe, touch and type_text actions through the HID connection
+// for call->device_id. Returns NULL for any other action.
+char* ios_gesture_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params);
+// Opens the HID connection for call->device_id unless it is already open.
+int ios_gesture_prepare(const IOSBridgeCall* call, char* error, size_t error_size);
+void ios_gesture_disconnect(IOSBridgeImpl* impl);
+// Simulator boot/shutdown and app launch/terminate/relaunch/reset/navigate
+// for ios_bridge_mutate_state; see ios_lifecycle.c.
+char* ios_lifecycle_mutate(IOSBridgeCall* call, const char* entity, const char* action, const char* data);
+
+// Receives ownership of result, freed with ios_bridge_free_string. Called on
+// the bridge's executor thread, so it should hand the result off and return.
+typedef void (*IOSBridgeCompletion)(void* context, uint64_t request_id, char* result);
+
+// Queues an action and returns at once with a non-zero request id; completion
+// runs exactly once when it finishes, or when the bridge is destroyed first.
+// Actions run in submission order, except plain waits, which are timers that
+// complete after their duration without holding up later actions. Returns 0,
+// without ever calling completion, if the action could not be queued.
+uint64_t ios_bridge_submit_action(void* bridge, const char* action, const char* params,
+                                  IOSBridgeCompletion completion, void* context);
+IOSBridgeExecutor* ios_executor_create(IOSBridgeImpl* bridge);
+void ios_executor_destroy(IOSBridgeExecutor* executor);
+
+// A fixed set of bridges, one per simulator. Already-booted simulators are
+// used first, least loaded first; the rest are created with the device type
+// and runtime of the first booted one. Creation fails unless all size
+// devices are available.
+typedef struct IOSBridgePool IOSBridgePool;
+IOSBridgePool* ios_bridge_pool_create(int size, const char* bundle_id);
+void ios_bridge_pool_destroy(IOSBridgePool* pool);
+int ios_bridge_pool_size(const IOSBridgePool* pool);
+// Hands out an idle bridge for exclusive use, waiting up to timeout_ms
+// (forever when negative). Returns NULL on timeout.
+void* ios_bridge_pool_acquire(IOSBridgePool* pool, int timeout_ms);
+// Same, restricted to members whose registry record passes filter (its
+// least_loaded flag is ignored, since members are never shared). Returns
+// NULL at once when no member matches.
+void* ios_bridge_pool_acquire_matching(IOSBridgePool* pool, const IOSDeviceFilter* filter, int timeout_ms);
+void ios_bridge_pool_release(IOSBridgePool* pool, void* bridge);
+
+// Which pool members are lent out, in ios_pool_checkout.c, needs no handle.
+// Members are indexes below count, which never changes.
+#define IOS_POOL_MAX_DEVICES 32
+typedef struct IOSPoolCheckout IOSPoolCheckout;
+IOSPoolCheckout* ios_pool_checkout_create(int count);
+void ios_pool_checkout_destroy(IOSPoolCheckout* checkout);
+// Marks the first idle member with eligible[i] set (any member when eligible
+// is NULL) busy, waiting up to timeout_ms (forever when negative). Returns
+// its index, or -1 on timeout and at once when no member is eligible.
+int ios_pool_checkout_acquire(IOSPoolCheckout* checkout, const int* eligible, int timeout_ms);
+void ios_pool_checkout_release(IOSPoolCheckout* checkout, int index);
+
+// Resolves (and, except for ios_bridge_handle, locks) the handle to act on,
+// falling back to a shared process-wide bridge for NULL handles. Each
+// returns NULL / -1, with nothing locked, when no simulator can be found.
+IOSBridgeImpl* ios_bridge_handle(void* bridge);
+IOSBridgeImpl* ios_bridge_lock(void* bridge);
+void ios_bridge_unlock(IOSBridgeImpl* impl);
+int ios_bridge_call_begin(IOSBridgeCall* call, void* bridge, const IOSActionParams* params);
+void ios_bridge_call_end(IOSBridgeCall* call);
+int ios_bridge_call_device_command(const IOSBridgeCall* call, const char* verb, const char* rest,
+                                   IOSCommandOutput* output);
+int ios_bridge_run_device_command(IOSBridgeImpl* bridge, const char* verb, const char* rest, IOSCommandOutput* output);
+
+// Both return 0 on success and -1 for malformed JSON or a known member with
+// the wrong type. A NULL or blank params string decodes to no members.
+int ios_action_params_parse(const char* json, IOSActionParams* params);
+int ios_action_params_decode(const char* json, const IOSJsonToken* tokens, int count, int object,
+                             IOSActionParams* params);
+// Unescaped copy of a string member, or NULL if absent, not a string or
+// holding a NUL character. The caller frees it.
+char* ios_action_params_string(const IOSActionParams* params, const IOSJsonToken* member);
+
+void ios_worker_init(IOSWorker* worker);
+int ios_worker_start(IOSWorker* worker);
+void ios_worker_stop(IOSWorker* worker);
+
+// Runs a simctl subcommand through the resident worker, falling back to popen
+// when the worker is unhealthy. Returns the exit status of the command, or -1
+// if it could not be launched at all. Output is optional.
+int ios_bridge_run_simctl(IOSBridgeImpl* impl, const char* args, IOSCommandOutput* output);
+int ios_worker_run_simctl(IOSWorker* worker, const char* args, IOSCommandOutput* output);
+// Same, with input written to simctl's stdin.
+int ios_worker_run_simctl_input(IOSWorker* worker, const char* args, const char* input, IOSCommandOutput* output);
+// Runs "simctl <verb> <device> <rest>" with the device id shell-quoted.
+int ios_worker_run_device_command(IOSWorker* worker, const char* device_id, const char* verb, const char* rest,
+                                  IOSCommandOutput* output);
+
+void ios_command_output_free(IOSCommandOutput* output);
+
+// Lends a malloc'd string through buffer, released with free.
+void ios_buffer_adopt(IOSBridgeBuffer* buffer, char* data, size_t length);
+
+// Deadlines are measured on the monotonic clock, but condition variables wait
+// for a wall-clock time (macOS cannot switch them to CLOCK_MONOTONIC).
+static inline struct timespec ios_wall_deadline(double delay_ms) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long long deadline_us = (long long)now.tv_sec * 1000000LL + now.tv_usec + (long long)(delay_ms * 1000.0);
+    struct timespec deadline = {
+        .tv_sec = (time_t)(deadline_us / 1000000LL),
+        .tv_nsec = (long)(deadline_us % 1000000LL) * 1000L,
+    };
+    return deadline;
+}
+
+#endif
@@ -0,0 +1,392 @@
+#include "ios_json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void ios_json_init(IOSJsonParser* parser) {
+    parser->pos = 0;
+    parser->next = 0;
+    parser->super = -1;
+}
+
+static IOSJsonToken* alloc_token(IOSJsonParser* parser, IOSJsonToken* tokens, unsigned int token_count) {
+    if ((unsigned int)parser->next >= token_count) return NULL;
+    IOSJsonToken* token = &tokens[parser->next++];
+    token->type = IOS_JSON_UNDEFINED;
+    token->start = -1;
+    token->end = -1;
+    token->size = 0;
+    token->parent = -1;
+    return token;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Only strings may be object keys, and a key carries exactly one value.
+static int attach_to_super(IOSJsonParser* parser, IOSJsonToken* tokens, IOSJsonToken* token, int may_be_key) {
+    if (parser->super == -1) return 0;
+    IOSJsonToken* super = &tokens[parser->super];
+    if (!may_be_key && super->type == IOS_JSON_OBJECT) return IOS_JSON_ERROR_INVALID;
+    if (super->type == IOS_JSON_STRING && super->size != 0) return IOS_JSON_ERROR_INVALID;
+    token->parent = parser->super;
+    super->size++;
+    return 0;
+}
+
+static int parse_string(IOSJsonParser* parser, const char* json, size_t length,
+                        IOSJsonToken* tokens, unsigned int token_count) {
+    size_t start = parser->pos;
+
+    for (parser->pos++; parser->pos < length && json[parser->pos]; parser->pos++) {
+        char c = json[parser->pos];
+        if (c == '"') {
+            if (!tokens) return 0;
+            IOSJsonToken* token = alloc_token(parser, tokens, token_count);
+            if (!token) {
+                parser->pos = start;
+                return IOS_JSON_ERROR_NOMEM;
+            }
+            token->type = IOS_JSON_STRING;
+            token->start = (int)start + 1;
+            token->end = (int)parser->pos;
+            return attach_to_super(parser, tokens, token, 1);
+        }
+        // Tokens are spliced into replies still escaped, so a raw control
+        // character would make those replies invalid JSON too.
+        if ((unsigned char)c < 32) {
+            parser->pos = start;
+            return IOS_JSON_ERROR_INVALID;
+        }
+
+        if (c == '\\') {
+            if (++parser->pos >= length || !json[parser->pos]) break;
+            switch (json[parser->pos]) {
+                case '"': case '/': case '\\': case 'b':
+                case 'f': case 'r': case 'n': case 't':
+                    break;
+                case 'u':
+                    // Running out of input mid-escape is truncation, like
+                    // running out anywhere else in the string.
+                    for (int i = 0; i < 4; i++) {
+                        if (++parser->pos >= length || !json[parser->pos]) {
+                            parser->pos = start;
+                            return IOS_JSON_ERROR_PARTIAL;
+                        }
+                        if (hex_value(json[parser->pos]) < 0) {
+                            parser->pos = start;
+                            return IOS_JSON_ERROR_INVALID;
+                        }
+                    }
+                    break;
+                default:
+                    parser->pos = start;
+                    return IOS_JSON_ERROR_INVALID;
+            }
+        }
+    }
+
+    parser->pos = start;
+    return IOS_JSON_ERROR_PARTIAL;
+}
+
+static int parse_primitive(IOSJsonParser* parser, const char* json, size_t length,
+                           IOSJsonToken* tokens, unsigned int token_count) {
+    size_t start = parser->pos;
+
+    for (; parser->pos < length && json[parser->pos]; parser->pos++) {
+        char c = json[parser->pos];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ']' || c == '}' || c == ':') break;
+        if (c < 32 || c == 127) {
+            parser->pos = start;
+            return IOS_JSON_ERROR_INVALID;
+        }
+    }
+
+    if (!tokens) {
+        parser->pos--;
+        return 0;
+    }
+
+    IOSJsonToken* token = alloc_token(parser, tokens, token_count);
+    if (!token) {
+        parser->pos = start;
+        return IOS_JSON_ERROR_NOMEM;
+    }
+    token->type = IOS_JSON_PRIMITIVE;
+    token->start = (int)start;
+    token->end = (int)parser->pos;
+    parser->pos--;
+    return attach_to_super(parser, tokens, token, 0);
+}
+
+static int close_container(IOSJsonParser* parser, IOSJsonToken* tokens, IOSJsonType type) {
+    if (parser->next < 1) return IOS_JSON_ERROR_INVALID;
+
+    IOSJsonToken* token = &tokens[parser->next - 1];
+    for (;;) {
+        if (token->start != -1 && token->end == -1) {
+            if (token->type != type) return IOS_JSON_ERROR_INVALID;
+            token->end = (int)parser->pos + 1;
+            parser->super = token->parent;
+            return 0;
+        }
+        if (token->parent == -1) return IOS_JSON_ERROR_INVALID;
+        token = &tokens[token->parent];
+    }
+}
+
+int ios_json_parse(IOSJsonParser* parser, const char* json, size_t length,
+                   IOSJsonToken* tokens, unsigned int token_count) {
+    int count = parser->next;
+
+    for (; parser->pos < length && json[parser->pos]; parser->pos++) {
+        char c = json[parser->pos];
+        int status = 0;
+
+        switch (c) {
+            case '{':
+            case '[': {
+                count++;
+                if (!tokens) break;
+                IOSJsonToken* token = alloc_token(parser, tokens, token_count);
+                if (!token) return IOS_JSON_ERROR_NOMEM;
+                status = attach_to_super(parser, tokens, token, 0);
+                token->type = c == '{' ? IOS_JSON_OBJECT : IOS_JSON_ARRAY;
+                token->start = (int)parser->pos;
+                parser->super = parser->next - 1;
+                break;
+            }
+            case '}':
+            case ']':
+                if (!tokens) break;
+                status = close_container(parser, tokens, c == '}' ? IOS_JSON_OBJECT : IOS_JSON_ARRAY);
+                break;
+            case '"':
+                status = parse_string(parser, json, length, tokens, token_count);
+                count++;
+                break;
+            case ':':
+                if (tokens && parser->next > 0 && tokens[parser->next - 1].type != IOS_JSON_STRING) {
+                    return IOS_JSON_ERROR_INVALID;
+                }
+                parser->super = parser->next - 1;
+                break;
+            case ',':
+                if (tokens && parser->super != -1 &&
+                    tokens[parser->super].type != IOS_JSON_ARRAY &&
+                    tokens[parser->super].type != IOS_JSON_OBJECT) {
+                    parser->super = tokens[parser->super].parent;
+                }
+                break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                break;
+            case '-': case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+            case 't': case 'f': case 'n':
+                status = parse_primitive(parser, json, length, tokens, token_count);
+                count++;
+                break;
+            default:
+                return IOS_JSON_ERROR_INVALID;
+        }
+
+        if (status < 0) return status;
+    }
+
+    if (tokens) {
+        for (int i = parser->next - 1; i >= 0; i--) {
+            if (tokens[i].start != -1 && tokens[i].end == -1) return IOS_JSON_ERROR_PARTIAL;
+        }
+    }
+
+    return count;
+}
+
+int ios_json_skip(const IOSJsonToken* tokens, int count, int index) {
+    int pending = 1;
+    while (pending > 0 && index < count) {
+        pending += tokens[index].size - 1;
+        index++;
+    }
+    return index;
+}
+
+int ios_json_find(const char* json, const IOSJsonToken* tokens, int count, int object, const char* key) {
+    if (object < 0 || object >= count || tokens[object].type != IOS_JSON_OBJECT) return -1;
+
+    int index = object + 1;
+    for (int member = 0; member < tokens[object].size && index + 1 < count; member++) {
+        if (tokens[index].size == 1 && ios_json_equals(json, &tokens[index], key)) return index + 1;
+        // A key's only child is its value, so skipping the key skips both.
+        index = ios_json_skip(tokens, count, index);
+    }
+    return -1;
+}
+
+int ios_json_equals(const char* json, const IOSJsonToken* token, const char* value) {
+    size_t length = strlen(value);
+    return token->type == IOS_JSON_STRING &&
+           (size_t)(token->end - token->start) == length &&
+           memcmp(json + token->start, value, length) == 0;
+}
+
+int ios_json_number(const char* json, const IOSJsonToken* token, double* value) {
+    if (token->type != IOS_JSON_PRIMITIVE) return -1;
+    char first = json[token->start];
+    if (first != '-' && (first < '0' || first > '9')) return -1;
+
+    // Primitives are short, so a bounded copy gives strtod a terminator
+    // without touching the caller's buffer.
+    char digits[64];
+    size_t length = (size_t)(token->end - token->start);
+    if (length >= sizeof(digits)) return -1;
+    memcpy(digits, json + token->start, length);
+    digits[length] = '\0';
+
+    char* end = NULL;
+    *value = strtod(digits, &end);
+    return end == digits + length ? 0 : -1;
+}
+
+int ios_json_bool(const char* json, const IOSJsonToken* token, int* value) {
+    if (token->type != IOS_JSON_PRIMITIVE) return -1;
+    size_t length = (size_t)(token->end - token->start);
+    if (length == 4 && memcmp(json + token->start, "true", 4) == 0) {
+        *value = 1;
+        return 0;
+    }
+    if (length == 5 && memcmp(json + token->start, "false", 5) == 0) {
+        *value = 0;
+        return 0;
+    }
+    return -1;
+}
+
+static size_t encode_utf8(unsigned int code, char* out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+static unsigned int read_hex4(const char* p) {
+    return (unsigned int)(hex_value(p[0]) << 12 | hex_value(p[1]) << 8 | hex_value(p[2]) << 4 | hex_value(p[3]));
+}
+
+int ios_json_unescape(const char* json, const IOSJsonToken* token, char* out, size_t out_size) {
+    if (token->type != IOS_JSON_STRING) return -1;
+    const char* p = json + token->start;
+    const char* end = json + token->end;
+    if (out_size < (size_t)(end - p) + 1) return -1;
+
+    // Escapes never decode to more bytes than they occupy, so the output
+    // always fits in the token's own length.
+    size_t length = 0;
+    while (p < end) {
+        if (*p != '\\') {
+            out[length++] = *p++;
+            continue;
+        }
+
+        p++;
+        switch (*p) {
+            case 'b': out[length++] = '\b'; break;
+            case 'f': out[length++] = '\f'; break;
+            case 'n': out[length++] = '\n'; break;
+            case 'r': out[length++] = '\r'; break;
+            case 't': out[length++] = '\t'; break;
+            case 'u': {
+                unsigned int code = read_hex4(p + 1);
+                p += 4;
+                if (code >= 0xD800 && code <= 0xDBFF && end - p >= 7 && p[1] == '\\' && p[2] == 'u') {
+                    unsigned int low = read_hex4(p + 3);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                if (code >= 0xD800 && code <= 0xDFFF) return -1;
+                length += encode_utf8(code, out + length);
+                break;
+            }
+            default: out[length++] = *p; break;
+        }
+        p++;
+    }
+
+    out[length] = '\0';
+    return (int)length;
+}
+
+int ios_json_parse_alloc(const char* json, size_t length, IOSJsonToken** tokens_out) {
+    *tokens_out = NULL;
+
+    IOSJsonParser parser;
+    ios_json_init(&parser);
+    int count = ios_json_parse(&parser, json, length, NULL, 0);
+    if (count <= 0) return count < 0 ? count : IOS_JSON_ERROR_PARTIAL;
+
+    IOSJsonToken* tokens = malloc(sizeof(IOSJsonToken) * (size_t)count);
+    if (!tokens) return IOS_JSON_ERROR_NOMEM;
+
+    ios_json_init(&parser);
+    int parsed = ios_json_parse(&parser, json, length, tokens, (unsigned int)count);
+    if (parsed < 0) {
+        free(tokens);
+        return parsed;
+    }
+
+    *tokens_out = tokens;
+    return parsed;
+}
+
+// Enough for a typical result; larger ones are tokenized on the heap.
+#define IOS_JSON_RESULT_TOKENS 64
+
+int ios_result_succeeded(const char* result) {
+    IOSJsonToken stack[IOS_JSON_RESULT_TOKENS];
+    IOSJsonToken* heap = NULL;
+    IOSJsonParser parser;
+    ios_json_init(&parser);
+    size_t length = strlen(result);
+    int count = ios_json_parse(&parser, result, length, stack, IOS_JSON_RESULT_TOKENS);
+    if (count == IOS_JSON_ERROR_NOMEM) count = ios_json_parse_alloc(result, length, &heap);
+    const IOSJsonToken* tokens = heap ? heap : stack;
+
+    int succeeded = 0;
+    if (count > 0 && tokens[0].type == IOS_JSON_OBJECT) {
+        int success = ios_json_find(result, tokens, count, 0, "success");
+        int value;
+        if (success >= 0) {
+            succeeded = ios_json_bool(result, &tokens[success], &value) == 0 && value;
+        } else {
+            succeeded = ios_json_find(result, tokens, count, 0, "error") < 0;
+        }
+    }
+    free(heap);
+    return succeeded;
+}
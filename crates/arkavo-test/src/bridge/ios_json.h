@@ -0,0 +1,67 @@
+#ifndef ARKAVO_IOS_JSON_H
+#define ARKAVO_IOS_JSON_H
+
+#include <stddef.h>
+
+// In-place JSON tokenizer in the style of jsmn: tokens are offsets into the
+// caller's buffer, so parsing never allocates or copies.
+typedef enum {
+    IOS_JSON_UNDEFINED = 0,
+    IOS_JSON_OBJECT,
+    IOS_JSON_ARRAY,
+    IOS_JSON_STRING,
+    IOS_JSON_PRIMITIVE
+} IOSJsonType;
+
+#define IOS_JSON_ERROR_NOMEM -1
+#define IOS_JSON_ERROR_INVALID -2
+#define IOS_JSON_ERROR_PARTIAL -3
+
+// String tokens span the contents between the quotes, still escaped. An
+// object's size is its member count; each key's size is 1, its value.
+typedef struct {
+    IOSJsonType type;
+    int start;
+    int end;
+    int size;
+    int parent;
+} IOSJsonToken;
+
+typedef struct {
+    size_t pos;
+    int next;
+    int super;
+} IOSJsonParser;
+
+void ios_json_init(IOSJsonParser* parser);
+
+// Returns the number of tokens, or a negative IOS_JSON_ERROR_* code. With
+// tokens == NULL only counts, which lets callers size the array exactly.
+int ios_json_parse(IOSJsonParser* parser, const char* json, size_t length,
+                   IOSJsonToken* tokens, unsigned int token_count);
+
+// Index of the first token after the value at index and all its children.
+int ios_json_skip(const IOSJsonToken* tokens, int count, int index);
+
+// Index of the value for key in the object at index, or -1.
+int ios_json_find(const char* json, const IOSJsonToken* tokens, int count, int object, const char* key);
+
+int ios_json_equals(const char* json, const IOSJsonToken* token, const char* value);
+int ios_json_number(const char* json, const IOSJsonToken* token, double* value);
+int ios_json_bool(const char* json, const IOSJsonToken* token, int* value);
+
+// Decodes a string token into out, which needs token length + 1 bytes.
+// Returns the decoded length, or -1 for a malformed escape.
+int ios_json_unescape(const char* json, const IOSJsonToken* token, char* out, size_t out_size);
+
+// Tokenizes into a freshly sized heap array. Returns the token count and
+// stores the array in tokens_out, or a negative IOS_JSON_ERROR_* code.
+int ios_json_parse_alloc(const char* json, size_t length, IOSJsonToken** tokens_out);
+
+// Whether an action result reports success: a top-level "success" that is
+// true, or else no top-level "error" member. Only the outer object counts,
+// since replies serialized from dictionaries order their keys arbitrarily
+// and nested results or string values may mention either word first.
+int ios_result_succeeded(const char* result);
+
+#endif
@@ -0,0 +1,337 @@
+#include "ios_impl.h"
+#include "ios_probe.h"
+#include "ios_registry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cold launches are the largest cost of a scenario, so resets and screen
+// changes first go to the running app as a deep link it applies in process
+// (ArkavoReference's LaunchCommand.swift):
+//
+//   <scheme>://reset?token=T[&screen=S][&user=U]   fresh state, then S
+//   <scheme>://screen/S?token=T                     S without a reset
+//
+// The app confirms on the first frame after the change with an
+// IOS_PROBE_COMMAND record carrying T in its probe ring. An app that does
+// not confirm in time is relaunched with the same request as arguments:
+// -ArkavoCommand reset|navigate -ArkavoScreen S -ArkavoUser U
+// -ArkavoCommandToken T, which it confirms the same way once it is up.
+#define IOS_LIFECYCLE_SCHEME "arkavo-reference"
+// Past this, waiting longer for a warm reset costs more than relaunching.
+#define IOS_LIFECYCLE_WARM_MS 1500
+// How long a launch waits for the app to confirm it shows the request.
+#define IOS_LIFECYCLE_READY_MS 5000
+
+typedef struct {
+    char* screen;
+    char* user;
+    char* scheme;
+    double timeout_ms;
+} IOSLifecycleOptions;
+
+static char* failure(const char* message) {
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_append(&out, "{\"success\": false, \"error\": ", 28);
+    ios_builder_append_json_string(&out, message, strlen(message));
+    ios_builder_append(&out, "}", 1);
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+static char* option_string(const char* data, const IOSJsonToken* tokens, int count, const char* key) {
+    int index = ios_json_find(data, tokens, count, 0, key);
+    if (index < 0 || tokens[index].type != IOS_JSON_STRING) return NULL;
+    size_t size = (size_t)(tokens[index].end - tokens[index].start) + 1;
+    char* value = malloc(size);
+    if (value && ios_json_unescape(data, &tokens[index], value, size) < 0) {
+        free(value);
+        return NULL;
+    }
+    return value;
+}
+
+// data is the request's JSON object: {"screen", "user", "scheme",
+// "timeout_ms"}, all optional; blank means all defaults.
+static int parse_options(const char* data, IOSLifecycleOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->timeout_ms = IOS_LIFECYCLE_WARM_MS;
+    if (!data || data[strspn(data, " \t\r\n")] == '\0') return 0;
+
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(data, strlen(data), &tokens);
+    if (count < 1 || tokens[0].type != IOS_JSON_OBJECT) {
+        free(tokens);
+        return -1;
+    }
+    options->screen = option_string(data, tokens, count, "screen");
+    options->user = option_string(data, tokens, count, "user");
+    options->scheme = option_string(data, tokens, count, "scheme");
+    int timeout = ios_json_find(data, tokens, count, 0, "timeout_ms");
+    double value;
+    if (timeout >= 0 && ios_json_number(data, &tokens[timeout], &value) == 0 && value >= 0) {
+        options->timeout_ms = value;
+    }
+    free(tokens);
+    return 0;
+}
+
+static void free_options(IOSLifecycleOptions* options) {
+    free(options->screen);
+    free(options->user);
+    free(options->scheme);
+}
+
+static void append_url_encoded(IOSStringBuilder* out, const char* value) {
+    for (const unsigned char* c = (const unsigned char*)value; *c; c++) {
+        if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || strchr("-._~", *c)) {
+            ios_builder_append(out, (const char*)c, 1);
+        } else {
+            ios_builder_appendf(out, "%%%02X", *c);
+        }
+    }
+}
+
+static void append_argument(IOSStringBuilder* out, const char* name, const char* value) {
+    char* quoted = ios_shell_quote(value);
+    if (!quoted) {
+        out->failed = 1;
+        return;
+    }
+    ios_builder_appendf(out, " -%s %s", name, quoted);
+    free(quoted);
+}
+
+// Stands for one request in the app's confirmation. Microseconds of host
+// uptime are unique per request on this machine, even across bridge
+// processes, and stay exact in the record's f64.
+static double command_token(void) {
+    return (double)(uint64_t)(ios_monotonic_ms() * 1000.0);
+}
+
+static IOSProbe* lifecycle_probe(IOSBridgeCall* call) {
+    if (!call->impl->lifecycle_probe) call->impl->lifecycle_probe = ios_probe_open_app(call, NULL);
+    return call->impl->lifecycle_probe;
+}
+
+// The deep link for command, or NULL if allocation failed.
+static char* command_url(const char* command, const IOSLifecycleOptions* options, double token) {
+    IOSStringBuilder url;
+    ios_builder_init(&url);
+    append_url_encoded(&url, options->scheme ? options->scheme : IOS_LIFECYCLE_SCHEME);
+    if (strcmp(command, "navigate") == 0) {
+        ios_builder_append(&url, "://screen/", 10);
+        append_url_encoded(&url, options->screen);
+        ios_builder_appendf(&url, "?token=%.0f", token);
+    } else {
+        ios_builder_appendf(&url, "://reset?token=%.0f", token);
+        if (options->screen) {
+            ios_builder_append(&url, "&screen=", 8);
+            append_url_encoded(&url, options->screen);
+        }
+        if (options->user) {
+            ios_builder_append(&url, "&user=", 6);
+            append_url_encoded(&url, options->user);
+        }
+    }
+    char* text = ios_builder_finish(&url);
+    char* quoted = text ? ios_shell_quote(text) : NULL;
+    free(text);
+    return quoted;
+}
+
+// Sends the deep link and waits for the app's confirmation. Returns 1 once
+// confirmed, with *relaunched set if the link had to start the app, or 0
+// with reason filled.
+static int warm_command(IOSBridgeCall* call, const char* command, const IOSLifecycleOptions* options,
+                        int* relaunched, char* reason, size_t reason_size) {
+    if (call->impl->lifecycle_unconfirmed) {
+        snprintf(reason, reason_size, "The app does not confirm lifecycle commands");
+        return 0;
+    }
+    IOSProbe* probe = lifecycle_probe(call);
+    if (!probe || !ios_probe_mapped(probe)) {
+        snprintf(reason, reason_size, "The app has no probe ring to confirm a warm reset");
+        return 0;
+    }
+
+    double token = command_token();
+    char* url = command_url(command, options, token);
+    if (!url) {
+        snprintf(reason, reason_size, "Memory allocation failed");
+        return 0;
+    }
+    uint64_t mark = ios_probe_published(probe);
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "lifecycle", "warm");
+    int status = ios_bridge_call_device_command(call, "openurl", url, NULL);
+    free(url);
+    IOSProbeEvent ack;
+    int confirmed = status == 0 && ios_probe_wait_command(probe, mark, token, ios_monotonic_ms() + options->timeout_ms,
+                                                          &ack, relaunched) == 1;
+    ios_metrics_end(&span);
+
+    if (status != 0) {
+        snprintf(reason, reason_size, "simctl openurl failed with status %d", status);
+    } else if (!confirmed) {
+        snprintf(reason, reason_size, "The app did not confirm the deep link within %.0f ms", options->timeout_ms);
+    }
+    return confirmed;
+}
+
+// Launches the bridge's app, terminating a running copy first with
+// relaunch. command is handed over as launch arguments, or NULL for none.
+// Returns the simctl status and fills *confirmed and *launch_ms.
+static int cold_launch(IOSBridgeCall* call, const char* command, const IOSLifecycleOptions* options, int relaunch,
+                       int* confirmed, double* launch_ms, IOSStringBuilder* pid) {
+    IOSProbe* probe = lifecycle_probe(call);
+    // A ring that was never written means the app cannot confirm, so the
+    // launch is not held up waiting for it.
+    int confirmable = !call->impl->lifecycle_unconfirmed && probe && ios_probe_mapped(probe);
+    double token = command_token();
+    char* bundle = ios_shell_quote(call->impl->bundle_id);
+    IOSStringBuilder rest;
+    ios_builder_init(&rest);
+    ios_builder_append(&rest, bundle ? bundle : "", bundle ? strlen(bundle) : 0);
+    if (!bundle) rest.failed = 1;
+    free(bundle);
+    if (command) append_argument(&rest, "ArkavoCommand", command);
+    if (options->screen) append_argument(&rest, "ArkavoScreen", options->screen);
+    if (options->user) append_argument(&rest, "ArkavoUser", options->user);
+    ios_builder_appendf(&rest, " -ArkavoCommandToken %.0f", token);
+    char* args = ios_builder_finish(&rest);
+    if (!args) return -1;
+
+    uint64_t mark = confirmable ? ios_probe_published(probe) : 0;
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "lifecycle", relaunch ? "relaunch" : "launch");
+    IOSCommandOutput output = {NULL, 0};
+    int status = ios_bridge_call_device_command(call, relaunch ? "launch --terminate-running-process" : "launch",
+                                                args, &output);
+    *launch_ms = ios_monotonic_ms() - span.started_ms;
+    IOSProbeEvent ack;
+    int relaunched;
+    *confirmed = status == 0 && confirmable &&
+                 ios_probe_wait_command(probe, mark, token, ios_monotonic_ms() + IOS_LIFECYCLE_READY_MS, &ack,
+                                        &relaunched) == 1;
+    ios_metrics_end(&span);
+    free(args);
+    if (status == 0 && confirmable && !*confirmed) call->impl->lifecycle_unconfirmed = 1;
+
+    // simctl prints "<bundle>: <pid>".
+    const char* separator = output.data ? strrchr(output.data, ':') : NULL;
+    if (status == 0 && separator) ios_builder_appendf(pid, "%ld", strtol(separator + 1, NULL, 10));
+    ios_command_output_free(&output);
+    return status;
+}
+
+static char* timed_result(const char* action, double elapsed_ms) {
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_appendf(&out, "{\"success\": true, \"action\": \"%s\", \"elapsed_ms\": %.3f}", action, elapsed_ms);
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+static char* launch_result(const char* action, const char* method, double started_ms, int confirmed,
+                           double launch_ms, const char* pid, const char* fallback) {
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_appendf(&out, "{\"success\": true, \"action\": \"%s\", \"method\": \"%s\", \"elapsed_ms\": %.3f, "
+                        "\"confirmed\": %s", action, method, ios_monotonic_ms() - started_ms,
+                        confirmed ? "true" : "false");
+    if (launch_ms >= 0) ios_builder_appendf(&out, ", \"launch_ms\": %.3f", launch_ms);
+    if (pid && *pid) ios_builder_appendf(&out, ", \"pid\": %s", pid);
+    if (fallback) {
+        ios_builder_append(&out, ", \"fallback\": ", 14);
+        ios_builder_append_json_string(&out, fallback, strlen(fallback));
+    }
+    ios_builder_append(&out, "}", 1);
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
+
+static char* app_launch(IOSBridgeCall* call, const char* action, const char* command,
+                        const IOSLifecycleOptions* options, double started_ms, const char* fallback) {
+    int confirmed;
+    double launch_ms;
+    IOSStringBuilder pid;
+    ios_builder_init(&pid);
+    int status = cold_launch(call, command, options, strcmp(action, "launch") != 0, &confirmed, &launch_ms, &pid);
+    char* pid_text = ios_builder_finish(&pid);
+    char* result;
+    if (status != 0) {
+        char message[IOS_BACKEND_ERROR_MAX];
+        snprintf(message, sizeof(message), "simctl launch of %s failed with status %d", call->impl->bundle_id, status);
+        result = failure(message);
+    } else {
+        result = launch_result(action, "cold", started_ms, confirmed, launch_ms, pid_text, fallback);
+    }
+    free(pid_text);
+    return result;
+}
+
+static char* app_mutate(IOSBridgeCall* call, const char* action, const IOSLifecycleOptions* options) {
+    double started_ms = ios_monotonic_ms();
+    if (strcmp(action, "launch") == 0 || strcmp(action, "relaunch") == 0) {
+        return app_launch(call, action, NULL, options, started_ms, NULL);
+    }
+
+    if (strcmp(action, "reset") == 0 || strcmp(action, "navigate") == 0) {
+        if (strcmp(action, "navigate") == 0 && !options->screen) return failure("navigate needs a \"screen\"");
+        int relaunched = 0;
+        char reason[IOS_BACKEND_ERROR_MAX];
+        if (warm_command(call, action, options, &relaunched, reason, sizeof(reason))) {
+            return launch_result(action, relaunched ? "cold" : "warm", started_ms, 1, -1, NULL, NULL);
+        }
+        return app_launch(call, action, action, options, started_ms, reason);
+    }
+
+    if (strcmp(action, "terminate") == 0) {
+        char* bundle = ios_shell_quote(call->impl->bundle_id);
+        if (!bundle) return failure("Memory allocation failed");
+        IOSMetricsSpan span;
+        ios_metrics_begin(&span, "lifecycle", "terminate");
+        int status = ios_bridge_call_device_command(call, "terminate", bundle, NULL);
+        double elapsed_ms = ios_metrics_end(&span);
+        free(bundle);
+        if (status != 0) {
+            char message[IOS_BACKEND_ERROR_MAX];
+            snprintf(message, sizeof(message), "simctl terminate failed with status %d; is %s running?", status,
+                     call->impl->bundle_id);
+            return failure(message);
+        }
+        return timed_result(action, elapsed_ms);
+    }
+    return NULL;
+}
+
+static char* simulator_mutate(IOSBridgeCall* call, const char* action) {
+    if (strcmp(action, "boot") != 0 && strcmp(action, "shutdown") != 0) return NULL;
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "lifecycle", action);
+    int status = ios_bridge_call_device_command(call, action, "", NULL);
+    double elapsed_ms = ios_metrics_end(&span);
+    ios_registry_refresh();
+    if (status != 0) {
+        char message[IOS_BACKEND_ERROR_MAX];
+        snprintf(message, sizeof(message), "simctl %s failed with status %d", action, status);
+        return failure(message);
+    }
+    return timed_result(action, elapsed_ms);
+}
+
+char* ios_lifecycle_mutate(IOSBridgeCall* call, const char* entity, const char* action, const char* data) {
+    char* result = NULL;
+    if (strcmp(entity, "simulator") == 0) {
+        result = simulator_mutate(call, action);
+    } else if (strcmp(entity, "app") == 0) {
+        IOSLifecycleOptions options;
+        if (parse_options(data, &options) != 0) return failure("data must be a JSON object");
+        result = app_mutate(call, action, &options);
+        free_options(&options);
+    }
+    return result ? result : failure("Unknown entity or action");
+}
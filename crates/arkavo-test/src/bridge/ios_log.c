@@ -0,0 +1,342 @@
+#include "ios_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// How long the reader blocks before checking whether the tap is stopping,
+// which bounds how long a stop waits on a quiet log.
+#define IOS_LOG_POLL_MS 100
+// A single event is at most a few kilobytes; a line this long means the
+// stream lost its framing, and the line is dropped.
+#define IOS_LOG_MAX_LINE (1024 * 1024)
+#define IOS_LOG_STOP_GRACE_MS 500
+
+typedef struct {
+    char* json;
+    size_t length;
+} IOSLogSlot;
+
+struct IOSLogTap {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t updated;
+    pid_t pid;
+    int fd;
+    int capacity;
+    IOSLogSlot* slots;
+    // Sequence of the newest entry; entry n lives in slots[n % capacity].
+    uint64_t sequence;
+    double clock_offset_ms;
+    int thread_started;
+    int running;
+    int stopping;
+};
+
+typedef struct {
+    char* subsystem;
+    char* process;
+    char* predicate;
+    char level[8];
+    int capacity;
+} IOSLogOptions;
+
+static double wall_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+static void store_entry(IOSLogTap* tap, const char* line, size_t length) {
+    // Only the reader thread appends, so it reads the sequence unlocked and
+    // formats the entry before taking the lock readers wait on.
+    uint64_t sequence = tap->sequence + 1;
+    char* json = ios_log_entry_from_ndjson(line, length, sequence, tap->clock_offset_ms, ios_monotonic_ms());
+    if (!json) return;
+
+    pthread_mutex_lock(&tap->lock);
+    IOSLogSlot* slot = &tap->slots[sequence % (uint64_t)tap->capacity];
+    free(slot->json);
+    slot->json = json;
+    slot->length = strlen(json);
+    tap->sequence = sequence;
+    pthread_cond_broadcast(&tap->updated);
+    pthread_mutex_unlock(&tap->lock);
+}
+
+static void* tap_main(void* context) {
+    IOSLogTap* tap = context;
+    size_t capacity = 64 * 1024;
+    size_t used = 0;
+    int discarding = 0;
+    char* buffer = malloc(capacity + 1);
+
+    while (buffer) {
+        pthread_mutex_lock(&tap->lock);
+        int stopping = tap->stopping;
+        pthread_mutex_unlock(&tap->lock);
+        if (stopping) break;
+
+        struct pollfd ready = {.fd = tap->fd, .events = POLLIN};
+        int polled = poll(&ready, 1, IOS_LOG_POLL_MS);
+        if (polled < 0 && errno != EINTR) break;
+        if (polled <= 0) continue;
+
+        if (used == capacity) {
+            if (capacity >= IOS_LOG_MAX_LINE) {
+                used = 0;
+                discarding = 1;
+            } else {
+                char* grown = realloc(buffer, capacity * 2 + 1);
+                if (!grown) break;
+                buffer = grown;
+                capacity *= 2;
+            }
+        }
+        ssize_t count = read(tap->fd, buffer + used, capacity - used);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        used += (size_t)count;
+
+        char* start = buffer;
+        char* newline;
+        while ((newline = memchr(start, '\n', used - (size_t)(start - buffer)))) {
+            *newline = '\0';
+            // The first line is log's "Filtering the log data" banner, and
+            // skipping what is not a log event covers it.
+            if (!discarding && *start == '{') store_entry(tap, start, (size_t)(newline - start));
+            discarding = 0;
+            start = newline + 1;
+        }
+        used -= (size_t)(start - buffer);
+        memmove(buffer, start, used);
+    }
+
+    free(buffer);
+    pthread_mutex_lock(&tap->lock);
+    tap->running = 0;
+    pthread_cond_broadcast(&tap->updated);
+    pthread_mutex_unlock(&tap->lock);
+    return NULL;
+}
+
+static char* option_string(const char* json, const IOSJsonToken* tokens, int count, const char* key) {
+    int index = ios_json_find(json, tokens, count, 0, key);
+    if (index < 0 || tokens[index].type != IOS_JSON_STRING) return NULL;
+    char* value = malloc((size_t)(tokens[index].end - tokens[index].start) + 1);
+    if (value && ios_json_unescape(json, &tokens[index], value, (size_t)(tokens[index].end - tokens[index].start) + 1) < 0) {
+        free(value);
+        value = NULL;
+    }
+    return value;
+}
+
+static int parse_options(const char* json, IOSLogOptions* options) {
+    memset(options, 0, sizeof(*options));
+    strcpy(options->level, "info");
+    options->capacity = IOS_LOG_DEFAULT_CAPACITY;
+    if (!json || !*json) return 0;
+
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(json, strlen(json), &tokens);
+    int status = count > 0 && tokens[0].type == IOS_JSON_OBJECT ? 0 : -1;
+    if (status == 0) {
+        options->subsystem = option_string(json, tokens, count, "subsystem");
+        options->process = option_string(json, tokens, count, "process");
+        options->predicate = option_string(json, tokens, count, "predicate");
+        int level = ios_json_find(json, tokens, count, 0, "level");
+        if (level >= 0) {
+            if (ios_json_equals(json, &tokens[level], "default") || ios_json_equals(json, &tokens[level], "info") ||
+                ios_json_equals(json, &tokens[level], "debug")) {
+                int length = tokens[level].end - tokens[level].start;
+                memcpy(options->level, json + tokens[level].start, (size_t)length);
+                options->level[length] = '\0';
+            } else {
+                status = -1;
+            }
+        }
+        int capacity = ios_json_find(json, tokens, count, 0, "capacity");
+        double value;
+        if (capacity >= 0) {
+            if (ios_json_number(json, &tokens[capacity], &value) != 0 || value < 1) status = -1;
+            else options->capacity = value > IOS_LOG_MAX_CAPACITY ? IOS_LOG_MAX_CAPACITY : (int)value;
+        }
+    }
+    free(tokens);
+    return status;
+}
+
+// Values are quoted as NSPredicate string literals.
+static void append_clause(IOSStringBuilder* out, const char* key, const char* value) {
+    if (out->length) ios_builder_append(out, " AND ", 5);
+    ios_builder_appendf(out, "%s == \"", key);
+    for (const char* p = value; *p; p++) {
+        if (*p == '"' || *p == '\\') ios_builder_append(out, "\\", 1);
+        ios_builder_append(out, p, 1);
+    }
+    ios_builder_append(out, "\"", 1);
+}
+
+static char* build_predicate(const IOSLogOptions* options) {
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    if (options->subsystem) append_clause(&out, "subsystem", options->subsystem);
+    if (options->process) append_clause(&out, "process", options->process);
+    if (options->predicate) {
+        if (out.length) ios_builder_append(&out, " AND ", 5);
+        ios_builder_appendf(&out, "(%s)", options->predicate);
+    }
+    return ios_builder_finish(&out);
+}
+
+static int spawn_stream(IOSLogTap* tap, const char* device_id, const IOSLogOptions* options) {
+    char* predicate = build_predicate(options);
+    if (!predicate) return -1;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        free(predicate);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+
+    // Arguments go to xcrun unquoted, so predicates need no shell escaping.
+    char* argv[] = {"xcrun", "simctl", "spawn", (char*)device_id, "log", "stream", "--style", "ndjson", "--level",
+                    (char*)options->level, *predicate ? "--predicate" : NULL, predicate, NULL};
+    int spawned = posix_spawnp(&tap->pid, "xcrun", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    free(predicate);
+    close(fds[1]);
+
+    if (spawned != 0) {
+        close(fds[0]);
+        return -1;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    tap->fd = fds[0];
+    return 0;
+}
+
+static void free_tap(IOSLogTap* tap) {
+    if (tap->slots) {
+        for (int i = 0; i < tap->capacity; i++) free(tap->slots[i].json);
+    }
+    free(tap->slots);
+    free(tap);
+}
+
+IOSLogTap* ios_log_start_device(const char* device_id, const char* options_json) {
+    IOSLogOptions options;
+    int parsed = parse_options(options_json, &options);
+    IOSLogTap* tap = parsed == 0 ? calloc(1, sizeof(IOSLogTap)) : NULL;
+    if (tap) {
+        tap->capacity = options.capacity;
+        tap->fd = -1;
+        tap->slots = calloc((size_t)tap->capacity, sizeof(IOSLogSlot));
+        // Sampled once, so every entry of one tap maps onto the monotonic
+        // clock through the same offset.
+        tap->clock_offset_ms = wall_ms() - ios_monotonic_ms();
+        if (!tap->slots || spawn_stream(tap, device_id, &options) != 0) {
+            free_tap(tap);
+            tap = NULL;
+        }
+    }
+    free(options.subsystem);
+    free(options.process);
+    free(options.predicate);
+    if (!tap) return NULL;
+
+    pthread_mutex_init(&tap->lock, NULL);
+    pthread_cond_init(&tap->updated, NULL);
+    tap->running = 1;
+    tap->thread_started = pthread_create(&tap->thread, NULL, tap_main, tap) == 0;
+    if (!tap->thread_started) {
+        tap->running = 0;
+        ios_bridge_log_stop(tap);
+        return NULL;
+    }
+    return tap;
+}
+
+IOSLogTap* ios_bridge_log_start(void* bridge, const char* options) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, NULL) != 0) return NULL;
+
+    IOSLogTap* tap = ios_log_start_device(call.device_id, options);
+    ios_bridge_call_end(&call);
+    return tap;
+}
+
+void ios_bridge_log_stop(IOSLogTap* tap) {
+    if (!tap) return;
+
+    pthread_mutex_lock(&tap->lock);
+    tap->stopping = 1;
+    pthread_mutex_unlock(&tap->lock);
+
+    // simctl forwards the signal to log inside the simulator; a child that
+    // ignores it is killed once the grace period runs out.
+    kill(tap->pid, SIGTERM);
+    int status;
+    for (int waited = 0; waitpid(tap->pid, &status, WNOHANG) == 0; waited += 10) {
+        if (waited >= IOS_LOG_STOP_GRACE_MS) {
+            kill(tap->pid, SIGKILL);
+            waitpid(tap->pid, &status, 0);
+            break;
+        }
+        usleep(10 * 1000);
+    }
+    if (tap->thread_started) pthread_join(tap->thread, NULL);
+    close(tap->fd);
+    pthread_mutex_destroy(&tap->lock);
+    pthread_cond_destroy(&tap->updated);
+    free_tap(tap);
+}
+
+char* ios_bridge_read_logs(IOSLogTap* tap, uint64_t cursor, int max_entries, int timeout_ms) {
+    if (!tap) return strdup("{\"error\": \"Log tap is not running\"}");
+    if (max_entries <= 0) max_entries = IOS_LOG_DEFAULT_READ;
+
+    pthread_mutex_lock(&tap->lock);
+    if (timeout_ms > 0) {
+        struct timespec deadline = ios_wall_deadline(timeout_ms);
+        while (tap->sequence <= cursor && tap->running &&
+               pthread_cond_timedwait(&tap->updated, &tap->lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+
+    uint64_t oldest = tap->sequence > (uint64_t)tap->capacity ? tap->sequence - (uint64_t)tap->capacity + 1 : 1;
+    uint64_t first = cursor + 1 > oldest ? cursor + 1 : oldest;
+    uint64_t last = tap->sequence;
+    if (last >= first && last - first >= (uint64_t)max_entries) last = first + (uint64_t)max_entries - 1;
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_append(&out, "{\"entries\": [", 13);
+    for (uint64_t sequence = first; sequence <= last; sequence++) {
+        const IOSLogSlot* slot = &tap->slots[sequence % (uint64_t)tap->capacity];
+        if (sequence > first) ios_builder_append(&out, ", ", 2);
+        ios_builder_append(&out, slot->json, slot->length);
+    }
+    uint64_t next = last >= first ? last : cursor;
+    uint64_t dropped = last >= first ? first - cursor - 1 : 0;
+    ios_builder_appendf(&out, "], \"cursor\": %llu, \"dropped\": %llu, \"running\": %s, \"now_ms\": %.3f}",
+                        (unsigned long long)next, (unsigned long long)dropped, tap->running ? "true" : "false",
+                        ios_monotonic_ms());
+    pthread_mutex_unlock(&tap->lock);
+    return ios_builder_finish(&out);
+}
@@ -0,0 +1,49 @@
+#ifndef ARKAVO_IOS_LOG_H
+#define ARKAVO_IOS_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ios_impl.h"
+
+#define IOS_LOG_DEFAULT_CAPACITY 4096
+#define IOS_LOG_MAX_CAPACITY 262144
+// Entries handed out by one read when the caller sets no limit.
+#define IOS_LOG_DEFAULT_READ 1000
+
+typedef struct IOSLogTap IOSLogTap;
+
+// Taps the simulator's unified log into a ring of the newest entries. One
+// `log stream` runs inside the simulator for the tap's whole life, so reads
+// only ever touch entries already in memory and never re-scan history.
+//
+// options is a JSON object or NULL:
+//   "subsystem", "process"  exact matches, combined with AND
+//   "predicate"             further NSPredicate text, ANDed with both
+//   "level"                 "default", "info" (the default) or "debug"
+//   "capacity"              entries kept before the oldest are dropped
+IOSLogTap* ios_bridge_log_start(void* bridge, const char* options);
+// Same, for a device chosen by the caller rather than a bridge handle.
+IOSLogTap* ios_log_start_device(const char* device_id, const char* options);
+void ios_bridge_log_stop(IOSLogTap* tap);
+
+// Entries with a sequence above cursor, oldest first, at most max_entries
+// (IOS_LOG_DEFAULT_READ when not positive). Waits up to timeout_ms for the
+// first one. Returns, freed with ios_bridge_free_string:
+//
+//   {"entries": [{"sequence", "mono_ms", "timestamp", "level", "process",
+//    "pid", "subsystem", "category", "message"}], "cursor", "dropped",
+//    "running", "now_ms"}
+//
+// mono_ms is on the clock of ios_monotonic_ms, which bridge metrics, frames
+// and traces use. cursor is the value to pass to the next read; dropped
+// counts entries after the given cursor that the ring had already lost.
+char* ios_bridge_read_logs(IOSLogTap* tap, uint64_t cursor, int max_entries, int timeout_ms);
+
+// One `log stream --style ndjson` line as an entry object, or NULL for
+// lines that are not log events. clock_offset_ms is wall-clock time minus
+// monotonic time; entries whose timestamp does not parse get received_ms.
+char* ios_log_entry_from_ndjson(const char* line, size_t length, uint64_t sequence, double clock_offset_ms,
+                                double received_ms);
+
+#endif
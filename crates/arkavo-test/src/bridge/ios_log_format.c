@@ -0,0 +1,102 @@
+#include "ios_log.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// "2024-05-01 10:11:12.345678-0700", the format log stream prints.
+static int parse_timestamp(const char* text, size_t length, double* out_ms) {
+    char copy[48];
+    if (length >= sizeof(copy)) return -1;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+
+    struct tm parts = {0};
+    double seconds;
+    char sign;
+    int zone;
+    if (sscanf(copy, "%d-%d-%d %d:%d:%lf%c%4d", &parts.tm_year, &parts.tm_mon, &parts.tm_mday, &parts.tm_hour,
+               &parts.tm_min, &seconds, &sign, &zone) != 8 ||
+        (sign != '+' && sign != '-')) {
+        return -1;
+    }
+    parts.tm_year -= 1900;
+    parts.tm_mon -= 1;
+    time_t local = timegm(&parts);
+    if (local == (time_t)-1) return -1;
+    int zone_seconds = (zone / 100 * 3600 + zone % 100 * 60) * (sign == '-' ? -1 : 1);
+    *out_ms = ((double)(local - zone_seconds) + seconds) * 1000.0;
+    return 0;
+}
+
+// Log output is already valid JSON, so string members are spliced in still
+// escaped rather than decoded and re-encoded.
+static void append_raw(IOSStringBuilder* out, const char* name, const char* json, const IOSJsonToken* tokens,
+                       int index, int lowercase) {
+    ios_builder_appendf(out, ", \"%s\": \"", name);
+    if (index >= 0 && tokens[index].type == IOS_JSON_STRING) {
+        const char* start = json + tokens[index].start;
+        size_t length = (size_t)(tokens[index].end - tokens[index].start);
+        if (lowercase) {
+            for (size_t i = 0; i < length; i++) {
+                char c = (char)tolower((unsigned char)start[i]);
+                ios_builder_append(out, &c, 1);
+            }
+        } else {
+            ios_builder_append(out, start, length);
+        }
+    }
+    ios_builder_append(out, "\"", 1);
+}
+
+char* ios_log_entry_from_ndjson(const char* line, size_t length, uint64_t sequence, double clock_offset_ms,
+                                double received_ms) {
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(line, length, &tokens);
+    int event = count > 0 && tokens[0].type == IOS_JSON_OBJECT ? ios_json_find(line, tokens, count, 0, "eventType") : -1;
+    if (event < 0 || !ios_json_equals(line, &tokens[event], "logEvent")) {
+        free(tokens);
+        return NULL;
+    }
+
+    int timestamp = ios_json_find(line, tokens, count, 0, "timestamp");
+    double mono_ms = received_ms;
+    double logged_ms;
+    if (timestamp >= 0 && tokens[timestamp].type == IOS_JSON_STRING &&
+        parse_timestamp(line + tokens[timestamp].start, (size_t)(tokens[timestamp].end - tokens[timestamp].start),
+                        &logged_ms) == 0) {
+        mono_ms = logged_ms - clock_offset_ms;
+    }
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_appendf(&out, "{\"sequence\": %llu, \"mono_ms\": %.3f", (unsigned long long)sequence, mono_ms);
+    append_raw(&out, "timestamp", line, tokens, timestamp, 0);
+    append_raw(&out, "level", line, tokens, ios_json_find(line, tokens, count, 0, "messageType"), 1);
+
+    // Only the executable's name is worth keeping from its path; a "\/"
+    // escape leaves its backslash before the last slash, which is cut too.
+    ios_builder_append(&out, ", \"process\": \"", 14);
+    int image = ios_json_find(line, tokens, count, 0, "processImagePath");
+    if (image >= 0 && tokens[image].type == IOS_JSON_STRING) {
+        const char* start = line + tokens[image].start;
+        const char* end = line + tokens[image].end;
+        const char* name = end;
+        while (name > start && name[-1] != '/') name--;
+        ios_builder_append(&out, name, (size_t)(end - name));
+    }
+    ios_builder_append(&out, "\"", 1);
+
+    int pid = ios_json_find(line, tokens, count, 0, "processID");
+    double pid_value = 0;
+    if (pid >= 0) ios_json_number(line, &tokens[pid], &pid_value);
+    ios_builder_appendf(&out, ", \"pid\": %lld", (long long)pid_value);
+    append_raw(&out, "subsystem", line, tokens, ios_json_find(line, tokens, count, 0, "subsystem"), 0);
+    append_raw(&out, "category", line, tokens, ios_json_find(line, tokens, count, 0, "category"), 0);
+    append_raw(&out, "message", line, tokens, ios_json_find(line, tokens, count, 0, "eventMessage"), 0);
+    ios_builder_append(&out, "}", 1);
+    free(tokens);
+    return ios_builder_finish(&out);
+}
@@ -0,0 +1,214 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __APPLE__
+#include <os/signpost.h>
+#endif
+
+#include "ios_builder.h"
+#include "ios_metrics.h"
+
+typedef struct {
+    char name[IOS_METRICS_NAME_MAX];
+    // Published with release ordering after name is written, so lookups that
+    // skip the lock never compare against a half-copied name.
+    int ready;
+    uint64_t total_us;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint64_t buckets[IOS_METRICS_BUCKETS];
+} IOSHistogram;
+
+// Open-addressed by name hash. Slots are claimed once and never freed, which
+// is what lets recording find its slot without locking.
+static IOSHistogram histograms[IOS_METRICS_MAX_NAMES];
+static pthread_mutex_t claim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef __APPLE__
+static os_log_t signpost_log;
+static int signposts_enabled;
+static pthread_once_t signpost_once = PTHREAD_ONCE_INIT;
+
+static void signpost_init(void) {
+    const char* flag = getenv("ARKAVO_SIGNPOSTS");
+    if (flag && flag[0] && strcmp(flag, "0") != 0) {
+        signpost_log = os_log_create("com.arkavo.bridge", OS_LOG_CATEGORY_POINTS_OF_INTEREST);
+        signposts_enabled = 1;
+    }
+}
+#endif
+
+// Values below two octaves map to themselves; above that, the top five bits
+// pick the bucket within the value's octave.
+static int bucket_of(uint64_t us) {
+    if (us < 2 * IOS_METRICS_SUB_BUCKETS) return (int)us;
+    int shift = 63 - __builtin_clzll(us) - 4;
+    int index = IOS_METRICS_SUB_BUCKETS * (shift + 1) + (int)((us >> shift) - IOS_METRICS_SUB_BUCKETS);
+    return index < IOS_METRICS_BUCKETS ? index : IOS_METRICS_BUCKETS - 1;
+}
+
+// Midpoint of the bucket, in milliseconds.
+static double bucket_value_ms(int index) {
+    if (index < 2 * IOS_METRICS_SUB_BUCKETS) return index / 1000.0;
+    int shift = index / IOS_METRICS_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(IOS_METRICS_SUB_BUCKETS + index % IOS_METRICS_SUB_BUCKETS) << shift;
+    return (double)(low + (((uint64_t)1 << shift) >> 1)) / 1000.0;
+}
+
+static uint32_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) hash = (hash ^ *p) * 16777619u;
+    return hash;
+}
+
+static IOSHistogram* histogram_for(const char* name) {
+    uint32_t start = hash_name(name);
+    for (int probe = 0; probe < IOS_METRICS_MAX_NAMES; probe++) {
+        IOSHistogram* histogram = &histograms[(start + (uint32_t)probe) % IOS_METRICS_MAX_NAMES];
+        if (!__atomic_load_n(&histogram->ready, __ATOMIC_ACQUIRE)) {
+            pthread_mutex_lock(&claim_lock);
+            int claimed = !__atomic_load_n(&histogram->ready, __ATOMIC_RELAXED);
+            if (claimed) {
+                snprintf(histogram->name, sizeof(histogram->name), "%s", name);
+                __atomic_store_n(&histogram->min_us, UINT64_MAX, __ATOMIC_RELAXED);
+                __atomic_store_n(&histogram->ready, 1, __ATOMIC_RELEASE);
+            }
+            pthread_mutex_unlock(&claim_lock);
+            if (claimed) return histogram;
+        }
+        if (strcmp(histogram->name, name) == 0) return histogram;
+    }
+    return NULL;
+}
+
+static void store_min(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value < current &&
+           !__atomic_compare_exchange_n(target, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void store_max(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(target, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void ios_metrics_record(const char* name, double elapsed_ms) {
+    char bounded[IOS_METRICS_NAME_MAX];
+    snprintf(bounded, sizeof(bounded), "%s", name);
+    IOSHistogram* histogram = histogram_for(bounded);
+    if (!histogram) return;
+
+    uint64_t us = elapsed_ms > 0 ? (uint64_t)(elapsed_ms * 1000.0 + 0.5) : 0;
+    __atomic_fetch_add(&histogram->buckets[bucket_of(us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->total_us, us, __ATOMIC_RELAXED);
+    store_min(&histogram->min_us, us);
+    store_max(&histogram->max_us, us);
+}
+
+void ios_metrics_begin(IOSMetricsSpan* span, const char* kind, const char* detail) {
+    if (detail) {
+        snprintf(span->name, sizeof(span->name), "%s.%s", kind, detail);
+    } else {
+        snprintf(span->name, sizeof(span->name), "%s", kind);
+    }
+    span->signpost = 0;
+#ifdef __APPLE__
+    pthread_once(&signpost_once, signpost_init);
+    if (signposts_enabled && os_signpost_enabled(signpost_log)) {
+        span->signpost = os_signpost_id_generate(signpost_log);
+        os_signpost_interval_begin(signpost_log, span->signpost, "bridge", "%{public}s", span->name);
+    }
+#endif
+    span->started_ms = ios_monotonic_ms();
+}
+
+double ios_metrics_end(IOSMetricsSpan* span) {
+    double elapsed = ios_monotonic_ms() - span->started_ms;
+#ifdef __APPLE__
+    if (span->signpost) os_signpost_interval_end(signpost_log, span->signpost, "bridge", "%{public}s", span->name);
+#endif
+    ios_metrics_record(span->name, elapsed);
+    return elapsed;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(histograms[*(const int*)a].name, histograms[*(const int*)b].name);
+}
+
+// Clamped to the exact extremes, which the bucket midpoints can overshoot.
+static double percentile_ms(const uint64_t* buckets, uint64_t count, double fraction, double min_ms, double max_ms) {
+    double exact = fraction * (double)count;
+    uint64_t rank = (uint64_t)exact;
+    if ((double)rank < exact || rank == 0) rank++;
+
+    uint64_t seen = 0;
+    int index = 0;
+    while (index < IOS_METRICS_BUCKETS - 1 && (seen += buckets[index]) < rank) index++;
+    double value = bucket_value_ms(index);
+    return value < min_ms ? min_ms : value > max_ms ? max_ms : value;
+}
+
+static void append_histogram(IOSStringBuilder* out, const IOSHistogram* histogram) {
+    // The count is taken from the copied buckets so the percentiles agree
+    // with it even while other threads keep recording.
+    uint64_t buckets[IOS_METRICS_BUCKETS];
+    uint64_t count = 0;
+    for (int i = 0; i < IOS_METRICS_BUCKETS; i++) {
+        buckets[i] = __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        count += buckets[i];
+    }
+    double total_ms = (double)__atomic_load_n(&histogram->total_us, __ATOMIC_RELAXED) / 1000.0;
+    double min_ms = count ? (double)__atomic_load_n(&histogram->min_us, __ATOMIC_RELAXED) / 1000.0 : 0;
+    double max_ms = count ? (double)__atomic_load_n(&histogram->max_us, __ATOMIC_RELAXED) / 1000.0 : 0;
+
+    ios_builder_append(out, "{\"name\": ", 9);
+    ios_builder_append_json_string(out, histogram->name, strlen(histogram->name));
+    ios_builder_appendf(out, ", \"count\": %llu, \"total_ms\": %.3f, \"min_ms\": %.3f, \"max_ms\": %.3f",
+                        (unsigned long long)count, total_ms, min_ms, max_ms);
+    if (count) {
+        ios_builder_appendf(out, ", \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f}",
+                            total_ms / (double)count, percentile_ms(buckets, count, 0.5, min_ms, max_ms),
+                            percentile_ms(buckets, count, 0.9, min_ms, max_ms),
+                            percentile_ms(buckets, count, 0.99, min_ms, max_ms));
+    } else {
+        ios_builder_appendf(out, ", \"mean_ms\": 0, \"p50_ms\": 0, \"p90_ms\": 0, \"p99_ms\": 0}");
+    }
+}
+
+char* ios_bridge_get_metrics(void* bridge) {
+    (void)bridge;
+    int order[IOS_METRICS_MAX_NAMES];
+    int count = 0;
+    for (int i = 0; i < IOS_METRICS_MAX_NAMES; i++) {
+        if (__atomic_load_n(&histograms[i].ready, __ATOMIC_ACQUIRE)) order[count++] = i;
+    }
+    qsort(order, (size_t)count, sizeof(int), compare_names);
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_append(&out, "{\"metrics\": [", 13);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) ios_builder_append(&out, ", ", 2);
+        append_histogram(&out, &histograms[order[i]]);
+    }
+    ios_builder_append(&out, "]}", 2);
+    return ios_builder_finish(&out);
+}
+
+// Names stay registered so their slots remain valid for concurrent
+// recorders; a sample landing mid-reset may survive it.
+void ios_bridge_reset_metrics(void* bridge) {
+    (void)bridge;
+    for (int i = 0; i < IOS_METRICS_MAX_NAMES; i++) {
+        IOSHistogram* histogram = &histograms[i];
+        if (!__atomic_load_n(&histogram->ready, __ATOMIC_ACQUIRE)) continue;
+        for (int j = 0; j < IOS_METRICS_BUCKETS; j++) __atomic_store_n(&histogram->buckets[j], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram->total_us, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram->min_us, UINT64_MAX, __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram->max_us, 0, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef ARKAVO_IOS_METRICS_H
+#define ARKAVO_IOS_METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+
+// The runner's Objective-C++ bridge includes this too.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide latency histograms, one per named operation ("action.tap",
+// "snapshot.restore", ...). Buckets are log-linear in the HDR style: every
+// power of two of microseconds is split into IOS_METRICS_SUB_BUCKETS equal
+// steps, so a bucket is 1/16 to 1/32 as wide as the values in it. A reported
+// percentile is its bucket's midpoint, within 1/32 to 1/64 of the true value
+// from 32us to ~19 hours and exact below that. Recording is a handful of
+// relaxed atomic adds and never takes a lock once the name has been seen.
+#define IOS_METRICS_SUB_BUCKETS 16
+#define IOS_METRICS_BUCKETS (IOS_METRICS_SUB_BUCKETS * 33)
+// Samples under names beyond this many distinct ones are dropped.
+#define IOS_METRICS_MAX_NAMES 64
+#define IOS_METRICS_NAME_MAX 48
+
+// Setting ARKAVO_SIGNPOSTS in the environment also emits every span as an
+// os_signpost interval on macOS, for Instruments' Points of Interest track.
+typedef struct {
+    char name[IOS_METRICS_NAME_MAX];
+    double started_ms;
+    uint64_t signpost;
+} IOSMetricsSpan;
+
+static inline double ios_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+// Names the span "<kind>.<detail>", or just kind when detail is NULL.
+void ios_metrics_begin(IOSMetricsSpan* span, const char* kind, const char* detail);
+// Records the span and returns its duration in milliseconds.
+double ios_metrics_end(IOSMetricsSpan* span);
+void ios_metrics_record(const char* name, double elapsed_ms);
+
+// {"metrics": [{"name", "count", "total_ms", "min_ms", "max_ms", "mean_ms",
+// "p50_ms", "p90_ms", "p99_ms"}]} sorted by name, freed with
+// ios_bridge_free_string. The bridge argument is accepted for symmetry with
+// the other entry points; the histograms are shared by every bridge, and
+// NULL is allowed.
+char* ios_bridge_get_metrics(void* bridge);
+void ios_bridge_reset_metrics(void* bridge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
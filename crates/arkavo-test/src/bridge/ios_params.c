@@ -0,0 +1,141 @@
+#include "ios_impl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Action params are flat objects apart from touch timelines, which are kept
+// as one token and tokenized again by the touch action. Anything larger than
+// this falls back to a heap-sized token array.
+#define IOS_PARAMS_MAX_TOKENS 128
+
+typedef struct {
+    const char* name;
+    unsigned int flag;
+    size_t offset;
+} IOSNumericParam;
+
+static const IOSNumericParam numeric_params[] = {
+    { "x", IOS_PARAM_X, offsetof(IOSActionParams, x) },
+    { "y", IOS_PARAM_Y, offsetof(IOSActionParams, y) },
+    { "x1", IOS_PARAM_X1, offsetof(IOSActionParams, x1) },
+    { "y1", IOS_PARAM_Y1, offsetof(IOSActionParams, y1) },
+    { "x2", IOS_PARAM_X2, offsetof(IOSActionParams, x2) },
+    { "y2", IOS_PARAM_Y2, offsetof(IOSActionParams, y2) },
+    { "duration", IOS_PARAM_DURATION, offsetof(IOSActionParams, duration) },
+    { "quiet_ms", IOS_PARAM_QUIET_MS, offsetof(IOSActionParams, quiet_ms) },
+    { "hold", IOS_PARAM_HOLD, offsetof(IOSActionParams, hold) },
+    { "timeout", IOS_PARAM_TIMEOUT, offsetof(IOSActionParams, timeout) },
+};
+
+static int decode_string_member(const char* json, const IOSJsonToken* key, const IOSJsonToken* value,
+                                IOSActionParams* params) {
+    IOSJsonToken* slot = NULL;
+    unsigned int flag = 0;
+
+    if (ios_json_equals(json, key, "text")) {
+        slot = &params->text;
+        flag = IOS_PARAM_TEXT;
+    } else if (ios_json_equals(json, key, "path")) {
+        slot = &params->path;
+        flag = IOS_PARAM_PATH;
+    } else if (ios_json_equals(json, key, "device_id")) {
+        slot = &params->device_id;
+        flag = IOS_PARAM_DEVICE_ID;
+    } else if (ios_json_equals(json, key, "until")) {
+        slot = &params->until;
+        flag = IOS_PARAM_UNTIL;
+    } else if (ios_json_equals(json, key, "condition")) {
+        slot = &params->condition;
+        flag = IOS_PARAM_CONDITION;
+    } else if (ios_json_equals(json, key, "identifier")) {
+        slot = &params->identifier;
+        flag = IOS_PARAM_IDENTIFIER;
+    } else if (ios_json_equals(json, key, "label")) {
+        slot = &params->label;
+        flag = IOS_PARAM_LABEL;
+    } else {
+        return 0;
+    }
+
+    if (value->type != IOS_JSON_STRING) return -1;
+    *slot = *value;
+    params->present |= flag;
+    return 0;
+}
+
+static int decode_member(const char* json, const IOSJsonToken* key, const IOSJsonToken* value,
+                         IOSActionParams* params) {
+    // An explicit null reads the same as leaving the member out.
+    if (value->type == IOS_JSON_PRIMITIVE && json[value->start] == 'n') return 0;
+
+    if (ios_json_equals(json, key, "touches")) {
+        if (value->type != IOS_JSON_ARRAY) return -1;
+        params->touches = *value;
+        params->present |= IOS_PARAM_TOUCHES;
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(numeric_params) / sizeof(numeric_params[0]); i++) {
+        if (!ios_json_equals(json, key, numeric_params[i].name)) continue;
+
+        double* slot = (double*)((char*)params + numeric_params[i].offset);
+        if (ios_json_number(json, value, slot) != 0) return -1;
+        params->present |= numeric_params[i].flag;
+        return 0;
+    }
+
+    return decode_string_member(json, key, value, params);
+}
+
+int ios_action_params_decode(const char* json, const IOSJsonToken* tokens, int count, int object,
+                             IOSActionParams* params) {
+    memset(params, 0, sizeof(*params));
+    params->source = json;
+
+    if (object < 0 || object >= count) return 0;
+    if (tokens[object].type == IOS_JSON_PRIMITIVE && json[tokens[object].start] == 'n') return 0;
+    if (tokens[object].type != IOS_JSON_OBJECT) return -1;
+    params->object = tokens[object];
+
+    int index = object + 1;
+    for (int member = 0; member < tokens[object].size; member++) {
+        if (index + 1 >= count || tokens[index].size != 1) return -1;
+        if (decode_member(json, &tokens[index], &tokens[index + 1], params) != 0) return -1;
+        index = ios_json_skip(tokens, count, index);
+    }
+    return 0;
+}
+
+int ios_action_params_parse(const char* json, IOSActionParams* params) {
+    IOSJsonToken tokens[IOS_PARAMS_MAX_TOKENS];
+    IOSJsonParser parser;
+    ios_json_init(&parser);
+
+    size_t length = json ? strlen(json) : 0;
+    int count = json ? ios_json_parse(&parser, json, length, tokens, IOS_PARAMS_MAX_TOKENS) : 0;
+    IOSJsonToken* heap = NULL;
+    if (count == IOS_JSON_ERROR_NOMEM) count = ios_json_parse_alloc(json, length, &heap);
+    if (count < 0) {
+        memset(params, 0, sizeof(*params));
+        return -1;
+    }
+    int status = ios_action_params_decode(json, heap ? heap : tokens, count, count > 0 ? 0 : -1, params);
+    free(heap);
+    return status;
+}
+
+char* ios_action_params_string(const IOSActionParams* params, const IOSJsonToken* member) {
+    if (member->type != IOS_JSON_STRING) return NULL;
+
+    size_t size = (size_t)(member->end - member->start) + 1;
+    char* value = malloc(size);
+    if (!value) return NULL;
+    // Every caller hands the value on as a C string, which would end at an
+    // escaped NUL and quietly act on a prefix of it.
+    int length = ios_json_unescape(params->source, member, value, size);
+    if (length < 0 || strlen(value) != (size_t)length) {
+        free(value);
+        return NULL;
+    }
+    return value;
+}
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ios_impl.h"
+#include "ios_registry.h"
+
+#define IOS_POOL_DEVICE_NAME "Arkavo Pool"
+
+typedef struct {
+    IOSBridgeImpl* bridge;
+    // Simulators the pool created are shut down and deleted with it; ones
+    // that were already booted are only borrowed.
+    int created;
+} IOSPoolDevice;
+
+struct IOSBridgePool {
+    IOSPoolCheckout* checkout;
+    IOSWorker worker;
+    IOSPoolDevice devices[IOS_POOL_MAX_DEVICES];
+    int count;
+};
+
+// New simulators copy the device type and runtime of a booted one, so pool
+// members behave like the device the suite was written against.
+static char* create_simulator(IOSWorker* worker, const IOSDeviceRecord* template, int index) {
+    if (!template->device_type[0] || !template->runtime[0]) return NULL;
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s %d", IOS_POOL_DEVICE_NAME, index + 1);
+    char* quoted_name = ios_shell_quote(name);
+    char* quoted_type = ios_shell_quote(template->device_type);
+    char* quoted_runtime = ios_shell_quote(template->runtime);
+    char* udid = NULL;
+
+    if (quoted_name && quoted_type && quoted_runtime) {
+        size_t args_size = strlen(quoted_name) + strlen(quoted_type) + strlen(quoted_runtime) + 16;
+        char* args = malloc(args_size);
+        if (args) {
+            snprintf(args, args_size, "create %s %s %s", quoted_name, quoted_type, quoted_runtime);
+            IOSCommandOutput output;
+            if (ios_worker_run_simctl(worker, args, &output) == 0 && output.data) {
+                output.data[strcspn(output.data, "\r\n")] = '\0';
+                if (output.data[0]) udid = strdup(output.data);
+            }
+            ios_command_output_free(&output);
+            free(args);
+        }
+    }
+
+    free(quoted_name);
+    free(quoted_type);
+    free(quoted_runtime);
+    return udid;
+}
+
+// simctl will not delete a booted device, so it is shut down first; that
+// fails harmlessly for one that never finished booting. Returns the status
+// of the delete.
+static int remove_simulator(IOSWorker* worker, const char* udid) {
+    ios_worker_run_device_command(worker, udid, "shutdown", "", NULL);
+    return ios_worker_run_device_command(worker, udid, "delete", "", NULL);
+}
+
+static void retire_device(IOSWorker* worker, IOSPoolDevice* device) {
+    if (device->created && device->bridge) remove_simulator(worker, device->bridge->device_id);
+    ios_bridge_destroy(device->bridge);
+    device->bridge = NULL;
+}
+
+static int add_device(IOSBridgePool* pool, const char* udid, const char* bundle_id, int created) {
+    IOSBridgeImpl* bridge = ios_bridge_create(udid, bundle_id);
+    if (!bridge) return -1;
+    pool->devices[pool->count].bridge = bridge;
+    pool->devices[pool->count].created = created;
+    pool->count++;
+    return 0;
+}
+
+IOSBridgePool* ios_bridge_pool_create(int size, const char* bundle_id) {
+    if (size <= 0) return NULL;
+    if (size > IOS_POOL_MAX_DEVICES) size = IOS_POOL_MAX_DEVICES;
+
+    IOSBridgePool* pool = calloc(1, sizeof(IOSBridgePool));
+    if (!pool) return NULL;
+    ios_worker_init(&pool->worker);
+
+    // Borrowing the least-loaded simulators first leaves the ones other
+    // bridges in this process are driving for last.
+    IOSDeviceFilter filter = {.booted_only = 1, .least_loaded = 1};
+    IOSDeviceRecord booted[IOS_POOL_MAX_DEVICES];
+    int booted_count = ios_registry_list(&filter, booted, size);
+    if (booted_count < 0) booted_count = 0;
+    for (int i = 0; i < booted_count; i++) add_device(pool, booted[i].udid, bundle_id, 0);
+
+    // Every missing simulator is asked to boot before any is waited on, so
+    // they come up concurrently instead of one after another.
+    int first_created = pool->count;
+    for (int i = pool->count; booted_count > 0 && i < size; i++) {
+        char* udid = create_simulator(&pool->worker, &booted[0], i);
+        if (!udid) break;
+        if (ios_worker_run_device_command(&pool->worker, udid, "boot", "", NULL) != 0 ||
+            add_device(pool, udid, bundle_id, 1) != 0) {
+            // A simulator that outlives its pool changes the device list
+            // everyone else picks from.
+            if (remove_simulator(&pool->worker, udid) != 0) ios_registry_refresh();
+            free(udid);
+            break;
+        }
+        free(udid);
+    }
+    for (int i = first_created; i < pool->count; i++) {
+        ios_worker_run_device_command(&pool->worker, pool->devices[i].bridge->device_id, "bootstatus", "", NULL);
+    }
+    if (pool->count > first_created) ios_registry_refresh();
+
+    if (pool->count == size) pool->checkout = ios_pool_checkout_create(size);
+    if (!pool->checkout) {
+        ios_bridge_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void ios_bridge_pool_destroy(IOSBridgePool* pool) {
+    if (!pool) return;
+    int created = 0;
+    for (int i = 0; i < pool->count; i++) {
+        created |= pool->devices[i].created;
+        retire_device(&pool->worker, &pool->devices[i]);
+    }
+    if (created) ios_registry_refresh();
+    ios_worker_stop(&pool->worker);
+    ios_pool_checkout_destroy(pool->checkout);
+    free(pool);
+}
+
+int ios_bridge_pool_size(const IOSBridgePool* pool) {
+    return pool ? pool->count : 0;
+}
+
+void* ios_bridge_pool_acquire_matching(IOSBridgePool* pool, const IOSDeviceFilter* filter, int timeout_ms) {
+    // Membership never changes after creation, so matching happens before
+    // any waiting and a registry refresh never holds up other checkouts.
+    int eligible[IOS_POOL_MAX_DEVICES];
+    for (int i = 0; i < pool->count; i++) {
+        IOSDeviceRecord record;
+        eligible[i] = !filter || (ios_registry_find(pool->devices[i].bridge->device_id, &record) == 0 &&
+                                  ios_registry_matches(&record, filter));
+    }
+    int index = ios_pool_checkout_acquire(pool->checkout, eligible, timeout_ms);
+    return index < 0 ? NULL : pool->devices[index].bridge;
+}
+
+void* ios_bridge_pool_acquire(IOSBridgePool* pool, int timeout_ms) {
+    return ios_bridge_pool_acquire_matching(pool, NULL, timeout_ms);
+}
+
+void ios_bridge_pool_release(IOSBridgePool* pool, void* bridge) {
+    for (int i = 0; i < pool->count; i++) {
+        if (pool->devices[i].bridge == bridge) ios_pool_checkout_release(pool->checkout, i);
+    }
+}
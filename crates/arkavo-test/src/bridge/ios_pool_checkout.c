@@ -0,0 +1,63 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "ios_impl.h"
+
+struct IOSPoolCheckout {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    int count;
+    int busy[IOS_POOL_MAX_DEVICES];
+};
+
+IOSPoolCheckout* ios_pool_checkout_create(int count) {
+    if (count < 0 || count > IOS_POOL_MAX_DEVICES) return NULL;
+    IOSPoolCheckout* checkout = calloc(1, sizeof(IOSPoolCheckout));
+    if (!checkout) return NULL;
+    pthread_mutex_init(&checkout->lock, NULL);
+    pthread_cond_init(&checkout->released, NULL);
+    checkout->count = count;
+    return checkout;
+}
+
+void ios_pool_checkout_destroy(IOSPoolCheckout* checkout) {
+    if (!checkout) return;
+    pthread_mutex_destroy(&checkout->lock);
+    pthread_cond_destroy(&checkout->released);
+    free(checkout);
+}
+
+int ios_pool_checkout_acquire(IOSPoolCheckout* checkout, const int* eligible, int timeout_ms) {
+    // Waiting for a member that can never be handed out would only ever
+    // end in a timeout.
+    int any_eligible = 0;
+    for (int i = 0; i < checkout->count; i++) any_eligible |= !eligible || eligible[i];
+    if (!any_eligible) return -1;
+
+    struct timespec deadline = ios_wall_deadline(timeout_ms);
+    pthread_mutex_lock(&checkout->lock);
+    for (;;) {
+        for (int i = 0; i < checkout->count; i++) {
+            if ((!eligible || eligible[i]) && !checkout->busy[i]) {
+                checkout->busy[i] = 1;
+                pthread_mutex_unlock(&checkout->lock);
+                return i;
+            }
+        }
+
+        int waited = timeout_ms < 0 ? pthread_cond_wait(&checkout->released, &checkout->lock)
+                                    : pthread_cond_timedwait(&checkout->released, &checkout->lock, &deadline);
+        if (waited != 0) break;
+    }
+    pthread_mutex_unlock(&checkout->lock);
+    return -1;
+}
+
+void ios_pool_checkout_release(IOSPoolCheckout* checkout, int index) {
+    if (index < 0 || index >= checkout->count) return;
+    pthread_mutex_lock(&checkout->lock);
+    checkout->busy[index] = 0;
+    // Waiters may be restricted to different members, so all of them look.
+    pthread_cond_broadcast(&checkout->released);
+    pthread_mutex_unlock(&checkout->lock);
+}
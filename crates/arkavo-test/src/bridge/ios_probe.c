@@ -0,0 +1,112 @@
+#include "ios_probe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char* probe_path(IOSBridgeCall* call, const char* bundle_id) {
+    char* bundle = ios_shell_quote(bundle_id ? bundle_id : call->impl->bundle_id);
+    if (!bundle) return NULL;
+
+    IOSStringBuilder rest;
+    ios_builder_init(&rest);
+    ios_builder_appendf(&rest, "%s data", bundle);
+    free(bundle);
+    char* args = ios_builder_finish(&rest);
+    char* path = NULL;
+    IOSCommandOutput output = {NULL, 0};
+    if (args && ios_bridge_call_device_command(call, "get_app_container", args, &output) == 0 && output.data) {
+        output.data[strcspn(output.data, "\r\n")] = '\0';
+        if (output.data[0] == '/') {
+            IOSStringBuilder full;
+            ios_builder_init(&full);
+            ios_builder_appendf(&full, "%s/%s", output.data, IOS_PROBE_PATH);
+            path = ios_builder_finish(&full);
+        }
+    }
+    ios_command_output_free(&output);
+    free(args);
+    return path;
+}
+
+IOSProbe* ios_probe_open_app(IOSBridgeCall* call, const char* bundle_id) {
+    char* path = probe_path(call, bundle_id);
+    IOSProbe* probe = path ? ios_probe_open(path) : NULL;
+    free(path);
+    return probe;
+}
+
+int ios_bridge_probe_attach(void* bridge, const char* bundle_id) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, NULL) != 0) return -1;
+
+    IOSProbe* probe = ios_probe_open_app(&call, bundle_id);
+    if (probe) {
+        ios_probe_detach_locked(call.impl);
+        call.impl->probe = probe;
+    }
+    ios_bridge_call_end(&call);
+    return probe ? 0 : -1;
+}
+
+void ios_probe_detach_locked(IOSBridgeImpl* impl) {
+    ios_probe_close(impl->probe);
+    impl->probe = NULL;
+}
+
+void ios_bridge_probe_detach(void* bridge) {
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) return;
+    ios_probe_detach_locked(impl);
+    ios_bridge_unlock(impl);
+}
+
+static void append_events(IOSStringBuilder* out, const IOSProbeEvent* events, int count) {
+    static const char* kinds[] = {"unknown", "touch_down", "touch_up", "render", "command"};
+    for (int i = 0; i < count; i++) {
+        const IOSProbeEvent* event = &events[i];
+        ios_builder_appendf(out,
+                            "%s{\"sequence\": %llu, \"kind\": \"%s\", \"mono_ms\": %.3f, \"x\": %.10g, "
+                            "\"y\": %.10g, \"value\": %.10g}",
+                            i ? ", " : "", (unsigned long long)event->sequence,
+                            kinds[event->kind >= 1 && event->kind <= IOS_PROBE_COMMAND ? event->kind : 0],
+                            event->mono_ms, event->x, event->y, event->value);
+    }
+}
+
+// The bridge lock is let go between polls, so a long wait never holds up
+// actions on the same bridge.
+char* ios_bridge_probe_read(void* bridge, uint64_t cursor, int max_events, int timeout_ms) {
+    if (max_events <= 0 || max_events > 1024) max_events = 1024;
+    IOSProbeEvent* events = malloc(sizeof(IOSProbeEvent) * (size_t)max_events);
+    if (!events) return strdup("{\"error\": \"Memory allocation failed\"}");
+
+    double deadline = ios_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+    uint64_t dropped = 0;
+    int reset = 0;
+    int count;
+    for (;;) {
+        IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+        if (!impl || !impl->probe) {
+            if (impl) ios_bridge_unlock(impl);
+            free(events);
+            return strdup("{\"error\": \"No probe is attached\"}");
+        }
+        count = ios_probe_read(impl->probe, &cursor, events, max_events, &dropped, &reset);
+        ios_bridge_unlock(impl);
+        if (count > 0 || dropped || reset || ios_monotonic_ms() >= deadline) break;
+        usleep(IOS_PROBE_POLL_US);
+    }
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    ios_builder_append(&out, "{\"events\": [", 12);
+    if (count > 0) append_events(&out, events, count);
+    ios_builder_appendf(&out, "], \"cursor\": %llu, \"dropped\": %llu, \"reset\": %s, \"now_ms\": %.3f}",
+                        (unsigned long long)cursor, (unsigned long long)dropped, reset ? "true" : "false",
+                        ios_monotonic_ms());
+    free(events);
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"error\": \"Memory allocation failed\"}");
+}
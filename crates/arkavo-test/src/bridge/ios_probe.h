@@ -0,0 +1,124 @@
+#ifndef ARKAVO_IOS_PROBE_H
+#define ARKAVO_IOS_PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ios_impl.h"
+
+// The probe is a ring of input and render events that an instrumented app
+// (ArkavoReference's ProbeChannel.swift) keeps in a file in its data
+// container. Simulator apps run on the host kernel, so the bridge maps the
+// same file and reads each event moments after the app wrote it, without
+// screenshots or the app's UI. Both sides stamp events with
+// CLOCK_MONOTONIC, so probe times compare directly with ios_monotonic_ms.
+//
+// Integers are in host byte order; both sides run on the same machine.
+//
+//   header, 64 bytes
+//   0   magic "ARKP"
+//   4   u32 version
+//   8   u32 capacity, in records
+//   12  u32 record size
+//   16  u64 published: records written so far
+//   24  u64 session: the writer's launch time, new for every launch
+//   32  f64 screen width, in points
+//   40  f64 screen height, in points
+//   48  16 bytes reserved, zero
+//
+//   record n (from 1) at 64 + ((n - 1) % capacity) * record size
+//   0   u64 sequence n
+//   8   u16 kind, IOS_PROBE_*
+//   10  u16 reserved, zero
+//   12  u32 reserved, zero
+//   16  f64 monotonic time, in milliseconds
+//   24  f64 x, in points
+//   32  f64 y, in points
+//   40  f64 render records: sequence of the touch they follow;
+//           command records: the command's token
+//
+// The writer stores a record before it bumps published, each with its own
+// write(2), so every record at or below published is complete. Only the
+// slot after published can be mid-write, which is why readers treat a
+// record as lost once it is within one slot of being overwritten.
+//
+// A relaunched app reuses the file: it zeroes published, rewrites the
+// header and stores its new session last. It only ever grows the file,
+// because truncating it would fault every reader still mapping it.
+#define IOS_PROBE_MAGIC "ARKP"
+#define IOS_PROBE_VERSION 1
+#define IOS_PROBE_HEADER_SIZE 64
+#define IOS_PROBE_RECORD_SIZE 48
+// Relative to the app's data container.
+#define IOS_PROBE_PATH "Library/Caches/arkavo-probe.ring"
+
+#define IOS_PROBE_TOUCH_DOWN 1
+#define IOS_PROBE_TOUCH_UP 2
+// First frame the app rendered after a touch ended.
+#define IOS_PROBE_RENDER 3
+// First frame the app rendered after carrying out a lifecycle command
+// (ios_lifecycle.c), which is how the bridge knows a warm reset took.
+#define IOS_PROBE_COMMAND 4
+
+// How long a tap waits for the app to report it and the frame after it.
+#define IOS_PROBE_CONFIRM_MS 1000
+// Shared memory has nothing to wait on, so waiting readers poll the
+// published count; it is one load from a mapped page.
+#define IOS_PROBE_POLL_US 1000
+
+typedef struct {
+    uint64_t sequence;
+    int kind;
+    double mono_ms;
+    double x;
+    double y;
+    double value;
+} IOSProbeEvent;
+
+// The reader, in ios_probe_ring.c, needs no handle. Nothing is read until
+// the file exists; a probe opened before the app launches starts
+// delivering once it does.
+IOSProbe* ios_probe_open(const char* path);
+void ios_probe_close(IOSProbe* probe);
+
+// Copies up to max events after *cursor into events and advances *cursor.
+// dropped counts events the ring overwrote first. A new app launch resets
+// the sequence, which sets *reset and restarts from the first event.
+// Returns the number of events, or -1 while no valid ring is mapped.
+int ios_probe_read(IOSProbe* probe, uint64_t* cursor, IOSProbeEvent* events, int max, uint64_t* dropped,
+                   int* reset);
+// Sequence of the newest event, for reading only what follows.
+uint64_t ios_probe_published(IOSProbe* probe);
+// Whether a valid ring is mapped, i.e. an instrumented app has run.
+int ios_probe_mapped(IOSProbe* probe);
+
+// Waits until deadline_ms (monotonic) for the command record carrying token
+// after mark. Returns 1 with *ack filled, 0 on timeout, or -1 if no ring was
+// ever mapped. Sets *relaunched when a new launch of the app answered.
+int ios_probe_wait_command(IOSProbe* probe, uint64_t mark, double token, double deadline_ms, IOSProbeEvent* ack,
+                           int* relaunched);
+
+// Appends ", \"probe\": {...}" to a tap result: the touch the app saw after
+// mark, its offset from (x, y), its delay from sent_ms and the delay until
+// the next rendered frame. Waits up to IOS_PROBE_CONFIRM_MS.
+void ios_probe_append_confirmation(IOSProbe* probe, uint64_t mark, double sent_ms, double x, double y,
+                                   IOSStringBuilder* out);
+
+// Opens the probe in bundle_id's data container, or the bridge's own app's
+// when NULL. NULL when the app is not installed.
+IOSProbe* ios_probe_open_app(IOSBridgeCall* call, const char* bundle_id);
+
+// Attaches the probe of bundle_id's data container, or of the bridge's own
+// app when NULL, replacing any probe already attached. Once attached, taps
+// report what the app saw. Returns 0 on success.
+int ios_bridge_probe_attach(void* bridge, const char* bundle_id);
+void ios_bridge_probe_detach(void* bridge);
+void ios_probe_detach_locked(IOSBridgeImpl* impl);
+
+// Events after cursor, waiting up to timeout_ms for the first one:
+// {"events": [{"sequence", "kind", "mono_ms", "x", "y", "value"}],
+//  "cursor", "dropped", "reset", "now_ms"}, freed with
+// ios_bridge_free_string.
+char* ios_bridge_probe_read(void* bridge, uint64_t cursor, int max_events, int timeout_ms);
+
+#endif
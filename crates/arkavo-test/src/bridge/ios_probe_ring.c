@@ -0,0 +1,208 @@
+#include "ios_probe.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The reader side of the ring, which needs no handle; ios_probe.c finds
+// the ring in an app container and serves it through the bridge.
+
+#define IOS_PROBE_BATCH 32
+
+struct IOSProbe {
+    char* path;
+    const uint8_t* base;
+    size_t size;
+    uint32_t capacity;
+    uint64_t session;
+};
+
+static uint64_t load_u64(const uint8_t* at) {
+    return __atomic_load_n((const uint64_t*)(const void*)at, __ATOMIC_ACQUIRE);
+}
+
+static void unmap(IOSProbe* probe) {
+    if (probe->base) munmap((void*)probe->base, probe->size);
+    probe->base = NULL;
+    probe->size = 0;
+}
+
+static int map_ring(IOSProbe* probe) {
+    int fd = open(probe->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat info;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size >= IOS_PROBE_HEADER_SIZE) {
+        base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping outlives the descriptor.
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const uint8_t* header = base;
+    uint32_t version, capacity, record_size;
+    memcpy(&version, header + 4, 4);
+    memcpy(&capacity, header + 8, 4);
+    memcpy(&record_size, header + 12, 4);
+    // One slot is always reserved for the record being written, so a ring
+    // needs two to hold anything.
+    if (memcmp(header, IOS_PROBE_MAGIC, 4) != 0 || version != IOS_PROBE_VERSION ||
+        record_size != IOS_PROBE_RECORD_SIZE || capacity < 2 ||
+        (uint64_t)info.st_size < IOS_PROBE_HEADER_SIZE + (uint64_t)capacity * IOS_PROBE_RECORD_SIZE) {
+        munmap(base, (size_t)info.st_size);
+        return -1;
+    }
+    probe->base = header;
+    probe->size = (size_t)info.st_size;
+    probe->capacity = capacity;
+    return 0;
+}
+
+IOSProbe* ios_probe_open(const char* path) {
+    IOSProbe* probe = calloc(1, sizeof(IOSProbe));
+    if (probe) probe->path = strdup(path);
+    if (!probe || !probe->path) {
+        free(probe);
+        return NULL;
+    }
+    return probe;
+}
+
+void ios_probe_close(IOSProbe* probe) {
+    if (!probe) return;
+    unmap(probe);
+    free(probe->path);
+    free(probe);
+}
+
+// A relaunched app rewrites the header with a new session, possibly with a
+// different capacity, so each new session is mapped afresh.
+static int refresh(IOSProbe* probe, int* reset) {
+    if (probe->base && load_u64(probe->base + 24) == probe->session) return 0;
+    unmap(probe);
+    if (map_ring(probe) != 0) return -1;
+    uint64_t session = load_u64(probe->base + 24);
+    *reset = probe->session != 0 && session != probe->session;
+    probe->session = session;
+    return 0;
+}
+
+// Records the writer may be overwriting sit at or before this sequence.
+static uint64_t first_intact(const IOSProbe* probe, uint64_t published) {
+    return published + 2 > probe->capacity ? published + 2 - probe->capacity : 1;
+}
+
+int ios_probe_read(IOSProbe* probe, uint64_t* cursor, IOSProbeEvent* events, int max, uint64_t* dropped,
+                   int* reset) {
+    *dropped = 0;
+    *reset = 0;
+    if (refresh(probe, reset) != 0) return -1;
+
+    uint64_t published = load_u64(probe->base + 16);
+    if (*reset) *cursor = 0;
+    if (*cursor > published) *cursor = published;
+
+    uint64_t sequence = *cursor + 1;
+    uint64_t oldest = first_intact(probe, published);
+    if (sequence < oldest) {
+        *dropped += oldest - sequence;
+        sequence = oldest;
+    }
+
+    int count = 0;
+    for (; sequence <= published && count < max; sequence++) {
+        const uint8_t* record =
+            probe->base + IOS_PROBE_HEADER_SIZE + ((sequence - 1) % probe->capacity) * IOS_PROBE_RECORD_SIZE;
+        IOSProbeEvent event;
+        uint16_t kind;
+        memcpy(&event.sequence, record, 8);
+        memcpy(&kind, record + 8, 2);
+        memcpy(&event.mono_ms, record + 16, 8);
+        memcpy(&event.x, record + 24, 8);
+        memcpy(&event.y, record + 32, 8);
+        memcpy(&event.value, record + 40, 8);
+        event.kind = kind;
+
+        // The copy only counts if the writer did not reach the slot while
+        // it was being made.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (event.sequence != sequence || sequence < first_intact(probe, load_u64(probe->base + 16))) {
+            (*dropped)++;
+            continue;
+        }
+        events[count++] = event;
+    }
+    *cursor = sequence - 1;
+    return count;
+}
+
+uint64_t ios_probe_published(IOSProbe* probe) {
+    int reset;
+    return refresh(probe, &reset) == 0 ? load_u64(probe->base + 16) : 0;
+}
+
+int ios_probe_mapped(IOSProbe* probe) {
+    int reset;
+    return refresh(probe, &reset) == 0;
+}
+
+int ios_probe_wait_command(IOSProbe* probe, uint64_t mark, double token, double deadline_ms, IOSProbeEvent* ack,
+                           int* relaunched) {
+    uint64_t cursor = mark;
+    IOSProbeEvent batch[IOS_PROBE_BATCH];
+    int mapped = 0;
+    *relaunched = 0;
+    for (;;) {
+        uint64_t dropped;
+        int reset;
+        int count = ios_probe_read(probe, &cursor, batch, IOS_PROBE_BATCH, &dropped, &reset);
+        mapped |= count >= 0;
+        *relaunched |= reset;
+        for (int i = 0; i < count; i++) {
+            if (batch[i].kind == IOS_PROBE_COMMAND && batch[i].value == token) {
+                *ack = batch[i];
+                return 1;
+            }
+        }
+        if (ios_monotonic_ms() >= deadline_ms) return mapped ? 0 : -1;
+        if (count < IOS_PROBE_BATCH) usleep(IOS_PROBE_POLL_US);
+    }
+}
+
+void ios_probe_append_confirmation(IOSProbe* probe, uint64_t mark, double sent_ms, double x, double y,
+                                   IOSStringBuilder* out) {
+    double deadline = ios_monotonic_ms() + IOS_PROBE_CONFIRM_MS;
+    uint64_t cursor = mark;
+    IOSProbeEvent down = {0}, up = {0}, render = {0};
+    IOSProbeEvent batch[IOS_PROBE_BATCH];
+
+    while (!render.sequence) {
+        uint64_t dropped;
+        int reset;
+        int count = ios_probe_read(probe, &cursor, batch, IOS_PROBE_BATCH, &dropped, &reset);
+        for (int i = 0; i < count; i++) {
+            const IOSProbeEvent* event = &batch[i];
+            if (event->kind == IOS_PROBE_TOUCH_DOWN && !down.sequence) down = *event;
+            if (event->kind == IOS_PROBE_TOUCH_UP && down.sequence && !up.sequence) up = *event;
+            if (event->kind == IOS_PROBE_RENDER && up.sequence && event->value >= (double)up.sequence) render = *event;
+        }
+        if (render.sequence || ios_monotonic_ms() >= deadline) break;
+        if (count < IOS_PROBE_BATCH) usleep(IOS_PROBE_POLL_US);
+    }
+
+    if (!down.sequence) {
+        ios_builder_append(out, ", \"probe\": {\"confirmed\": false}", 31);
+        return;
+    }
+    ios_builder_appendf(out,
+                        ", \"probe\": {\"confirmed\": true, \"x\": %.10g, \"y\": %.10g, \"offset_x\": %.10g, "
+                        "\"offset_y\": %.10g, \"input_ms\": %.3f",
+                        down.x, down.y, down.x - x, down.y - y, down.mono_ms - sent_ms);
+    if (up.sequence) ios_builder_appendf(out, ", \"hold_ms\": %.3f", up.mono_ms - down.mono_ms);
+    if (render.sequence) ios_builder_appendf(out, ", \"render_ms\": %.3f", render.mono_ms - up.mono_ms);
+    ios_builder_append(out, "}", 1);
+}
@@ -0,0 +1,307 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ios_impl.h"
+#include "ios_registry.h"
+
+typedef struct {
+    char udid[64];
+    int count;
+} IOSDeviceLoad;
+
+static struct {
+    pthread_mutex_t lock;
+    // Broadcast whenever the generation moves.
+    pthread_cond_t changed;
+    pthread_cond_t wake;
+    // Serializes refreshes, which share one worker and must apply in order.
+    pthread_mutex_t refresh_lock;
+    IOSWorker worker;
+    int worker_ready;
+    IOSDeviceRecord* devices;
+    int count;
+    int loaded;
+    IOSDeviceLoad* loads;
+    int load_count;
+    uint64_t generation;
+    double refreshed_ms;
+    double queried_ms;
+    int waiters;
+    int watcher_started;
+    int watcher_idle;
+} registry = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .changed = PTHREAD_COND_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .refresh_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void copy_token(const char* json, const IOSJsonToken* token, char* out, size_t size) {
+    if (token->type != IOS_JSON_STRING) return;
+    size_t length = (size_t)(token->end - token->start) + 1;
+    char* value = malloc(length);
+    if (value && ios_json_unescape(json, token, value, length) >= 0) snprintf(out, size, "%s", value);
+    free(value);
+}
+
+static void copy_member(const char* json, const IOSJsonToken* tokens, int count, int object, const char* key,
+                        char* out, size_t size) {
+    int member = ios_json_find(json, tokens, count, object, key);
+    if (member >= 0) copy_token(json, &tokens[member], out, size);
+}
+
+// {"devices": {"<runtime>": [{"udid": ..., "name": ..., "state": ...}]}}
+static int parse_devices(const char* json, size_t length, IOSDeviceRecord** out) {
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(json, length, &tokens);
+    int devices = count > 0 ? ios_json_find(json, tokens, count, 0, "devices") : -1;
+    if (devices < 0 || tokens[devices].type != IOS_JSON_OBJECT) {
+        free(tokens);
+        return -1;
+    }
+
+    // Every device is an object token, so the token count bounds the list.
+    IOSDeviceRecord* records = calloc((size_t)count, sizeof(IOSDeviceRecord));
+    int found = 0;
+    int runtime = devices + 1;
+    for (int i = 0; records && i < tokens[devices].size; i++) {
+        int list = runtime + 1;
+        if (list < count && tokens[list].type == IOS_JSON_ARRAY) {
+            int entry = list + 1;
+            for (int j = 0; j < tokens[list].size; j++) {
+                int available = ios_json_find(json, tokens, count, entry, "isAvailable");
+                int usable = 1;
+                if (available >= 0) ios_json_bool(json, &tokens[available], &usable);
+
+                IOSDeviceRecord* record = &records[found];
+                copy_member(json, tokens, count, entry, "udid", record->udid, sizeof(record->udid));
+                if (usable && record->udid[0]) {
+                    copy_member(json, tokens, count, entry, "name", record->name, sizeof(record->name));
+                    copy_member(json, tokens, count, entry, "state", record->state, sizeof(record->state));
+                    copy_member(json, tokens, count, entry, "deviceTypeIdentifier", record->device_type,
+                                sizeof(record->device_type));
+                    copy_token(json, &tokens[runtime], record->runtime, sizeof(record->runtime));
+                    found++;
+                } else {
+                    memset(record, 0, sizeof(*record));
+                }
+                entry = ios_json_skip(tokens, count, entry);
+            }
+        }
+        runtime = ios_json_skip(tokens, count, runtime);
+    }
+
+    free(tokens);
+    if (!records) return -1;
+    *out = records;
+    return found;
+}
+
+void ios_registry_refresh(void) {
+    pthread_mutex_lock(&registry.refresh_lock);
+    if (!registry.worker_ready) {
+        ios_worker_init(&registry.worker);
+        registry.worker_ready = 1;
+    }
+
+    IOSCommandOutput output;
+    IOSDeviceRecord* devices = NULL;
+    int count = -1;
+    if (ios_worker_run_simctl(&registry.worker, "list devices -j", &output) == 0 && output.data) {
+        count = parse_devices(output.data, output.length, &devices);
+    }
+    ios_command_output_free(&output);
+
+    if (count >= 0) {
+        pthread_mutex_lock(&registry.lock);
+        // Records are zero-filled past their strings, so equal lists compare
+        // equal byte for byte.
+        int changed = !registry.loaded || count != registry.count ||
+                      (count > 0 && memcmp(devices, registry.devices, (size_t)count * sizeof(IOSDeviceRecord)) != 0);
+        IOSDeviceRecord* previous = registry.devices;
+        registry.devices = devices;
+        registry.count = count;
+        registry.loaded = 1;
+        registry.refreshed_ms = ios_monotonic_ms();
+        if (changed) {
+            registry.generation++;
+            pthread_cond_broadcast(&registry.changed);
+        }
+        pthread_mutex_unlock(&registry.lock);
+        free(previous);
+    }
+    pthread_mutex_unlock(&registry.refresh_lock);
+}
+
+// Polls while someone has asked recently or is waiting for a change, and
+// parks otherwise so an idle process does not keep spawning simctl.
+static void* watcher_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&registry.lock);
+    for (;;) {
+        if (!registry.waiters && ios_monotonic_ms() - registry.queried_ms > IOS_REGISTRY_IDLE_MS) {
+            registry.watcher_idle = 1;
+            pthread_cond_wait(&registry.wake, &registry.lock);
+            registry.watcher_idle = 0;
+            continue;
+        }
+
+        struct timespec deadline = ios_wall_deadline(IOS_REGISTRY_POLL_MS);
+        pthread_cond_timedwait(&registry.wake, &registry.lock, &deadline);
+        if (ios_monotonic_ms() - registry.refreshed_ms < IOS_REGISTRY_POLL_MS) continue;
+
+        pthread_mutex_unlock(&registry.lock);
+        ios_registry_refresh();
+        pthread_mutex_lock(&registry.lock);
+    }
+    return NULL;
+}
+
+// Called with the lock held.
+static void note_query(void) {
+    registry.queried_ms = ios_monotonic_ms();
+    if (!registry.watcher_started) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, watcher_main, NULL) == 0) {
+            pthread_detach(thread);
+            registry.watcher_started = 1;
+        }
+    } else if (registry.watcher_idle) {
+        pthread_cond_signal(&registry.wake);
+    }
+}
+
+// Data is refreshed in place when it predates the last poll the watcher
+// would have made, which only happens before the first load or after idling.
+static void ensure_fresh(void) {
+    pthread_mutex_lock(&registry.lock);
+    note_query();
+    int stale = !registry.loaded || ios_monotonic_ms() - registry.refreshed_ms > 2 * IOS_REGISTRY_POLL_MS;
+    pthread_mutex_unlock(&registry.lock);
+    if (stale) ios_registry_refresh();
+}
+
+static int load_of(const char* udid) {
+    for (int i = 0; i < registry.load_count; i++) {
+        if (strcmp(registry.loads[i].udid, udid) == 0) return registry.loads[i].count;
+    }
+    return 0;
+}
+
+int ios_registry_matches(const IOSDeviceRecord* record, const IOSDeviceFilter* filter) {
+    if (!filter) return 1;
+    if (filter->booted_only && strcmp(record->state, "Booted") != 0) return 0;
+    if (filter->runtime && filter->runtime[0] && !strstr(record->runtime, filter->runtime)) return 0;
+    if (filter->device_type && filter->device_type[0] && !strstr(record->device_type, filter->device_type) &&
+        !strstr(record->name, filter->device_type)) {
+        return 0;
+    }
+    return 1;
+}
+
+int ios_registry_list(const IOSDeviceFilter* filter, IOSDeviceRecord* out, int max) {
+    ensure_fresh();
+    pthread_mutex_lock(&registry.lock);
+    if (!registry.loaded) {
+        pthread_mutex_unlock(&registry.lock);
+        return -1;
+    }
+
+    int least_loaded = filter && filter->least_loaded;
+    IOSDeviceRecord* matched = least_loaded ? malloc((size_t)registry.count * sizeof(IOSDeviceRecord) + 1) : out;
+    int limit = least_loaded ? registry.count : max;
+    int found = 0;
+    for (int i = 0; matched && i < registry.count && found < limit; i++) {
+        if (!ios_registry_matches(&registry.devices[i], filter)) continue;
+        matched[found] = registry.devices[i];
+        matched[found].load = load_of(matched[found].udid);
+        found++;
+    }
+    pthread_mutex_unlock(&registry.lock);
+    if (!least_loaded) return found;
+    if (!matched) return -1;
+
+    // Insertion sort keeps equally loaded devices in listing order.
+    for (int i = 1; i < found; i++) {
+        IOSDeviceRecord record = matched[i];
+        int j = i;
+        for (; j > 0 && matched[j - 1].load > record.load; j--) matched[j] = matched[j - 1];
+        matched[j] = record;
+    }
+    if (found > max) found = max;
+    memcpy(out, matched, (size_t)found * sizeof(IOSDeviceRecord));
+    free(matched);
+    return found;
+}
+
+int ios_registry_select(const IOSDeviceFilter* filter, IOSDeviceRecord* out) {
+    return ios_registry_list(filter, out, 1) == 1 ? 0 : -1;
+}
+
+int ios_registry_find(const char* udid, IOSDeviceRecord* out) {
+    ensure_fresh();
+    int status = -1;
+    pthread_mutex_lock(&registry.lock);
+    for (int i = 0; i < registry.count && status != 0; i++) {
+        if (strcmp(registry.devices[i].udid, udid) == 0) {
+            *out = registry.devices[i];
+            out->load = load_of(udid);
+            status = 0;
+        }
+    }
+    pthread_mutex_unlock(&registry.lock);
+    return status;
+}
+
+uint64_t ios_registry_generation(void) {
+    ensure_fresh();
+    pthread_mutex_lock(&registry.lock);
+    uint64_t generation = registry.generation;
+    pthread_mutex_unlock(&registry.lock);
+    return generation;
+}
+
+uint64_t ios_registry_wait_change(uint64_t since, int timeout_ms) {
+    ensure_fresh();
+    struct timespec deadline = ios_wall_deadline(timeout_ms);
+    pthread_mutex_lock(&registry.lock);
+    registry.waiters++;
+    note_query();
+    while (registry.generation <= since) {
+        if (pthread_cond_timedwait(&registry.changed, &registry.lock, &deadline) != 0) break;
+    }
+    registry.waiters--;
+    uint64_t generation = registry.generation;
+    pthread_mutex_unlock(&registry.lock);
+    return generation;
+}
+
+void ios_registry_attach(const char* udid) {
+    pthread_mutex_lock(&registry.lock);
+    int i = 0;
+    while (i < registry.load_count && strcmp(registry.loads[i].udid, udid) != 0) i++;
+    if (i == registry.load_count) {
+        IOSDeviceLoad* grown = realloc(registry.loads, (size_t)(i + 1) * sizeof(IOSDeviceLoad));
+        if (grown) {
+            registry.loads = grown;
+            snprintf(grown[i].udid, sizeof(grown[i].udid), "%s", udid);
+            grown[i].count = 0;
+            registry.load_count++;
+        }
+    }
+    if (i < registry.load_count) registry.loads[i].count++;
+    pthread_mutex_unlock(&registry.lock);
+}
+
+void ios_registry_detach(const char* udid) {
+    pthread_mutex_lock(&registry.lock);
+    for (int i = 0; i < registry.load_count; i++) {
+        if (strcmp(registry.loads[i].udid, udid) == 0 && registry.loads[i].count > 0) {
+            registry.loads[i].count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry.lock);
+}
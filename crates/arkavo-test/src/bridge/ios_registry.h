@@ -0,0 +1,67 @@
+#ifndef ARKAVO_IOS_REGISTRY_H
+#define ARKAVO_IOS_REGISTRY_H
+
+#include <stdint.h>
+
+// Process-wide view of the simulators simctl knows about. The first query
+// loads the list; a watcher thread then re-lists it on a short interval for
+// as long as queries keep arriving, so state lookups are answered from
+// memory instead of spawning simctl each time.
+#define IOS_REGISTRY_POLL_MS 2000
+// The watcher stops polling after this long without a query. The next query
+// after that refreshes synchronously if its data is older than a poll.
+#define IOS_REGISTRY_IDLE_MS 30000
+
+// Fixed-size so records copy out of the registry without allocating; longer
+// values are truncated.
+typedef struct {
+    char udid[64];
+    char name[128];
+    // As simctl reports it: "Booted", "Shutdown", "Booting", ...
+    char state[32];
+    char runtime[128];
+    char device_type[128];
+    // Bridges currently attached to the device in this process.
+    int load;
+} IOSDeviceRecord;
+
+// NULL or empty strings match anything. runtime and device_type match
+// substrings, so "iOS-17" or "iPhone-15" select a family; device_type also
+// matches the device name.
+typedef struct {
+    const char* runtime;
+    const char* device_type;
+    int booted_only;
+    // Orders matches by ascending load instead of simctl's listing order.
+    int least_loaded;
+} IOSDeviceFilter;
+
+// Copies up to max matching records into out. Returns the number copied, or
+// -1 when the device list could not be loaded.
+int ios_registry_list(const IOSDeviceFilter* filter, IOSDeviceRecord* out, int max);
+
+// Whether record passes filter; least_loaded does not affect matching.
+int ios_registry_matches(const IOSDeviceRecord* record, const IOSDeviceFilter* filter);
+
+// First match for filter. Returns 0, or -1 when nothing matches.
+int ios_registry_select(const IOSDeviceFilter* filter, IOSDeviceRecord* out);
+
+// Looks up one device. Returns 0, or -1 when the device is not listed.
+int ios_registry_find(const char* udid, IOSDeviceRecord* out);
+
+// Re-lists now and waits for the result. For callers that just booted,
+// shut down, created or deleted a device and need to see the change.
+void ios_registry_refresh(void);
+
+// Bumped every time a refresh sees the device list change.
+uint64_t ios_registry_generation(void);
+
+// Waits up to timeout_ms for the generation to pass since. Returns the
+// current generation either way.
+uint64_t ios_registry_wait_change(uint64_t since, int timeout_ms);
+
+// Load accounting for least_loaded selection, kept by bridge handles.
+void ios_registry_attach(const char* udid);
+void ios_registry_detach(const char* udid);
+
+#endif
@@ -0,0 +1,224 @@
+#include "ios_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define IOS_REPLAY_DEFAULT_TIMEOUT_MS 3000.0
+#define IOS_REPLAY_DEFAULT_TOLERANCE 2
+// Traces hold a few hundred bytes per step; anything this large is not one.
+#define IOS_REPLAY_MAX_TRACE (64L * 1024 * 1024)
+#define IOS_REPLAY_ACTION_NAME_MAX 64
+
+// checkpoints: compare the screen after each step with the recorded one
+// (default true). checkpoint_timeout_ms: how long a step may take to reach
+// its recorded screen. tolerance: signature cells allowed to differ.
+typedef struct {
+    int checkpoints;
+    double timeout_ms;
+    int tolerance;
+} IOSReplayOptions;
+
+typedef enum {
+    IOS_CHECKPOINT_SKIPPED,
+    IOS_CHECKPOINT_MATCHED,
+    IOS_CHECKPOINT_DIVERGED,
+    IOS_CHECKPOINT_FAILED
+} IOSCheckpoint;
+
+static const char* checkpoint_names[] = {"skipped", "matched", "diverged", "failed"};
+
+static int parse_options(const char* json, IOSReplayOptions* options) {
+    options->checkpoints = 1;
+    options->timeout_ms = IOS_REPLAY_DEFAULT_TIMEOUT_MS;
+    options->tolerance = IOS_REPLAY_DEFAULT_TOLERANCE;
+    if (!json || !*json) return 0;
+
+    IOSJsonToken* tokens = NULL;
+    int count = ios_json_parse_alloc(json, strlen(json), &tokens);
+    int status = count > 0 && tokens[0].type == IOS_JSON_OBJECT ? 0 : -1;
+    if (status == 0) {
+        int checkpoints = ios_json_find(json, tokens, count, 0, "checkpoints");
+        int timeout = ios_json_find(json, tokens, count, 0, "checkpoint_timeout_ms");
+        int tolerance = ios_json_find(json, tokens, count, 0, "tolerance");
+        double value;
+        if (checkpoints >= 0 && ios_json_bool(json, &tokens[checkpoints], &options->checkpoints) != 0) status = -1;
+        if (timeout >= 0 && ios_json_number(json, &tokens[timeout], &options->timeout_ms) != 0) status = -1;
+        if (tolerance >= 0) {
+            if (ios_json_number(json, &tokens[tolerance], &value) != 0 || value < 0) status = -1;
+            else options->tolerance = (int)value;
+        }
+    }
+    free(tokens);
+    return status;
+}
+
+static char* read_trace(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    char* data = NULL;
+    long length = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (length >= 0 && length <= IOS_REPLAY_MAX_TRACE && fseek(file, 0, SEEK_SET) == 0) {
+        data = malloc((size_t)length + 1);
+        if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    if (data) *size = (size_t)length;
+    return data;
+}
+
+// Counts the records and how long the recording of all of them took.
+static int scan_trace(const char* data, size_t size, double* recorded_ms) {
+    IOSTraceRecord record;
+    size_t offset = IOS_TRACE_HEADER_SIZE;
+    int count = 0;
+    *recorded_ms = 0;
+    while (ios_trace_next(data, size, &offset, &record) == 1) {
+        *recorded_ms = record.offset_ms + record.duration_ms;
+        count++;
+    }
+    return count;
+}
+
+// Polls until the screen is back within tolerance of the recorded one. The
+// replay never sleeps out recorded think time; this is the only pacing, so
+// each step starts as soon as the device has caught up with the last.
+static IOSCheckpoint await_checkpoint(const IOSBridgeCall* call, const IOSTraceRecord* record,
+                                      const IOSReplayOptions* options, int* distance) {
+    double deadline = ios_monotonic_ms() + options->timeout_ms;
+    uint32_t signature[IOS_TRACE_CELLS];
+    for (;;) {
+        if (ios_trace_capture_signature(&call->impl->worker, call->device_id, signature) != 0) return IOS_CHECKPOINT_FAILED;
+        *distance = ios_trace_signature_distance(signature, record->signature);
+        if (*distance <= options->tolerance) return IOS_CHECKPOINT_MATCHED;
+        if (ios_monotonic_ms() >= deadline) return IOS_CHECKPOINT_DIVERGED;
+        usleep(IOS_TRACE_POLL_MS * 1000);
+    }
+}
+
+// Runs one record and appends its step, counting it in *replayed. Returns
+// NULL to go on, or the outcome that ends the replay.
+static const char* replay_step(IOSBridgeImpl* impl, int* replayed, const IOSTraceRecord* record,
+                               const IOSReplayOptions* options, IOSStringBuilder* out,
+                               IOSStringBuilder* divergence) {
+    char action[IOS_REPLAY_ACTION_NAME_MAX];
+    char* params = record->action_length < sizeof(action) ? malloc(record->params_length + 1) : NULL;
+    IOSActionParams decoded;
+    if (!params) return "invalid_trace";
+    memcpy(action, record->action, record->action_length);
+    action[record->action_length] = '\0';
+    memcpy(params, record->params, record->params_length);
+    params[record->params_length] = '\0';
+    if (ios_action_params_parse(params, &decoded) != 0) {
+        free(params);
+        return "invalid_trace";
+    }
+
+    int index = (*replayed)++;
+    double started = ios_monotonic_ms();
+    char* result = ios_bridge_execute_params(impl, action, &decoded);
+    double elapsed = ios_monotonic_ms() - started;
+    int succeeded = result && ios_result_succeeded(result);
+
+    IOSCheckpoint checkpoint = IOS_CHECKPOINT_SKIPPED;
+    int distance = 0;
+    double checkpoint_started = ios_monotonic_ms();
+    IOSBridgeCall call;
+    if (succeeded && options->checkpoints && record->flags & IOS_TRACE_FLAG_SIGNATURE &&
+        ios_bridge_call_begin(&call, impl, &decoded) == 0) {
+        checkpoint = await_checkpoint(&call, record, options, &distance);
+        ios_bridge_call_end(&call);
+    }
+
+    if (index > 0) ios_builder_append(out, ",", 1);
+    ios_builder_appendf(out, "{\"index\": %d, \"action\": ", index);
+    ios_builder_append_json_string(out, action, record->action_length);
+    ios_builder_appendf(out,
+                        ", \"success\": %s, \"duration_ms\": %.3f, \"checkpoint\": \"%s\", "
+                        "\"changed_cells\": %d, \"checkpoint_ms\": %.3f, \"result\": %s}",
+                        succeeded ? "true" : "false", elapsed, checkpoint_names[checkpoint], distance,
+                        ios_monotonic_ms() - checkpoint_started,
+                        result ? result : "{\"error\": \"Null result from bridge\"}");
+    free(result);
+
+    // A diverged step carries everything a caller needs to resolve its
+    // target again and carry on from there.
+    if (checkpoint == IOS_CHECKPOINT_DIVERGED) {
+        ios_builder_appendf(divergence, "{\"index\": %d, \"action\": ", index);
+        ios_builder_append_json_string(divergence, action, record->action_length);
+        ios_builder_appendf(divergence, ", \"params\": %s, \"changed_cells\": %d}", params, distance);
+    }
+    free(params);
+
+    if (!succeeded) return "action_failed";
+    if (checkpoint == IOS_CHECKPOINT_DIVERGED) return "diverged";
+    if (checkpoint == IOS_CHECKPOINT_FAILED) return "checkpoint_failed";
+    return NULL;
+}
+
+static void replay_locked(IOSBridgeImpl* impl, const char* data, size_t size, const IOSReplayOptions* options,
+                          IOSStringBuilder* out) {
+    IOSStringBuilder divergence;
+    ios_builder_init(&divergence);
+    ios_builder_append(out, "{\"steps\": [", 11);
+
+    double recorded_ms;
+    int total = scan_trace(data, size, &recorded_ms);
+    double started = ios_monotonic_ms();
+    const char* outcome = NULL;
+    int replayed = 0;
+    size_t offset = IOS_TRACE_HEADER_SIZE;
+    IOSTraceRecord record;
+    int status = 0;
+    while (!outcome && (status = ios_trace_next(data, size, &offset, &record)) == 1) {
+        outcome = replay_step(impl, &replayed, &record, options, out, &divergence);
+    }
+    if (!outcome) outcome = status < 0 ? "invalid_trace" : "completed";
+
+    char* divergence_json = ios_builder_finish(&divergence);
+    ios_builder_appendf(out,
+                        "], \"outcome\": \"%s\", \"success\": %s, \"replayed\": %d, \"total\": %d, "
+                        "\"recorded_ms\": %.3f, \"total_ms\": %.3f, \"divergence\": %s}",
+                        outcome, strcmp(outcome, "completed") == 0 ? "true" : "false", replayed, total,
+                        recorded_ms, ios_monotonic_ms() - started,
+                        divergence_json && *divergence_json ? divergence_json : "null");
+    free(divergence_json);
+}
+
+char* ios_bridge_replay_trace(void* bridge, const char* path, const char* options_json) {
+    IOSReplayOptions options;
+    if (parse_options(options_json, &options) != 0) {
+        return strdup("{\"success\": false, \"error\": \"Invalid replay options\"}");
+    }
+    size_t size = 0;
+    char* data = path ? read_trace(path, &size) : NULL;
+    if (!data) return strdup("{\"success\": false, \"error\": \"Failed to read trace\"}");
+    if (ios_trace_validate(data, size) != 0) {
+        free(data);
+        return strdup("{\"success\": false, \"error\": \"Not a trace file\"}");
+    }
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "trace.replay", NULL);
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) {
+        ios_metrics_end(&span);
+        free(data);
+        return strdup("{\"success\": false, \"error\": \"No iOS device specified or found\"}");
+    }
+
+    IOSStringBuilder out;
+    ios_builder_init(&out);
+    replay_locked(impl, data, size, &options, &out);
+    ios_bridge_unlock(impl);
+    ios_metrics_end(&span);
+    free(data);
+
+    char* json = ios_builder_finish(&out);
+    return json ? json : strdup("{\"success\": false, \"error\": \"Memory allocation failed\"}");
+}
@@ -0,0 +1,208 @@
+#include "ios_backend.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Client for the resident XCUITest runner (ArkavoTestBridge+Host.m and
+// mcp::xctest_runner_host, which starts it). Frames are a 12-byte
+// little-endian header, payload length, kind, flags and request id, then
+// the payload; replies echo the kind with the reply bit.
+#define IOS_RUNNER_ATTACH 2
+#define IOS_RUNNER_ACTION 3
+#define IOS_RUNNER_REPLY_BIT 0x8000
+#define IOS_RUNNER_HEADER_SIZE 12
+#define IOS_RUNNER_MAX_REPLY (64u * 1024 * 1024)
+// On top of whatever the action itself may wait for.
+#define IOS_RUNNER_REPLY_MS 30000
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static int write_fully(int fd, const void* data, size_t length) {
+    const uint8_t* bytes = data;
+    while (length > 0) {
+        ssize_t count = write(fd, bytes, length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return -1;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return 0;
+}
+
+static int read_fully(int fd, void* data, size_t length) {
+    uint8_t* bytes = data;
+    while (length > 0) {
+        ssize_t count = read(fd, bytes, length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return -1;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return 0;
+}
+
+static void set_timeout(int fd, double timeout_ms) {
+    struct timeval timeout = {(time_t)(timeout_ms / 1000.0), (int)((long long)timeout_ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// One request in flight per connection, under the handle's lock, so the
+// request id only has to match the reply that follows it.
+static char* request(IOSBridgeImpl* impl, uint16_t kind, const char* name, const char* body, size_t body_length,
+                     double timeout_ms) {
+    static uint32_t next_id = 1;
+    uint32_t id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    size_t name_length = name ? strlen(name) : 0;
+    size_t length = (name ? 2 + name_length : 0) + body_length;
+
+    uint8_t header[IOS_RUNNER_HEADER_SIZE + 2];
+    put_u32(header, (uint32_t)length);
+    header[4] = (uint8_t)kind;
+    header[5] = (uint8_t)(kind >> 8);
+    header[6] = header[7] = 0;
+    put_u32(header + 8, id);
+    header[12] = (uint8_t)name_length;
+    header[13] = (uint8_t)(name_length >> 8);
+
+    set_timeout(impl->runner_fd, timeout_ms);
+    if (write_fully(impl->runner_fd, header, IOS_RUNNER_HEADER_SIZE + (name ? 2 : 0)) != 0 ||
+        (name && write_fully(impl->runner_fd, name, name_length) != 0) ||
+        write_fully(impl->runner_fd, body, body_length) != 0 ||
+        read_fully(impl->runner_fd, header, IOS_RUNNER_HEADER_SIZE) != 0) {
+        return NULL;
+    }
+    uint32_t reply_length = get_u32(header);
+    uint16_t reply_kind = (uint16_t)(header[4] | (header[5] << 8));
+    if (reply_kind != (kind | IOS_RUNNER_REPLY_BIT) || get_u32(header + 8) != id ||
+        reply_length > IOS_RUNNER_MAX_REPLY) {
+        return NULL;
+    }
+    char* reply = malloc((size_t)reply_length + 1);
+    if (!reply) return NULL;
+    if (read_fully(impl->runner_fd, reply, reply_length) != 0) {
+        free(reply);
+        return NULL;
+    }
+    reply[reply_length] = '\0';
+    return reply;
+}
+
+void ios_runner_disconnect(IOSBridgeImpl* impl) {
+    if (impl->runner_fd >= 0) close(impl->runner_fd);
+    free(impl->runner_device_id);
+    impl->runner_fd = -1;
+    impl->runner_device_id = NULL;
+}
+
+// A runner that went away leaves the idle connection readable at EOF,
+// which poll sees without a round trip.
+static int connection_alive(int fd) {
+    struct pollfd entry = {fd, POLLIN, 0};
+    return poll(&entry, 1, 0) == 0;
+}
+
+static int runner_connect(const IOSBridgeCall* call, char* error, size_t error_size) {
+    // Matches RunnerHost::socket_path; the runner binds it inside the
+    // simulator, which shares the host file system.
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    int written = snprintf(address.sun_path, sizeof(address.sun_path), "/tmp/arkavo-runner-%s.sock", call->device_id);
+    if (written < 0 || (size_t)written >= sizeof(address.sun_path)) {
+        snprintf(error, error_size, "Runner socket path is too long");
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        snprintf(error, error_size, "No XCUITest runner is serving %s", address.sun_path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    call->impl->runner_fd = fd;
+    call->impl->runner_device_id = strdup(call->device_id);
+
+    // Attaching brings the bridge's app forward and keeps its process when
+    // the runner already drives it.
+    const char* bundle = call->impl->bundle_id ? call->impl->bundle_id : "";
+    char* reply = call->impl->runner_device_id && *bundle
+        ? request(call->impl, IOS_RUNNER_ATTACH, NULL, bundle, strlen(bundle), IOS_RUNNER_REPLY_MS)
+        : NULL;
+    int attached = reply && ios_result_succeeded(reply);
+    free(reply);
+    if (!attached) {
+        ios_runner_disconnect(call->impl);
+        snprintf(error, error_size, "XCUITest runner could not attach to %s", bundle);
+        return -1;
+    }
+    return 0;
+}
+
+int ios_runner_prepare(const IOSBridgeCall* call, char* error, size_t error_size) {
+    IOSBridgeImpl* impl = call->impl;
+    if (impl->runner_fd >= 0) {
+        if (strcmp(impl->runner_device_id, call->device_id) == 0 && connection_alive(impl->runner_fd)) return 0;
+        ios_runner_disconnect(impl);
+    }
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "runner.connect", NULL);
+    int status = runner_connect(call, error, error_size);
+    ios_metrics_end(&span);
+    return status;
+}
+
+// The runner names typing "type" and only types into an element it can
+// find; everything it does not implement goes to the next backend.
+static const char* runner_action(const char* action, const IOSActionParams* params) {
+    if (strcmp(action, "type_text") == 0) {
+        return params->present & (IOS_PARAM_IDENTIFIER | IOS_PARAM_LABEL) ? "type" : NULL;
+    }
+    static const char* supported[] = {"tap", "swipe", "wait_for", "query_ui", "assert"};
+    for (size_t i = 0; i < sizeof(supported) / sizeof(supported[0]); i++) {
+        if (strcmp(action, supported[i]) == 0) return supported[i];
+    }
+    return NULL;
+}
+
+char* ios_runner_execute(const IOSBridgeCall* call, const char* action, const IOSActionParams* params, int* lost) {
+    const char* name = runner_action(action, params);
+    if (!name) return NULL;
+
+    // The params object goes through untouched; the runner parses it again.
+    const char* body = "{}";
+    size_t body_length = 2;
+    if (params->object.type == IOS_JSON_OBJECT) {
+        body = params->source + params->object.start;
+        body_length = (size_t)(params->object.end - params->object.start);
+    }
+    double waits_ms = ((params->present & IOS_PARAM_TIMEOUT ? params->timeout : 0) +
+                       (params->present & IOS_PARAM_DURATION ? params->duration : 0)) * 1000.0;
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "runner", name);
+    char* reply = request(call->impl, IOS_RUNNER_ACTION, name, body, body_length,
+                          IOS_RUNNER_REPLY_MS + (waits_ms > 0 ? waits_ms : 0));
+    ios_metrics_end(&span);
+    if (reply) return reply;
+
+    // A half-read reply leaves the framing unusable.
+    ios_runner_disconnect(call->impl);
+    *lost = 1;
+    return strdup("{\"success\": false, \"error\": \"XCUITest runner stopped answering\"}");
+}
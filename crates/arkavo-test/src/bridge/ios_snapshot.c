@@ -0,0 +1,294 @@
+#include <errno.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/clonefile.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ios_impl.h"
+#include "ios_snapshot_format.h"
+
+#define IOS_SNAPSHOT_CONTAINER_MARKER "/data/Containers/"
+#define IOS_SNAPSHOT_DIRECTORY "arkavo-snapshots"
+
+static unsigned long snapshot_counter = 0;
+
+static char* app_data_container(IOSBridgeImpl* impl) {
+    char* bundle = ios_shell_quote(impl->bundle_id);
+    if (!bundle) return NULL;
+
+    size_t rest_size = strlen(bundle) + 6;
+    char* rest = malloc(rest_size);
+    char* container = NULL;
+    if (rest) {
+        snprintf(rest, rest_size, "%s data", bundle);
+        IOSCommandOutput output;
+        if (ios_bridge_run_device_command(impl, "get_app_container", rest, &output) == 0 && output.data) {
+            output.data[strcspn(output.data, "\r\n")] = '\0';
+            if (output.data[0] == '/') container = strdup(output.data);
+        }
+        ios_command_output_free(&output);
+        free(rest);
+    }
+    free(bundle);
+    return container;
+}
+
+// Clones only work within one APFS volume, and a clone placed among the
+// device's containers would register as a second copy of the app. Keeping
+// them beside the device's data directory satisfies both, and deleting the
+// simulator deletes its snapshots with it.
+static char* snapshot_directory(const char* container) {
+    const char* marker = strstr(container, IOS_SNAPSHOT_CONTAINER_MARKER);
+    if (!marker) return NULL;
+
+    int prefix = (int)(marker - container);
+    size_t size = (size_t)prefix + strlen(IOS_SNAPSHOT_DIRECTORY) + 2;
+    char* directory = malloc(size);
+    if (directory) snprintf(directory, size, "%.*s/%s", prefix, container, IOS_SNAPSHOT_DIRECTORY);
+    return directory;
+}
+
+static char* snapshot_path(const char* directory, const char* kind) {
+    unsigned long sequence = __atomic_add_fetch(&snapshot_counter, 1, __ATOMIC_RELAXED);
+    size_t size = strlen(directory) + strlen(kind) + 64;
+    char* path = malloc(size);
+    if (path) snprintf(path, size, "%s/%s-%ld-%d-%lu", directory, kind, (long)time(NULL), (int)getpid(), sequence);
+    return path;
+}
+
+static int remove_entry(const char* path, const struct stat* info, int flag, struct FTW* walk) {
+    (void)info;
+    (void)flag;
+    (void)walk;
+    return remove(path);
+}
+
+static int remove_tree(const char* path) {
+    return nftw(path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static void run_app_command(IOSBridgeImpl* impl, const char* verb) {
+    char* bundle = ios_shell_quote(impl->bundle_id);
+    if (!bundle) return;
+    ios_bridge_run_device_command(impl, verb, bundle, NULL);
+    free(bundle);
+}
+
+// The app is stopped while its container is cloned so the copy is consistent
+// on disk, then launched again. When no container can be located (the app is
+// not installed) there is no clone and *clone is left NULL.
+static int capture_locked(IOSBridgeImpl* impl, char** clone) {
+    char* container = app_data_container(impl);
+    char* directory = container ? snapshot_directory(container) : NULL;
+    int failed = 0;
+    *clone = NULL;
+
+    if (directory) {
+        *clone = snapshot_path(directory, "snapshot");
+        failed = !*clone || (mkdir(directory, 0755) != 0 && errno != EEXIST);
+        if (!failed) {
+            run_app_command(impl, "terminate");
+            failed = clonefile(container, *clone, CLONE_NOFOLLOW) != 0;
+            run_app_command(impl, "launch");
+        }
+    }
+    free(container);
+    free(directory);
+    if (failed) {
+        free(*clone);
+        *clone = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void put_timestamp(unsigned char out[8]) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t ms = (uint64_t)now.tv_sec * 1000u + (uint64_t)(now.tv_usec / 1000);
+    for (int i = 0; i < 8; i++) out[i] = (unsigned char)(ms >> (8 * i));
+}
+
+static int create_snapshot(void* bridge, IOSBridgeReserve reserve, void* context) {
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) return -1;
+    char* clone = NULL;
+    int status = capture_locked(impl, &clone);
+    // Copied before unlocking, since another caller may retarget the handle
+    // as soon as it is released.
+    char* device_id = strdup(impl->device_id);
+    char* bundle_id = strdup(impl->bundle_id);
+    ios_bridge_unlock(impl);
+    if (status != 0 || !device_id || !bundle_id) {
+        free(clone);
+        free(device_id);
+        free(bundle_id);
+        return -1;
+    }
+
+    unsigned char timestamp[8];
+    put_timestamp(timestamp);
+    IOSSnapshotField fields[] = {
+        {IOS_SNAPSHOT_DEVICE_ID, device_id, (uint32_t)strlen(device_id)},
+        {IOS_SNAPSHOT_BUNDLE_ID, bundle_id, (uint32_t)strlen(bundle_id)},
+        {IOS_SNAPSHOT_TIMESTAMP_MS, timestamp, sizeof(timestamp)},
+        {IOS_SNAPSHOT_CLONE_PATH, clone, clone ? (uint32_t)strlen(clone) : 0},
+    };
+    int count = clone ? 4 : 3;
+
+    // The record is encoded straight into the caller's memory.
+    size_t size = ios_snapshot_encoded_size(fields, count);
+    void* data = size ? reserve(context, size) : NULL;
+    if (data) ios_snapshot_encode(fields, count, data);
+    free(clone);
+    free(device_id);
+    free(bundle_id);
+    return data ? 0 : -1;
+}
+
+int ios_bridge_create_snapshot_into(void* bridge, IOSBridgeReserve reserve, void* context) {
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "snapshot.create", NULL);
+    int status = create_snapshot(bridge, reserve, context);
+    ios_metrics_end(&span);
+    return status;
+}
+
+typedef struct {
+    void* data;
+    size_t size;
+} IOSSnapshotAllocation;
+
+static void* reserve_malloc(void* context, size_t size) {
+    IOSSnapshotAllocation* allocation = context;
+    allocation->data = malloc(size);
+    allocation->size = size;
+    return allocation->data;
+}
+
+void* ios_bridge_create_snapshot(void* bridge, size_t* size) {
+    IOSSnapshotAllocation allocation = {NULL, 0};
+    if (ios_bridge_create_snapshot_into(bridge, reserve_malloc, &allocation) != 0) {
+        free(allocation.data);
+        *size = 0;
+        return NULL;
+    }
+    *size = allocation.size;
+    return allocation.data;
+}
+
+static int field_equals(const void* data, size_t size, uint16_t tag, const char* expected) {
+    const void* value = NULL;
+    long length = ios_snapshot_find(data, size, tag, &value);
+    return length == (long)strlen(expected) && memcmp(value, expected, (size_t)length) == 0;
+}
+
+// Copy of the snapshot's clone path, or NULL when it has none. Sets *valid to
+// 0 when data is not a snapshot, or, given device_id, not one taken on that
+// device of bundle_id.
+static char* snapshot_clone(const void* data, size_t size, const char* device_id, const char* bundle_id,
+                            int* valid) {
+    const void* value = NULL;
+    *valid = ios_snapshot_validate(data, size) == 0;
+    if (*valid && device_id) {
+        *valid = field_equals(data, size, IOS_SNAPSHOT_DEVICE_ID, device_id) &&
+                 field_equals(data, size, IOS_SNAPSHOT_BUNDLE_ID, bundle_id);
+    }
+    if (!*valid) return NULL;
+
+    long length = ios_snapshot_find(data, size, IOS_SNAPSHOT_CLONE_PATH, &value);
+    if (length <= 0) return NULL;
+    char* clone = malloc((size_t)length + 1);
+    if (!clone) {
+        *valid = 0;
+        return NULL;
+    }
+    memcpy(clone, value, (size_t)length);
+    clone[length] = '\0';
+    // An embedded NUL would point the restore somewhere else entirely.
+    if (strlen(clone) != (size_t)length) {
+        free(clone);
+        *valid = 0;
+        return NULL;
+    }
+    return clone;
+}
+
+// Records come from the caller, so a restore or delete only touches what
+// capture_locked could have made: a "snapshot-" entry directly inside an arkavo-snapshots
+// directory, after resolving any symlinks on the way there.
+static int is_snapshot_clone(const char* clone) {
+    const char* name = strrchr(clone, '/');
+    if (!name || name == clone || strncmp(name + 1, "snapshot-", 9) != 0) return 0;
+
+    char* parent = strndup(clone, (size_t)(name - clone));
+    char resolved[PATH_MAX];
+    int inside = 0;
+    if (parent && realpath(parent, resolved)) {
+        const char* directory = strrchr(resolved, '/');
+        inside = directory && strcmp(directory + 1, IOS_SNAPSHOT_DIRECTORY) == 0;
+    }
+    free(parent);
+    return inside;
+}
+
+// The snapshot is cloned into the snapshot directory first, so a failed clone
+// leaves the app's current data untouched; the swap itself is two renames.
+static int restore_locked(IOSBridgeImpl* impl, const char* clone) {
+    char* container = app_data_container(impl);
+    char* directory = container ? snapshot_directory(container) : NULL;
+    char* staged = directory ? snapshot_path(directory, "restoring") : NULL;
+    char* retired = directory ? snapshot_path(directory, "retired") : NULL;
+    int status = -1;
+
+    if (staged && retired && clonefile(clone, staged, CLONE_NOFOLLOW) == 0) {
+        run_app_command(impl, "terminate");
+        if (rename(container, retired) == 0) {
+            if (rename(staged, container) == 0) {
+                status = 0;
+                remove_tree(retired);
+            } else {
+                rename(retired, container);
+            }
+        }
+        run_app_command(impl, "launch");
+        if (status != 0) remove_tree(staged);
+    }
+
+    free(container);
+    free(directory);
+    free(staged);
+    free(retired);
+    return status;
+}
+
+int ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size) {
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) return -1;
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "snapshot.restore", NULL);
+    int valid = 0;
+    char* clone = snapshot_clone(data, size, impl->device_id, impl->bundle_id, &valid);
+    // Snapshots without a clone had no app data to capture, so there is
+    // nothing on disk to rewind.
+    int status = !valid ? -1 : !clone ? 0 : is_snapshot_clone(clone) ? restore_locked(impl, clone) : -1;
+    ios_metrics_end(&span);
+    ios_bridge_unlock(impl);
+    free(clone);
+    return status;
+}
+
+int ios_bridge_delete_snapshot(void* bridge, const void* data, size_t size) {
+    (void)bridge;
+    int valid = 0;
+    char* clone = snapshot_clone(data, size, NULL, NULL, &valid);
+    int status = !valid ? -1 : !clone ? 0 : is_snapshot_clone(clone) ? remove_tree(clone) : -1;
+    free(clone);
+    return status;
+}
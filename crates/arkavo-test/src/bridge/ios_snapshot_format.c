@@ -0,0 +1,80 @@
+#include <string.h>
+
+#include "ios_snapshot_format.h"
+
+static void put_u16(unsigned char* out, uint16_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+size_t ios_snapshot_encoded_size(const IOSSnapshotField* fields, int count) {
+    if (count < 0 || count > UINT16_MAX) return 0;
+    size_t size = IOS_SNAPSHOT_HEADER_SIZE + (size_t)count * IOS_SNAPSHOT_ENTRY_SIZE;
+    for (int i = 0; i < count; i++) size += fields[i].length;
+    return size <= UINT32_MAX ? size : 0;
+}
+
+void ios_snapshot_encode(const IOSSnapshotField* fields, int count, void* out) {
+    unsigned char* bytes = out;
+    size_t size = ios_snapshot_encoded_size(fields, count);
+    memcpy(bytes, IOS_SNAPSHOT_MAGIC, 4);
+    put_u16(bytes + 4, IOS_SNAPSHOT_VERSION);
+    put_u16(bytes + 6, (uint16_t)count);
+    put_u32(bytes + 8, (uint32_t)size);
+    put_u32(bytes + 12, 0);
+
+    size_t offset = IOS_SNAPSHOT_HEADER_SIZE + (size_t)count * IOS_SNAPSHOT_ENTRY_SIZE;
+    for (int i = 0; i < count; i++) {
+        unsigned char* entry = bytes + IOS_SNAPSHOT_HEADER_SIZE + (size_t)i * IOS_SNAPSHOT_ENTRY_SIZE;
+        put_u16(entry, fields[i].tag);
+        put_u16(entry + 2, 0);
+        put_u32(entry + 4, (uint32_t)offset);
+        put_u32(entry + 8, fields[i].length);
+        if (fields[i].length) memcpy(bytes + offset, fields[i].data, fields[i].length);
+        offset += fields[i].length;
+    }
+}
+
+int ios_snapshot_validate(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    if (size < IOS_SNAPSHOT_HEADER_SIZE || memcmp(bytes, IOS_SNAPSHOT_MAGIC, 4) != 0) return -1;
+    if (get_u16(bytes + 4) != IOS_SNAPSHOT_VERSION || get_u32(bytes + 8) != size) return -1;
+
+    size_t count = get_u16(bytes + 6);
+    size_t table_end = IOS_SNAPSHOT_HEADER_SIZE + count * IOS_SNAPSHOT_ENTRY_SIZE;
+    if (table_end > size) return -1;
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char* entry = bytes + IOS_SNAPSHOT_HEADER_SIZE + i * IOS_SNAPSHOT_ENTRY_SIZE;
+        size_t offset = get_u32(entry + 4);
+        size_t length = get_u32(entry + 8);
+        if (offset < table_end || offset > size || length > size - offset) return -1;
+    }
+    return 0;
+}
+
+long ios_snapshot_find(const void* data, size_t size, uint16_t tag, const void** value) {
+    const unsigned char* bytes = data;
+    if (ios_snapshot_validate(data, size) != 0) return -1;
+
+    size_t count = get_u16(bytes + 6);
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char* entry = bytes + IOS_SNAPSHOT_HEADER_SIZE + i * IOS_SNAPSHOT_ENTRY_SIZE;
+        if (get_u16(entry) == tag) {
+            *value = bytes + get_u32(entry + 4);
+            return (long)get_u32(entry + 8);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,58 @@
+#ifndef ARKAVO_IOS_SNAPSHOT_FORMAT_H
+#define ARKAVO_IOS_SNAPSHOT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Snapshot records shared by every backend. All integers are little-endian
+// and every offset counts from the start of the record, so a single field can
+// be read in place without decoding the rest:
+//
+//   0   magic "ARKS"
+//   4   u16 version
+//   6   u16 field count
+//   8   u32 total size
+//   12  u32 reserved, zero
+//   16  field table, 12 bytes per field: u16 tag, u16 reserved, u32 offset,
+//       u32 length
+//   ..  field bytes
+//
+// Strings are UTF-8 without a terminator. Readers skip tags they do not know;
+// the version only changes when existing fields change meaning.
+#define IOS_SNAPSHOT_MAGIC "ARKS"
+#define IOS_SNAPSHOT_VERSION 1
+#define IOS_SNAPSHOT_HEADER_SIZE 16
+#define IOS_SNAPSHOT_ENTRY_SIZE 12
+
+typedef enum {
+    IOS_SNAPSHOT_DEVICE_ID = 1,
+    IOS_SNAPSHOT_BUNDLE_ID = 2,
+    // u64 milliseconds since the Unix epoch.
+    IOS_SNAPSHOT_TIMESTAMP_MS = 3,
+    // Path of the cloned app data container.
+    IOS_SNAPSHOT_CLONE_PATH = 4,
+    IOS_SNAPSHOT_SCREEN = 5,
+    // View hierarchy as JSON.
+    IOS_SNAPSHOT_HIERARCHY = 6
+} IOSSnapshotTag;
+
+typedef struct {
+    uint16_t tag;
+    const void* data;
+    uint32_t length;
+} IOSSnapshotField;
+
+// Bytes needed to encode the fields, or 0 if they cannot fit in a record.
+size_t ios_snapshot_encoded_size(const IOSSnapshotField* fields, int count);
+
+// Writes exactly ios_snapshot_encoded_size(fields, count) bytes into out.
+void ios_snapshot_encode(const IOSSnapshotField* fields, int count, void* out);
+
+// Checks the header and field table. Returns 0 for a well-formed record.
+int ios_snapshot_validate(const void* data, size_t size);
+
+// Points *value at the first field with tag inside a validated record and
+// returns its length, or -1 when the record has no such field.
+long ios_snapshot_find(const void* data, size_t size, uint16_t tag, const void** value);
+
+#endif
@@ -0,0 +1,283 @@
+#include "ios_stream.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IOS_STREAM_DEFAULT_FPS 4.0
+// Only a cap on what is asked for; frames report the rate reached.
+#define IOS_STREAM_MAX_FPS 30.0
+#define IOS_STREAM_DEFAULT_CAPACITY 4
+#define IOS_STREAM_DEFAULT_SCALE 0.25
+#define IOS_STREAM_DEFAULT_TILE 16
+// Consecutive capture failures after which the stream reports itself failed
+// instead of retrying forever against a dead simulator.
+#define IOS_STREAM_MAX_FAILURES 5
+
+typedef struct {
+    uint8_t* pixels;
+    size_t capacity;
+    size_t length;
+    IOSStreamFrameInfo info;
+} IOSStreamSlot;
+
+typedef struct {
+    uint8_t* pixels;
+    size_t capacity;
+    size_t length;
+} IOSStreamScratch;
+
+struct IOSFrameStream {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t updated;
+    IOSWorker worker;
+    char* device_id;
+    IOSStreamConfig config;
+    IOSStreamSlot* slots;
+    uint64_t sequence;
+    uint64_t change_sequence;
+    double change_ms;
+    // Smoothed time between captures, behind the fps each frame reports.
+    double interval_ms;
+    int running;
+    int failed;
+
+    // Owned by the capture thread alone, so touched without the lock.
+    IOSStreamScratch scratch;
+    IOSStreamTiles tiles;
+};
+
+static void* reserve_scratch(void* context, size_t size) {
+    IOSStreamScratch* scratch = context;
+    if (size > scratch->capacity) {
+        uint8_t* grown = realloc(scratch->pixels, size);
+        if (!grown) return NULL;
+        scratch->pixels = grown;
+        scratch->capacity = size;
+    }
+    scratch->length = size;
+    return scratch->pixels;
+}
+
+// Called with the lock held. The captured pixels trade places with the
+// oldest slot's buffer, so publishing a frame never copies it.
+static void publish_frame(IOSFrameStream* stream, const IOSFrameInfo* frame, int changed_tiles, int total_tiles) {
+    uint64_t sequence = stream->sequence + 1;
+    IOSStreamSlot* slot = &stream->slots[sequence % (uint64_t)stream->config.capacity];
+
+    uint8_t* pixels = slot->pixels;
+    size_t capacity = slot->capacity;
+    slot->pixels = stream->scratch.pixels;
+    slot->capacity = stream->scratch.capacity;
+    slot->length = stream->scratch.length;
+    stream->scratch.pixels = pixels;
+    stream->scratch.capacity = capacity;
+    stream->scratch.length = 0;
+
+    // Each frame waits on a simctl screenshot, so the rate the stream
+    // reaches depends on the host and is usually below the configured one.
+    if (stream->sequence > 0) {
+        const IOSStreamSlot* newest = &stream->slots[stream->sequence % (uint64_t)stream->config.capacity];
+        double interval = frame->captured_ms - newest->info.frame.captured_ms;
+        stream->interval_ms = stream->interval_ms > 0 ? stream->interval_ms * 0.75 + interval * 0.25 : interval;
+    }
+
+    slot->info.frame = *frame;
+    slot->info.sequence = sequence;
+    slot->info.measured_fps = stream->interval_ms > 0 ? 1000.0 / stream->interval_ms : 0;
+    slot->info.changed_tiles = changed_tiles;
+    slot->info.total_tiles = total_tiles;
+    slot->info.changed = changed_tiles >= stream->config.min_changed_tiles;
+
+    stream->sequence = sequence;
+    if (slot->info.changed) {
+        stream->change_sequence = sequence;
+        stream->change_ms = frame->captured_ms;
+    }
+    pthread_cond_broadcast(&stream->updated);
+}
+
+// Converting the monotonic deadline at each wait keeps clock adjustments
+// from stretching it.
+static int wait_until(IOSFrameStream* stream, double deadline_ms) {
+    double remaining = deadline_ms - ios_monotonic_ms();
+    if (remaining <= 0) return ETIMEDOUT;
+    struct timespec deadline = ios_wall_deadline(remaining);
+    return pthread_cond_timedwait(&stream->updated, &stream->lock, &deadline);
+}
+
+static void* stream_main(void* context) {
+    IOSFrameStream* stream = context;
+    IOSFrameRequest request = { .format = IOS_FRAME_RAW_BGRA, .scale = stream->config.scale };
+    double interval = 1000.0 / stream->config.fps;
+    int failures = 0;
+
+    for (;;) {
+        double started = ios_monotonic_ms();
+        IOSFrameInfo frame;
+        int status = ios_frame_capture(&stream->worker, stream->device_id, &request,
+                                       reserve_scratch, &stream->scratch, &frame);
+
+        int changed_tiles = 0;
+        int total_tiles = status == 0
+            ? ios_stream_tiles_update(&stream->tiles, stream->scratch.pixels, &frame, stream->config.tile_size,
+                                      &changed_tiles)
+            : -1;
+
+        pthread_mutex_lock(&stream->lock);
+        if (total_tiles > 0) {
+            failures = 0;
+            publish_frame(stream, &frame, changed_tiles, total_tiles);
+        } else if (++failures >= IOS_STREAM_MAX_FAILURES) {
+            stream->failed = 1;
+            pthread_cond_broadcast(&stream->updated);
+        }
+
+        while (stream->running && !stream->failed && wait_until(stream, started + interval) != ETIMEDOUT) {
+        }
+        int keep_running = stream->running && !stream->failed;
+        pthread_mutex_unlock(&stream->lock);
+
+        if (!keep_running) break;
+    }
+    return NULL;
+}
+
+static void free_stream(IOSFrameStream* stream) {
+    if (stream->slots) {
+        for (int i = 0; i < stream->config.capacity; i++) free(stream->slots[i].pixels);
+    }
+    free(stream->slots);
+    free(stream->scratch.pixels);
+    ios_stream_tiles_free(&stream->tiles);
+    free(stream->device_id);
+    free(stream);
+}
+
+IOSFrameStream* ios_stream_start_device(const char* device_id, const IOSStreamConfig* config) {
+    IOSFrameStream* stream = calloc(1, sizeof(IOSFrameStream));
+    if (!stream) return NULL;
+
+    stream->config = *config;
+    if (!(stream->config.fps > 0)) stream->config.fps = IOS_STREAM_DEFAULT_FPS;
+    if (stream->config.fps > IOS_STREAM_MAX_FPS) stream->config.fps = IOS_STREAM_MAX_FPS;
+    if (stream->config.capacity <= 0) stream->config.capacity = IOS_STREAM_DEFAULT_CAPACITY;
+    if (!(stream->config.scale > 0 && stream->config.scale <= 1.0)) stream->config.scale = IOS_STREAM_DEFAULT_SCALE;
+    if (stream->config.tile_size <= 0) stream->config.tile_size = IOS_STREAM_DEFAULT_TILE;
+    if (stream->config.min_changed_tiles <= 0) stream->config.min_changed_tiles = 1;
+
+    stream->device_id = strdup(device_id);
+    stream->slots = calloc((size_t)stream->config.capacity, sizeof(IOSStreamSlot));
+    if (!stream->device_id || !stream->slots) {
+        free_stream(stream);
+        return NULL;
+    }
+
+    ios_worker_init(&stream->worker);
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->updated, NULL);
+    stream->running = 1;
+
+    if (pthread_create(&stream->thread, NULL, stream_main, stream) != 0) {
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->updated);
+        free_stream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+IOSFrameStream* ios_bridge_stream_start(void* bridge, const IOSStreamConfig* config) {
+    IOSBridgeCall call;
+    if (ios_bridge_call_begin(&call, bridge, NULL) != 0) return NULL;
+
+    IOSFrameStream* stream = ios_stream_start_device(call.device_id, config);
+    ios_bridge_call_end(&call);
+    return stream;
+}
+
+void ios_bridge_stream_stop(IOSFrameStream* stream) {
+    if (!stream) return;
+
+    pthread_mutex_lock(&stream->lock);
+    stream->running = 0;
+    pthread_cond_broadcast(&stream->updated);
+    pthread_mutex_unlock(&stream->lock);
+
+    pthread_join(stream->thread, NULL);
+    ios_worker_stop(&stream->worker);
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->updated);
+    free_stream(stream);
+}
+
+static int wait_status(IOSFrameStream* stream) {
+    return stream->failed || !stream->running ? IOS_STREAM_FAILED : IOS_STREAM_TIMEOUT;
+}
+
+int ios_bridge_stream_next(IOSFrameStream* stream, uint64_t after_sequence, int timeout_ms,
+                           IOSBridgeReserve reserve, void* context, IOSStreamFrameInfo* info) {
+    memset(info, 0, sizeof(*info));
+    double deadline = ios_monotonic_ms() + timeout_ms;
+
+    pthread_mutex_lock(&stream->lock);
+    while (stream->sequence <= after_sequence && !stream->failed &&
+           wait_until(stream, deadline) != ETIMEDOUT) {
+    }
+
+    if (stream->sequence <= after_sequence) {
+        int status = wait_status(stream);
+        pthread_mutex_unlock(&stream->lock);
+        return status;
+    }
+
+    const IOSStreamSlot* slot = &stream->slots[stream->sequence % (uint64_t)stream->config.capacity];
+    void* target = reserve(context, slot->length);
+    if (target) {
+        memcpy(target, slot->pixels, slot->length);
+        *info = slot->info;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return target ? IOS_STREAM_OK : IOS_STREAM_FAILED;
+}
+
+int ios_bridge_stream_wait_change(IOSFrameStream* stream, uint64_t after_sequence, int timeout_ms,
+                                  uint64_t* sequence_out) {
+    double deadline = ios_monotonic_ms() + timeout_ms;
+
+    pthread_mutex_lock(&stream->lock);
+    while (stream->change_sequence <= after_sequence && !stream->failed &&
+           wait_until(stream, deadline) != ETIMEDOUT) {
+    }
+
+    int status = stream->change_sequence > after_sequence ? IOS_STREAM_OK : wait_status(stream);
+    *sequence_out = stream->change_sequence;
+    pthread_mutex_unlock(&stream->lock);
+    return status;
+}
+
+int ios_bridge_stream_wait_settled(IOSFrameStream* stream, int quiet_ms, int timeout_ms,
+                                   uint64_t* sequence_out) {
+    double deadline = ios_monotonic_ms() + timeout_ms;
+
+    // Quiet time is measured between captured frames, so a stalled capture
+    // thread can never be mistaken for a settled screen.
+    pthread_mutex_lock(&stream->lock);
+    for (;;) {
+        if (stream->sequence > 0) {
+            const IOSStreamSlot* newest = &stream->slots[stream->sequence % (uint64_t)stream->config.capacity];
+            if (newest->info.frame.captured_ms - stream->change_ms >= quiet_ms) break;
+        }
+        if (stream->failed || wait_until(stream, deadline) == ETIMEDOUT) break;
+    }
+
+    int settled = stream->sequence > 0 &&
+        stream->slots[stream->sequence % (uint64_t)stream->config.capacity].info.frame.captured_ms -
+                stream->change_ms >= quiet_ms;
+    int status = settled ? IOS_STREAM_OK : wait_status(stream);
+    *sequence_out = stream->sequence;
+    pthread_mutex_unlock(&stream->lock);
+    return status;
+}
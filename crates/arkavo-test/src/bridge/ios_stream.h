@@ -0,0 +1,74 @@
+#ifndef ARKAVO_IOS_STREAM_H
+#define ARKAVO_IOS_STREAM_H
+
+#include <stdint.h>
+
+#include "ios_impl.h"
+
+#define IOS_STREAM_OK 0
+#define IOS_STREAM_TIMEOUT 1
+#define IOS_STREAM_FAILED -1
+
+// Zero or out-of-range fields fall back to defaults: 4 fps, 4 ring slots,
+// quarter-resolution frames, 16-pixel tiles, and any changed tile counting
+// as a screen change. fps is capped at 30 but is only an upper bound: every
+// frame is a simctl screenshot, which usually takes longer than a thirtieth
+// of a second, so frames report the rate actually reached.
+typedef struct {
+    double fps;
+    int capacity;
+    double scale;
+    int tile_size;
+    int min_changed_tiles;
+} IOSStreamConfig;
+
+typedef struct {
+    IOSFrameInfo frame;
+    uint64_t sequence;
+    int changed_tiles;
+    int total_tiles;
+    int changed;
+    // Captures per second, smoothed over recent frames; 0 for the first.
+    double measured_fps;
+} IOSStreamFrameInfo;
+
+// Per-tile hashes of the previous frame, in ios_stream_tiles.c. Start from
+// zeroed memory.
+typedef struct {
+    uint64_t* current;
+    uint64_t* previous;
+    int count;
+} IOSStreamTiles;
+
+// Hashes a raw BGRA frame in tile_size pixel tiles and sets *changed to the
+// number that differ from the previous update; every tile counts as changed
+// on the first frame and whenever the tile grid changes size. Returns the
+// number of tiles, or -1 for an empty frame or when out of memory.
+int ios_stream_tiles_update(IOSStreamTiles* tiles, const uint8_t* pixels, const IOSFrameInfo* frame,
+                            int tile_size, int* changed);
+void ios_stream_tiles_free(IOSStreamTiles* tiles);
+
+typedef struct IOSFrameStream IOSFrameStream;
+
+// Starts a capture thread with its own worker, so the stream runs alongside
+// actions on the bridge and outlives nothing but its own handle.
+IOSFrameStream* ios_bridge_stream_start(void* bridge, const IOSStreamConfig* config);
+// Same, for a device chosen by the caller rather than a bridge handle.
+IOSFrameStream* ios_stream_start_device(const char* device_id, const IOSStreamConfig* config);
+void ios_bridge_stream_stop(IOSFrameStream* stream);
+
+// Copies the newest frame once one newer than after_sequence exists. Waits
+// at most timeout_ms; returns an IOS_STREAM_* code.
+int ios_bridge_stream_next(IOSFrameStream* stream, uint64_t after_sequence, int timeout_ms,
+                           IOSBridgeReserve reserve, void* context, IOSStreamFrameInfo* info);
+
+// Waits for a frame that differs from its predecessor, newer than
+// after_sequence.
+int ios_bridge_stream_wait_change(IOSFrameStream* stream, uint64_t after_sequence, int timeout_ms,
+                                  uint64_t* sequence_out);
+
+// Waits until captured frames have shown no change for quiet_ms.
+int ios_bridge_stream_wait_settled(IOSFrameStream* stream, int quiet_ms, int timeout_ms,
+                                   uint64_t* sequence_out);
+
+#endif
@@ -0,0 +1,76 @@
+#include "ios_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Exact tile hashing for the capture thread in ios_stream.c. It needs no
+// simulator, so the stub build links it too.
+
+static uint64_t hash_bytes(uint64_t hash, const uint8_t* bytes, size_t length) {
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+        bytes += 8;
+        length -= 8;
+    }
+    while (length--) hash = (hash ^ *bytes++) * 0x100000001b3ULL;
+    return hash;
+}
+
+// Hashes tiles row by row so each pixel row is read once, in order.
+static int hash_tiles(IOSStreamTiles* tiles, const uint8_t* pixels, const IOSFrameInfo* frame, int tile) {
+    int columns = (frame->width + tile - 1) / tile;
+    int rows = (frame->height + tile - 1) / tile;
+    int count = columns * rows;
+
+    if (count != tiles->count) {
+        uint64_t* current = realloc(tiles->current, sizeof(uint64_t) * (size_t)count);
+        if (current) tiles->current = current;
+        uint64_t* previous = realloc(tiles->previous, sizeof(uint64_t) * (size_t)count);
+        if (previous) tiles->previous = previous;
+        if (!current || !previous) return -1;
+    }
+
+    for (int i = 0; i < count; i++) tiles->current[i] = 0xcbf29ce484222325ULL;
+
+    for (int y = 0; y < frame->height; y++) {
+        const uint8_t* row = pixels + (size_t)y * (size_t)frame->bytes_per_row;
+        uint64_t* hashes = tiles->current + (y / tile) * columns;
+        for (int column = 0; column < columns; column++) {
+            int x = column * tile;
+            int span = frame->width - x < tile ? frame->width - x : tile;
+            hashes[column] = hash_bytes(hashes[column], row + (size_t)x * 4, (size_t)span * 4);
+        }
+    }
+    return count;
+}
+
+int ios_stream_tiles_update(IOSStreamTiles* tiles, const uint8_t* pixels, const IOSFrameInfo* frame,
+                            int tile_size, int* changed) {
+    *changed = 0;
+    if (tile_size <= 0 || frame->width <= 0 || frame->height <= 0) return -1;
+    int count = hash_tiles(tiles, pixels, frame, tile_size);
+    if (count < 0) return -1;
+
+    *changed = count;
+    if (count == tiles->count) {
+        *changed = 0;
+        for (int i = 0; i < count; i++) {
+            if (tiles->current[i] != tiles->previous[i]) (*changed)++;
+        }
+    }
+
+    uint64_t* swap = tiles->previous;
+    tiles->previous = tiles->current;
+    tiles->current = swap;
+    tiles->count = count;
+    return count;
+}
+
+void ios_stream_tiles_free(IOSStreamTiles* tiles) {
+    free(tiles->current);
+    free(tiles->previous);
+    memset(tiles, 0, sizeof(*tiles));
+}
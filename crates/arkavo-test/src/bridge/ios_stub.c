@@ -4,6 +4,16 @@
 // Stub implementations for iOS bridge functions
 // These will be replaced with actual implementations when building for iOS
 
+void* ios_bridge_create(const char* device_id, const char* bundle_id) {
+    (void)device_id;
+    (void)bundle_id;
+    return NULL;
+}
+
+void ios_bridge_destroy(void* bridge) {
+    (void)bridge;
+}
+
 char* ios_bridge_execute_action(void* bridge, const char* action, const char* params) {
     (void)bridge;
     (void)action;
@@ -11,11 +21,61 @@ char* ios_bridge_execute_action(void* bridge, const char* action, const char* pa
     return strdup("{\"status\": \"stub\"}");
 }
 
+int ios_bridge_execute_batch(void* bridge, const char* actions_json, char** results_out) {
+    (void)bridge;
+    (void)actions_json;
+    *results_out = strdup("{\"status\": \"stub\", \"results\": [], \"success\": false, "
+                          "\"executed\": 0, \"total\": 0, \"stopped_early\": false, \"total_ms\": 0}");
+    return 0;
+}
+
+typedef struct {
+    const char* data;
+    size_t length;
+    void* context;
+    void (*release)(void* context);
+} IOSBridgeBuffer;
+
+static void lend_string(IOSBridgeBuffer* out, const char* value) {
+    char* data = strdup(value);
+    out->data = data;
+    out->length = strlen(data);
+    out->context = data;
+    out->release = free;
+}
+
+int ios_bridge_execute_action_buffer(void* bridge, const char* action, const char* params, IOSBridgeBuffer* out) {
+    (void)bridge;
+    (void)action;
+    (void)params;
+    lend_string(out, "{\"status\": \"stub\"}");
+    return 0;
+}
+
+int ios_bridge_execute_batch_buffer(void* bridge, const char* actions_json, IOSBridgeBuffer* out) {
+    (void)bridge;
+    (void)actions_json;
+    lend_string(out, "{\"status\": \"stub\", \"results\": [], \"success\": false, "
+                     "\"executed\": 0, \"total\": 0, \"stopped_early\": false, \"total_ms\": 0}");
+    return 0;
+}
+
 char* ios_bridge_get_current_state(void* bridge) {
     (void)bridge;
     return strdup("{\"state\": \"stub\"}");
 }
 
+char* ios_bridge_get_state_delta(void* bridge) {
+    (void)bridge;
+    return strdup("{\"state_hash\": \"0000000000000000\", \"previous_hash\": null, \"changed\": false, "
+                  "\"inserted\": [], \"removed\": [], \"updated\": []}");
+}
+
+char* ios_bridge_analyze_screen(void* bridge) {
+    (void)bridge;
+    return strdup("{\"screen\": \"stub\", \"availableActions\": [], \"visibleElements\": [], \"elementCount\": 0}");
+}
+
 char* ios_bridge_mutate_state(void* bridge, const char* entity, const char* action, const char* data) {
     (void)bridge;
     (void)entity;
@@ -24,19 +84,193 @@ char* ios_bridge_mutate_state(void* bridge, const char* entity, const char* acti
     return strdup("{\"success\": true}");
 }
 
+// A snapshot record with no fields: magic, version 1, no entries, 16 bytes.
+static const unsigned char empty_snapshot[16] = {'A', 'R', 'K', 'S', 1, 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 0};
+
 void* ios_bridge_create_snapshot(void* bridge, size_t* size) {
     (void)bridge;
-    *size = 4;
-    void* data = malloc(4);
-    memset(data, 0, 4);
+    *size = sizeof(empty_snapshot);
+    void* data = malloc(sizeof(empty_snapshot));
+    memcpy(data, empty_snapshot, sizeof(empty_snapshot));
     return data;
 }
 
-void ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size) {
+int ios_bridge_create_snapshot_into(void* bridge, void* (*reserve)(void* context, size_t size), void* context) {
+    (void)bridge;
+    void* data = reserve(context, sizeof(empty_snapshot));
+    if (!data) return -1;
+    memcpy(data, empty_snapshot, sizeof(empty_snapshot));
+    return 0;
+}
+
+typedef struct {
+    int format;
+    int width;
+    int height;
+    int bytes_per_row;
+    double captured_ms;
+} IOSFrameInfo;
+
+// Frame capture needs a simulator, so it reports a capture failure here.
+int ios_bridge_capture_frame(void* bridge, const void* request, void* (*reserve)(void* context, size_t size),
+                             void* context, IOSFrameInfo* info) {
+    (void)bridge;
+    (void)request;
+    (void)reserve;
+    (void)context;
+    memset(info, 0, sizeof(*info));
+    return -1;
+}
+
+// Streams capture frames too, so they never start here.
+void* ios_bridge_stream_start(void* bridge, const void* config) {
+    (void)bridge;
+    (void)config;
+    return NULL;
+}
+
+void ios_bridge_stream_stop(void* stream) {
+    (void)stream;
+}
+
+int ios_bridge_stream_next(void* stream, unsigned long long after_sequence, int timeout_ms,
+                           void* (*reserve)(void* context, size_t size), void* context, void* info) {
+    (void)stream;
+    (void)after_sequence;
+    (void)timeout_ms;
+    (void)reserve;
+    (void)context;
+    (void)info;
+    return -1;
+}
+
+int ios_bridge_stream_wait_change(void* stream, unsigned long long after_sequence, int timeout_ms,
+                                  unsigned long long* sequence_out) {
+    (void)stream;
+    (void)after_sequence;
+    (void)timeout_ms;
+    *sequence_out = 0;
+    return -1;
+}
+
+int ios_bridge_stream_wait_settled(void* stream, int quiet_ms, int timeout_ms, unsigned long long* sequence_out) {
+    (void)stream;
+    (void)quiet_ms;
+    (void)timeout_ms;
+    *sequence_out = 0;
+    return -1;
+}
+
+// Pools boot simulators, so none can be created here.
+void* ios_bridge_pool_create(int size, const char* bundle_id) {
+    (void)size;
+    (void)bundle_id;
+    return NULL;
+}
+
+void ios_bridge_pool_destroy(void* pool) {
+    (void)pool;
+}
+
+int ios_bridge_pool_size(const void* pool) {
+    (void)pool;
+    return 0;
+}
+
+void* ios_bridge_pool_acquire(void* pool, int timeout_ms) {
+    (void)pool;
+    (void)timeout_ms;
+    return NULL;
+}
+
+void* ios_bridge_pool_acquire_matching(void* pool, const void* filter, int timeout_ms) {
+    (void)pool;
+    (void)filter;
+    (void)timeout_ms;
+    return NULL;
+}
+
+void ios_bridge_pool_release(void* pool, void* bridge) {
+    (void)pool;
+    (void)bridge;
+}
+
+int ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size) {
     (void)bridge;
     (void)data;
     (void)size;
-    // No-op stub
+    return 0;
+}
+
+int ios_bridge_delete_snapshot(void* bridge, const void* data, size_t size) {
+    (void)bridge;
+    (void)data;
+    (void)size;
+    return 0;
+}
+
+// Traces record and replay simulator input, so there is nothing to record.
+int ios_bridge_trace_start(void* bridge, const char* path) {
+    (void)bridge;
+    (void)path;
+    return -1;
+}
+
+int ios_bridge_trace_stop(void* bridge) {
+    (void)bridge;
+    return -1;
+}
+
+char* ios_bridge_replay_trace(void* bridge, const char* path, const char* options) {
+    (void)bridge;
+    (void)path;
+    (void)options;
+    return strdup("{\"success\": false, \"error\": \"Trace replay requires a simulator\"}");
+}
+
+// Log taps read a simulator's unified log, so none can start here.
+void* ios_bridge_log_start(void* bridge, const char* options) {
+    (void)bridge;
+    (void)options;
+    return NULL;
+}
+
+void ios_bridge_log_stop(void* tap) {
+    (void)tap;
+}
+
+char* ios_bridge_read_logs(void* tap, unsigned long long cursor, int max_entries, int timeout_ms) {
+    (void)tap;
+    (void)cursor;
+    (void)max_entries;
+    (void)timeout_ms;
+    return strdup("{\"error\": \"Log tap is not running\"}");
+}
+
+// Probes map a file inside a simulator app's container, so none can attach.
+int ios_bridge_probe_attach(void* bridge, const char* bundle_id) {
+    (void)bridge;
+    (void)bundle_id;
+    return -1;
+}
+
+void ios_bridge_probe_detach(void* bridge) {
+    (void)bridge;
+}
+
+char* ios_bridge_probe_read(void* bridge, unsigned long long cursor, int max_events, int timeout_ms) {
+    (void)bridge;
+    (void)cursor;
+    (void)max_events;
+    (void)timeout_ms;
+    return strdup("{\"error\": \"No probe is attached\"}");
+}
+
+// No backend can reach a simulator here.
+char* ios_bridge_get_backends(void* bridge, int probe) {
+    (void)bridge;
+    (void)probe;
+    return strdup("{\"backends\": []}");
 }
 
 void ios_bridge_free_string(char* s) {
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ios_impl.h"
+
+// Off macOS the stub links the real executor (ios_async.c), so submission
+// order, wait timers and cancellation on destroy behave as they do against a
+// simulator. This supplies the handle it runs on. ios_bridge_create still
+// returns NULL in the stub, so such a handle only comes from
+// ios_stub_bridge_create and never reaches the other stub entry points.
+
+void* ios_stub_bridge_create(void) {
+    IOSBridgeImpl* impl = calloc(1, sizeof(IOSBridgeImpl));
+    if (!impl) return NULL;
+    impl->executor = ios_executor_create(impl);
+    if (!impl->executor) {
+        free(impl);
+        return NULL;
+    }
+    return impl;
+}
+
+void ios_stub_bridge_destroy(void* bridge) {
+    IOSBridgeImpl* impl = bridge;
+    if (!impl) return;
+    ios_executor_destroy(impl->executor);
+    free(impl);
+}
+
+IOSBridgeImpl* ios_bridge_handle(void* bridge) {
+    return bridge;
+}
+
+// Echoes the action so callers can tell which request a reply belongs to.
+char* ios_bridge_execute_params(void* bridge, const char* action, const IOSActionParams* params) {
+    (void)bridge;
+    (void)params;
+    size_t size = strlen(action) + 40;
+    char* result = malloc(size);
+    if (result) snprintf(result, size, "{\"status\": \"stub\", \"action\": \"%s\"}", action);
+    return result;
+}
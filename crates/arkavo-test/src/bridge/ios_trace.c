@@ -0,0 +1,228 @@
+#include "ios_trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Quarter resolution is plenty for a per-cell hash and keeps each capture
+// a fraction of a full-size decode.
+#define IOS_TRACE_SCALE 0.25
+// Upper bound on waiting for the screen to hold still before a signature is
+// recorded; animations that loop forever get their latest frame.
+#define IOS_TRACE_SETTLE_MS 2000.0
+
+// Signatures are captured after the bridge is unlocked, so the recorder
+// has its own lock and simctl worker. Records are written in the order
+// their actions ran: each takes a ticket under the bridge lock and waits
+// for its turn.
+struct IOSTraceRecorder {
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    IOSWorker worker;
+    FILE* file;
+    double started_ms;
+    uint64_t issued;
+    uint64_t written;
+    // Set once a record failed to reach the file; reported by stop.
+    int failed;
+};
+
+struct IOSTracePending {
+    IOSTraceRecorder* recorder;
+    uint64_t ticket;
+    char* device_id;
+    IOSTraceRecord record;
+};
+
+typedef struct {
+    uint8_t* pixels;
+    size_t capacity;
+} IOSTraceScratch;
+
+static void* reserve_pixels(void* context, size_t size) {
+    IOSTraceScratch* scratch = context;
+    if (size > scratch->capacity) {
+        uint8_t* grown = realloc(scratch->pixels, size);
+        if (!grown) return NULL;
+        scratch->pixels = grown;
+        scratch->capacity = size;
+    }
+    return scratch->pixels;
+}
+
+int ios_trace_capture_signature(IOSWorker* worker, const char* device_id, uint32_t* signature) {
+    IOSFrameRequest request = { .format = IOS_FRAME_RAW_BGRA, .scale = IOS_TRACE_SCALE };
+    IOSTraceScratch scratch = { NULL, 0 };
+    IOSFrameInfo frame;
+    int status = ios_frame_capture(worker, device_id, &request, reserve_pixels, &scratch, &frame);
+    if (status == 0) ios_trace_signature(scratch.pixels, &frame, signature);
+    free(scratch.pixels);
+    return status;
+}
+
+// The signature is taken once the screen holds still, so a checkpoint names
+// where the action led rather than a frame of its transition.
+static int settled_signature(IOSWorker* worker, const char* device_id, uint32_t* signature) {
+    uint32_t previous[IOS_TRACE_CELLS];
+    double deadline = ios_monotonic_ms() + IOS_TRACE_SETTLE_MS;
+    if (ios_trace_capture_signature(worker, device_id, previous) != 0) return -1;
+
+    for (;;) {
+        usleep(IOS_TRACE_POLL_MS * 1000);
+        if (ios_trace_capture_signature(worker, device_id, signature) != 0) return -1;
+        if (ios_trace_signature_distance(previous, signature) == 0 || ios_monotonic_ms() >= deadline) return 0;
+        memcpy(previous, signature, sizeof(previous));
+    }
+}
+
+// Waits, queries and screenshots change nothing on the device, and replay
+// replaces waits with checkpoints, so only input is worth replaying.
+static int is_input_action(const char* action) {
+    static const char* recorded[] = {"tap", "swipe", "touch", "type_text"};
+    for (size_t i = 0; i < sizeof(recorded) / sizeof(recorded[0]); i++) {
+        if (strcmp(action, recorded[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static char* copy_bytes(const char* data, size_t length) {
+    char* copy = malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, data, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+IOSTracePending* ios_trace_record_begin(const IOSBridgeCall* call, const char* action, const IOSActionParams* params,
+                                        const char* result, double started_ms, double duration_ms) {
+    IOSTraceRecorder* recorder = call->impl->trace;
+    if (!recorder || !is_input_action(action) || !result || !ios_result_succeeded(result)) return NULL;
+
+    const char* json = "{}";
+    size_t json_length = 2;
+    if (params->object.type == IOS_JSON_OBJECT) {
+        json = params->source + params->object.start;
+        json_length = (size_t)(params->object.end - params->object.start);
+    }
+
+    IOSTracePending* pending = calloc(1, sizeof(IOSTracePending));
+    char* action_copy = pending ? strdup(action) : NULL;
+    char* params_copy = action_copy ? copy_bytes(json, json_length) : NULL;
+    char* device_id = params_copy ? strdup(call->device_id) : NULL;
+    if (!device_id) {
+        free(params_copy);
+        free(action_copy);
+        free(pending);
+        pthread_mutex_lock(&recorder->lock);
+        recorder->failed = 1;
+        pthread_mutex_unlock(&recorder->lock);
+        return NULL;
+    }
+
+    pending->recorder = recorder;
+    pending->device_id = device_id;
+    pending->record.action = action_copy;
+    pending->record.action_length = strlen(action_copy);
+    pending->record.params = params_copy;
+    pending->record.params_length = json_length;
+    pending->record.offset_ms = started_ms - recorder->started_ms;
+    pending->record.duration_ms = duration_ms;
+    pthread_mutex_lock(&recorder->lock);
+    pending->ticket = recorder->issued++;
+    pthread_mutex_unlock(&recorder->lock);
+    return pending;
+}
+
+void ios_trace_record_finish(IOSTracePending* pending) {
+    if (!pending) return;
+    IOSTraceRecorder* recorder = pending->recorder;
+    IOSTraceRecord* record = &pending->record;
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "trace.record", NULL);
+    pthread_mutex_lock(&recorder->lock);
+    while (recorder->written != pending->ticket) pthread_cond_wait(&recorder->turn, &recorder->lock);
+
+    if (settled_signature(&recorder->worker, pending->device_id, record->signature) == 0) {
+        record->flags |= IOS_TRACE_FLAG_SIGNATURE;
+    }
+    size_t size = ios_trace_record_size(record);
+    unsigned char* bytes = size ? malloc(size) : NULL;
+    if (bytes) {
+        ios_trace_record_encode(record, bytes);
+        if (fwrite(bytes, 1, size, recorder->file) != size || fflush(recorder->file) != 0) recorder->failed = 1;
+        free(bytes);
+    } else {
+        recorder->failed = 1;
+    }
+
+    recorder->written++;
+    pthread_cond_broadcast(&recorder->turn);
+    pthread_mutex_unlock(&recorder->lock);
+    ios_metrics_end(&span);
+
+    free((char*)record->action);
+    free((char*)record->params);
+    free(pending->device_id);
+    free(pending);
+}
+
+// Called with the bridge locked, which keeps new records from being issued
+// while the pending ones drain.
+static int close_recorder(IOSTraceRecorder* recorder) {
+    pthread_mutex_lock(&recorder->lock);
+    while (recorder->written != recorder->issued) pthread_cond_wait(&recorder->turn, &recorder->lock);
+    int status = recorder->failed ? -1 : 0;
+    pthread_mutex_unlock(&recorder->lock);
+
+    if (fclose(recorder->file) != 0) status = -1;
+    ios_worker_stop(&recorder->worker);
+    pthread_mutex_destroy(&recorder->lock);
+    pthread_cond_destroy(&recorder->turn);
+    free(recorder);
+    return status;
+}
+
+void ios_trace_recorder_close(IOSBridgeImpl* impl) {
+    if (!impl->trace) return;
+    close_recorder(impl->trace);
+    impl->trace = NULL;
+}
+
+int ios_bridge_trace_start(void* bridge, const char* path) {
+    if (!path) return -1;
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) return -1;
+    ios_trace_recorder_close(impl);
+
+    IOSTraceRecorder* recorder = calloc(1, sizeof(IOSTraceRecorder));
+    FILE* file = recorder ? fopen(path, "wb") : NULL;
+    unsigned char header[IOS_TRACE_HEADER_SIZE];
+    ios_trace_header_encode(header);
+    if (!file || fwrite(header, 1, sizeof(header), file) != sizeof(header) || fflush(file) != 0) {
+        if (file) fclose(file);
+        free(recorder);
+        ios_bridge_unlock(impl);
+        return -1;
+    }
+
+    pthread_mutex_init(&recorder->lock, NULL);
+    pthread_cond_init(&recorder->turn, NULL);
+    ios_worker_init(&recorder->worker);
+    recorder->file = file;
+    recorder->started_ms = ios_monotonic_ms();
+    impl->trace = recorder;
+    ios_bridge_unlock(impl);
+    return 0;
+}
+
+int ios_bridge_trace_stop(void* bridge) {
+    IOSBridgeImpl* impl = ios_bridge_lock(bridge);
+    if (!impl) return -1;
+    int status = impl->trace ? close_recorder(impl->trace) : -1;
+    impl->trace = NULL;
+    ios_bridge_unlock(impl);
+    return status;
+}
@@ -0,0 +1,113 @@
+#ifndef ARKAVO_IOS_TRACE_H
+#define ARKAVO_IOS_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ios_impl.h"
+
+// Traces are append-only files of the input actions a bridge executed, so a
+// known flow can be replayed without going back through the planner. Each
+// record is written and flushed as its action finishes, so an interrupted
+// recording keeps every step before the interruption. All integers are
+// little-endian; doubles are IEEE 754 bit patterns stored as u64:
+//
+//   file header, 16 bytes
+//   0   magic "ARKT"
+//   4   u16 version
+//   6   u16 signature columns
+//   8   u16 signature rows
+//   10  u16 reserved, zero
+//   12  u32 reserved, zero
+//
+//   each record
+//   0   u32 record size, this header included
+//   4   u16 action name length
+//   6   u16 flags
+//   8   u32 params length
+//   12  u32 reserved, zero
+//   16  f64 offset from the start of recording, in milliseconds
+//   24  f64 action duration, in milliseconds
+//   32  u32[columns * rows] screen signature after the action
+//   ..  action name, then params JSON, both without terminators
+//
+// Readers stop at a truncated final record instead of rejecting the trace.
+#define IOS_TRACE_MAGIC "ARKT"
+#define IOS_TRACE_VERSION 1
+#define IOS_TRACE_HEADER_SIZE 16
+#define IOS_TRACE_RECORD_HEADER_SIZE 32
+
+// A coarse grid keeps records small and makes a checkpoint insensitive to
+// where inside a cell something changed; a clock or a blinking caret costs
+// one cell, not a mismatch.
+#define IOS_TRACE_COLUMNS 8
+#define IOS_TRACE_ROWS 16
+#define IOS_TRACE_CELLS (IOS_TRACE_COLUMNS * IOS_TRACE_ROWS)
+
+// The record carries a screen signature; without it replay cannot check the
+// step and moves straight on.
+#define IOS_TRACE_FLAG_SIGNATURE 0x0001
+
+// Pause between screen samples while waiting on a signature. Each sample is
+// a simctl screenshot, so this only keeps a fast capture from spinning.
+#define IOS_TRACE_POLL_MS 20
+
+typedef struct {
+    const char* action;
+    size_t action_length;
+    const char* params;
+    size_t params_length;
+    unsigned int flags;
+    double offset_ms;
+    double duration_ms;
+    uint32_t signature[IOS_TRACE_CELLS];
+} IOSTraceRecord;
+
+// The format and signature functions, in ios_trace_format.c, need no handle.
+// Writes the IOS_TRACE_HEADER_SIZE byte file header into out.
+void ios_trace_header_encode(void* out);
+// Bytes for one encoded record, or 0 when it cannot be encoded.
+size_t ios_trace_record_size(const IOSTraceRecord* record);
+// Writes exactly ios_trace_record_size(record) bytes into out.
+void ios_trace_record_encode(const IOSTraceRecord* record, void* out);
+// Validates the file header. Returns 0 for a trace this reader understands.
+int ios_trace_validate(const void* data, size_t size);
+// Decodes the record at *offset and advances it. Strings in the record point
+// into data. Returns 1 for a record, 0 at the end of the trace, -1 when the
+// record is malformed.
+int ios_trace_next(const void* data, size_t size, size_t* offset, IOSTraceRecord* record);
+
+// Signature of a raw BGRA frame: one hash per grid cell.
+void ios_trace_signature(const uint8_t* pixels, const IOSFrameInfo* frame, uint32_t* signature);
+// Number of cells that differ between two signatures.
+int ios_trace_signature_distance(const uint32_t* a, const uint32_t* b);
+// Captures the screen of device_id into signature. Returns 0 or a negative
+// IOS_FRAME_ERROR_* code.
+int ios_trace_capture_signature(IOSWorker* worker, const char* device_id, uint32_t* signature);
+
+// Recording is split around the end of the call: ios_bridge_execute_params
+// takes a pending record after every action while it still holds the
+// bridge, which is NULL unless a successful input action is being recorded,
+// then lets go of the bridge before finishing it. Finishing waits for the
+// screen to settle, which takes several screenshots that other callers of
+// the bridge need not wait for, and writes the record.
+typedef struct IOSTracePending IOSTracePending;
+IOSTracePending* ios_trace_record_begin(const IOSBridgeCall* call, const char* action, const IOSActionParams* params,
+                                        const char* result, double started_ms, double duration_ms);
+void ios_trace_record_finish(IOSTracePending* pending);
+// Waits for pending records; called with the bridge locked.
+void ios_trace_recorder_close(IOSBridgeImpl* impl);
+
+// Starts recording into path, replacing any file there, and stops any
+// recording already running on the bridge. Returns 0 on success.
+int ios_bridge_trace_start(void* bridge, const char* path);
+// Stops recording. Returns 0, or -1 when the bridge was not recording or the
+// trace could not be completely written.
+int ios_bridge_trace_stop(void* bridge);
+
+// Replays the trace at path on the bridge, holding it for the whole replay
+// like a batch. options is a JSON object or NULL; see ios_replay.c. Returns a
+// JSON report, freed with ios_bridge_free_string.
+char* ios_bridge_replay_trace(void* bridge, const char* path, const char* options);
+
+#endif
@@ -0,0 +1,132 @@
+#include "ios_trace.h"
+
+#include <string.h>
+
+// The trace file format and screen signatures, which need no handle;
+// ios_trace.c records through the bridge and ios_replay.c plays back.
+
+static void put_u16(unsigned char* out, uint16_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void put_f64(unsigned char* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++) out[i] = (unsigned char)(bits >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static double get_f64(const unsigned char* in) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) bits |= (uint64_t)in[i] << (8 * i);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static size_t fixed_size(void) {
+    return IOS_TRACE_RECORD_HEADER_SIZE + IOS_TRACE_CELLS * sizeof(uint32_t);
+}
+
+size_t ios_trace_record_size(const IOSTraceRecord* record) {
+    if (record->action_length > UINT16_MAX || record->params_length > UINT32_MAX - fixed_size()) return 0;
+    size_t size = fixed_size() + record->action_length + record->params_length;
+    return size <= UINT32_MAX ? size : 0;
+}
+
+void ios_trace_record_encode(const IOSTraceRecord* record, void* out) {
+    unsigned char* bytes = out;
+    size_t size = ios_trace_record_size(record);
+    put_u32(bytes, (uint32_t)size);
+    put_u16(bytes + 4, (uint16_t)record->action_length);
+    put_u16(bytes + 6, (uint16_t)record->flags);
+    put_u32(bytes + 8, (uint32_t)record->params_length);
+    put_u32(bytes + 12, 0);
+    put_f64(bytes + 16, record->offset_ms);
+    put_f64(bytes + 24, record->duration_ms);
+
+    unsigned char* cells = bytes + IOS_TRACE_RECORD_HEADER_SIZE;
+    for (int i = 0; i < IOS_TRACE_CELLS; i++) put_u32(cells + 4 * i, record->signature[i]);
+    unsigned char* strings = bytes + fixed_size();
+    memcpy(strings, record->action, record->action_length);
+    if (record->params_length) memcpy(strings + record->action_length, record->params, record->params_length);
+}
+
+void ios_trace_header_encode(void* out) {
+    unsigned char* bytes = out;
+    memset(bytes, 0, IOS_TRACE_HEADER_SIZE);
+    memcpy(bytes, IOS_TRACE_MAGIC, 4);
+    put_u16(bytes + 4, IOS_TRACE_VERSION);
+    put_u16(bytes + 6, IOS_TRACE_COLUMNS);
+    put_u16(bytes + 8, IOS_TRACE_ROWS);
+}
+
+int ios_trace_validate(const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    if (size < IOS_TRACE_HEADER_SIZE || memcmp(bytes, IOS_TRACE_MAGIC, 4) != 0) return -1;
+    if (get_u16(bytes + 4) != IOS_TRACE_VERSION) return -1;
+    return get_u16(bytes + 6) == IOS_TRACE_COLUMNS && get_u16(bytes + 8) == IOS_TRACE_ROWS ? 0 : -1;
+}
+
+int ios_trace_next(const void* data, size_t size, size_t* offset, IOSTraceRecord* record) {
+    // A recording cut off mid-write leaves a partial record, which ends the
+    // trace rather than invalidating the steps before it.
+    if (*offset >= size || size - *offset < IOS_TRACE_RECORD_HEADER_SIZE) return 0;
+
+    const unsigned char* bytes = (const unsigned char*)data + *offset;
+    size_t record_size = get_u32(bytes);
+    size_t action_length = get_u16(bytes + 4);
+    size_t params_length = get_u32(bytes + 8);
+    if (params_length > UINT32_MAX - fixed_size() - action_length) return -1;
+    if (record_size != fixed_size() + action_length + params_length) return -1;
+    if (record_size > size - *offset) return 0;
+
+    record->action_length = action_length;
+    record->params_length = params_length;
+    record->flags = get_u16(bytes + 6);
+    record->offset_ms = get_f64(bytes + 16);
+    record->duration_ms = get_f64(bytes + 24);
+    const unsigned char* cells = bytes + IOS_TRACE_RECORD_HEADER_SIZE;
+    for (int i = 0; i < IOS_TRACE_CELLS; i++) record->signature[i] = get_u32(cells + 4 * i);
+    record->action = (const char*)bytes + fixed_size();
+    record->params = record->action + action_length;
+
+    *offset += record_size;
+    return 1;
+}
+
+void ios_trace_signature(const uint8_t* pixels, const IOSFrameInfo* frame, uint32_t* signature) {
+    for (int i = 0; i < IOS_TRACE_CELLS; i++) signature[i] = 2166136261u;
+    if (frame->width <= 0 || frame->height <= 0) return;
+
+    for (int y = 0; y < frame->height; y++) {
+        const uint8_t* row = pixels + (size_t)y * (size_t)frame->bytes_per_row;
+        uint32_t* cells = signature + (y * IOS_TRACE_ROWS / frame->height) * IOS_TRACE_COLUMNS;
+        for (int x = 0; x < frame->width; x++) {
+            uint32_t* cell = &cells[x * IOS_TRACE_COLUMNS / frame->width];
+            uint32_t pixel;
+            memcpy(&pixel, row + (size_t)x * 4, sizeof(pixel));
+            *cell = (*cell ^ pixel) * 16777619u;
+        }
+    }
+}
+
+int ios_trace_signature_distance(const uint32_t* a, const uint32_t* b) {
+    int distance = 0;
+    for (int i = 0; i < IOS_TRACE_CELLS; i++) {
+        if (a[i] != b[i]) distance++;
+    }
+    return distance;
+}
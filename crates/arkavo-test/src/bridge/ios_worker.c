@@ -0,0 +1,399 @@
+#include "ios_impl.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#define IOS_WORKER_TIMEOUT_MS 30000
+// Copying or installing a large app, erasing or creating a device.
+#define IOS_WORKER_SLOW_TIMEOUT_MS 300000
+#define IOS_WORKER_RETRY_SECONDS 5
+// Returned once a command has been handed to the worker but no status came
+// back; the command may have run, so it must not be replayed through popen.
+#define IOS_WORKER_LOST -2
+
+void ios_worker_init(IOSWorker* worker) {
+    worker->pid = -1;
+    worker->in_fd = -1;
+    worker->out_fd = -1;
+    worker->healthy = 0;
+    worker->retry_after = 0;
+    worker->nonce[0] = '\0';
+    worker->simctl_path[0] = '\0';
+}
+
+void ios_worker_stop(IOSWorker* worker) {
+    if (worker->in_fd >= 0) close(worker->in_fd);
+    if (worker->out_fd >= 0) close(worker->out_fd);
+    if (worker->pid > 0) {
+        kill(worker->pid, SIGKILL);
+        waitpid(worker->pid, NULL, 0);
+    }
+    worker->pid = -1;
+    worker->in_fd = -1;
+    worker->out_fd = -1;
+    worker->healthy = 0;
+}
+
+static void worker_mark_unhealthy(IOSWorker* worker) {
+    ios_worker_stop(worker);
+    worker->retry_after = time(NULL) + IOS_WORKER_RETRY_SECONDS;
+}
+
+static int write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+static const char* find_bytes(const char* haystack, size_t length, const char* needle, size_t needle_length) {
+    if (needle_length > length) return NULL;
+    for (size_t i = 0; i + needle_length <= length; i++) {
+        if (haystack[i] == needle[0] && memcmp(haystack + i, needle, needle_length) == 0) {
+            return haystack + i;
+        }
+    }
+    return NULL;
+}
+
+// Each command is followed by a sentinel line carrying a per-worker nonce and
+// the exit status, so output is framed without relying on it being text. A
+// command still running timeout_ms after it was sent (never, when negative)
+// is taken as hung and the worker replaced.
+static int worker_exec(IOSWorker* worker, const char* command, int timeout_ms, IOSCommandOutput* output) {
+    char marker[32];
+    int marker_length = snprintf(marker, sizeof(marker), "\036ARKAVO:%s:", worker->nonce);
+
+    size_t script_size = strlen(command) + 96;
+    char* script = malloc(script_size);
+    if (!script) return -1;
+    snprintf(script, script_size,
+             "{ %s\n} </dev/null\nprintf '\\036ARKAVO:%s:%%d\\n' \"$?\"\n",
+             command, worker->nonce);
+
+    int sent = write_all(worker->in_fd, script, strlen(script));
+    free(script);
+    if (sent != 0) {
+        worker_mark_unhealthy(worker);
+        return -1;
+    }
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    size_t scanned = 0;
+    char* buffer = malloc(capacity);
+    if (!buffer) {
+        worker_mark_unhealthy(worker);
+        return -1;
+    }
+
+    double deadline = ios_monotonic_ms() + timeout_ms;
+    for (;;) {
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            double left = deadline - ios_monotonic_ms();
+            if (left <= 0) break;
+            wait_ms = (int)left + 1;
+        }
+        struct pollfd pfd = { .fd = worker->out_fd, .events = POLLIN, .revents = 0 };
+        int ready = poll(&pfd, 1, wait_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) break;
+
+        if (capacity - length < 4096) {
+            char* grown = realloc(buffer, capacity * 2);
+            if (!grown) break;
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        ssize_t received = read(worker->out_fd, buffer + length, capacity - length - 1);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        length += (size_t)received;
+
+        const char* found = find_bytes(buffer + scanned, length - scanned, marker, (size_t)marker_length);
+        if (!found) {
+            scanned = length > (size_t)marker_length ? length - (size_t)marker_length : 0;
+            continue;
+        }
+
+        const char* status_start = found + marker_length;
+        const char* line_end = memchr(status_start, '\n', (size_t)(buffer + length - status_start));
+        if (!line_end) {
+            scanned = (size_t)(found - buffer);
+            continue;
+        }
+
+        int status = atoi(status_start);
+        size_t output_length = (size_t)(found - buffer);
+        if (output) {
+            buffer[output_length] = '\0';
+            output->data = buffer;
+            output->length = output_length;
+        } else {
+            free(buffer);
+        }
+        return status;
+    }
+
+    free(buffer);
+    worker_mark_unhealthy(worker);
+    return IOS_WORKER_LOST;
+}
+
+static int worker_spawn(IOSWorker* worker) {
+
+    int to_child[2];
+    int from_child[2];
+    if (pipe(to_child) != 0) return -1;
+    if (pipe(from_child) != 0) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, to_child[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, from_child[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addclose(&actions, to_child[1]);
+    posix_spawn_file_actions_addclose(&actions, from_child[0]);
+
+    char* argv[] = { "sh", "-s", NULL };
+    pid_t pid = -1;
+    int spawned = posix_spawn(&pid, "/bin/sh", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(to_child[0]);
+    close(from_child[1]);
+
+    if (spawned != 0) {
+        close(to_child[1]);
+        close(from_child[0]);
+        worker->retry_after = time(NULL) + IOS_WORKER_RETRY_SECONDS;
+        return -1;
+    }
+
+    fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETNOSIGPIPE
+    fcntl(to_child[1], F_SETNOSIGPIPE, 1);
+#endif
+
+    worker->pid = pid;
+    worker->in_fd = to_child[1];
+    worker->out_fd = from_child[0];
+    worker->healthy = 1;
+
+    unsigned char random_bytes[8];
+    arc4random_buf(random_bytes, sizeof(random_bytes));
+    for (size_t i = 0; i < sizeof(random_bytes); i++) {
+        snprintf(worker->nonce + i * 2, 3, "%02x", random_bytes[i]);
+    }
+
+    // Resolving simctl once lets later commands skip the xcrun lookup.
+    IOSCommandOutput found = { NULL, 0 };
+    if (worker_exec(worker, "xcrun --find simctl", IOS_WORKER_TIMEOUT_MS, &found) == 0 && found.data) {
+        size_t path_length = strcspn(found.data, "\r\n");
+        if (path_length > 0 && path_length < sizeof(worker->simctl_path)) {
+            memcpy(worker->simctl_path, found.data, path_length);
+            worker->simctl_path[path_length] = '\0';
+        }
+    }
+    ios_command_output_free(&found);
+
+    return worker->healthy ? 0 : -1;
+}
+
+int ios_worker_start(IOSWorker* worker) {
+    if (worker->healthy) return 0;
+    if (time(NULL) < worker->retry_after) return -1;
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "worker.spawn", NULL);
+    int status = worker_spawn(worker);
+    ios_metrics_end(&span);
+    return status;
+}
+
+// Each fallback pays for a fresh shell and xcrun lookup, which is what the
+// separate "simctl.popen" histogram makes visible.
+static int popen_simctl(const char* feed, const char* args, IOSCommandOutput* output) {
+    size_t command_size = strlen(feed) + strlen(args) + 32;
+    char* command = malloc(command_size);
+    if (!command) return -1;
+    snprintf(command, command_size, "%sxcrun simctl %s 2>/dev/null", feed, args);
+
+    FILE* pipe = popen(command, "r");
+    free(command);
+    if (!pipe) return -1;
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* buffer = malloc(capacity);
+    while (buffer) {
+        if (capacity - length < 4096) {
+            char* grown = realloc(buffer, capacity * 2);
+            if (!grown) {
+                free(buffer);
+                buffer = NULL;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        size_t received = fread(buffer + length, 1, capacity - length - 1, pipe);
+        if (received == 0) break;
+        length += received;
+    }
+
+    int status = pclose(pipe);
+    if (output && buffer) {
+        buffer[length] = '\0';
+        output->data = buffer;
+        output->length = length;
+    } else {
+        free(buffer);
+    }
+
+    if (status == -1 || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+int ios_bridge_run_simctl(IOSBridgeImpl* impl, const char* args, IOSCommandOutput* output) {
+    return ios_worker_run_simctl(&impl->worker, args, output);
+}
+
+static int verb_is(const char* args, size_t length, const char* verb) {
+    return strlen(verb) == length && strncmp(args, verb, length) == 0;
+}
+
+// Booting a simulator on a cold runtime can take minutes, and bootstatus
+// prints nothing until the device is up, so those two wait as long as the
+// boot does, the same as they would under popen.
+static int command_timeout_ms(const char* args) {
+    size_t length = strcspn(args, " ");
+    if (verb_is(args, length, "boot") || verb_is(args, length, "bootstatus")) return -1;
+    static const char* slow[] = {"clone", "create", "erase", "install"};
+    for (size_t i = 0; i < sizeof(slow) / sizeof(slow[0]); i++) {
+        if (verb_is(args, length, slow[i])) return IOS_WORKER_SLOW_TIMEOUT_MS;
+    }
+    return IOS_WORKER_TIMEOUT_MS;
+}
+
+// feed is a shell pipeline stage ending in "| " that produces simctl's
+// stdin, or "" for none.
+static int run_simctl(IOSWorker* worker, const char* feed, const char* args, IOSCommandOutput* output) {
+    if (output) {
+        output->data = NULL;
+        output->length = 0;
+    }
+
+    if (ios_worker_start(worker) == 0) {
+        char* tool = worker->simctl_path[0] ? ios_shell_quote(worker->simctl_path) : strdup("xcrun simctl");
+        if (tool) {
+            size_t command_size = strlen(feed) + strlen(tool) + strlen(args) + 2;
+            char* command = malloc(command_size);
+            if (command) {
+                snprintf(command, command_size, "%s%s %s", feed, tool, args);
+                int status = worker_exec(worker, command, command_timeout_ms(args), output);
+                free(command);
+                free(tool);
+                if (status == IOS_WORKER_LOST) return -1;
+                if (status >= 0) return status;
+            } else {
+                free(tool);
+            }
+        }
+    }
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "simctl.popen", NULL);
+    int status = popen_simctl(feed, args, output);
+    ios_metrics_end(&span);
+    return status;
+}
+
+// "simctl.<verb>" covers the whole command, including a popen fallback.
+static int timed_simctl(IOSWorker* worker, const char* feed, const char* args, IOSCommandOutput* output) {
+    char verb[24];
+    size_t length = strcspn(args, " ");
+    snprintf(verb, sizeof(verb), "%.*s", (int)length, args);
+
+    IOSMetricsSpan span;
+    ios_metrics_begin(&span, "simctl", verb);
+    int status = run_simctl(worker, feed, args, output);
+    ios_metrics_end(&span);
+    return status;
+}
+
+int ios_worker_run_simctl(IOSWorker* worker, const char* args, IOSCommandOutput* output) {
+    return timed_simctl(worker, "", args, output);
+}
+
+// printf is a shell builtin, so input of any size reaches simctl without
+// passing through an exec argument list.
+int ios_worker_run_simctl_input(IOSWorker* worker, const char* args, const char* input, IOSCommandOutput* output) {
+    char* quoted = ios_shell_quote(input);
+    if (!quoted) return -1;
+    size_t feed_size = strlen(quoted) + 16;
+    char* feed = malloc(feed_size);
+    if (!feed) {
+        free(quoted);
+        return -1;
+    }
+    snprintf(feed, feed_size, "printf %%s %s | ", quoted);
+    free(quoted);
+
+    int status = timed_simctl(worker, feed, args, output);
+    free(feed);
+    return status;
+}
+
+int ios_worker_run_device_command(IOSWorker* worker, const char* device_id, const char* verb, const char* rest,
+                                  IOSCommandOutput* output) {
+    if (output) {
+        output->data = NULL;
+        output->length = 0;
+    }
+
+    char* device = ios_shell_quote(device_id);
+    if (!device) return -1;
+
+    size_t args_size = strlen(verb) + strlen(device) + strlen(rest) + 3;
+    char* args = malloc(args_size);
+    if (!args) {
+        free(device);
+        return -1;
+    }
+    snprintf(args, args_size, "%s %s %s", verb, device, rest);
+
+    int status = ios_worker_run_simctl(worker, args, output);
+    free(args);
+    free(device);
+    return status;
+}
+
+void ios_command_output_free(IOSCommandOutput* output) {
+    free(output->data);
+    output->data = NULL;
+    output->length = 0;
+}
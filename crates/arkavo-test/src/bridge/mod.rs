@@ -1 +1,16 @@
 pub mod ios_ffi;
+pub mod ios_ffi_async;
+pub mod ios_ffi_backend;
+pub mod ios_ffi_batch;
+pub mod ios_ffi_buffer;
+pub mod ios_ffi_delta;
+pub mod ios_ffi_diff;
+pub mod ios_ffi_frame;
+pub mod ios_ffi_lifecycle;
+pub mod ios_ffi_log;
+pub mod ios_ffi_metrics;
+pub mod ios_ffi_pool;
+pub mod ios_ffi_probe;
+pub mod ios_ffi_screen;
+pub mod ios_ffi_stream;
+pub mod ios_ffi_trace;
@@ -1,6 +1,8 @@
 pub mod intelligent_runner;
 pub mod runner;
 pub mod snapshot;
+pub mod snapshot_format;
+pub mod snapshot_store;
 pub mod state;
 
 pub use intelligent_runner::{
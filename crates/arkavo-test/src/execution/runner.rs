@@ -1,14 +1,18 @@
 use crate::bridge::ios_ffi::RustTestHarness;
+use crate::bridge::ios_ffi_batch::BridgeAction;
+use crate::bridge::ios_ffi_pool::BridgePool;
 use crate::gherkin::parser::{Scenario, Step};
 use crate::reporting::business_report::{ScenarioResult, StepResult, TestStatus};
 use crate::{Result, TestError};
+use std::collections::VecDeque;
 use std::sync::Arc;
 use std::time::{Duration, Instant};
-use tokio::sync::RwLock;
+use tokio::sync::{Mutex, RwLock};
 
 pub struct TestRunner {
     harness: Arc<RwLock<RustTestHarness>>,
     results: Arc<RwLock<Vec<TestResult>>>,
+    pool: Option<Arc<BridgePool>>,
 }
 
 impl TestRunner {
@@ -16,6 +20,16 @@ impl TestRunner {
         Self {
             harness: Arc::new(RwLock::new(RustTestHarness::new())),
             results: Arc::new(RwLock::new(Vec::new())),
+            pool: None,
+        }
+    }
+
+    /// A runner whose parallel scenarios are spread across the simulators of
+    /// `pool`, each scenario running on a device of its own.
+    pub fn with_pool(pool: Arc<BridgePool>) -> Self {
+        Self {
+            pool: Some(pool),
+            ..Self::new()
         }
     }
 
@@ -35,18 +49,47 @@ impl TestRunner {
             harness.checkpoint("scenario_start")?;
         }
 
-        for step in &scenario.steps {
-            let step_result = self.execute_step(step).await?;
+        let planned: Vec<Option<Vec<BridgeAction>>> =
+            scenario.steps.iter().map(step_actions).collect();
 
-            if step_result.status == TestStatus::Failed {
-                result.status = TestStatus::Failed;
-
-                let minimal = self.minimize_failure(&scenario, step).await?;
-                result.minimal_reproduction = Some(minimal);
+        let mut index = 0;
+        while index < scenario.steps.len() {
+            let first = index;
+            // Consecutive steps that carry bridge actions run as one native batch
+            let batch_end = planned[index..]
+                .iter()
+                .position(Option::is_none)
+                .map_or(scenario.steps.len(), |offset| index + offset);
+
+            let step_results = if batch_end > index {
+                let results = self
+                    .execute_step_batch(
+                        &scenario.steps[index..batch_end],
+                        &planned[index..batch_end],
+                    )
+                    .await?;
+                index = batch_end;
+                results
+            } else {
+                let results = vec![self.execute_step(&scenario.steps[index]).await?];
+                index += 1;
+                results
+            };
+
+            // Results come back in step order from `first`; scenarios may
+            // repeat a step's text, so it cannot identify the failing one.
+            for (offset, step_result) in step_results.into_iter().enumerate() {
+                if step_result.status == TestStatus::Failed && result.status != TestStatus::Failed {
+                    result.status = TestStatus::Failed;
+
+                    let step = &scenario.steps[first + offset];
+                    let minimal = self.minimize_failure(&scenario, step).await?;
+                    result.minimal_reproduction = Some(minimal);
+                }
+
+                result.steps.push(step_result);
             }
 
-            result.steps.push(step_result);
-
             if result.status == TestStatus::Failed {
                 break;
             }
@@ -89,6 +132,73 @@ impl TestRunner {
         Ok(result)
     }
 
+    /// Run the bridge actions of several steps in a single batch, stopping at
+    /// the first failing action. Steps after the failure are not reported, the
+    /// same as when steps run one at a time.
+    async fn execute_step_batch(
+        &self,
+        steps: &[Step],
+        planned: &[Option<Vec<BridgeAction>>],
+    ) -> Result<Vec<StepResult>> {
+        let mut actions = Vec::new();
+        let mut ranges = Vec::with_capacity(steps.len());
+        for step_actions in planned.iter().flatten() {
+            ranges.push(actions.len()..actions.len() + step_actions.len());
+            actions.extend_from_slice(step_actions);
+        }
+
+        let batch = {
+            let harness = self.harness.read().await;
+            harness.execute_batch(&actions, true)
+        };
+
+        let mut step_results = Vec::with_capacity(steps.len());
+        for (step, range) in steps.iter().zip(ranges) {
+            let mut step_result = StepResult {
+                keyword: step.keyword.to_string(),
+                text: step.text.clone(),
+                status: TestStatus::Passed,
+                error: None,
+                screenshot_path: None,
+                duration: Duration::from_secs(0),
+            };
+
+            match &batch {
+                Ok(batch) => {
+                    if range.start >= batch.results.len() && !range.is_empty() {
+                        break;
+                    }
+
+                    let executed = &batch.results
+                        [range.start.min(batch.results.len())..range.end.min(batch.results.len())];
+                    let millis: f64 = executed.iter().map(|r| r.duration_ms).sum();
+                    step_result.duration = Duration::from_secs_f64(millis / 1000.0);
+
+                    if let Some(failed) = executed.iter().find(|r| !r.success) {
+                        step_result.status = TestStatus::Failed;
+                        step_result.error = Some(format!(
+                            "Action {} failed: {}",
+                            failed.action.as_deref().unwrap_or("<unnamed>"),
+                            failed.result
+                        ));
+                    }
+                }
+                Err(e) => {
+                    step_result.status = TestStatus::Failed;
+                    step_result.error = Some(e.to_string());
+                }
+            }
+
+            let failed = step_result.status == TestStatus::Failed;
+            step_results.push(step_result);
+            if failed {
+                break;
+            }
+        }
+
+        Ok(step_results)
+    }
+
     async fn execute_step_action(&self, _step: &Step) -> Result<()> {
         tokio::time::sleep(Duration::from_millis(100)).await;
         Ok(())
@@ -120,6 +230,10 @@ impl TestRunner {
         &self,
         scenarios: Vec<Scenario>,
     ) -> Result<Vec<ScenarioResult>> {
+        if let Some(pool) = &self.pool {
+            return self.run_on_pool(pool.clone(), scenarios).await;
+        }
+
         let mut handles = Vec::new();
 
         for scenario in scenarios {
@@ -140,6 +254,62 @@ impl TestRunner {
         Ok(results)
     }
 
+    /// One worker per simulator pulls scenarios off a shared queue, so a
+    /// device that finishes early takes on the next scenario instead of
+    /// idling behind a fixed split. Results keep the input order.
+    async fn run_on_pool(
+        &self,
+        pool: Arc<BridgePool>,
+        scenarios: Vec<Scenario>,
+    ) -> Result<Vec<ScenarioResult>> {
+        let total = scenarios.len();
+        let queue = Arc::new(Mutex::new(
+            scenarios.into_iter().enumerate().collect::<VecDeque<_>>(),
+        ));
+
+        let mut handles = Vec::new();
+        for _ in 0..pool.size().min(total) {
+            let pool = pool.clone();
+            let queue = queue.clone();
+            let results = self.results.clone();
+            handles.push(tokio::spawn(async move {
+                let lease = tokio::task::spawn_blocking(move || pool.acquire(None))
+                    .await
+                    .map_err(|e| TestError::Execution(format!("Task join error: {}", e)))??;
+                let runner = TestRunner {
+                    harness: Arc::new(RwLock::new(lease.harness())),
+                    results,
+                    pool: None,
+                };
+
+                let mut finished = Vec::new();
+                loop {
+                    let next = queue.lock().await.pop_front();
+                    let Some((index, scenario)) = next else {
+                        break;
+                    };
+                    finished.push((index, runner.run_scenario(scenario).await?));
+                }
+                Ok::<_, TestError>(finished)
+            }));
+        }
+
+        let mut ordered: Vec<Option<ScenarioResult>> = (0..total).map(|_| None).collect();
+        for handle in handles {
+            match handle.await {
+                Ok(Ok(finished)) => {
+                    for (index, result) in finished {
+                        ordered[index] = Some(result);
+                    }
+                }
+                Ok(Err(e)) => return Err(e),
+                Err(e) => return Err(TestError::Execution(format!("Task join error: {}", e))),
+            }
+        }
+
+        Ok(ordered.into_iter().flatten().collect())
+    }
+
     pub async fn inject_dynamic_test(&self, test_code: &str) -> Result<TestResult> {
         let test_id = uuid::Uuid::new_v4().to_string();
 
@@ -169,10 +339,19 @@ impl Clone for TestRunner {
         Self {
             harness: self.harness.clone(),
             results: self.results.clone(),
+            pool: self.pool.clone(),
         }
     }
 }
 
+/// Bridge actions carried by a step as a JSON doc string, either a single
+/// `{"action": ..., "params": ...}` object or an array of them.
+fn step_actions(step: &Step) -> Option<Vec<BridgeAction>> {
+    step.doc_string
+        .as_deref()
+        .and_then(BridgeAction::parse_list)
+}
+
 #[derive(Debug, Clone)]
 pub struct TestResult {
     pub id: String,
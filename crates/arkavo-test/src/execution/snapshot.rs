@@ -1,3 +1,5 @@
+use super::snapshot_format::{SnapshotField, SnapshotRecord};
+use super::snapshot_store::{Blob, SnapshotStore};
 use crate::{Result, TestError};
 use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
@@ -20,13 +22,22 @@ pub struct SnapshotNode {
     pub tags: Vec<String>,
 }
 
+/// Node payloads live in a [`SnapshotStore`] rather than in the nodes, so
+/// branches that differ by a few bytes share the rest of their data. The
+/// nodes returned to callers carry a copy of their payload.
 pub struct SnapshotManager {
     nodes: Arc<RwLock<HashMap<String, SnapshotNode>>>,
+    payloads: Arc<RwLock<HashMap<String, Blob>>>,
+    store: SnapshotStore,
     current_branch: Arc<RwLock<String>>,
 }
 
 impl SnapshotManager {
     pub fn new() -> Self {
+        Self::with_store(SnapshotStore::shared())
+    }
+
+    pub fn with_store(store: SnapshotStore) -> Self {
         let root_id = uuid::Uuid::new_v4().to_string();
         let root_node = SnapshotNode {
             id: root_id.clone(),
@@ -43,6 +54,8 @@ impl SnapshotManager {
 
         Self {
             nodes: Arc::new(RwLock::new(nodes)),
+            payloads: Arc::new(RwLock::new(HashMap::new())),
+            store,
             current_branch: Arc::new(RwLock::new(root_id)),
         }
     }
@@ -60,10 +73,11 @@ impl SnapshotManager {
             name: name.to_string(),
             parent_id: Some(current_id.clone()),
             children: Vec::new(),
-            data,
+            data: Vec::new(),
             timestamp: chrono::Utc::now(),
-            tags: Vec::new(),
+            tags: index_tags(&data),
         };
+        self.store_payload(&new_id, &data)?;
 
         let mut nodes = self
             .nodes
@@ -126,7 +140,8 @@ impl SnapshotManager {
 
         drop(nodes);
 
-        let merged_data = self.merge_data(&source.data, &target.data)?;
+        let merged_data =
+            self.merge_data(&self.payload(&source.id)?, &self.payload(&target.id)?)?;
 
         let merged_id = uuid::Uuid::new_v4().to_string();
         let merged_node = SnapshotNode {
@@ -134,10 +149,11 @@ impl SnapshotManager {
             name: format!("merge_{}", chrono::Utc::now().timestamp()),
             parent_id: Some(target_id.to_string()),
             children: Vec::new(),
-            data: merged_data,
+            data: Vec::new(),
             timestamp: chrono::Utc::now(),
             tags: vec!["merge".to_string()],
         };
+        self.store_payload(&merged_id, &merged_data)?;
 
         let mut nodes = self
             .nodes
@@ -171,8 +187,13 @@ impl SnapshotManager {
             }
         }
 
+        drop(nodes);
+
         history.reverse();
-        Ok(history)
+        history
+            .into_iter()
+            .map(|node| self.with_payload(node))
+            .collect()
     }
 
     pub fn tag_snapshot(&self, snapshot_id: &str, tag: &str) -> Result<()> {
@@ -203,8 +224,41 @@ impl SnapshotManager {
             .filter(|node| node.tags.contains(&tag.to_string()))
             .cloned()
             .collect();
+        drop(nodes);
+
+        tagged
+            .into_iter()
+            .map(|node| self.with_payload(node))
+            .collect()
+    }
+
+    /// Fields that differ between two snapshots taken by a bridge.
+    pub fn diff(&self, from_id: &str, to_id: &str) -> Result<Vec<SnapshotField>> {
+        let from = self.payload(from_id)?;
+        let to = self.payload(to_id)?;
+        Ok(SnapshotRecord::parse(&from)?.diff(&SnapshotRecord::parse(&to)?))
+    }
+
+    fn store_payload(&self, id: &str, data: &[u8]) -> Result<()> {
+        let blob = self.store.put(data)?;
+        self.payloads
+            .write()
+            .map_err(|e| TestError::Execution(format!("Failed to write payloads: {}", e)))?
+            .insert(id.to_string(), blob);
+        Ok(())
+    }
 
-        Ok(tagged)
+    fn payload(&self, id: &str) -> Result<Vec<u8>> {
+        let payloads = self
+            .payloads
+            .read()
+            .map_err(|e| TestError::Execution(format!("Failed to read payloads: {}", e)))?;
+        payloads.get(id).map_or(Ok(Vec::new()), Blob::read)
+    }
+
+    fn with_payload(&self, mut node: SnapshotNode) -> Result<SnapshotNode> {
+        node.data = self.payload(&node.id)?;
+        Ok(node)
     }
 
     fn merge_data(&self, _source: &[u8], target: &[u8]) -> Result<Vec<u8>> {
@@ -212,6 +266,25 @@ impl SnapshotManager {
     }
 }
 
+/// Bridge snapshots are tagged with the device and screen they were taken on,
+/// so `find_by_tag("screen:Login")` finds them without reading any payload.
+fn index_tags(data: &[u8]) -> Vec<String> {
+    let Ok(record) = SnapshotRecord::parse(data) else {
+        return Vec::new();
+    };
+    [
+        (SnapshotField::DeviceId, "device"),
+        (SnapshotField::Screen, "screen"),
+    ]
+    .into_iter()
+    .filter_map(|(field, prefix)| {
+        record
+            .text(field)
+            .map(|value| format!("{}:{}", prefix, value))
+    })
+    .collect()
+}
+
 impl Default for SnapshotManager {
     fn default() -> Self {
         Self::new()
@@ -0,0 +1,383 @@
+use crate::{Result, TestError};
+
+// Layout shared with the native bridges; see bridge/ios_snapshot_format.h.
+const MAGIC: &[u8; 4] = b"ARKS";
+const VERSION: u16 = 1;
+const HEADER_SIZE: usize = 16;
+const ENTRY_SIZE: usize = 12;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum SnapshotField {
+    DeviceId,
+    BundleId,
+    /// u64 milliseconds since the Unix epoch, little-endian.
+    TimestampMs,
+    /// Cloned app data container, for snapshots taken through simctl.
+    ClonePath,
+    Screen,
+    /// View hierarchy as JSON, for snapshots taken inside XCUITest.
+    Hierarchy,
+    Unknown(u16),
+}
+
+impl SnapshotField {
+    pub fn from_tag(tag: u16) -> Self {
+        match tag {
+            1 => Self::DeviceId,
+            2 => Self::BundleId,
+            3 => Self::TimestampMs,
+            4 => Self::ClonePath,
+            5 => Self::Screen,
+            6 => Self::Hierarchy,
+            other => Self::Unknown(other),
+        }
+    }
+
+    pub fn tag(self) -> u16 {
+        match self {
+            Self::DeviceId => 1,
+            Self::BundleId => 2,
+            Self::TimestampMs => 3,
+            Self::ClonePath => 4,
+            Self::Screen => 5,
+            Self::Hierarchy => 6,
+            Self::Unknown(tag) => tag,
+        }
+    }
+}
+
+fn u16_at(data: &[u8], offset: usize) -> u16 {
+    u16::from_le_bytes([data[offset], data[offset + 1]])
+}
+
+fn u32_at(data: &[u8], offset: usize) -> usize {
+    u32::from_le_bytes(data[offset..offset + 4].try_into().unwrap()) as usize
+}
+
+/// A snapshot record read in place. Parsing only checks the header and the
+/// field table; field values are borrowed from the record when asked for.
+#[derive(Debug, Clone, Copy)]
+pub struct SnapshotRecord<'a> {
+    data: &'a [u8],
+    count: usize,
+}
+
+impl<'a> SnapshotRecord<'a> {
+    pub fn parse(data: &'a [u8]) -> Result<Self> {
+        let invalid = |reason: &str| TestError::Execution(format!("Invalid snapshot: {}", reason));
+        if data.len() < HEADER_SIZE || &data[..4] != MAGIC {
+            return Err(invalid("not a snapshot record"));
+        }
+        if u16_at(data, 4) != VERSION {
+            return Err(invalid("unsupported version"));
+        }
+        if u32_at(data, 8) != data.len() {
+            return Err(invalid("size does not match the header"));
+        }
+
+        let count = u16_at(data, 6) as usize;
+        let table_end = HEADER_SIZE + count * ENTRY_SIZE;
+        if table_end > data.len() {
+            return Err(invalid("field table is truncated"));
+        }
+        for index in 0..count {
+            let entry = HEADER_SIZE + index * ENTRY_SIZE;
+            let (offset, len) = (u32_at(data, entry + 4), u32_at(data, entry + 8));
+            if offset < table_end || offset > data.len() || len > data.len() - offset {
+                return Err(invalid("field lies outside the record"));
+            }
+        }
+        Ok(Self { data, count })
+    }
+
+    pub fn fields(&self) -> impl Iterator<Item = (SnapshotField, &'a [u8])> + '_ {
+        let data = self.data;
+        (0..self.count).map(move |index| {
+            let entry = HEADER_SIZE + index * ENTRY_SIZE;
+            let offset = u32_at(data, entry + 4);
+            let len = u32_at(data, entry + 8);
+            (
+                SnapshotField::from_tag(u16_at(data, entry)),
+                &data[offset..offset + len],
+            )
+        })
+    }
+
+    pub fn get(&self, field: SnapshotField) -> Option<&'a [u8]> {
+        self.fields()
+            .find(|(candidate, _)| *candidate == field)
+            .map(|(_, value)| value)
+    }
+
+    pub fn text(&self, field: SnapshotField) -> Option<&'a str> {
+        self.get(field)
+            .and_then(|value| std::str::from_utf8(value).ok())
+    }
+
+    pub fn timestamp_ms(&self) -> Option<u64> {
+        self.get(SnapshotField::TimestampMs)
+            .and_then(|value| value.try_into().ok())
+            .map(u64::from_le_bytes)
+    }
+
+    /// Fields whose values differ, including fields only one record has.
+    pub fn diff(&self, other: &SnapshotRecord<'_>) -> Vec<SnapshotField> {
+        let mut changed: Vec<SnapshotField> = Vec::new();
+        let mut note = |field: SnapshotField| {
+            if !changed.contains(&field) {
+                changed.push(field);
+            }
+        };
+        for (field, value) in self.fields() {
+            if other.get(field) != Some(value) {
+                note(field);
+            }
+        }
+        for (field, _) in other.fields() {
+            if self.get(field).is_none() {
+                note(field);
+            }
+        }
+        changed
+    }
+}
+
+/// Encodes a record the way the native bridges do.
+pub fn encode(fields: &[(SnapshotField, &[u8])]) -> Vec<u8> {
+    let table_end = HEADER_SIZE + fields.len() * ENTRY_SIZE;
+    let size = table_end + fields.iter().map(|(_, value)| value.len()).sum::<usize>();
+
+    let mut data = Vec::with_capacity(size);
+    data.extend_from_slice(MAGIC);
+    data.extend_from_slice(&VERSION.to_le_bytes());
+    data.extend_from_slice(&(fields.len() as u16).to_le_bytes());
+    data.extend_from_slice(&(size as u32).to_le_bytes());
+    data.extend_from_slice(&0u32.to_le_bytes());
+
+    let mut offset = table_end;
+    for (field, value) in fields {
+        data.extend_from_slice(&field.tag().to_le_bytes());
+        data.extend_from_slice(&0u16.to_le_bytes());
+        data.extend_from_slice(&(offset as u32).to_le_bytes());
+        data.extend_from_slice(&(value.len() as u32).to_le_bytes());
+        offset += value.len();
+    }
+    for (_, value) in fields {
+        data.extend_from_slice(value);
+    }
+    data
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::os::raw::{c_int, c_long, c_void};
+    use std::ptr;
+
+    // The native bridges' record code (bridge/ios_snapshot_format.c), which
+    // the stub build links too.
+    #[repr(C)]
+    struct NativeField {
+        tag: u16,
+        data: *const c_void,
+        length: u32,
+    }
+
+    unsafe extern "C" {
+        fn ios_snapshot_encoded_size(fields: *const NativeField, count: c_int) -> usize;
+        fn ios_snapshot_encode(fields: *const NativeField, count: c_int, out: *mut c_void);
+        fn ios_snapshot_validate(data: *const c_void, size: usize) -> c_int;
+        fn ios_snapshot_find(
+            data: *const c_void,
+            size: usize,
+            tag: u16,
+            value: *mut *const c_void,
+        ) -> c_long;
+    }
+
+    fn native_encode(fields: &[(SnapshotField, &[u8])]) -> Vec<u8> {
+        let native: Vec<NativeField> = fields
+            .iter()
+            .map(|(field, value)| NativeField {
+                tag: field.tag(),
+                data: value.as_ptr().cast(),
+                length: value.len() as u32,
+            })
+            .collect();
+        let count = native.len() as c_int;
+        let size = unsafe { ios_snapshot_encoded_size(native.as_ptr(), count) };
+        let mut out = vec![0u8; size];
+        unsafe { ios_snapshot_encode(native.as_ptr(), count, out.as_mut_ptr().cast()) };
+        out
+    }
+
+    fn native_valid(data: &[u8]) -> bool {
+        unsafe { ios_snapshot_validate(data.as_ptr().cast(), data.len()) == 0 }
+    }
+
+    fn native_find(data: &[u8], field: SnapshotField) -> Option<&[u8]> {
+        let mut value = ptr::null();
+        let length =
+            unsafe { ios_snapshot_find(data.as_ptr().cast(), data.len(), field.tag(), &mut value) };
+        let start = (value as usize).checked_sub(data.as_ptr() as usize)?;
+        (length >= 0).then(|| &data[start..start + length as usize])
+    }
+
+    fn put_u32(data: &mut [u8], offset: usize, value: u32) {
+        data[offset..offset + 4].copy_from_slice(&value.to_le_bytes());
+    }
+
+    #[test]
+    fn reads_fields_in_place() {
+        let data = encode(&[
+            (SnapshotField::DeviceId, b"ABC-123"),
+            (
+                SnapshotField::TimestampMs,
+                &1_700_000_000_000u64.to_le_bytes(),
+            ),
+            (SnapshotField::Unknown(99), b"future"),
+        ]);
+        let record = SnapshotRecord::parse(&data).unwrap();
+
+        assert_eq!(record.text(SnapshotField::DeviceId), Some("ABC-123"));
+        assert_eq!(record.timestamp_ms(), Some(1_700_000_000_000));
+        assert_eq!(record.get(SnapshotField::Screen), None);
+        assert_eq!(record.fields().count(), 3);
+    }
+
+    #[test]
+    fn rejects_malformed_records() {
+        let mut data = encode(&[(SnapshotField::Screen, b"Login")]);
+        assert!(SnapshotRecord::parse(&data[..data.len() - 1]).is_err());
+        data[20] = 0xff;
+        assert!(SnapshotRecord::parse(&data).is_err());
+        assert!(SnapshotRecord::parse(b"{\"clone\": null}").is_err());
+    }
+
+    #[test]
+    fn diff_reports_changed_and_missing_fields() {
+        let before = encode(&[
+            (SnapshotField::Screen, b"Login"),
+            (SnapshotField::DeviceId, b"A"),
+        ]);
+        let after = encode(&[
+            (SnapshotField::DeviceId, b"A"),
+            (SnapshotField::Screen, b"Home"),
+            (SnapshotField::ClonePath, b"/clone"),
+        ]);
+        let before = SnapshotRecord::parse(&before).unwrap();
+        let after = SnapshotRecord::parse(&after).unwrap();
+
+        assert_eq!(
+            before.diff(&after),
+            vec![SnapshotField::Screen, SnapshotField::ClonePath]
+        );
+    }
+
+    #[test]
+    fn native_records_match_the_rust_encoding() {
+        let fields: [(SnapshotField, &[u8]); 5] = [
+            (SnapshotField::DeviceId, b"ABC-123"),
+            (SnapshotField::Screen, b""),
+            (SnapshotField::Unknown(99), b"future"),
+            (SnapshotField::Hierarchy, b"{\"a\": \"\\u0000\"}\0tail"),
+            (SnapshotField::DeviceId, b"shadowed"),
+        ];
+        let data = native_encode(&fields);
+        assert_eq!(data, encode(&fields));
+
+        let record = SnapshotRecord::parse(&data).unwrap();
+        assert_eq!(record.fields().count(), 5);
+        for field in [
+            SnapshotField::DeviceId,
+            SnapshotField::Screen,
+            SnapshotField::Unknown(99),
+            SnapshotField::Hierarchy,
+            SnapshotField::ClonePath,
+        ] {
+            assert_eq!(native_find(&data, field), record.get(field), "{field:?}");
+        }
+        // Both readers take the first of repeated tags, and bytes after a NUL
+        // are still part of the field.
+        assert_eq!(record.text(SnapshotField::DeviceId), Some("ABC-123"));
+        assert!(
+            record
+                .get(SnapshotField::Hierarchy)
+                .unwrap()
+                .ends_with(b"\0tail")
+        );
+
+        let empty = native_encode(&[]);
+        assert_eq!(empty.len(), HEADER_SIZE);
+        assert_eq!(SnapshotRecord::parse(&empty).unwrap().fields().count(), 0);
+    }
+
+    #[test]
+    fn malformed_records_fail_both_readers() {
+        let valid = encode(&[
+            (SnapshotField::DeviceId, b"A"),
+            (SnapshotField::Screen, b"Login"),
+        ]);
+        let table_end = HEADER_SIZE + 2 * ENTRY_SIZE;
+        let second = HEADER_SIZE + ENTRY_SIZE;
+        let mut malformed: Vec<(String, Vec<u8>)> = (0..valid.len())
+            .map(|cut| (format!("cut at {cut}"), valid[..cut].to_vec()))
+            .collect();
+        let mut variant = |name: &str, edit: &dyn Fn(&mut Vec<u8>)| {
+            let mut data = valid.clone();
+            edit(&mut data);
+            malformed.push((name.to_string(), data));
+        };
+        variant("magic", &|data| data[0] = b'X');
+        variant("version", &|data| data[4] = 2);
+        variant("trailing byte", &|data| data.push(0));
+        variant("size too large", &|data| {
+            put_u32(data, 8, valid.len() as u32 + 1)
+        });
+        variant("table past the end", &|data| data[6] = 0xff);
+        variant("field inside the table", &|data| {
+            put_u32(data, second + 4, (table_end - 1) as u32)
+        });
+        variant("field past the end", &|data| {
+            put_u32(data, second + 4, valid.len() as u32 + 1)
+        });
+        variant("length past the end", &|data| put_u32(data, second + 8, 6));
+        variant("length that wraps", &|data| {
+            put_u32(data, second + 8, u32::MAX)
+        });
+
+        for (name, data) in &malformed {
+            assert!(SnapshotRecord::parse(data).is_err(), "{name}");
+            assert!(!native_valid(data), "{name}");
+            assert_eq!(native_find(data, SnapshotField::DeviceId), None, "{name}");
+        }
+
+        // A field may end exactly at the end of the record or be empty there.
+        let mut edge = valid.clone();
+        put_u32(&mut edge, second + 4, valid.len() as u32);
+        put_u32(&mut edge, second + 8, 0);
+        assert!(native_valid(&edge) && SnapshotRecord::parse(&edge).is_ok());
+    }
+
+    #[test]
+    fn records_too_large_for_the_format_are_refused() {
+        let field = |length| NativeField {
+            tag: 1,
+            data: ptr::null(),
+            length,
+        };
+        let huge = [field(u32::MAX), field(1)];
+        assert_eq!(unsafe { ios_snapshot_encoded_size(huge.as_ptr(), 2) }, 0);
+        assert_eq!(unsafe { ios_snapshot_encoded_size(huge.as_ptr(), -1) }, 0);
+        let many: Vec<NativeField> = (0..=u16::MAX as usize).map(|_| field(0)).collect();
+        let count = many.len() as c_int;
+        assert_eq!(
+            unsafe { ios_snapshot_encoded_size(many.as_ptr(), count) },
+            0
+        );
+        assert_eq!(
+            unsafe { ios_snapshot_encoded_size(many.as_ptr(), count - 1) },
+            HEADER_SIZE + (count as usize - 1) * ENTRY_SIZE
+        );
+    }
+}
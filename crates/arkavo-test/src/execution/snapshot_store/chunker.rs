@@ -0,0 +1,107 @@
+const MIN_CHUNK: usize = 2 * 1024;
+pub(super) const MAX_CHUNK: usize = 64 * 1024;
+// Thirteen set bits put a boundary roughly every 8 KiB. The high bits of the
+// rolling hash are used because they depend on the most recent 64 bytes,
+// where the low bits only see the last few.
+const CUT_MASK: u64 = !0 << (64 - 13);
+const GEAR: [u64; 256] = gear_table();
+
+const fn gear_table() -> [u64; 256] {
+    let mut table = [0u64; 256];
+    let mut state = 0u64;
+    let mut i = 0;
+    while i < 256 {
+        state = state.wrapping_add(0x9E37_79B9_7F4A_7C15);
+        let mut z = state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+        table[i] = z ^ (z >> 31);
+        i += 1;
+    }
+    table
+}
+
+/// Length of the chunk starting at `data`, or `None` while more input could
+/// still move the boundary. Boundaries depend on content rather than offsets,
+/// so an edit early in a snapshot leaves the chunks after it unchanged.
+pub(super) fn chunk_boundary(data: &[u8], complete: bool) -> Option<usize> {
+    if data.len() <= MIN_CHUNK {
+        return (complete && !data.is_empty()).then_some(data.len());
+    }
+    let end = data.len().min(MAX_CHUNK);
+    let mut hash = 0u64;
+    for (index, &byte) in data[..end].iter().enumerate().skip(MIN_CHUNK) {
+        hash = (hash << 1).wrapping_add(GEAR[byte as usize]);
+        if hash & CUT_MASK == 0 {
+            return Some(index + 1);
+        }
+    }
+    (complete || end == MAX_CHUNK).then_some(end)
+}
+
+/// Names a stored chunk. Equal hashes are only a hint: the store compares
+/// bytes before sharing a chunk, and a different chunk that collides is kept
+/// under the next `variant`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub(super) struct ChunkKey {
+    hash: u128,
+    pub(super) len: usize,
+    variant: u32,
+}
+
+impl ChunkKey {
+    /// 128-bit FNV-1a, like the build cache's keys.
+    pub(super) fn of(data: &[u8]) -> Self {
+        const OFFSET: u128 = 0x6c62272e07bb014262b821756295c58d;
+        const PRIME: u128 = 0x0000000001000000000000000000013b;
+        let hash = data.iter().fold(OFFSET, |hash, &byte| {
+            (hash ^ byte as u128).wrapping_mul(PRIME)
+        });
+        Self {
+            hash,
+            len: data.len(),
+            variant: 0,
+        }
+    }
+
+    pub(super) fn next_variant(self) -> Self {
+        Self {
+            variant: self.variant + 1,
+            ..self
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn chunks(data: &[u8]) -> Vec<&[u8]> {
+        let mut out = Vec::new();
+        let mut start = 0;
+        while let Some(len) = chunk_boundary(&data[start..], true) {
+            out.push(&data[start..start + len]);
+            start += len;
+        }
+        out
+    }
+
+    #[test]
+    fn boundaries_survive_an_earlier_insertion() {
+        let data: Vec<u8> = (0..200_000u32)
+            .map(|i| (i.wrapping_mul(2_654_435_761) >> 13) as u8)
+            .collect();
+        let mut edited = b"inserted".to_vec();
+        edited.extend_from_slice(&data);
+
+        let original = chunks(&data);
+        let shifted = chunks(&edited);
+        assert!(original.iter().all(|chunk| chunk.len() <= MAX_CHUNK));
+        assert_eq!(original.concat(), data);
+        let shared = shifted
+            .iter()
+            .filter(|chunk| original.contains(chunk))
+            .count();
+        assert!(shared + 2 >= original.len());
+    }
+}
@@ -0,0 +1,292 @@
+mod chunker;
+mod table;
+
+use crate::Result;
+use chunker::{ChunkKey, MAX_CHUNK, chunk_boundary};
+use std::io::{self, Write};
+use std::path::PathBuf;
+use std::sync::{Arc, Mutex, OnceLock};
+use table::{StoreInner, lock};
+
+/// Resident chunk bytes the shared store keeps before new chunks go to disk.
+pub const DEFAULT_MEMORY_BUDGET: usize = 256 * 1024 * 1024;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct StoreStats {
+    /// Distinct chunks held by the store.
+    pub chunks: usize,
+    pub resident_bytes: usize,
+    pub spilled_bytes: u64,
+    /// Total size of every live blob, counting shared chunks once per blob.
+    pub referenced_bytes: u64,
+}
+
+/// Deduplicating storage for snapshot payloads. Payloads are split into
+/// content-defined chunks keyed by their hash, so near-identical snapshots
+/// share everything but the chunks that differ. Chunks are reference counted
+/// by the blobs that use them and spill to a temporary file once the resident
+/// bytes would exceed the memory budget.
+#[derive(Clone)]
+pub struct SnapshotStore {
+    inner: Arc<Mutex<StoreInner>>,
+}
+
+impl SnapshotStore {
+    pub fn new(memory_budget: usize) -> Self {
+        Self::with_spill_dir(memory_budget, std::env::temp_dir())
+    }
+
+    pub fn with_spill_dir(memory_budget: usize, spill_dir: impl Into<PathBuf>) -> Self {
+        Self {
+            inner: Arc::new(Mutex::new(StoreInner::new(memory_budget, spill_dir.into()))),
+        }
+    }
+
+    /// The process-wide store, so snapshots taken by different harnesses
+    /// deduplicate against each other.
+    pub fn shared() -> Self {
+        static SHARED: OnceLock<SnapshotStore> = OnceLock::new();
+        SHARED
+            .get_or_init(|| SnapshotStore::new(DEFAULT_MEMORY_BUDGET))
+            .clone()
+    }
+
+    pub fn put(&self, data: &[u8]) -> Result<Blob> {
+        let mut writer = self.writer();
+        writer.write_all(data)?;
+        writer.finish()
+    }
+
+    /// Writer that chunks a payload as it arrives, holding at most one
+    /// maximum-size chunk of it in memory at a time.
+    pub fn writer(&self) -> BlobWriter {
+        BlobWriter {
+            store: self.clone(),
+            pending: Vec::new(),
+            chunks: Vec::new(),
+            len: 0,
+        }
+    }
+
+    pub fn stats(&self) -> StoreStats {
+        lock(&self.inner).stats()
+    }
+}
+
+impl std::fmt::Debug for SnapshotStore {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_tuple("SnapshotStore").field(&self.stats()).finish()
+    }
+}
+
+/// A payload held by a [`SnapshotStore`]. Clones share the stored chunks, and
+/// chunks are freed when the last blob using them is dropped.
+pub struct Blob {
+    store: Arc<Mutex<StoreInner>>,
+    chunks: Arc<[ChunkKey]>,
+    len: usize,
+}
+
+impl Blob {
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    pub fn read(&self) -> Result<Vec<u8>> {
+        let mut data = Vec::with_capacity(self.len);
+        let inner = lock(&self.store);
+        for key in self.chunks.iter() {
+            inner.read_into(key, &mut data)?;
+        }
+        Ok(data)
+    }
+}
+
+impl Clone for Blob {
+    fn clone(&self) -> Self {
+        let mut inner = lock(&self.store);
+        for key in self.chunks.iter() {
+            inner.retain(key);
+        }
+        Self {
+            store: Arc::clone(&self.store),
+            chunks: Arc::clone(&self.chunks),
+            len: self.len,
+        }
+    }
+}
+
+impl Drop for Blob {
+    fn drop(&mut self) {
+        let mut inner = lock(&self.store);
+        for key in self.chunks.iter() {
+            inner.release(key);
+        }
+    }
+}
+
+/// Blobs in the same store compare by their chunk keys, which stand in for
+/// their contents without reading them back.
+impl PartialEq for Blob {
+    fn eq(&self, other: &Self) -> bool {
+        Arc::ptr_eq(&self.store, &other.store) && self.chunks == other.chunks
+    }
+}
+
+impl Eq for Blob {}
+
+impl std::fmt::Debug for Blob {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Blob")
+            .field("len", &self.len)
+            .field("chunks", &self.chunks.len())
+            .finish()
+    }
+}
+
+/// Streams a payload into the store. Dropping the writer without calling
+/// [`BlobWriter::finish`] releases whatever it has stored so far.
+pub struct BlobWriter {
+    store: SnapshotStore,
+    pending: Vec<u8>,
+    chunks: Vec<ChunkKey>,
+    len: usize,
+}
+
+impl BlobWriter {
+    fn store_chunks(&mut self, complete: bool) -> io::Result<()> {
+        let mut start = 0;
+        let mut inner = lock(&self.store.inner);
+        while let Some(len) = chunk_boundary(&self.pending[start..], complete) {
+            self.chunks
+                .push(inner.insert(&self.pending[start..start + len])?);
+            start += len;
+        }
+        drop(inner);
+        self.pending.drain(..start);
+        Ok(())
+    }
+
+    pub fn finish(mut self) -> Result<Blob> {
+        self.store_chunks(true)?;
+        Ok(Blob {
+            store: Arc::clone(&self.store.inner),
+            chunks: std::mem::take(&mut self.chunks).into(),
+            len: self.len,
+        })
+    }
+}
+
+impl Write for BlobWriter {
+    fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+        self.pending.extend_from_slice(data);
+        self.len += data.len();
+        if self.pending.len() >= MAX_CHUNK {
+            self.store_chunks(false)?;
+        }
+        Ok(data.len())
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        Ok(())
+    }
+}
+
+impl Drop for BlobWriter {
+    fn drop(&mut self) {
+        let mut inner = lock(&self.store.inner);
+        for key in &self.chunks {
+            inner.release(key);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn payload(seed: u32, len: usize) -> Vec<u8> {
+        (0..len as u32)
+            .map(|i| (i.wrapping_add(seed).wrapping_mul(2_654_435_761) >> 11) as u8)
+            .collect()
+    }
+
+    #[test]
+    fn identical_payloads_share_chunks() {
+        let store = SnapshotStore::new(DEFAULT_MEMORY_BUDGET);
+        let data = payload(1, 300_000);
+        let first = store.put(&data).unwrap();
+        let second = store.put(&data).unwrap();
+
+        assert_eq!(first, second);
+        assert_eq!(second.read().unwrap(), data);
+        let stats = store.stats();
+        assert_eq!(stats.resident_bytes, data.len());
+        assert_eq!(stats.referenced_bytes, 2 * data.len() as u64);
+
+        drop(first);
+        drop(second);
+        assert_eq!(store.stats(), StoreStats::default());
+    }
+
+    #[test]
+    fn chunks_past_the_budget_spill_to_disk() {
+        let dir = tempfile::tempdir().unwrap();
+        let store = SnapshotStore::with_spill_dir(64 * 1024, dir.path());
+        let data = payload(2, 256 * 1024);
+        let blob = store.put(&data).unwrap();
+
+        let stats = store.stats();
+        assert!(stats.resident_bytes <= 64 * 1024);
+        assert_eq!(
+            stats.resident_bytes as u64 + stats.spilled_bytes,
+            data.len() as u64
+        );
+        assert_eq!(blob.clone().read().unwrap(), data);
+
+        drop(blob);
+        drop(store);
+        assert_eq!(std::fs::read_dir(dir.path()).unwrap().count(), 0);
+    }
+
+    #[test]
+    fn released_spill_space_is_reused() {
+        let dir = tempfile::tempdir().unwrap();
+        let store = SnapshotStore::with_spill_dir(0, dir.path());
+        let spill_len = || {
+            let entry = std::fs::read_dir(dir.path()).unwrap().next().unwrap();
+            entry.unwrap().metadata().unwrap().len()
+        };
+        // Disjoint stretches of the generator, so no chunk is shared.
+        let first = store.put(&payload(0, 150_000)).unwrap();
+        let second = store.put(&payload(150_000, 150_000)).unwrap();
+        let full = spill_len();
+
+        drop(first);
+        let third = store.put(&payload(300_000, 120_000)).unwrap();
+        assert_eq!(spill_len(), full);
+        assert_eq!(third.read().unwrap(), payload(300_000, 120_000));
+        assert_eq!(second.read().unwrap(), payload(150_000, 150_000));
+
+        drop(second);
+        drop(third);
+        assert_eq!(spill_len(), 0);
+    }
+
+    #[test]
+    fn streamed_writes_match_a_single_put() {
+        let store = SnapshotStore::new(DEFAULT_MEMORY_BUDGET);
+        let data = payload(3, 150_000);
+        let mut writer = store.writer();
+        for piece in data.chunks(1000) {
+            writer.write_all(piece).unwrap();
+        }
+        let streamed = writer.finish().unwrap();
+        assert_eq!(streamed, store.put(&data).unwrap());
+        assert!(store.put(&[]).unwrap().is_empty());
+    }
+}
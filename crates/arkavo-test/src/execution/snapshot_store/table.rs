@@ -0,0 +1,236 @@
+use super::StoreStats;
+use super::chunker::ChunkKey;
+use std::collections::{BTreeMap, HashMap};
+use std::fs::{File, OpenOptions};
+use std::io;
+use std::os::unix::fs::FileExt;
+use std::path::PathBuf;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Mutex, MutexGuard, PoisonError};
+
+static SPILL_COUNTER: AtomicU64 = AtomicU64::new(0);
+
+enum Location {
+    Memory(Box<[u8]>),
+    Disk(u64),
+}
+
+struct Chunk {
+    refs: usize,
+    location: Location,
+}
+
+struct SpillFile {
+    file: File,
+    path: PathBuf,
+    end: u64,
+    /// Released ranges below `end`, by offset. Neighbours are merged as they
+    /// are freed, so a range reaching `end` always shrinks the file instead.
+    holes: BTreeMap<u64, u64>,
+}
+
+impl SpillFile {
+    /// First fit: holes are few next to the chunks, and spilling is already
+    /// paying for a write.
+    fn allocate(&mut self, len: u64) -> u64 {
+        let fit = self
+            .holes
+            .iter()
+            .find(|&(_, &size)| size >= len)
+            .map(|(&offset, &size)| (offset, size));
+        let Some((offset, size)) = fit else {
+            self.end += len;
+            return self.end - len;
+        };
+        self.holes.remove(&offset);
+        if size > len {
+            self.holes.insert(offset + len, size - len);
+        }
+        offset
+    }
+
+    fn free(&mut self, mut offset: u64, mut len: u64) {
+        if let Some((&before, &size)) = self.holes.range(..offset).next_back() {
+            if before + size == offset {
+                self.holes.remove(&before);
+                offset = before;
+                len += size;
+            }
+        }
+        if let Some(size) = self.holes.remove(&(offset + len)) {
+            len += size;
+        }
+        if offset + len == self.end {
+            self.end = offset;
+            // Nothing reads past end, so a failed truncate only costs disk.
+            let _ = self.file.set_len(offset);
+        } else {
+            self.holes.insert(offset, len);
+        }
+    }
+}
+
+impl Drop for SpillFile {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_file(&self.path);
+    }
+}
+
+pub(super) struct StoreInner {
+    chunks: HashMap<ChunkKey, Chunk>,
+    memory_budget: usize,
+    spill_dir: PathBuf,
+    spill: Option<SpillFile>,
+    resident_bytes: usize,
+    spilled_bytes: u64,
+    referenced_bytes: u64,
+}
+
+impl StoreInner {
+    pub(super) fn new(memory_budget: usize, spill_dir: PathBuf) -> Self {
+        Self {
+            chunks: HashMap::new(),
+            memory_budget,
+            spill_dir,
+            spill: None,
+            resident_bytes: 0,
+            spilled_bytes: 0,
+            referenced_bytes: 0,
+        }
+    }
+
+    pub(super) fn stats(&self) -> StoreStats {
+        StoreStats {
+            chunks: self.chunks.len(),
+            resident_bytes: self.resident_bytes,
+            spilled_bytes: self.spilled_bytes,
+            referenced_bytes: self.referenced_bytes,
+        }
+    }
+
+    pub(super) fn insert(&mut self, data: &[u8]) -> io::Result<ChunkKey> {
+        let mut key = ChunkKey::of(data);
+        while let Some(chunk) = self.chunks.get(&key) {
+            if self.holds(chunk, data)? {
+                self.retain(&key);
+                return Ok(key);
+            }
+            key = key.next_variant();
+        }
+
+        let location = if self.resident_bytes + data.len() <= self.memory_budget {
+            self.resident_bytes += data.len();
+            Location::Memory(data.into())
+        } else {
+            let offset = self.write_to_spill(data)?;
+            self.spilled_bytes += data.len() as u64;
+            Location::Disk(offset)
+        };
+        self.chunks.insert(key, Chunk { refs: 1, location });
+        self.referenced_bytes += data.len() as u64;
+        Ok(key)
+    }
+
+    /// Whether a chunk already stored under data's hash really holds data.
+    /// Spilled chunks are read back, which only happens on a hash hit.
+    fn holds(&self, chunk: &Chunk, data: &[u8]) -> io::Result<bool> {
+        match &chunk.location {
+            Location::Memory(bytes) => Ok(**bytes == *data),
+            Location::Disk(offset) => {
+                let mut stored = vec![0; data.len()];
+                self.spill_file()?
+                    .file
+                    .read_exact_at(&mut stored, *offset)?;
+                Ok(stored == data)
+            }
+        }
+    }
+
+    fn spill_file(&self) -> io::Result<&SpillFile> {
+        self.spill.as_ref().ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "snapshot spill file is missing")
+        })
+    }
+
+    fn write_to_spill(&mut self, data: &[u8]) -> io::Result<u64> {
+        if self.spill.is_none() {
+            let path = self.spill_dir.join(format!(
+                "arkavo-snapshots-{}-{}.chunks",
+                std::process::id(),
+                SPILL_COUNTER.fetch_add(1, Ordering::Relaxed)
+            ));
+            let file = OpenOptions::new()
+                .read(true)
+                .write(true)
+                .create_new(true)
+                .open(&path)?;
+            self.spill = Some(SpillFile {
+                file,
+                path,
+                end: 0,
+                holes: BTreeMap::new(),
+            });
+        }
+        let spill = self.spill.as_mut().expect("spill file was just opened");
+        let offset = spill.allocate(data.len() as u64);
+        if let Err(error) = spill.file.write_all_at(data, offset) {
+            spill.free(offset, data.len() as u64);
+            return Err(error);
+        }
+        Ok(offset)
+    }
+
+    pub(super) fn retain(&mut self, key: &ChunkKey) {
+        if let Some(chunk) = self.chunks.get_mut(key) {
+            chunk.refs += 1;
+            self.referenced_bytes += key.len as u64;
+        }
+    }
+
+    pub(super) fn release(&mut self, key: &ChunkKey) {
+        let Some(chunk) = self.chunks.get_mut(key) else {
+            return;
+        };
+        chunk.refs -= 1;
+        self.referenced_bytes -= key.len as u64;
+        if chunk.refs > 0 {
+            return;
+        }
+
+        match self.chunks.remove(key).map(|chunk| chunk.location) {
+            Some(Location::Memory(_)) => self.resident_bytes -= key.len,
+            Some(Location::Disk(offset)) => {
+                self.spilled_bytes -= key.len as u64;
+                if let Some(spill) = self.spill.as_mut() {
+                    spill.free(offset, key.len as u64);
+                }
+            }
+            None => {}
+        }
+    }
+
+    /// Reads are positional, so they never depend on where a previous read
+    /// or write left the file's cursor.
+    pub(super) fn read_into(&self, key: &ChunkKey, out: &mut Vec<u8>) -> io::Result<()> {
+        let chunk = self.chunks.get(key).ok_or_else(|| {
+            io::Error::new(io::ErrorKind::NotFound, "snapshot chunk was released")
+        })?;
+        match &chunk.location {
+            Location::Memory(bytes) => out.extend_from_slice(bytes),
+            Location::Disk(offset) => {
+                let start = out.len();
+                out.resize(start + key.len, 0);
+                self.spill_file()?
+                    .file
+                    .read_exact_at(&mut out[start..], *offset)?;
+            }
+        }
+        Ok(())
+    }
+}
+
+// Every update leaves the counters consistent before it can panic, and Clone
+// and Drop have no way to report a poisoned lock, so poisoning is ignored.
+pub(super) fn lock(inner: &Mutex<StoreInner>) -> MutexGuard<'_, StoreInner> {
+    inner.lock().unwrap_or_else(PoisonError::into_inner)
+}
@@ -0,0 +1,120 @@
+use super::server::{Tool, ToolSchema};
+use crate::Result;
+use crate::bridge::ios_ffi_metrics::{BridgeMetrics, bridge_metrics, reset_bridge_metrics};
+use async_trait::async_trait;
+use serde_json::{Value, json};
+
+/// Surfaces the native bridge's per-operation latency histograms, so slow
+/// runs can be attributed to simctl, XCUITest queries or serialization
+/// without attaching a profiler.
+pub struct BridgeMetricsKit {
+    schema: ToolSchema,
+}
+
+impl BridgeMetricsKit {
+    pub fn new() -> Self {
+        Self {
+            schema: ToolSchema {
+                name: "bridge_metrics".to_string(),
+                description: "Report latency percentiles (p50/p90/p99, in ms) for each bridge operation: actions, state queries, snapshots, simctl commands and JSON handling".to_string(),
+                parameters: json!({
+                    "type": "object",
+                    "properties": {
+                        "prefix": {
+                            "type": "string",
+                            "description": "Only report operations whose name starts with this, e.g. \"action.\" or \"snapshot.\""
+                        },
+                        "reset": {
+                            "type": "boolean",
+                            "default": false,
+                            "description": "Clear the histograms after reading them, to measure the next run on its own"
+                        }
+                    }
+                }),
+            },
+        }
+    }
+}
+
+impl Default for BridgeMetricsKit {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+fn report(metrics: &BridgeMetrics, prefix: Option<&str>) -> Value {
+    let selected: Vec<_> = metrics.with_prefix(prefix.unwrap_or("")).collect();
+    let slowest = selected
+        .iter()
+        .max_by(|a, b| a.total_ms.total_cmp(&b.total_ms))
+        .map(|metric| metric.name.clone());
+    json!({
+        "unit": "ms",
+        "operations": selected,
+        "most_time_spent_in": slowest,
+    })
+}
+
+#[async_trait]
+impl Tool for BridgeMetricsKit {
+    async fn execute(&self, params: Value) -> Result<Value> {
+        let prefix = params.get("prefix").and_then(|v| v.as_str());
+        let reset = params
+            .get("reset")
+            .and_then(|v| v.as_bool())
+            .unwrap_or(false);
+
+        let metrics = bridge_metrics()?;
+        if reset {
+            reset_bridge_metrics();
+        }
+
+        let mut result = report(&metrics, prefix);
+        result["reset"] = json!(reset);
+        Ok(result)
+    }
+
+    fn schema(&self) -> &ToolSchema {
+        &self.schema
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::bridge::ios_ffi_metrics::OperationLatency;
+
+    fn latency(name: &str, total_ms: f64) -> OperationLatency {
+        OperationLatency {
+            name: name.to_string(),
+            count: 1,
+            total_ms,
+            min_ms: total_ms,
+            max_ms: total_ms,
+            mean_ms: total_ms,
+            p50_ms: total_ms,
+            p90_ms: total_ms,
+            p99_ms: total_ms,
+        }
+    }
+
+    #[test]
+    fn reports_where_most_time_went() {
+        let metrics = BridgeMetrics {
+            metrics: vec![
+                latency("action.tap", 40.0),
+                latency("params.parse", 2.0),
+                latency("snapshot.restore", 35.0),
+                latency("snapshot.create", 12.0),
+            ],
+        };
+
+        let all = report(&metrics, None);
+        assert_eq!(all["operations"].as_array().unwrap().len(), 4);
+        assert_eq!(all["most_time_spent_in"], "action.tap");
+
+        let snapshots = report(&metrics, Some("snapshot."));
+        assert_eq!(snapshots["operations"].as_array().unwrap().len(), 2);
+        assert_eq!(snapshots["most_time_spent_in"], "snapshot.restore");
+    }
+}
@@ -3,6 +3,7 @@ pub mod app_diagnostic_tool;
 pub mod applescript_tap;
 pub mod biometric_dialog_handler;
 pub mod biometric_test_scenarios;
+pub mod bridge_metrics_tool;
 pub mod calibration;
 pub mod calibration_setup_tool;
 pub mod calibration_tools;
@@ -65,9 +66,11 @@ pub mod usage_guide;
 pub mod xcode_info_tool;
 pub mod xcode_version;
 pub mod xctest_app_runner;
+pub mod xctest_build_cache;
 pub mod xctest_compiler;
 pub mod xctest_direct_runner;
 pub mod xctest_enhanced;
+pub mod xctest_runner_host;
 pub mod xctest_setup_tool;
 pub mod xctest_simple_runner;
 pub mod xctest_status_tool;
@@ -1,6 +1,7 @@
 use super::app_diagnostic_tool::AppDiagnosticTool;
 use super::biometric_dialog_handler::{AccessibilityDialogHandler, BiometricDialogHandler};
 use super::biometric_test_scenarios::{BiometricTestScenario, SmartBiometricHandler};
+use super::bridge_metrics_tool::BridgeMetricsKit;
 use super::code_analysis_tools::{CodeAnalysisKit, FindBugsKit, TestAnalysisKit};
 use super::coordinate_tools::CoordinateConverterKit;
 use super::deeplink_tools::{AppLauncherKit, DeepLinkKit};
@@ -149,6 +150,10 @@ impl McpTestServer {
         );
         tools.insert("usage_guide".to_string(), Arc::new(UsageGuideKit::new()));
         tools.insert("xcode_info".to_string(), Arc::new(XcodeInfoTool::new()));
+        tools.insert(
+            "bridge_metrics".to_string(),
+            Arc::new(BridgeMetricsKit::new()),
+        );
 
         #[cfg(target_os = "macos")]
         tools.insert(
@@ -472,6 +477,7 @@ impl McpTestServer {
                 | "biometric_test_scenario"
                 | "smart_biometric_handler"
                 | "enrollment_flow"
+                | "bridge_metrics"
         )
     }
 
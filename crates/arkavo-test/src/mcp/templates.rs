@@ -6,6 +6,117 @@ pub const ARKAVO_TEST_RUNNER_ENHANCED_SWIFT: &str =
     include_str!("../../templates/XCTestRunner/ArkavoTestRunnerEnhanced.swift.template");
 pub const INFO_PLIST: &str = include_str!("../../templates/XCTestRunner/Info.plist.template");
 
+/// Sources of the resident runner host and the bridge it links, relative to
+/// the repository root, whose layout the project's paths assume. Written out
+/// at runtime like the templates above, so an installed binary builds the
+/// runner without a checkout.
+pub const RUNNER_HOST_SOURCES: &[(&str, &str)] = &[
+    (
+        "ios/ArkavoRunnerHost/ArkavoRunnerHost.xcodeproj/project.pbxproj",
+        include_str!("../../../../ios/ArkavoRunnerHost/ArkavoRunnerHost.xcodeproj/project.pbxproj"),
+    ),
+    (
+        "ios/ArkavoRunnerHost/ArkavoRunnerHost/ArkavoRunnerHost.m",
+        include_str!("../../../../ios/ArkavoRunnerHost/ArkavoRunnerHost/ArkavoRunnerHost.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Analysis.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Analysis.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Async.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Async.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Batch.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Batch.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Buffer.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Buffer.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Coordinates.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Coordinates.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Delta.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Delta.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Frame.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Frame.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Hierarchy.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Hierarchy.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Host.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Host.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Lifecycle.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Lifecycle.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Lookup.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Lookup.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Metrics.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Metrics.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Private.h",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Private.h"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Snapshot.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Snapshot.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Typing.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Typing.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge+Wait.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge+Wait.m"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge.h",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge.h"),
+    ),
+    (
+        "ios/ArkavoTestBridge/ArkavoTestBridge.m",
+        include_str!("../../../../ios/ArkavoTestBridge/ArkavoTestBridge.m"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_analysis.c",
+        include_str!("../bridge/ios_analysis.c"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_analysis.h",
+        include_str!("../bridge/ios_analysis.h"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_builder.c",
+        include_str!("../bridge/ios_builder.c"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_builder.h",
+        include_str!("../bridge/ios_builder.h"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_metrics.c",
+        include_str!("../bridge/ios_metrics.c"),
+    ),
+    (
+        "crates/arkavo-test/src/bridge/ios_metrics.h",
+        include_str!("../bridge/ios_metrics.h"),
+    ),
+];
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -77,4 +188,38 @@ mod tests {
             "Info.plist should have XCTestBundleIdentifier for test bundles"
         );
     }
+
+    #[test]
+    fn runner_host_sources_cover_the_projects() {
+        // A file added to either project but not listed here would be missing
+        // from every runner an installed binary builds.
+        let root = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("../..");
+        let mut on_disk: Vec<String> = ["ios/ArkavoRunnerHost", "ios/ArkavoTestBridge"]
+            .iter()
+            .flat_map(|project| {
+                walkdir::WalkDir::new(root.join(project))
+                    .into_iter()
+                    .filter_entry(|entry| entry.file_name() != "xcuserdata")
+            })
+            .flatten()
+            .filter(|entry| entry.file_type().is_file() && entry.file_name() != ".DS_Store")
+            .map(|entry| {
+                let path = entry.path().strip_prefix(&root).unwrap();
+                path.to_string_lossy().into_owned()
+            })
+            .collect();
+        on_disk.sort();
+        // The native sources the bridge shares are referenced by path rather
+        // than living in either project directory.
+        let (shared, listed): (Vec<&str>, Vec<&str>) = RUNNER_HOST_SOURCES
+            .iter()
+            .map(|(path, _)| *path)
+            .partition(|path| path.starts_with("crates/"));
+        assert_eq!(on_disk, listed);
+        let project = RUNNER_HOST_SOURCES[0].1;
+        for path in shared {
+            let name = path.rsplit('/').next().unwrap();
+            assert!(project.contains(&format!("path = \"{name}\"")), "{name}");
+        }
+    }
 }
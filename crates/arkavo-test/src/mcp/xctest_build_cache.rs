@@ -0,0 +1,252 @@
+use crate::{Result, TestError};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+use std::sync::OnceLock;
+
+/// Bumped whenever the layout of a cache entry changes, so older entries are
+/// never mistaken for new ones.
+const CACHE_FORMAT: &str = "1";
+
+/// Per-user data directory shared by every project on the host:
+/// `$ARKAVO_DATA_DIR`, else `~/Library/Application Support/arkavo` on macOS
+/// and `$XDG_DATA_HOME/arkavo` (or `~/.local/share/arkavo`) elsewhere.
+pub fn data_dir() -> PathBuf {
+    if let Some(dir) = std::env::var_os("ARKAVO_DATA_DIR") {
+        return PathBuf::from(dir);
+    }
+    let home = std::env::var_os("HOME").map(PathBuf::from);
+    if cfg!(target_os = "macos") {
+        if let Some(home) = home {
+            return home.join("Library/Application Support/arkavo");
+        }
+    } else if let Some(data) = std::env::var_os("XDG_DATA_HOME") {
+        return PathBuf::from(data).join("arkavo");
+    } else if let Some(home) = home {
+        return home.join(".local/share/arkavo");
+    }
+    std::env::temp_dir().join("arkavo")
+}
+
+/// 128-bit FNV-1a. Keys name directories that outlive the binary, so the
+/// hash must not change between Rust releases the way `DefaultHasher` may.
+#[derive(Debug, Clone)]
+pub struct BuildKey {
+    state: u128,
+}
+
+impl BuildKey {
+    const OFFSET: u128 = 0x6c62272e07bb014262b821756295c58d;
+    const PRIME: u128 = 0x0000000001000000000000000000013b;
+
+    /// Starts a key for one kind of artifact; kinds never share entries.
+    pub fn new(kind: &str) -> Self {
+        let mut key = Self {
+            state: Self::OFFSET,
+        };
+        key.input("format", CACHE_FORMAT.as_bytes());
+        key.input("kind", kind.as_bytes());
+        key
+    }
+
+    /// Adds a named input. Names and values are length-prefixed, so moving
+    /// bytes from one input to the next always changes the key.
+    pub fn input(&mut self, name: &str, value: &[u8]) -> &mut Self {
+        for part in [name.as_bytes(), value] {
+            self.write(&(part.len() as u64).to_le_bytes());
+            self.write(part);
+        }
+        self
+    }
+
+    /// Adds a file's path relative to `root` and its contents.
+    pub fn file(&mut self, root: &Path, path: &Path) -> Result<&mut Self> {
+        let name = path.strip_prefix(root).unwrap_or(path).to_string_lossy();
+        let contents = fs::read(path)?;
+        Ok(self.input(&name, &contents))
+    }
+
+    /// Adds the Xcode build and the simulator SDK build, which decide what
+    /// any compiled runner links against.
+    pub fn toolchain(&mut self) -> Result<&mut Self> {
+        let fingerprint = toolchain_fingerprint()?;
+        Ok(self.input("toolchain", fingerprint.as_bytes()))
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for &byte in bytes {
+            self.state = (self.state ^ byte as u128).wrapping_mul(Self::PRIME);
+        }
+    }
+
+    pub fn hex(&self) -> String {
+        format!("{:032x}", self.state)
+    }
+}
+
+fn command_output(program: &str, args: &[&str]) -> Result<String> {
+    let output = Command::new(program)
+        .args(args)
+        .output()
+        .map_err(|e| TestError::Mcp(format!("Failed to run {}: {}", program, e)))?;
+    if !output.status.success() {
+        return Err(TestError::Mcp(format!(
+            "{} {} failed: {}",
+            program,
+            args.join(" "),
+            String::from_utf8_lossy(&output.stderr).trim()
+        )));
+    }
+    Ok(String::from_utf8_lossy(&output.stdout).trim().to_string())
+}
+
+fn toolchain_fingerprint() -> Result<String> {
+    static FINGERPRINT: OnceLock<String> = OnceLock::new();
+    if let Some(fingerprint) = FINGERPRINT.get() {
+        return Ok(fingerprint.clone());
+    }
+    let xcode = command_output("xcodebuild", &["-version"])?;
+    let runtime = command_output(
+        "xcrun",
+        &["--sdk", "iphonesimulator", "--show-sdk-build-version"],
+    )?;
+    Ok(FINGERPRINT
+        .get_or_init(|| format!("{}\n{}", xcode, runtime))
+        .clone())
+}
+
+/// Content-addressed store of compiled runner artifacts under
+/// `<data dir>/build-cache/<key>`. An entry is a directory that only ever
+/// appears complete: builds fill a private staging directory that is then
+/// renamed into place, so readers never see a half-written entry.
+pub struct BuildCache {
+    root: PathBuf,
+}
+
+impl Default for BuildCache {
+    fn default() -> Self {
+        Self::new(data_dir().join("build-cache"))
+    }
+}
+
+impl BuildCache {
+    pub fn new(root: impl Into<PathBuf>) -> Self {
+        Self { root: root.into() }
+    }
+
+    pub fn lookup(&self, key: &BuildKey) -> Option<PathBuf> {
+        let entry = self.root.join(key.hex());
+        entry.is_dir().then_some(entry)
+    }
+
+    /// Returns the entry for `key`, running `build` to fill it on a miss.
+    /// `build` gets an empty directory to write the artifacts into.
+    pub fn get_or_build(
+        &self,
+        key: &BuildKey,
+        build: impl FnOnce(&Path) -> Result<()>,
+    ) -> Result<PathBuf> {
+        if let Some(entry) = self.lookup(key) {
+            eprintln!("[BuildCache] Reusing {}", entry.display());
+            return Ok(entry);
+        }
+
+        let entry = self.root.join(key.hex());
+        let staging = self
+            .root
+            .join(format!("{}.staging-{}", key.hex(), std::process::id()));
+        if staging.exists() {
+            fs::remove_dir_all(&staging)?;
+        }
+        fs::create_dir_all(&staging)?;
+        if let Err(e) = build(&staging) {
+            let _ = fs::remove_dir_all(&staging);
+            return Err(e);
+        }
+
+        // Another process may have published the same key meanwhile; the
+        // entries are interchangeable, so whichever landed first is kept.
+        if fs::rename(&staging, &entry).is_err() {
+            let _ = fs::remove_dir_all(&staging);
+            if !entry.is_dir() {
+                return Err(TestError::Mcp(format!(
+                    "Failed to publish build cache entry {}",
+                    entry.display()
+                )));
+            }
+        }
+        eprintln!("[BuildCache] Stored {}", entry.display());
+        Ok(entry)
+    }
+}
+
+/// Recursively copies `from` into `to`, keeping file modes and symlinks, for
+/// moving artifacts between the cache and the temp dir, which may be on
+/// different volumes.
+pub fn copy_dir(from: &Path, to: &Path) -> Result<()> {
+    fs::create_dir_all(to)?;
+    for entry in fs::read_dir(from)? {
+        let entry = entry?;
+        let target = to.join(entry.file_name());
+        let file_type = entry.file_type()?;
+        if file_type.is_dir() {
+            copy_dir(&entry.path(), &target)?;
+        } else if file_type.is_symlink() {
+            std::os::unix::fs::symlink(fs::read_link(entry.path())?, &target)?;
+        } else {
+            fs::copy(entry.path(), &target)?;
+        }
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn keys_separate_inputs_and_are_stable() {
+        let mut key = BuildKey::new("xctest-bundle");
+        key.input("template", b"ab").input("socket", b"c");
+        let mut shifted = BuildKey::new("xctest-bundle");
+        shifted.input("template", b"a").input("socket", b"bc");
+
+        assert_ne!(key.hex(), shifted.hex());
+        assert_ne!(key.hex(), BuildKey::new("runner-host").hex());
+        // Entries on disk are named by this; it must never drift.
+        assert_eq!(
+            BuildKey::new("xctest-bundle").hex(),
+            "22946a812e837b5e0ca14fd79a460fe5"
+        );
+        assert_eq!(key.hex().len(), 32);
+    }
+
+    #[test]
+    fn builds_once_per_key() {
+        let root = tempfile::tempdir().unwrap();
+        let cache = BuildCache::new(root.path());
+        let key = BuildKey::new("test");
+        let mut builds = 0;
+
+        for _ in 0..2 {
+            let entry = cache
+                .get_or_build(&key, |dir| {
+                    builds += 1;
+                    fs::write(dir.join("artifact"), b"built")?;
+                    Ok(())
+                })
+                .unwrap();
+            assert_eq!(fs::read(entry.join("artifact")).unwrap(), b"built");
+        }
+        assert_eq!(builds, 1);
+
+        let failed = BuildKey::new("failing");
+        assert!(
+            cache
+                .get_or_build(&failed, |_| Err(TestError::Mcp("no".into())))
+                .is_err()
+        );
+        assert!(cache.lookup(&failed).is_none());
+        assert_eq!(fs::read_dir(root.path()).unwrap().count(), 1);
+    }
+}
@@ -1,11 +1,21 @@
 use super::templates;
+use super::xctest_build_cache::{BuildCache, BuildKey, copy_dir};
 use crate::{Result, TestError};
 use std::fs;
 use std::path::{Path, PathBuf};
 use std::process::Command;
 
-// Disabled caching due to architecture issues
-// static XCTEST_BUNDLE_CACHE: OnceLock<PathBuf> = OnceLock::new();
+const BUNDLE_NAME: &str = "ArkavoTestRunner.xctest";
+// Only ARM64 simulators are supported. Part of the bundle cache key, since a
+// bundle built for one architecture cannot load on another.
+const SIMULATOR_TARGET: &str = "arm64-apple-ios15.0-simulator";
+
+/// Socket path compiled into the bundle for a runner started without
+/// ARKAVO_SOCKET_PATH. Both launchers always pass the per-process path, so
+/// the fallback is fixed and one cached bundle serves every process.
+fn fallback_socket_path() -> PathBuf {
+    std::env::temp_dir().join("arkavo-xctest.sock")
+}
 
 pub struct XCTestCompiler {
     build_dir: PathBuf,
@@ -60,14 +70,36 @@ impl XCTestCompiler {
         &self.socket_path
     }
 
-    /// Get or compile the XCTest bundle
+    /// Get the XCTest bundle, compiling it only when no bundle built from
+    /// the same templates, substitutions and toolchain is in the build cache
     pub fn get_xctest_bundle(&self) -> Result<PathBuf> {
-        // Always compile fresh to avoid architecture mismatches
-        eprintln!("[XCTestCompiler] Compiling fresh XCTest bundle (caching disabled)");
-        let bundle_path = self.compile_xctest_bundle()?;
+        let entry = BuildCache::default().get_or_build(&self.bundle_cache_key()?, |dir| {
+            let bundle_path = self.compile_xctest_bundle()?;
+            copy_dir(&bundle_path, &dir.join(BUNDLE_NAME))
+        })?;
+
+        // The launchers embed the bundle from the build directory
+        let bundle_path = self.build_dir.join(BUNDLE_NAME);
+        if bundle_path.exists() {
+            fs::remove_dir_all(&bundle_path)?;
+        }
+        copy_dir(&entry.join(BUNDLE_NAME), &bundle_path)?;
         Ok(bundle_path)
     }
 
+    fn bundle_cache_key(&self) -> Result<BuildKey> {
+        let mut key = BuildKey::new("xctest-bundle");
+        key.input("template", templates::ARKAVO_TEST_RUNNER_SWIFT.as_bytes())
+            .input("info_plist", templates::INFO_PLIST.as_bytes())
+            .input(
+                "{{SOCKET_PATH}}",
+                fallback_socket_path().to_string_lossy().as_bytes(),
+            )
+            .input("target", SIMULATOR_TARGET.as_bytes())
+            .toolchain()?;
+        Ok(key)
+    }
+
     /// Compile the XCTest bundle from templates
     fn compile_xctest_bundle(&self) -> Result<PathBuf> {
         eprintln!("[XCTestCompiler] Starting XCTest bundle compilation...");
@@ -116,7 +148,7 @@ impl XCTestCompiler {
 
         // Replace template variables
         let swift_source =
-            swift_template.replace("{{SOCKET_PATH}}", &self.socket_path.to_string_lossy());
+            swift_template.replace("{{SOCKET_PATH}}", &fallback_socket_path().to_string_lossy());
 
         // Write Swift source
         let swift_path = source_dir.join("ArkavoTestRunner.swift");
@@ -225,8 +257,7 @@ let package = Package(
             )));
         }
 
-        // Only support ARM64 simulators
-        let target = "arm64-apple-ios15.0-simulator";
+        let target = SIMULATOR_TARGET;
         eprintln!("[XCTestCompiler] Compiling for architecture: {}", target);
 
         // Compile as a framework/bundle
@@ -282,7 +313,7 @@ let package = Package(
 
     /// Create the .xctest bundle structure
     fn create_xctest_bundle(&self, build_dir: &Path) -> Result<PathBuf> {
-        let bundle_name = "ArkavoTestRunner.xctest";
+        let bundle_name = BUNDLE_NAME;
         let bundle_path = build_dir.join(bundle_name);
 
         eprintln!(
@@ -0,0 +1,336 @@
+use super::templates::RUNNER_HOST_SOURCES;
+use super::xctest_build_cache::{BuildCache, BuildKey, copy_dir};
+use crate::{Result, TestError};
+use serde_json::Value;
+use std::fs::{self, File};
+use std::io::{Read, Write};
+use std::os::unix::net::UnixStream;
+use std::os::unix::process::CommandExt;
+use std::path::{Path, PathBuf};
+use std::process::{Command, Stdio};
+use std::time::{Duration, Instant};
+
+/// Frame layout shared with ArkavoTestBridge+Host.m: u32 payload length,
+/// u16 kind, u16 flags, u32 request id, then the payload, all little-endian.
+const FRAME_HEADER_SIZE: usize = 12;
+const REPLY_BIT: u16 = 0x8000;
+const MAX_PAYLOAD: usize = 64 * 1024 * 1024;
+
+/// How long a cold start may take between launching the runner and its
+/// socket answering; the first launch on a fresh simulator installs XCTRunner.
+const LAUNCH_TIMEOUT: Duration = Duration::from_secs(120);
+const CONNECT_POLL: Duration = Duration::from_millis(250);
+/// Ceiling on a single request, long enough for a batch with waits in it.
+const REQUEST_TIMEOUT: Duration = Duration::from_secs(300);
+
+const PROJECT: &str = "ArkavoRunnerHost.xcodeproj";
+const SCHEME: &str = "ArkavoRunnerHost";
+const TEST_IDENTIFIER: &str = "ArkavoRunnerHost/ArkavoRunnerHost/testServe";
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u16)]
+pub enum RequestKind {
+    Ping = 1,
+    Attach = 2,
+    Action = 3,
+    Batch = 4,
+    Shutdown = 5,
+}
+
+pub fn encode_frame(kind: RequestKind, request_id: u32, payload: &[u8]) -> Vec<u8> {
+    let mut frame = Vec::with_capacity(FRAME_HEADER_SIZE + payload.len());
+    frame.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    frame.extend_from_slice(&(kind as u16).to_le_bytes());
+    frame.extend_from_slice(&0u16.to_le_bytes());
+    frame.extend_from_slice(&request_id.to_le_bytes());
+    frame.extend_from_slice(payload);
+    frame
+}
+
+/// Reads one frame, returning its kind, request id and payload.
+pub fn read_frame(reader: &mut impl Read) -> Result<(u16, u32, Vec<u8>)> {
+    let mut header = [0u8; FRAME_HEADER_SIZE];
+    reader.read_exact(&mut header)?;
+    let length = u32::from_le_bytes([header[0], header[1], header[2], header[3]]) as usize;
+    let kind = u16::from_le_bytes([header[4], header[5]]);
+    let request_id = u32::from_le_bytes([header[8], header[9], header[10], header[11]]);
+    if length > MAX_PAYLOAD {
+        return Err(TestError::Bridge(format!(
+            "Runner host frame of {} bytes exceeds the protocol limit",
+            length
+        )));
+    }
+    let mut payload = vec![0u8; length];
+    reader.read_exact(&mut payload)?;
+    Ok((kind, request_id, payload))
+}
+
+fn action_payload(action: &str, params: &Value) -> Result<Vec<u8>> {
+    let name = action.as_bytes();
+    let length = u16::try_from(name.len())
+        .map_err(|_| TestError::Bridge(format!("Action name too long: {} bytes", name.len())))?;
+    let mut payload = length.to_le_bytes().to_vec();
+    payload.extend_from_slice(name);
+    serde_json::to_writer(&mut payload, params)?;
+    Ok(payload)
+}
+
+/// A connection to the resident XCUITest runner on one simulator. The runner
+/// is a UI test that never finishes: it keeps `XCUIApplication` attached and
+/// outlives the session that launched it, so every later session attaches
+/// over the socket in milliseconds instead of waiting for xcodebuild.
+pub struct RunnerHost {
+    stream: UnixStream,
+    next_id: u32,
+}
+
+impl RunnerHost {
+    /// Per-device socket, so each simulator keeps its own runner. /tmp rather
+    /// than the per-user temp dir, whose path leaves too little of the
+    /// 104-byte sun_path for the device UDID; simulator processes share the
+    /// host file system, so the runner binds the same path.
+    pub fn socket_path(device_id: &str) -> PathBuf {
+        PathBuf::from("/tmp").join(format!("arkavo-runner-{}.sock", device_id))
+    }
+
+    /// Connects to a runner that is already resident on the device.
+    pub fn connect(device_id: &str) -> Result<Self> {
+        let stream = UnixStream::connect(Self::socket_path(device_id))?;
+        stream.set_read_timeout(Some(REQUEST_TIMEOUT))?;
+        let mut host = Self { stream, next_id: 1 };
+        host.ping()?;
+        Ok(host)
+    }
+
+    /// Attaches to `bundle_id` through the device's runner, launching a
+    /// runner only when none answers. Attaching to the app the runner
+    /// already drives keeps its process and state.
+    pub fn attach(device_id: &str, bundle_id: &str) -> Result<Self> {
+        let mut host = Self::ensure(device_id)?;
+        let result = host.request(RequestKind::Attach, bundle_id.as_bytes())?;
+        if result["success"] != Value::Bool(true) {
+            return Err(TestError::Bridge(format!(
+                "Runner host failed to attach to {}: {}",
+                bundle_id, result["error"]
+            )));
+        }
+        Ok(host)
+    }
+
+    /// Connects to the device's runner, launching one when none answers.
+    /// The native bridge attaches it to its own app on first use.
+    pub fn ensure(device_id: &str) -> Result<Self> {
+        Self::connect(device_id).or_else(|_| Self::launch(device_id))
+    }
+
+    /// Cold start: builds the runner if no build is cached, starts it as a
+    /// detached xcodebuild test run and waits for its socket to answer.
+    pub fn launch(device_id: &str) -> Result<Self> {
+        let xctestrun = runner_xctestrun()?;
+        let build_dir = build_dir();
+        fs::create_dir_all(&build_dir)?;
+        let log_path = build_dir.join(format!("runner-{}.log", device_id));
+        let log = File::create(&log_path)?;
+        // Its own process group keeps the runner alive when the session that
+        // started it is interrupted from the terminal.
+        let mut child = Command::new("xcodebuild")
+            .arg("test-without-building")
+            .arg("-xctestrun")
+            .arg(&xctestrun)
+            .args(["-destination", &format!("id={}", device_id)])
+            .arg(format!("-only-testing:{}", TEST_IDENTIFIER))
+            .env(
+                "TEST_RUNNER_ARKAVO_SOCKET_PATH",
+                Self::socket_path(device_id),
+            )
+            .stdin(Stdio::null())
+            .stdout(log.try_clone()?)
+            .stderr(log)
+            .process_group(0)
+            .spawn()
+            .map_err(|e| TestError::Mcp(format!("Failed to run xcodebuild: {}", e)))?;
+
+        let deadline = Instant::now() + LAUNCH_TIMEOUT;
+        loop {
+            if let Ok(host) = Self::connect(device_id) {
+                return Ok(host);
+            }
+            if let Some(status) = child.try_wait()? {
+                return Err(TestError::Mcp(format!(
+                    "Runner host exited with {} before it was ready; see {}",
+                    status,
+                    log_path.display()
+                )));
+            }
+            if Instant::now() >= deadline {
+                let _ = child.kill();
+                return Err(TestError::Mcp(format!(
+                    "Runner host did not answer within {}s; see {}",
+                    LAUNCH_TIMEOUT.as_secs(),
+                    log_path.display()
+                )));
+            }
+            std::thread::sleep(CONNECT_POLL);
+        }
+    }
+
+    fn request(&mut self, kind: RequestKind, payload: &[u8]) -> Result<Value> {
+        let request_id = self.next_id;
+        self.next_id = self.next_id.wrapping_add(1);
+        self.stream
+            .write_all(&encode_frame(kind, request_id, payload))?;
+        let (reply_kind, reply_id, body) = read_frame(&mut self.stream)?;
+        if reply_kind != kind as u16 | REPLY_BIT || reply_id != request_id {
+            return Err(TestError::Bridge(format!(
+                "Runner host answered request {} with kind {:#06x} for request {}",
+                request_id, reply_kind, reply_id
+            )));
+        }
+        Ok(serde_json::from_slice(&body)?)
+    }
+
+    /// The runner's pid, attached bundle id and uptime.
+    pub fn ping(&mut self) -> Result<Value> {
+        self.request(RequestKind::Ping, &[])
+    }
+
+    pub fn execute(&mut self, action: &str, params: &Value) -> Result<Value> {
+        let payload = action_payload(action, params)?;
+        self.request(RequestKind::Action, &payload)
+    }
+
+    /// Runs a batch in one round trip; `actions` takes the same shapes as
+    /// `ios_bridge_execute_batch`.
+    pub fn execute_batch(&mut self, actions: &Value) -> Result<Value> {
+        let payload = serde_json::to_vec(actions)?;
+        self.request(RequestKind::Batch, &payload)
+    }
+
+    /// Ends the resident runner; the next `attach` cold-starts a new one.
+    pub fn shutdown(mut self) -> Result<()> {
+        self.request(RequestKind::Shutdown, &[])?;
+        Ok(())
+    }
+}
+
+fn build_dir() -> PathBuf {
+    std::env::temp_dir().join("arkavo-runner-host")
+}
+
+/// Writes the embedded runner sources under the build dir, leaving files
+/// that already match alone so xcodebuild's incremental build still works.
+fn write_sources(dir: &Path) -> Result<()> {
+    for (name, contents) in RUNNER_HOST_SOURCES {
+        let path = dir.join(name);
+        if fs::read(&path).is_ok_and(|existing| existing == contents.as_bytes()) {
+            continue;
+        }
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        fs::write(&path, contents)?;
+    }
+    Ok(())
+}
+
+fn find_xctestrun(products: &Path) -> Option<PathBuf> {
+    fs::read_dir(products)
+        .ok()?
+        .flatten()
+        .map(|entry| entry.path())
+        .find(|path| path.extension().is_some_and(|ext| ext == "xctestrun"))
+}
+
+/// The runner's build products, keyed on every runner and bridge source and
+/// the toolchain, and shared by every project and device on the host;
+/// test-without-building runs them straight out of the cache.
+fn runner_xctestrun() -> Result<PathBuf> {
+    let mut key = BuildKey::new("runner-host");
+    for (name, contents) in RUNNER_HOST_SOURCES {
+        key.input(name, contents.as_bytes());
+    }
+    key.toolchain()?;
+
+    let entry = BuildCache::default().get_or_build(&key, |products| {
+        let sources = build_dir().join("sources");
+        write_sources(&sources)?;
+        build_runner(
+            &sources.join("ios/ArkavoRunnerHost").join(PROJECT),
+            products,
+        )
+    })?;
+    find_xctestrun(&entry).ok_or_else(|| {
+        TestError::Mcp(format!(
+            "Cached runner host build has no .xctestrun in {}",
+            entry.display()
+        ))
+    })
+}
+
+/// Builds once for any simulator into the temp dir, which keeps xcodebuild's
+/// intermediates for incremental rebuilds, and copies only the products out.
+fn build_runner(project: &Path, out: &Path) -> Result<()> {
+    let derived_data = build_dir().join("DerivedData");
+    let products = derived_data.join("Build").join("Products");
+    if products.exists() {
+        fs::remove_dir_all(&products)?;
+    }
+    eprintln!("[RunnerHost] Building runner host...");
+    let output = Command::new("xcodebuild")
+        .arg("build-for-testing")
+        .arg("-project")
+        .arg(project)
+        .args(["-scheme", SCHEME])
+        .args(["-destination", "generic/platform=iOS Simulator"])
+        .arg("-derivedDataPath")
+        .arg(&derived_data)
+        .output()
+        .map_err(|e| TestError::Mcp(format!("Failed to run xcodebuild: {}", e)))?;
+    if !output.status.success() {
+        return Err(TestError::Mcp(format!(
+            "Runner host build failed: {}",
+            String::from_utf8_lossy(&output.stderr)
+        )));
+    }
+    if find_xctestrun(&products).is_none() {
+        return Err(TestError::Mcp(format!(
+            "Runner host build produced no .xctestrun under {}",
+            products.display()
+        )));
+    }
+    copy_dir(&products, out)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+
+    #[test]
+    fn action_frames_round_trip() {
+        let payload = action_payload("tap", &json!({"x": 10, "y": 20})).unwrap();
+        let frame = encode_frame(RequestKind::Action, 7, &payload);
+        assert_eq!(&frame[..12], &[20, 0, 0, 0, 3, 0, 0, 0, 7, 0, 0, 0]);
+
+        let (kind, request_id, decoded) = read_frame(&mut frame.as_slice()).unwrap();
+        assert_eq!((kind, request_id), (RequestKind::Action as u16, 7));
+        assert_eq!(&decoded[..5], b"\x03\x00tap");
+        assert_eq!(&decoded[5..], br#"{"x":10,"y":20}"#);
+    }
+
+    #[test]
+    fn rejects_oversized_and_truncated_frames() {
+        let mut oversized = encode_frame(RequestKind::Batch, 1, b"[]");
+        oversized[..4].copy_from_slice(&(MAX_PAYLOAD as u32 + 1).to_le_bytes());
+        assert!(matches!(
+            read_frame(&mut oversized.as_slice()),
+            Err(TestError::Bridge(_))
+        ));
+
+        let truncated = encode_frame(RequestKind::Batch, 1, b"[]");
+        assert!(matches!(
+            read_frame(&mut &truncated[..13]),
+            Err(TestError::Io(_))
+        ));
+    }
+}
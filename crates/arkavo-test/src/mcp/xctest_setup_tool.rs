@@ -2,6 +2,7 @@ use super::device_manager::DeviceManager;
 use super::ios_tools::UiInteractionKit;
 use super::server::{Tool, ToolSchema};
 use super::xctest_compiler::XCTestCompiler;
+use super::xctest_runner_host::RunnerHost;
 use super::xctest_unix_bridge::XCTestUnixBridge;
 use super::xctest_verifier::XCTestVerifier;
 use crate::Result;
@@ -87,6 +88,21 @@ impl Tool for XCTestSetupKit {
             );
         }
 
+        // The native bridge sends element actions to the device's resident
+        // runner only when its socket answers, so it is brought up here,
+        // before any session routes to it. Without it the bridge falls back
+        // to its other backends, so a failure does not fail the setup.
+        let runner_device = device_id.clone();
+        let runner_host =
+            match tokio::task::spawn_blocking(move || RunnerHost::ensure(&runner_device)?.ping())
+                .await
+            {
+                Ok(Ok(status)) => status,
+                Ok(Err(e)) => serde_json::json!({ "error": e.to_string() }),
+                Err(e) => serde_json::json!({ "error": format!("Task join error: {}", e) }),
+            };
+        eprintln!("[XCTestSetupKit] Runner host: {}", runner_host);
+
         // Check if XCUITest is already available and functional
         if !force_reinstall {
             eprintln!(
@@ -104,6 +120,7 @@ impl Tool for XCTestSetupKit {
                         "status": "already_setup",
                         "message": "XCUITest is already available and functional",
                         "device_status": verification_status,
+                        "runner_host": runner_host,
                         "capabilities": [
                             "Text-based element finding: {\"action\":\"tap\",\"target\":{\"text\":\"Button Label\"}}",
                             "Accessibility ID support: {\"action\":\"tap\",\"target\":{\"accessibility_id\":\"element_id\"}}",
@@ -300,6 +317,7 @@ impl Tool for XCTestSetupKit {
                     "status": "setup_complete",
                     "message": "XCUITest is now available for UI automation on any app",
                     "device_id": device_id,
+                    "runner_host": runner_host,
                     "important_note": "The ArkavoTestHost app briefly appeared with a black screen but has been moved to background. This is normal and expected.",
                     "capabilities": {
                         "coordinate_tap": "Improved coordinate-based tapping through XCUITest",
@@ -9,6 +9,7 @@ struct ArkavoReferenceApp: App {
         WindowGroup {
             ZStack {
                 ContentView()
+                    .id(navigationManager.generation)
                     .environmentObject(navigationManager)
                     .environmentObject(diagnosticManager)
                     .onOpenURL { url in
@@ -28,6 +29,12 @@ struct ArkavoReferenceApp: App {
     }
     
     private func setupApp() {
+        // Lets the test bridge confirm taps; costs nothing until touched.
+        ProbeChannel.shared.start()
+        if let command = LaunchCommand(arguments: .standard) {
+            apply(command)
+        }
+        
         // Enable diagnostics in debug mode
         #if DEBUG
         // Disabled by default - let CalibrationView manage its own diagnostics
@@ -65,9 +72,12 @@ struct ArkavoReferenceApp: App {
         }
         
         // Handle arkavo-reference:// scheme
-        guard url.scheme == "arkavo-reference" else { return }
+        guard let command = LaunchCommand(url: url) else { return }
         
         switch url.host {
+        case "reset":
+            apply(command)
+            return
         case "screen":
             if let screenName = url.pathComponents.dropFirst().first {
                 navigationManager.navigateToScreen(screenName)
@@ -83,6 +93,24 @@ struct ArkavoReferenceApp: App {
         default:
             break
         }
+        if let token = command.token {
+            ProbeChannel.shared.acknowledge(token)
+        }
+    }
+    
+    // Leaves the app as a fresh launch with the command's arguments would.
+    private func apply(_ command: LaunchCommand) {
+        if command.reset || command.user != nil {
+            AuthenticationManager.testUser = command.user
+            diagnosticManager.events.removeAll()
+            navigationManager.reset()
+        }
+        if let screen = command.screen {
+            navigationManager.navigateToScreen(screen)
+        }
+        if let token = command.token {
+            ProbeChannel.shared.acknowledge(token)
+        }
     }
     
     private func handleDiagnosticAction(_ action: String) {
@@ -161,6 +189,9 @@ struct ArkavoReferenceApp: App {
 class NavigationManager: ObservableObject {
     @Published var currentScreen: Screen = .main
     @Published var navigationPath = NavigationPath()
+    // The view tree is keyed on this, so bumping it starts every view's
+    // state over as a relaunch would, without one.
+    @Published private(set) var generation = 0
     
     enum Screen: String {
         case main
@@ -175,6 +206,12 @@ class NavigationManager: ObservableObject {
         case test
     }
     
+    func reset() {
+        currentScreen = .main
+        navigationPath = NavigationPath()
+        generation += 1
+    }
+    
     func navigateToScreen(_ screenName: String) {
         if let screen = Screen(rawValue: screenName) {
             currentScreen = screen
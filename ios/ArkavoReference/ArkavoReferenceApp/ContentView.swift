@@ -299,9 +299,20 @@ struct SecondaryButtonStyle: ButtonStyle {
 
 // Authentication Manager
 class AuthenticationManager: ObservableObject {
+    // Signed in from the start when set, for tests that begin logged in;
+    // see LaunchCommand.
+    static var testUser: String?
+    
     @Published var isAuthenticated = false
     @Published var currentUser = ""
     
+    init() {
+        if let user = Self.testUser {
+            isAuthenticated = true
+            currentUser = user
+        }
+    }
+    
     private let context = LAContext()
     
     var isBiometricAvailable: Bool {
@@ -0,0 +1,47 @@
+import Foundation
+
+// A state change the test bridge asks for, either as a deep link to the
+// running app or as launch arguments when it relaunches it. Applying a link
+// in process costs about a frame; the relaunch it replaces costs seconds.
+// The bridge side is crates/arkavo-test/src/bridge/ios_lifecycle.c; both
+// must change together.
+//
+//   arkavo-reference://reset?token=T&screen=S&user=U
+//   arkavo-reference://screen/S?token=T
+//   -ArkavoCommand reset|navigate -ArkavoScreen S -ArkavoUser U -ArkavoCommandToken T
+struct LaunchCommand {
+    var reset = false
+    var screen: String?
+    var user: String?
+    // Echoed through the probe once the result is on screen, which is how
+    // the bridge knows it need not relaunch.
+    var token: Double?
+
+    init?(url: URL) {
+        guard url.scheme == "arkavo-reference" else { return nil }
+        let query = URLComponents(url: url, resolvingAgainstBaseURL: false)?.queryItems ?? []
+        func value(_ name: String) -> String? { query.first { $0.name == name }?.value }
+        token = value("token").flatMap(Double.init)
+
+        switch url.host {
+        case "reset":
+            reset = true
+            screen = value("screen")
+            user = value("user")
+        case "screen":
+            screen = url.pathComponents.dropFirst().first
+        default:
+            break
+        }
+    }
+
+    // Launch arguments land in the argument domain of UserDefaults. The
+    // XCUITest bridge relaunches with a screen or user but no token.
+    init?(arguments defaults: UserDefaults = .standard) {
+        token = defaults.string(forKey: "ArkavoCommandToken").flatMap(Double.init)
+        reset = defaults.string(forKey: "ArkavoCommand") == "reset"
+        screen = defaults.string(forKey: "ArkavoScreen")
+        user = defaults.string(forKey: "ArkavoUser")
+        guard token != nil || screen != nil || user != nil else { return nil }
+    }
+}
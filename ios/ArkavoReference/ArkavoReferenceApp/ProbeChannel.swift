@@ -0,0 +1,198 @@
+import SwiftUI
+import UIKit.UIGestureRecognizerSubclass
+
+// Publishes every touch and the first frame rendered after it, and confirms
+// the bridge's lifecycle commands (LaunchCommand) the same way, into a ring
+// file in Library/Caches, which the test bridge maps to confirm its input
+// landed without reading the screen. The layout is specified in
+// crates/arkavo-test/src/bridge/ios_probe.h; both sides must change together.
+final class ProbeChannel {
+    static let shared = ProbeChannel()
+
+    enum Kind: UInt16 {
+        case touchDown = 1
+        case touchUp = 2
+        case render = 3
+        case command = 4
+    }
+
+    private static let version: UInt32 = 1
+    private static let capacity: UInt32 = 1024
+    private static let headerSize = 64
+    private static let recordSize = 48
+
+    private var fd: Int32 = -1
+    private var published: UInt64 = 0
+    private var displayLink: CADisplayLink?
+    private var pendingTouch: UInt64 = 0
+    private var pendingSince: CFTimeInterval = 0
+    private var pendingCommand: Double = 0
+    private var commandSince: CFTimeInterval = 0
+
+    func start() {
+        guard fd < 0, openRing() else { return }
+        let link = CADisplayLink(target: self, selector: #selector(frameRendered(_:)))
+        link.isPaused = true
+        link.add(to: .main, forMode: .common)
+        displayLink = link
+        attachRecognizer()
+    }
+
+    private func openRing() -> Bool {
+        guard let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first else {
+            return false
+        }
+        try? FileManager.default.createDirectory(at: caches, withIntermediateDirectories: true)
+        let path = caches.appendingPathComponent("arkavo-probe.ring").path
+        fd = open(path, O_RDWR | O_CREAT, 0o644)
+        guard fd >= 0 else { return false }
+
+        // Never shrink: a bridge from the last launch may still map the file.
+        let size = off_t(Self.headerSize + Int(Self.capacity) * Self.recordSize)
+        var info = stat()
+        let grow = fstat(fd, &info) != 0 || info.st_size < size
+        if grow && ftruncate(fd, size) != 0 {
+            close(fd)
+            fd = -1
+            return false
+        }
+
+        write(UInt64(0), at: 16)
+        let bounds = UIScreen.main.bounds
+        var header = Data("ARKP".utf8)
+        for value in [Self.version, Self.capacity, UInt32(Self.recordSize)] {
+            withUnsafeBytes(of: value) { header.append(contentsOf: $0) }
+        }
+        header.append(Data(count: 16))
+        for value in [Double(bounds.width), Double(bounds.height)] {
+            withUnsafeBytes(of: value) { header.append(contentsOf: $0) }
+        }
+        header.append(Data(count: 16))
+        header.withUnsafeBytes { _ = pwrite(fd, $0.baseAddress, 16, 0) }
+        header.withUnsafeBytes { _ = pwrite(fd, $0.baseAddress! + 32, 32, 32) }
+        // Readers switch to the new launch when the session changes, so it
+        // goes last.
+        write(clock_gettime_nsec_np(CLOCK_REALTIME), at: 24)
+        return true
+    }
+
+    private func attachRecognizer() {
+        let window = UIApplication.shared.connectedScenes
+            .compactMap { ($0 as? UIWindowScene)?.keyWindow }
+            .first
+        guard let window else {
+            // SwiftUI creates the window after the first onAppear.
+            DispatchQueue.main.async { self.attachRecognizer() }
+            return
+        }
+        window.addGestureRecognizer(TouchObserver(channel: self))
+    }
+
+    fileprivate func touched(_ touch: UITouch, kind: Kind) {
+        let point = touch.location(in: nil)
+        let sequence = record(kind, at: monoMs(uptime: touch.timestamp), x: point.x, y: point.y)
+        if kind == .touchUp, sequence > 0 {
+            pendingTouch = sequence
+            pendingSince = touch.timestamp
+            displayLink?.isPaused = false
+        }
+    }
+
+    // Confirmed on the next frame, once the command's state changes are
+    // on screen. A link can arrive before the first onAppear, so this
+    // opens the ring itself.
+    func acknowledge(_ token: Double) {
+        start()
+        pendingCommand = token
+        commandSince = CACurrentMediaTime()
+        displayLink?.isPaused = false
+    }
+
+    @objc private func frameRendered(_ link: CADisplayLink) {
+        // The callback for the frame on screen when the touch ended comes
+        // first; the response to the touch is in a later one.
+        if pendingTouch > 0, link.timestamp > pendingSince {
+            record(.render, at: monoMs(uptime: link.timestamp), x: 0, y: 0, value: Double(pendingTouch))
+            pendingTouch = 0
+        }
+        if pendingCommand > 0, link.timestamp > commandSince {
+            record(.command, at: monoMs(uptime: link.timestamp), x: 0, y: 0, value: pendingCommand)
+            pendingCommand = 0
+        }
+        if pendingTouch == 0, pendingCommand == 0 {
+            link.isPaused = true
+        }
+    }
+
+    // Touch and frame times are system uptime, which stops during sleep;
+    // the bridge uses CLOCK_MONOTONIC, so convert by their distance from now.
+    private func monoMs(uptime: TimeInterval) -> Double {
+        let now = Double(clock_gettime_nsec_np(CLOCK_MONOTONIC)) / 1_000_000
+        return now - (ProcessInfo.processInfo.systemUptime - uptime) * 1000
+    }
+
+    @discardableResult
+    private func record(_ kind: Kind, at monoMs: Double, x: CGFloat, y: CGFloat, value: Double = 0) -> UInt64 {
+        guard fd >= 0 else { return 0 }
+        let sequence = published + 1
+        var bytes = Data()
+        withUnsafeBytes(of: sequence) { bytes.append(contentsOf: $0) }
+        withUnsafeBytes(of: kind.rawValue) { bytes.append(contentsOf: $0) }
+        bytes.append(Data(count: 6))
+        for field in [monoMs, Double(x), Double(y), value] {
+            withUnsafeBytes(of: field) { bytes.append(contentsOf: $0) }
+        }
+        let offset = off_t(Self.headerSize + Int((sequence - 1) % UInt64(Self.capacity)) * Self.recordSize)
+        let written = bytes.withUnsafeBytes { pwrite(fd, $0.baseAddress, bytes.count, offset) }
+        guard written == bytes.count else { return 0 }
+        // Publishing after the record is what lets readers trust every
+        // record at or below published.
+        published = sequence
+        write(sequence, at: 16)
+        return sequence
+    }
+
+    private func write(_ value: UInt64, at offset: off_t) {
+        withUnsafeBytes(of: value) { _ = pwrite(fd, $0.baseAddress, 8, offset) }
+    }
+}
+
+// Watches touches on the whole window without taking part in gesture
+// recognition, so every control behaves exactly as it would untested.
+private final class TouchObserver: UIGestureRecognizer, UIGestureRecognizerDelegate {
+    private weak var channel: ProbeChannel?
+
+    init(channel: ProbeChannel) {
+        self.channel = channel
+        super.init(target: nil, action: nil)
+        cancelsTouchesInView = false
+        delaysTouchesBegan = false
+        delaysTouchesEnded = false
+        delegate = self
+    }
+
+    override func touchesBegan(_ touches: Set<UITouch>, with event: UIEvent) {
+        touches.forEach { channel?.touched($0, kind: .touchDown) }
+    }
+
+    override func touchesEnded(_ touches: Set<UITouch>, with event: UIEvent) {
+        touches.forEach { channel?.touched($0, kind: .touchUp) }
+        finishIfIdle(event)
+    }
+
+    override func touchesCancelled(_ touches: Set<UITouch>, with event: UIEvent) {
+        touches.forEach { channel?.touched($0, kind: .touchUp) }
+        finishIfIdle(event)
+    }
+
+    // Failing once all fingers lift resets the recognizer for the next touch.
+    private func finishIfIdle(_ event: UIEvent) {
+        let active = event.touches(for: self)?.contains { $0.phase != .ended && $0.phase != .cancelled } ?? false
+        if !active { state = .failed }
+    }
+
+    func gestureRecognizer(_ gestureRecognizer: UIGestureRecognizer,
+                           shouldRecognizeSimultaneouslyWith other: UIGestureRecognizer) -> Bool {
+        true
+    }
+}
@@ -0,0 +1,33 @@
+//
+//  ArkavoRunnerHost.m
+//  A UI test that never finishes, keeping one bridge resident for every session
+//
+
+#import <XCTest/XCTest.h>
+#import "ArkavoTestBridge.h"
+
+@interface ArkavoRunnerHost : XCTestCase
+@end
+
+@implementation ArkavoRunnerHost
+
+// xcodebuild hands TEST_RUNNER_-prefixed variables to the runner without
+// the prefix. The target app is attached over the socket, not here, so one
+// runner serves whichever app each session asks for.
+- (void)testServe {
+    NSString *socketPath = NSProcessInfo.processInfo.environment[@"ARKAVO_SOCKET_PATH"];
+    XCTAssertNotNil(socketPath, @"ARKAVO_SOCKET_PATH is not set");
+    if (!socketPath) return;
+
+    // A failed query inside one action must not end the host for every
+    // session after it.
+    self.continueAfterFailure = YES;
+    ArkavoTestBridge *bridge = [[ArkavoTestBridge alloc] initWithBundleIdentifier:nil];
+    NSError *error = nil;
+    BOOL serving = [bridge serveAtPath:socketPath error:&error];
+    XCTAssertTrue(serving, @"%@", error.localizedDescription);
+    if (!serving) return;
+    [bridge runUntilShutdown];
+}
+
+@end
@@ -0,0 +1,105 @@
+//
+//  ArkavoTestBridge+Analysis.m
+//  Classifies the whole screen in one pass over an element snapshot
+//
+
+#import "ArkavoTestBridge+Private.h"
+#include "ios_analysis.h"
+
+typedef struct {
+    IOSAnalysisRect screen;
+    NSUInteger count;
+    __unsafe_unretained NSString *screenName;
+} ArkavoAnalysisWalk;
+
+static int analysisKind(XCUIElementType type) {
+    switch (type) {
+        case XCUIElementTypeButton: return IOS_ANALYSIS_BUTTON;
+        case XCUIElementTypeTextField: return IOS_ANALYSIS_TEXT_FIELD;
+        case XCUIElementTypeTextView: return IOS_ANALYSIS_TEXT_VIEW;
+        case XCUIElementTypeSwitch: return IOS_ANALYSIS_SWITCH;
+        case XCUIElementTypeSlider: return IOS_ANALYSIS_SLIDER;
+        case XCUIElementTypeNavigationBar: return IOS_ANALYSIS_NAVIGATION_BAR;
+        default: return IOS_ANALYSIS_OTHER;
+    }
+}
+
+static IOSAnalysisRect analysisRect(CGRect rect) {
+    return (IOSAnalysisRect){ rect.origin.x, rect.origin.y, rect.size.width, rect.size.height };
+}
+
+@implementation ArkavoTestBridge (Analysis)
+
+- (void)classifySnapshot:(id<XCUIElementSnapshot>)snapshot
+                    walk:(ArkavoAnalysisWalk *)walk
+                 visible:(NSMutableArray *)visible
+                 actions:(NSMutableArray *)actions {
+    walk->count++;
+    int kind = analysisKind(snapshot.elementType);
+
+    if (kind == IOS_ANALYSIS_NAVIGATION_BAR && !walk->screenName) {
+        const char *name = ios_analysis_screen_name(snapshot.identifier.UTF8String);
+        if (name) walk->screenName = @(name);
+    }
+
+    int role = ios_analysis_classify(kind, analysisRect(snapshot.frame), walk->screen);
+    if (role != IOS_ANALYSIS_SKIP) {
+        [visible addObject:@{
+            @"type": @(ios_analysis_kind_name(kind)),
+            @"identifier": snapshot.identifier ?: @"",
+            @"label": snapshot.label ?: @"",
+            @"value": [snapshot.value description] ?: @"",
+            @"enabled": @(snapshot.enabled)
+        }];
+        const char *verb = ios_analysis_verb(role);
+        if (verb) {
+            const char *target = ios_analysis_target(snapshot.identifier.UTF8String, snapshot.label.UTF8String);
+            [actions addObject:[NSString stringWithFormat:@"%s:%@", verb, @(target)]];
+        }
+    }
+
+    for (id<XCUIElementSnapshot> child in snapshot.children) {
+        [self classifySnapshot:child walk:walk visible:visible actions:actions];
+    }
+}
+
+- (NSDictionary *)screenAnalysis {
+    NSError *error = nil;
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "query.snapshot", NULL);
+    id<XCUIElementSnapshot> root = [self.app snapshotWithError:&error];
+    ArkavoMetricsEnd(&span);
+    if (!root) {
+        return [self errorResult:@"Failed to snapshot view hierarchy" error:error];
+    }
+
+    ArkavoAnalysisWalk walk = { .screen = analysisRect(root.frame), .count = 0, .screenName = nil };
+    NSMutableArray *visible = [NSMutableArray array];
+    NSMutableArray *actions = [NSMutableArray array];
+    [self classifySnapshot:root walk:&walk visible:visible actions:actions];
+    [actions addObjectsFromArray:@[@"swipe:up", @"swipe:down", @"swipe:left", @"swipe:right"]];
+
+    return @{
+        @"screen": walk.screenName ?: @"UnknownScreen",
+        @"availableActions": actions,
+        @"visibleElements": visible,
+        // The application element itself is not one of its descendants.
+        @"elementCount": @(walk.count - 1)
+    };
+}
+
+@end
+
+#pragma mark - C Interface Implementation
+
+char* ios_bridge_analyze_screen(void* bridge) {
+    __block char *result = NULL;
+    ArkavoRunOnMainThread(^{
+        @autoreleasepool {
+            ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+            NSString *analysis = [testBridge jsonStringFromDictionary:[testBridge screenAnalysis]];
+            result = strdup([analysis UTF8String]);
+        }
+    });
+    return result;
+}
@@ -0,0 +1,62 @@
+//
+//  ArkavoTestBridge+Async.m
+//  Runs submitted actions on the main queue and reports them through a callback
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+static uint64_t nextRequestId = 0;
+
+static void finish(IOSBridgeCompletion completion, void *context, uint64_t requestId, NSString *result) {
+    completion(context, requestId, strdup(result.UTF8String));
+}
+
+NSTimeInterval ArkavoPlainWaitDuration(NSString *action, id params) {
+    if (![action isEqualToString:@"wait"] || ![params isKindOfClass:[NSDictionary class]] || params[@"until"]) {
+        return -1;
+    }
+    return MAX(0.0, [params[@"duration"] doubleValue] ?: 1.0);
+}
+
+NSString *ArkavoWaitOffMainThread(ArkavoTestBridge *bridge, NSString *action, NSData *params) {
+    if ([NSThread isMainThread]) return nil;
+    id decoded = params.length ? [NSJSONSerialization JSONObjectWithData:params options:0 error:nil] : nil;
+    NSTimeInterval duration = ArkavoPlainWaitDuration(action, decoded);
+    if (duration < 0) return nil;
+    [NSThread sleepForTimeInterval:duration];
+    return [bridge jsonStringFromDictionary:[bridge successResult:@{@"action": @"wait", @"duration": @(duration)}]];
+}
+
+#pragma mark - C Interface Implementation
+
+// Plain waits are scheduled with dispatch_after instead of sleeping, so the
+// main queue keeps serving other submissions while they are pending.
+uint64_t ios_bridge_submit_action(void* bridge, const char* action, const char* params,
+                                  IOSBridgeCompletion completion, void* context) {
+    // The block retains the bridge, keeping it alive until the action is done.
+    ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+    NSString *actionStr = [NSString stringWithUTF8String:action];
+    NSData *paramsData = [[NSString stringWithUTF8String:params ?: ""] dataUsingEncoding:NSUTF8StringEncoding];
+    if (!testBridge || !actionStr || !paramsData) return 0;
+
+    uint64_t requestId = __atomic_add_fetch(&nextRequestId, 1, __ATOMIC_RELAXED);
+    dispatch_async(dispatch_get_main_queue(), ^{
+        @autoreleasepool {
+            NSDictionary *decoded = [NSJSONSerialization JSONObjectWithData:paramsData options:0 error:nil];
+            NSTimeInterval duration = ArkavoPlainWaitDuration(actionStr, decoded);
+            if (duration < 0) {
+                NSDictionary *result = [testBridge resultForAction:actionStr paramsData:paramsData];
+                finish(completion, context, requestId, [testBridge jsonStringFromDictionary:result]);
+                return;
+            }
+
+            NSDictionary *result = [testBridge successResult:@{@"action": @"wait", @"duration": @(duration)}];
+            NSString *json = [testBridge jsonStringFromDictionary:result];
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(duration * NSEC_PER_SEC)),
+                           dispatch_get_main_queue(), ^{
+                finish(completion, context, requestId, json);
+            });
+        }
+    });
+    return requestId;
+}
@@ -0,0 +1,109 @@
+//
+//  ArkavoTestBridge+Batch.m
+//  Executes a sequence of actions in a single bridge call
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+@implementation ArkavoTestBridge (Batch)
+
+- (NSString *)executeBatch:(NSString *)actionsJSON {
+    return [self jsonStringFromDictionary:[self batchResultForActions:actionsJSON]];
+}
+
+- (NSDictionary *)batchResultForActions:(NSString *)actionsJSON {
+    NSError *error = nil;
+    id root = [NSJSONSerialization JSONObjectWithData:[actionsJSON dataUsingEncoding:NSUTF8StringEncoding]
+                                              options:0
+                                                error:&error];
+    if (error) {
+        return [self errorResult:@"Invalid JSON batch" error:error];
+    }
+    
+    NSArray *actions = nil;
+    BOOL stopOnFailure = NO;
+    if ([root isKindOfClass:[NSArray class]]) {
+        actions = root;
+    } else if ([root isKindOfClass:[NSDictionary class]]) {
+        actions = root[@"actions"];
+        stopOnFailure = [root[@"stop_on_failure"] boolValue];
+    }
+    
+    if (![actions isKindOfClass:[NSArray class]]) {
+        return [self errorResult:@"Batch requires an actions array" error:nil];
+    }
+    
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:actions.count];
+    NSTimeInterval batchStart = [NSProcessInfo processInfo].systemUptime;
+    BOOL allSucceeded = YES;
+    BOOL stopped = NO;
+    
+    for (id entry in actions) {
+        NSUInteger index = results.count;
+        NSString *action = [entry isKindOfClass:[NSDictionary class]] ? entry[@"action"] : nil;
+        if (![action isKindOfClass:[NSString class]]) {
+            [results addObject:@{
+                @"index": @(index),
+                @"action": [NSNull null],
+                @"success": @NO,
+                @"duration_ms": @0,
+                @"result": [self errorResult:@"Missing action name" error:nil]
+            }];
+            allSucceeded = NO;
+            if (stopOnFailure) {
+                stopped = YES;
+                break;
+            }
+            continue;
+        }
+        
+        NSDictionary *params = [entry[@"params"] isKindOfClass:[NSDictionary class]] ? entry[@"params"] : @{};
+        NSTimeInterval actionStart = [NSProcessInfo processInfo].systemUptime;
+        NSDictionary *result = [self resultForAction:action params:params];
+        NSTimeInterval elapsed = [NSProcessInfo processInfo].systemUptime - actionStart;
+        BOOL succeeded = [result[@"success"] boolValue];
+        
+        [results addObject:@{
+            @"index": @(index),
+            @"action": action,
+            @"success": @(succeeded),
+            @"duration_ms": @(elapsed * 1000.0),
+            @"result": result
+        }];
+        
+        if (!succeeded) {
+            allSucceeded = NO;
+            if (stopOnFailure) {
+                stopped = YES;
+                break;
+            }
+        }
+    }
+    
+    return @{
+        @"results": results,
+        @"success": @(allSucceeded && results.count == actions.count),
+        @"executed": @(results.count),
+        @"total": @(actions.count),
+        @"stopped_early": @(stopped),
+        @"total_ms": @(([NSProcessInfo processInfo].systemUptime - batchStart) * 1000.0)
+    };
+}
+
+@end
+
+#pragma mark - C Interface Implementation
+
+int ios_bridge_execute_batch(void* bridge, const char* actions_json, char** results_out) {
+    __block int executed = -1;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+        NSString *actionsStr = [NSString stringWithUTF8String:actions_json];
+        NSDictionary *summary = [testBridge batchResultForActions:actionsStr];
+        *results_out = strdup([[testBridge jsonStringFromDictionary:summary] UTF8String]);
+
+        NSNumber *count = summary[@"executed"];
+        if (count) executed = count.intValue;
+    });
+    return executed;
+}
@@ -0,0 +1,66 @@
+//
+//  ArkavoTestBridge+Buffer.m
+//  Lends result bytes across the FFI boundary without intermediate copies
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+static void release_lent_data(void *context) {
+    CFRelease(context);
+}
+
+// The serialized NSData is immutable, so its bytes stay put for as long as the
+// retained reference handed to the caller.
+static void lend_data(NSData *data, IOSBridgeBuffer *out) {
+    out->data = data.bytes;
+    out->length = data.length;
+    out->context = (void *)CFBridgingRetain(data);
+    out->release = release_lent_data;
+}
+
+#pragma mark - C Interface Implementation
+
+int ios_bridge_execute_action_buffer(void* bridge, const char* action, const char* params, IOSBridgeBuffer* out) {
+    ArkavoRunOnMainThread(^{
+        @autoreleasepool {
+            ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+            NSString *actionStr = [NSString stringWithUTF8String:action];
+            NSData *paramsData = [NSData dataWithBytesNoCopy:(void *)params length:strlen(params) freeWhenDone:NO];
+            NSDictionary *result = [testBridge resultForAction:actionStr paramsData:paramsData];
+            lend_data([testBridge jsonDataFromDictionary:result], out);
+        }
+    });
+    return 0;
+}
+
+int ios_bridge_execute_batch_buffer(void* bridge, const char* actions_json, IOSBridgeBuffer* out) {
+    __block int executed = -1;
+    ArkavoRunOnMainThread(^{
+        @autoreleasepool {
+            ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+            NSString *actionsStr = [NSString stringWithUTF8String:actions_json];
+            NSDictionary *summary = [testBridge batchResultForActions:actionsStr];
+            lend_data([testBridge jsonDataFromDictionary:summary], out);
+
+            NSNumber *count = summary[@"executed"];
+            if (count) executed = count.intValue;
+        }
+    });
+    return executed;
+}
+
+int ios_bridge_create_snapshot_into(void* bridge, IOSBridgeReserve reserve, void* context) {
+    __block NSData *snapshot = nil;
+    ArkavoRunOnMainThread(^{
+        snapshot = [(__bridge ArkavoTestBridge *)bridge createSnapshot];
+    });
+    if (!snapshot) return -1;
+
+    // Filling caller memory needs nothing from XCUITest, so it happens on the
+    // calling thread.
+    void *target = reserve(context, snapshot.length);
+    if (!target) return -1;
+
+    [snapshot getBytes:target length:snapshot.length];
+    return 0;
+}
@@ -0,0 +1,51 @@
+//
+//  ArkavoTestBridge+Coordinates.m
+//  Taps and swipes at screen points, for when the host cannot inject HID
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+// XCUITest rejects drags without a press first; this is about the shortest
+// it takes, and still reads as a swipe to the app.
+static const NSTimeInterval kMinimumDragHold = 0.05;
+
+@implementation ArkavoTestBridge (Coordinates)
+
+// Points from the app's top-left corner, like the native bridge's HID input.
+- (nullable XCUICoordinate *)coordinateForX:(id)x y:(id)y {
+    if (![x isKindOfClass:[NSNumber class]] || ![y isKindOfClass:[NSNumber class]]) return nil;
+    XCUICoordinate *origin = [self.app coordinateWithNormalizedOffset:CGVectorMake(0, 0)];
+    return [origin coordinateWithOffset:CGVectorMake([x doubleValue], [y doubleValue])];
+}
+
+// Element lookups win whenever the params name one.
+- (BOOL)targetsElement:(NSDictionary *)params {
+    return params[@"identifier"] != nil || params[@"label"] != nil;
+}
+
+- (nullable NSDictionary *)performCoordinateTap:(NSDictionary *)params {
+    XCUICoordinate *point = [self targetsElement:params] ? nil : [self coordinateForX:params[@"x"] y:params[@"y"]];
+    if (!point) return nil;
+
+    NSTimeInterval duration = [params[@"duration"] doubleValue];
+    if (duration > 0) {
+        [point pressForDuration:duration];
+    } else {
+        [point tap];
+    }
+    return [self successResult:@{@"action": @"tap", @"coordinates": @{@"x": params[@"x"], @"y": params[@"y"]}}];
+}
+
+- (nullable NSDictionary *)performCoordinateSwipe:(NSDictionary *)params {
+    if (params[@"direction"] || [self targetsElement:params]) return nil;
+    XCUICoordinate *from = [self coordinateForX:params[@"x1"] y:params[@"y1"]];
+    XCUICoordinate *to = [self coordinateForX:params[@"x2"] y:params[@"y2"]];
+    if (!from || !to) return nil;
+
+    [from pressForDuration:MAX([params[@"hold"] doubleValue], kMinimumDragHold) thenDragToCoordinate:to];
+    return [self successResult:@{@"action": @"swipe",
+                                 @"from": @{@"x": params[@"x1"], @"y": params[@"y1"]},
+                                 @"to": @{@"x": params[@"x2"], @"y": params[@"y2"]}}];
+}
+
+@end
@@ -0,0 +1,128 @@
+//
+//  ArkavoTestBridge+Delta.m
+//  Reports only what changed in the view hierarchy since the last call
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <objc/runtime.h>
+
+static const void *kDeltaBaselineKey = &kDeltaBaselineKey;
+static const void *kDeltaHashKey = &kDeltaHashKey;
+
+static uint64_t hashString(uint64_t hash, NSString *string) {
+    const unsigned char *bytes = (const unsigned char *)string.UTF8String;
+    while (bytes && *bytes) hash = (hash ^ *bytes++) * 0x100000001b3ULL;
+    return hash;
+}
+
+static NSString *hexHash(uint64_t hash) {
+    return [NSString stringWithFormat:@"%016llx", (unsigned long long)hash];
+}
+
+// A node's fingerprint is its path from the root, where each step is the
+// accessibility identifier when there is one and the position among
+// same-typed unidentified siblings otherwise. Label and value changes
+// therefore update a node instead of replacing it.
+static void collectNodes(id<XCUIElementSnapshot> snapshot, uint64_t pathHash, NSString *parent,
+                         NSMutableDictionary *nodes, NSMutableArray *order) {
+    NSString *fingerprint = hexHash(pathHash);
+    CGRect frame = snapshot.frame;
+    NSDictionary *node = @{
+        @"fingerprint": fingerprint,
+        @"parent": parent ?: [NSNull null],
+        @"type": @(snapshot.elementType),
+        @"identifier": snapshot.identifier ?: @"",
+        @"label": snapshot.label ?: @"",
+        @"value": [snapshot.value description] ?: @"",
+        @"enabled": @(snapshot.enabled),
+        @"selected": @(snapshot.selected),
+        @"frame": @{@"x": @(frame.origin.x), @"y": @(frame.origin.y),
+                    @"width": @(frame.size.width), @"height": @(frame.size.height)},
+    };
+    NSString *contents = [NSString stringWithFormat:@"%@|%@|%@|%d|%d|%@", node[@"identifier"], node[@"label"],
+                                                    node[@"value"], snapshot.enabled, snapshot.selected,
+                                                    NSStringFromCGRect(frame)];
+    nodes[fingerprint] = @{@"node": node, @"hash": @(hashString(pathHash, contents))};
+    [order addObject:fingerprint];
+
+    NSCountedSet *seen = [NSCountedSet set];
+    for (id<XCUIElementSnapshot> child in snapshot.children) {
+        NSString *step = child.identifier.length > 0
+            ? [NSString stringWithFormat:@"%lu#%@", (unsigned long)child.elementType, child.identifier]
+            : [NSString stringWithFormat:@"%lu", (unsigned long)child.elementType];
+        [seen addObject:step];
+        NSString *indexed = [NSString stringWithFormat:@"/%@[%lu]", step, (unsigned long)[seen countForObject:step]];
+        collectNodes(child, hashString(pathHash, indexed), fingerprint, nodes, order);
+    }
+}
+
+@implementation ArkavoTestBridge (Delta)
+
+- (NSDictionary *)stateDelta {
+    NSError *error = nil;
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "query.snapshot", NULL);
+    id<XCUIElementSnapshot> snapshot = [self.app snapshotWithError:&error];
+    ArkavoMetricsEnd(&span);
+    if (!snapshot) {
+        return [self errorResult:@"Failed to snapshot view hierarchy" error:error];
+    }
+
+    NSMutableDictionary *nodes = [NSMutableDictionary dictionary];
+    NSMutableArray *order = [NSMutableArray array];
+    collectNodes(snapshot, 0xcbf29ce484222325ULL, nil, nodes, order);
+
+    NSDictionary *baseline = objc_getAssociatedObject(self, kDeltaBaselineKey);
+    NSString *previousHash = objc_getAssociatedObject(self, kDeltaHashKey);
+    NSMutableArray *inserted = [NSMutableArray array];
+    NSMutableArray *updated = [NSMutableArray array];
+    uint64_t stateHash = 0xcbf29ce484222325ULL;
+
+    for (NSString *fingerprint in order) {
+        NSDictionary *entry = nodes[fingerprint];
+        NSDictionary *before = baseline[fingerprint];
+        if (!before) {
+            [inserted addObject:entry[@"node"]];
+        } else if (![before[@"hash"] isEqual:entry[@"hash"]]) {
+            [updated addObject:entry[@"node"]];
+        }
+        stateHash = (stateHash ^ [entry[@"hash"] unsignedLongLongValue]) * 0x100000001b3ULL;
+    }
+
+    NSMutableArray *removed = [NSMutableArray array];
+    for (NSString *fingerprint in baseline) {
+        if (!nodes[fingerprint]) [removed addObject:fingerprint];
+    }
+
+    NSString *hash = hexHash(stateHash);
+    if (previousHash && ![hash isEqualToString:previousHash]) [self invalidateElementCache];
+    objc_setAssociatedObject(self, kDeltaBaselineKey, nodes, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(self, kDeltaHashKey, hash, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    // The next tap can use frames from this snapshot instead of querying.
+    [self recordFramesFromSnapshot:snapshot hash:hash];
+
+    return @{
+        @"state_hash": hash,
+        @"previous_hash": previousHash ?: [NSNull null],
+        @"changed": @(![hash isEqualToString:previousHash]),
+        @"inserted": inserted,
+        @"removed": removed,
+        @"updated": updated,
+    };
+}
+
+@end
+
+#pragma mark - C Interface Implementation
+
+char* ios_bridge_get_state_delta(void* bridge) {
+    __block char *result = NULL;
+    ArkavoRunOnMainThread(^{
+        @autoreleasepool {
+            ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+            NSString *delta = [testBridge jsonStringFromDictionary:[testBridge stateDelta]];
+            result = strdup([delta UTF8String]);
+        }
+    });
+    return result;
+}
@@ -0,0 +1,132 @@
+//
+//  ArkavoTestBridge+Frame.m
+//  Captures the screen into caller memory without touching disk
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <ImageIO/ImageIO.h>
+#import <UIKit/UIKit.h>
+
+static const int kFrameRawBGRA = 0;
+static const int kFramePNG = 1;
+static const int kFrameJPEG = 2;
+static const int kDefaultJPEGQuality = 85;
+
+static int copyOut(NSData *data, IOSBridgeReserve reserve, void *context) {
+    void *target = reserve(context, data.length);
+    if (!target) return -4;
+    [data getBytes:target length:data.length];
+    return 0;
+}
+
+// Premultiplied-first with little-endian byte order is BGRA in memory.
+static CGContextRef createBGRAContext(void *pixels, size_t width, size_t height) {
+    CGColorSpaceRef space = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    CGContextRef bitmap = CGBitmapContextCreate(pixels, width, height, 8, width * 4, space,
+                                                (CGBitmapInfo)kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(space);
+    if (bitmap) CGContextSetInterpolationQuality(bitmap, kCGInterpolationMedium);
+    return bitmap;
+}
+
+static NSData *encodeImage(CGImageRef image, const IOSFrameRequest *request) {
+    NSMutableData *encoded = [NSMutableData data];
+    CFStringRef type = request->format == kFrameJPEG ? CFSTR("public.jpeg") : CFSTR("public.png");
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)encoded, type, 1, NULL);
+    if (!destination) return nil;
+
+    NSDictionary *options = nil;
+    if (request->format == kFrameJPEG) {
+        int quality = request->jpeg_quality > 0 ? MIN(request->jpeg_quality, 100) : kDefaultJPEGQuality;
+        options = @{ (__bridge NSString *)kCGImageDestinationLossyCompressionQuality: @(quality / 100.0) };
+    }
+
+    CGImageDestinationAddImage(destination, image, (__bridge CFDictionaryRef)options);
+    BOOL finalized = CGImageDestinationFinalize(destination);
+    CFRelease(destination);
+    return finalized ? encoded : nil;
+}
+
+#pragma mark - C Interface Implementation
+
+static int captureFrame(const IOSFrameRequest* request, IOSBridgeReserve reserve, void* context,
+                        IOSFrameInfo* info) {
+    memset(info, 0, sizeof(*info));
+    if (request->format < kFrameRawBGRA || request->format > kFrameJPEG) return -3;
+    if (request->scale < 0 || request->scale > 1.0) return -3;
+
+    @autoreleasepool {
+        XCUIScreenshot *screenshot = [XCUIScreen mainScreen].screenshot;
+        info->captured_ms = [NSProcessInfo processInfo].systemUptime * 1000.0;
+        CGImageRef image = screenshot.image.CGImage;
+        if (!image) return -1;
+
+        BOOL crop = request->crop_width > 0 && request->crop_height > 0;
+        BOOL scale = request->scale > 0 && request->scale != 1.0;
+        info->format = request->format;
+
+        // XCUIScreenshot already holds a PNG encoding, so untouched PNG frames
+        // are handed over without a re-encode.
+        if (request->format == kFramePNG && !crop && !scale) {
+            info->width = (int)CGImageGetWidth(image);
+            info->height = (int)CGImageGetHeight(image);
+            return copyOut(screenshot.PNGRepresentation, reserve, context);
+        }
+
+        CGImageRef source = CGImageRetain(image);
+        if (crop) {
+            CGRect bounds = CGRectMake(0, 0, CGImageGetWidth(source), CGImageGetHeight(source));
+            CGRect region = CGRectIntersection(bounds, CGRectMake(request->crop_x, request->crop_y,
+                                                                  request->crop_width, request->crop_height));
+            CGImageRef cropped = CGRectIsEmpty(region) ? NULL : CGImageCreateWithImageInRect(source, region);
+            CGImageRelease(source);
+            if (!cropped) return -3;
+            source = cropped;
+        }
+
+        double factor = scale ? request->scale : 1.0;
+        size_t width = (size_t)MAX(1.0, round(CGImageGetWidth(source) * factor));
+        size_t height = (size_t)MAX(1.0, round(CGImageGetHeight(source) * factor));
+        info->width = (int)width;
+        info->height = (int)height;
+
+        int status = 0;
+        if (request->format == kFrameRawBGRA) {
+            void *pixels = reserve(context, width * height * 4);
+            CGContextRef bitmap = pixels ? createBGRAContext(pixels, width, height) : NULL;
+            if (bitmap) {
+                CGContextDrawImage(bitmap, CGRectMake(0, 0, width, height), source);
+                CGContextRelease(bitmap);
+                info->bytes_per_row = (int)(width * 4);
+            } else {
+                status = -4;
+            }
+        } else {
+            CGImageRef scaled = NULL;
+            if (scale) {
+                CGContextRef bitmap = createBGRAContext(NULL, width, height);
+                if (bitmap) {
+                    CGContextDrawImage(bitmap, CGRectMake(0, 0, width, height), source);
+                    scaled = CGBitmapContextCreateImage(bitmap);
+                    CGContextRelease(bitmap);
+                }
+            }
+            NSData *encoded = (!scale || scaled) ? encodeImage(scaled ? scaled : source, request) : nil;
+            status = encoded ? copyOut(encoded, reserve, context) : -4;
+            if (scaled) CGImageRelease(scaled);
+        }
+
+        CGImageRelease(source);
+        return status;
+    }
+}
+
+int ios_bridge_capture_frame(void* bridge, const IOSFrameRequest* request, IOSBridgeReserve reserve,
+                             void* context, IOSFrameInfo* info) {
+    (void)bridge;
+    __block int status = -1;
+    ArkavoRunOnMainThread(^{
+        status = captureFrame(request, reserve, context, info);
+    });
+    return status;
+}
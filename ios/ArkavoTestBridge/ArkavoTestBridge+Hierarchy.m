@@ -0,0 +1,118 @@
+//
+//  ArkavoTestBridge+Hierarchy.m
+//  Builds view hierarchies from one XCUIElementSnapshot fetch
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+typedef NS_OPTIONS(NSUInteger, ArkavoHierarchyAttributes) {
+    ArkavoHierarchyType = 1 << 0,
+    ArkavoHierarchyIdentifier = 1 << 1,
+    ArkavoHierarchyLabel = 1 << 2,
+    ArkavoHierarchyValue = 1 << 3,
+    ArkavoHierarchyTitle = 1 << 4,
+    ArkavoHierarchyPlaceholder = 1 << 5,
+    ArkavoHierarchyEnabled = 1 << 6,
+    ArkavoHierarchySelected = 1 << 7,
+    ArkavoHierarchyFocused = 1 << 8,
+    ArkavoHierarchyFrame = 1 << 9,
+};
+
+// Matches the fields captureViewHierarchy has always reported.
+static const ArkavoHierarchyAttributes kDefaultAttributes =
+    ArkavoHierarchyType | ArkavoHierarchyIdentifier | ArkavoHierarchyLabel |
+    ArkavoHierarchyEnabled | ArkavoHierarchySelected;
+
+static ArkavoHierarchyAttributes attributesFromNames(NSArray *names) {
+    if (![names isKindOfClass:[NSArray class]] || names.count == 0) return kDefaultAttributes;
+
+    NSDictionary<NSString *, NSNumber *> *known = @{
+        @"type": @(ArkavoHierarchyType),
+        @"identifier": @(ArkavoHierarchyIdentifier),
+        @"label": @(ArkavoHierarchyLabel),
+        @"value": @(ArkavoHierarchyValue),
+        @"title": @(ArkavoHierarchyTitle),
+        @"placeholder": @(ArkavoHierarchyPlaceholder),
+        @"enabled": @(ArkavoHierarchyEnabled),
+        @"selected": @(ArkavoHierarchySelected),
+        @"focused": @(ArkavoHierarchyFocused),
+        @"frame": @(ArkavoHierarchyFrame),
+    };
+    ArkavoHierarchyAttributes attributes = 0;
+    for (id name in names) {
+        if ([name isKindOfClass:[NSString class]]) attributes |= known[name].unsignedIntegerValue;
+    }
+    return attributes ?: kDefaultAttributes;
+}
+
+// Snapshots are plain values already resident in this process, so walking
+// them costs no further accessibility queries.
+static NSDictionary *dictionaryForSnapshot(id<XCUIElementSnapshot> snapshot, NSInteger depth, NSInteger maxDepth,
+                                           ArkavoHierarchyAttributes attributes) {
+    NSMutableDictionary *node = [NSMutableDictionary dictionary];
+    if (attributes & ArkavoHierarchyType) node[@"type"] = @(snapshot.elementType);
+    if (attributes & ArkavoHierarchyIdentifier) node[@"identifier"] = snapshot.identifier ?: @"";
+    if (attributes & ArkavoHierarchyLabel) node[@"label"] = snapshot.label ?: @"";
+    if (attributes & ArkavoHierarchyValue) node[@"value"] = [snapshot.value description] ?: @"";
+    if (attributes & ArkavoHierarchyTitle) node[@"title"] = snapshot.title ?: @"";
+    if (attributes & ArkavoHierarchyPlaceholder) node[@"placeholder"] = snapshot.placeholderValue ?: @"";
+    if (attributes & ArkavoHierarchyEnabled) node[@"enabled"] = @(snapshot.enabled);
+    if (attributes & ArkavoHierarchySelected) node[@"selected"] = @(snapshot.selected);
+    if (attributes & ArkavoHierarchyFocused) node[@"focused"] = @(snapshot.hasFocus);
+    if (attributes & ArkavoHierarchyFrame) {
+        CGRect frame = snapshot.frame;
+        node[@"frame"] = @{@"x": @(frame.origin.x), @"y": @(frame.origin.y),
+                           @"width": @(frame.size.width), @"height": @(frame.size.height)};
+    }
+
+    NSArray<id<XCUIElementSnapshot>> *children = snapshot.children;
+    if (children.count == 0) return node;
+
+    // Cut-off nodes keep their child count so callers can fetch that subtree
+    // next with it as the root.
+    if (maxDepth > 0 && depth >= maxDepth) {
+        node[@"childCount"] = @(children.count);
+        return node;
+    }
+
+    NSMutableArray *childNodes = [NSMutableArray arrayWithCapacity:children.count];
+    for (id<XCUIElementSnapshot> child in children) {
+        [childNodes addObject:dictionaryForSnapshot(child, depth + 1, maxDepth, attributes)];
+    }
+    node[@"children"] = childNodes;
+    return node;
+}
+
+@implementation ArkavoTestBridge (Hierarchy)
+
+- (nullable NSDictionary *)hierarchyWithOptions:(NSDictionary *)options error:(NSError **)error {
+    XCUIElement *root = self.app;
+    NSString *rootIdentifier = options[@"root"];
+    if ([rootIdentifier isKindOfClass:[NSString class]]) {
+        root = [self findElement:@{@"identifier": rootIdentifier}];
+    }
+
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "query.snapshot", NULL);
+    id<XCUIElementSnapshot> snapshot = [root snapshotWithError:error];
+    ArkavoMetricsEnd(&span);
+    if (!snapshot) return nil;
+
+    NSInteger maxDepth = [options[@"max_depth"] integerValue];
+    return dictionaryForSnapshot(snapshot, 0, maxDepth, attributesFromNames(options[@"attributes"]));
+}
+
+- (NSDictionary *)captureViewHierarchy {
+    return [self hierarchyWithOptions:@{} error:nil] ?: @{};
+}
+
+- (NSDictionary *)performQueryUI:(NSDictionary *)params {
+    NSError *error = nil;
+    NSDictionary *tree = [self hierarchyWithOptions:params ?: @{} error:&error];
+    if (!tree) {
+        return [self errorResult:@"Failed to snapshot view hierarchy" error:error];
+    }
+    return [self successResult:@{@"action": @"query_ui", @"tree": tree}];
+}
+
+@end
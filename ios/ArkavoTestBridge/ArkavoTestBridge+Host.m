@@ -0,0 +1,261 @@
+//
+//  ArkavoTestBridge+Host.m
+//  Serves the bridge on a Unix socket so one resident runner outlives sessions
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <unistd.h>
+
+// Every message in either direction is one frame. Integers are little-endian:
+//
+//   0   u32 payload length
+//   4   u16 kind
+//   6   u16 flags, zero
+//   8   u32 request id, echoed by the reply
+//   12  payload
+//
+// Requests are ping (empty), attach (target bundle id), action (u16 name
+// length, name, params JSON), batch (actions JSON) and shutdown (empty). A
+// reply carries the request's kind with the reply bit set and a JSON result.
+// Requests on one connection are answered in order.
+typedef NS_ENUM(uint16_t, ArkavoHostKind) {
+    ArkavoHostPing = 1,
+    ArkavoHostAttach = 2,
+    ArkavoHostAction = 3,
+    ArkavoHostBatch = 4,
+    ArkavoHostShutdown = 5,
+};
+
+static const char *kKindNames[] = {"unknown", "ping", "attach", "action", "batch", "shutdown"};
+static const uint16_t kReplyBit = 0x8000;
+enum { kFrameHeaderSize = 12 };
+// Batches and params are a few kilobytes; anything this large is a client
+// that lost its framing, and the connection is dropped.
+static const uint32_t kMaxPayload = 64u * 1024 * 1024;
+static const NSTimeInterval kRunLoopSlice = 0.25;
+
+// One host per runner process. Only the main thread touches the attached
+// bundle id; the stop flag is set by whichever client asked for it.
+static int listenFd = -1;
+static int stopRequested = 0;
+static NSString *hostSocketPath = nil;
+static NSString *attachedBundleId = nil;
+static NSTimeInterval hostStarted = 0;
+
+static void putU16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t getU16(const uint8_t *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static BOOL readFully(int fd, void *buffer, size_t length) {
+    uint8_t *bytes = (uint8_t *)buffer;
+    while (length > 0) {
+        ssize_t count = read(fd, bytes, length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return NO;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return YES;
+}
+
+static BOOL writeFully(int fd, const void *buffer, size_t length) {
+    const uint8_t *bytes = (const uint8_t *)buffer;
+    while (length > 0) {
+        ssize_t count = write(fd, bytes, length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return NO;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return YES;
+}
+
+static BOOL sendReply(int fd, uint16_t kind, uint32_t requestId, NSData *payload) {
+    uint8_t header[kFrameHeaderSize];
+    putU32(header, (uint32_t)payload.length);
+    putU16(header + 4, kind | kReplyBit);
+    putU16(header + 6, 0);
+    putU32(header + 8, requestId);
+    return writeFully(fd, header, sizeof(header)) && writeFully(fd, payload.bytes, payload.length);
+}
+
+static NSError *posixError(NSString *message) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain
+                               code:errno
+                           userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"%@: %s", message, strerror(errno)]}];
+}
+
+// Splits an action request into its name and params ("{}" when empty).
+// Returns why it is malformed, or nil.
+static NSString *decodeAction(NSData *payload, NSString **action, NSData **params) {
+    const uint8_t *bytes = (const uint8_t *)payload.bytes;
+    size_t nameLength = payload.length >= 2 ? getU16(bytes) : SIZE_MAX;
+    if (nameLength == SIZE_MAX || payload.length - 2 < nameLength) return @"Malformed action request";
+    *action = [[NSString alloc] initWithBytes:bytes + 2 length:nameLength encoding:NSUTF8StringEncoding];
+    if (!*action) return @"Action name is not UTF-8";
+    *params = [payload subdataWithRange:NSMakeRange(2 + nameLength, payload.length - 2 - nameLength)];
+    if (!(*params).length) *params = [NSData dataWithBytes:"{}" length:2];
+    return nil;
+}
+
+@implementation ArkavoTestBridge (Host)
+
+// Re-attaching to the app already under test only brings it forward, so
+// its process, state and the element cache survive from one session to the
+// next. activate launches the app when it is not running, without the
+// terminate-and-relaunch that launch always does.
+- (NSDictionary *)attachToBundleIdentifier:(NSString *)bundleId {
+    if (bundleId.length == 0) {
+        return [self errorResult:@"Attach requires a bundle identifier" error:nil];
+    }
+    BOOL reused = [bundleId isEqualToString:attachedBundleId] && self.app.state != XCUIApplicationStateNotRunning;
+    if (!reused) {
+        [self setApp:[[XCUIApplication alloc] initWithBundleIdentifier:bundleId]];
+        [self invalidateElementCache];
+        attachedBundleId = [bundleId copy];
+    }
+    if (self.app.state != XCUIApplicationStateRunningForeground) {
+        [self.app activate];
+    }
+    return [self successResult:@{@"action": @"attach", @"bundle_id": bundleId, @"reused": @(reused),
+                                 @"state": @(self.app.state)}];
+}
+
+- (NSDictionary *)hostResultForKind:(uint16_t)kind payload:(NSData *)payload {
+    switch (kind) {
+        case ArkavoHostPing:
+            return [self successResult:@{
+                @"pid": @(getpid()),
+                @"bundle_id": attachedBundleId ?: [NSNull null],
+                @"uptime_ms": @(([NSProcessInfo processInfo].systemUptime - hostStarted) * 1000.0)
+            }];
+        case ArkavoHostAttach: {
+            NSString *bundleId = [[NSString alloc] initWithData:payload encoding:NSUTF8StringEncoding];
+            return [self attachToBundleIdentifier:bundleId ?: @""];
+        }
+        case ArkavoHostAction: {
+            NSString *action = nil;
+            NSData *params = nil;
+            NSString *malformed = decodeAction(payload, &action, &params);
+            if (malformed) return [self errorResult:malformed error:nil];
+            return [self resultForAction:action paramsData:params];
+        }
+        case ArkavoHostBatch: {
+            NSString *actions = [[NSString alloc] initWithData:payload encoding:NSUTF8StringEncoding];
+            return [self batchResultForActions:actions ?: @""];
+        }
+        case ArkavoHostShutdown:
+            return [self successResult:@{@"action": @"shutdown"}];
+        default:
+            return [self errorResult:[NSString stringWithFormat:@"Unknown host request %u", kind] error:nil];
+    }
+}
+
+- (void)serveClient:(int)fd {
+    int noSigpipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+
+    uint8_t header[kFrameHeaderSize];
+    while (readFully(fd, header, sizeof(header))) {
+        uint32_t length = getU32(header);
+        uint16_t kind = getU16(header + 4);
+        uint32_t requestId = getU32(header + 8);
+        if (length > kMaxPayload) break;
+        NSMutableData *payload = [NSMutableData dataWithLength:length];
+        if (length && !readFully(fd, payload.mutableBytes, length)) break;
+
+        // A plain wait is timed on this connection's thread, which keeps its
+        // replies in order without holding the main queue from other clients.
+        NSString *action = nil;
+        NSData *params = nil;
+        BOOL isAction = kind == ArkavoHostAction && !decodeAction(payload, &action, &params);
+        __block NSData *reply = nil;
+        if (isAction) reply = [ArkavoWaitOffMainThread(self, action, params) dataUsingEncoding:NSUTF8StringEncoding];
+        if (!reply) ArkavoRunOnMainThread(^{
+            @autoreleasepool {
+                ArkavoMetricsSpan span;
+                ArkavoMetricsBegin(&span, "host", kKindNames[kind <= ArkavoHostShutdown ? kind : 0]);
+                reply = [self jsonDataFromDictionary:[self hostResultForKind:kind payload:payload]];
+                ArkavoMetricsEnd(&span);
+            }
+        });
+        BOOL sent = sendReply(fd, kind, requestId, reply);
+        // Stopping only after the reply is out lets the client tell a clean
+        // shutdown from a runner that died.
+        if (kind == ArkavoHostShutdown) __atomic_store_n(&stopRequested, 1, __ATOMIC_RELEASE);
+        if (!sent) break;
+    }
+    close(fd);
+}
+
+- (BOOL)serveAtPath:(NSString *)path error:(NSError **)error {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (path.UTF8String == NULL || strlen(path.UTF8String) >= sizeof(address.sun_path)) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                         code:ENAMETOOLONG
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Socket path is too long"}];
+        }
+        return NO;
+    }
+    strlcpy(address.sun_path, path.UTF8String, sizeof(address.sun_path));
+
+    // A runner that crashed leaves its socket file behind, and bind refuses
+    // a path that exists.
+    unlink(address.sun_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        if (error) *error = posixError(@"Failed to listen on runner socket");
+        if (fd >= 0) close(fd);
+        return NO;
+    }
+
+    listenFd = fd;
+    hostSocketPath = [path copy];
+    hostStarted = [NSProcessInfo processInfo].systemUptime;
+    [NSThread detachNewThreadWithBlock:^{
+        for (;;) {
+            int client = accept(fd, NULL, NULL);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                [self serveClient:client];
+            });
+        }
+    }];
+    return YES;
+}
+
+// Bridge calls from client threads run on the main queue, which only drains
+// while this loop keeps the main run loop turning.
+- (void)runUntilShutdown {
+    while (!__atomic_load_n(&stopRequested, __ATOMIC_ACQUIRE)) {
+        @autoreleasepool {
+            [[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode
+                                  beforeDate:[NSDate dateWithTimeIntervalSinceNow:kRunLoopSlice]];
+        }
+    }
+    if (listenFd >= 0) close(listenFd);
+    listenFd = -1;
+    if (hostSocketPath) unlink(hostSocketPath.UTF8String);
+}
+
+@end
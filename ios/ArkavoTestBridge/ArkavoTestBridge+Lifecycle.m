@@ -0,0 +1,80 @@
+//
+//  ArkavoTestBridge+Lifecycle.m
+//  State changes as deep links into the running app, relaunching only when it cannot take them
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+// A link the app does not answer would hold up every state change; past
+// this, relaunching is the faster way.
+static const NSTimeInterval kWarmTimeout = 1.5;
+
+@implementation ArkavoTestBridge (Lifecycle)
+
+// The request's "scheme", else ARKAVO_APP_URL_SCHEME from the runner's
+// environment. Only apps that speak the warm-reset protocol
+// (ArkavoReference's LaunchCommand) should name one: XCUITest cannot read
+// the app's probe, so a link the app ignores still counts as applied.
+- (nullable NSString *)appURLScheme:(nullable NSDictionary *)options {
+    id scheme = options[@"scheme"] ?: NSProcessInfo.processInfo.environment[@"ARKAVO_APP_URL_SCHEME"];
+    return [scheme isKindOfClass:[NSString class]] && [scheme length] > 0 ? scheme : nil;
+}
+
+// "warm" once the running app took the link, else "cold" after a relaunch
+// with arguments asking for the same state.
+- (NSString *)applyInApp:(NSString *)host path:(nullable NSString *)path query:(NSDictionary<NSString *, NSString *> *)query
+               arguments:(NSArray<NSString *> *)arguments scheme:(nullable NSString *)scheme {
+    ArkavoMetricsSpan span;
+    if (@available(iOS 16.4, *)) {
+        if (scheme) {
+            NSURLComponents *link = [[NSURLComponents alloc] init];
+            link.scheme = scheme;
+            link.host = host;
+            link.path = path ? [@"/" stringByAppendingString:path] : nil;
+            NSMutableArray<NSURLQueryItem *> *items = [NSMutableArray array];
+            [query enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop) {
+                [items addObject:[NSURLQueryItem queryItemWithName:name value:value]];
+            }];
+            link.queryItems = items.count ? items : nil;
+
+            ArkavoMetricsBegin(&span, "lifecycle", "warm");
+            [self.app openURL:link.URL];
+            BOOL applied = [self.app waitForState:XCUIApplicationStateRunningForeground timeout:kWarmTimeout];
+            ArkavoMetricsEnd(&span);
+            [self invalidateElementCache];
+            if (applied) return @"warm";
+        }
+    }
+
+    // The arguments are for this launch only; a later attach launches the
+    // app plain.
+    ArkavoMetricsBegin(&span, "lifecycle", "relaunch");
+    NSArray<NSString *> *previous = self.app.launchArguments;
+    [self.app terminate];
+    self.app.launchArguments = arguments;
+    [self.app launch];
+    self.app.launchArguments = previous;
+    ArkavoMetricsEnd(&span);
+    [self invalidateElementCache];
+    return @"cold";
+}
+
+- (NSDictionary *)performLogin:(nullable NSString *)data {
+    NSData *json = [data dataUsingEncoding:NSUTF8StringEncoding];
+    id options = json.length ? [NSJSONSerialization JSONObjectWithData:json options:0 error:nil] : nil;
+    if (![options isKindOfClass:[NSDictionary class]]) options = nil;
+    NSString *user = [options[@"user"] isKindOfClass:[NSString class]] ? options[@"user"] : @"test-user";
+
+    NSString *method = [self applyInApp:@"reset" path:nil query:@{@"user": user}
+                              arguments:@[@"--test-user-logged-in", @"-ArkavoUser", user]
+                                 scheme:[self appURLScheme:options]];
+    return [self successResult:@{@"entity": @"user", @"action": @"login", @"user": user, @"method": method}];
+}
+
+- (NSString *)openScreenInApp:(NSString *)screen {
+    return [self applyInApp:@"screen" path:screen query:@{}
+                  arguments:@[@"--open-screen", screen, @"-ArkavoScreen", screen]
+                     scheme:[self appURLScheme:nil]];
+}
+
+@end
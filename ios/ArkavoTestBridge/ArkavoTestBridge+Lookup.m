@@ -0,0 +1,151 @@
+//
+//  ArkavoTestBridge+Lookup.m
+//  Resolves element params to type-narrowed queries, or to frames already
+//  read from the last hierarchy snapshot
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <objc/runtime.h>
+
+static const void *kElementCacheKey = &kElementCacheKey;
+static const void *kFrameCacheKey = &kFrameCacheKey;
+static const void *kFrameHashKey = &kFrameHashKey;
+// Bounds the cache on screens that generate many distinct lookups, such as
+// long lists addressed by label.
+static const NSUInteger kElementCacheLimit = 256;
+
+static XCUIElementType elementTypeNamed(NSString *name) {
+    static NSDictionary<NSString *, NSNumber *> *types;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        types = @{
+            @"button": @(XCUIElementTypeButton),
+            @"textField": @(XCUIElementTypeTextField),
+            @"secureTextField": @(XCUIElementTypeSecureTextField),
+            @"textView": @(XCUIElementTypeTextView),
+            @"searchField": @(XCUIElementTypeSearchField),
+            @"switch": @(XCUIElementTypeSwitch),
+            @"slider": @(XCUIElementTypeSlider),
+            @"staticText": @(XCUIElementTypeStaticText),
+            @"image": @(XCUIElementTypeImage),
+            @"cell": @(XCUIElementTypeCell),
+            @"link": @(XCUIElementTypeLink),
+            @"navigationBar": @(XCUIElementTypeNavigationBar),
+            @"tab": @(XCUIElementTypeTab),
+        };
+    });
+    NSNumber *type = [name isKindOfClass:[NSString class]] ? types[name] : nil;
+    return type ? (XCUIElementType)type.unsignedIntegerValue : XCUIElementTypeAny;
+}
+
+// Parsing predicate formats is not free, so each shape is compiled once and
+// only its variables are substituted per lookup.
+static NSPredicate *matchPredicate(NSString *identifier, NSString *label) {
+    static NSPredicate *both;
+    static NSPredicate *labelOnly;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        both = [NSPredicate predicateWithFormat:@"identifier == $IDENTIFIER AND label == $LABEL"];
+        labelOnly = [NSPredicate predicateWithFormat:@"label == $LABEL"];
+    });
+
+    if (identifier && label) {
+        return [both predicateWithSubstitutionVariables:@{@"IDENTIFIER": identifier, @"LABEL": label}];
+    }
+    return [labelOnly predicateWithSubstitutionVariables:@{@"LABEL": label}];
+}
+
+static NSString *lookupKey(XCUIElementType type, NSString *identifier, NSString *label) {
+    return [NSString stringWithFormat:@"%lu\x1f%@\x1f%@", (unsigned long)type, identifier ?: @"", label ?: @""];
+}
+
+// Pre-order, like the query it stands in for, so the first frame recorded
+// under a key is the element firstMatch would have found.
+static void collectFrames(id<XCUIElementSnapshot> snapshot, BOOL isRoot, NSMutableDictionary *frames) {
+    CGRect frame = snapshot.frame;
+    if (!isRoot && !CGRectIsEmpty(frame)) {
+        NSString *identifier = snapshot.identifier.length ? snapshot.identifier : nil;
+        NSString *label = snapshot.label.length ? snapshot.label : nil;
+        NSValue *value = [NSValue valueWithCGRect:frame];
+        for (NSNumber *type in @[@(snapshot.elementType), @(XCUIElementTypeAny)]) {
+            XCUIElementType elementType = (XCUIElementType)type.unsignedIntegerValue;
+            NSMutableArray *keys = [NSMutableArray array];
+            if (identifier) [keys addObject:lookupKey(elementType, identifier, nil)];
+            if (label) [keys addObject:lookupKey(elementType, nil, label)];
+            if (identifier && label) [keys addObject:lookupKey(elementType, identifier, label)];
+            for (NSString *key in keys) frames[key] = frames[key] ?: value;
+        }
+    }
+    for (id<XCUIElementSnapshot> child in snapshot.children) collectFrames(child, NO, frames);
+}
+
+@implementation ArkavoTestBridge (Lookup)
+
+- (NSMutableDictionary<NSString *, XCUIElement *> *)elementCache {
+    NSMutableDictionary *cache = objc_getAssociatedObject(self, kElementCacheKey);
+    if (!cache) {
+        cache = [NSMutableDictionary dictionary];
+        objc_setAssociatedObject(self, kElementCacheKey, cache, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return cache;
+}
+
+- (void)invalidateElementCache {
+    [objc_getAssociatedObject(self, kElementCacheKey) removeAllObjects];
+    [self forgetResolvedFrames];
+}
+
+- (void)recordFramesFromSnapshot:(id<XCUIElementSnapshot>)snapshot hash:(NSString *)hash {
+    NSMutableDictionary *frames = [NSMutableDictionary dictionary];
+    collectFrames(snapshot, YES, frames);
+    objc_setAssociatedObject(self, kFrameCacheKey, frames, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(self, kFrameHashKey, hash, OBJC_ASSOCIATION_COPY_NONATOMIC);
+}
+
+- (void)forgetResolvedFrames {
+    objc_setAssociatedObject(self, kFrameCacheKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(self, kFrameHashKey, nil, OBJC_ASSOCIATION_COPY_NONATOMIC);
+}
+
+// Taps at the frame the last snapshot recorded, which skips resolving the
+// query against the live hierarchy. nil when there is no such frame.
+- (nullable NSDictionary *)performResolvedTap:(NSDictionary *)params {
+    NSString *identifier = [params[@"identifier"] isKindOfClass:[NSString class]] ? params[@"identifier"] : nil;
+    NSString *label = [params[@"label"] isKindOfClass:[NSString class]] ? params[@"label"] : nil;
+    NSDictionary *frames = objc_getAssociatedObject(self, kFrameCacheKey);
+    NSValue *value = identifier || label ? frames[lookupKey(elementTypeNamed(params[@"type"]), identifier, label)] : nil;
+    if (!value) return nil;
+
+    CGRect frame = value.CGRectValue;
+    XCUICoordinate *origin = [self.app coordinateWithNormalizedOffset:CGVectorMake(0, 0)];
+    [[origin coordinateWithOffset:CGVectorMake(CGRectGetMidX(frame), CGRectGetMidY(frame))] tap];
+    return [self successResult:@{@"action": @"tap", @"element": identifier ?: @"unknown",
+                                 @"state_hash": objc_getAssociatedObject(self, kFrameHashKey) ?: [NSNull null]}];
+}
+
+- (XCUIElement *)findElement:(NSDictionary *)params {
+    NSString *identifier = [params[@"identifier"] isKindOfClass:[NSString class]] ? params[@"identifier"] : nil;
+    NSString *label = [params[@"label"] isKindOfClass:[NSString class]] ? params[@"label"] : nil;
+    XCUIElementType type = elementTypeNamed(params[@"type"]);
+
+    NSString *key = lookupKey(type, identifier, label);
+    NSMutableDictionary<NSString *, XCUIElement *> *cache = [self elementCache];
+    XCUIElement *element = cache[key];
+    if (element) return element;
+
+    XCUIElementQuery *query = [self.app descendantsMatchingType:type];
+    if (label) {
+        query = [query matchingPredicate:matchPredicate(identifier, label)];
+    } else if (identifier) {
+        query = [query matchingIdentifier:identifier];
+    }
+
+    // firstMatch is lazy: it resolves the query again each time it is used,
+    // so the cache saves building the query, not searching the hierarchy.
+    element = query.firstMatch;
+    if (cache.count >= kElementCacheLimit) [cache removeAllObjects];
+    cache[key] = element;
+    return element;
+}
+
+@end
@@ -0,0 +1,43 @@
+//
+//  ArkavoTestBridge+Metrics.m
+//  Times actions and copies across the C interface; the histograms, their
+//  signposts and ios_bridge_get_metrics live in the shared ios_metrics.c
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+char *ArkavoCopyCString(NSString *string) {
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "ffi.copy", NULL);
+    char *copy = string ? strdup(string.UTF8String) : NULL;
+    ArkavoMetricsEnd(&span);
+    return copy;
+}
+
+void *ArkavoCopyBytes(NSData *data) {
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "ffi.copy", NULL);
+    void *copy = malloc(MAX(data.length, (NSUInteger)1));
+    if (copy) memcpy(copy, data.bytes, data.length);
+    ArkavoMetricsEnd(&span);
+    return copy;
+}
+
+@implementation ArkavoTestBridge (Metrics)
+
+// Every entry point funnels through here, so each action is timed once.
+// Unrecognized names share one histogram rather than claiming slots.
+- (NSDictionary *)resultForAction:(NSString *)action params:(NSDictionary *)params {
+    static NSSet<NSString *> *known;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        known = [NSSet setWithArray:@[@"tap", @"type", @"swipe", @"wait", @"assert", @"wait_for", @"query_ui"]];
+    });
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "action", [known containsObject:action] ? action.UTF8String : "unknown");
+    NSDictionary *result = [self performAction:action params:params];
+    ArkavoMetricsEnd(&span);
+    return result;
+}
+
+@end
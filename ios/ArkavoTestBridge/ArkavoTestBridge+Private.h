@@ -0,0 +1,108 @@
+//
+//  ArkavoTestBridge+Private.h
+//  Methods shared between ArkavoTestBridge and its categories
+//
+
+#import "ArkavoTestBridge.h"
+#include "ios_metrics.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface ArkavoTestBridge (Private)
+
+- (XCUIApplication *)app;
+- (void)setApp:(XCUIApplication *)app;
+- (XCUIElement *)findElement:(NSDictionary *)params;
+- (void)invalidateElementCache;
+// Element frames read from a hierarchy snapshot, good only until the next
+// action changes the screen (ArkavoTestBridge+Lookup.m).
+- (void)recordFramesFromSnapshot:(id<XCUIElementSnapshot>)snapshot hash:(NSString *)hash;
+- (void)forgetResolvedFrames;
+- (nullable NSDictionary *)performResolvedTap:(NSDictionary *)params;
+
+- (NSDictionary *)resultForAction:(NSString *)action params:(NSDictionary *)params;
+- (NSDictionary *)performAction:(NSString *)action params:(NSDictionary *)params;
+- (NSDictionary *)performType:(NSDictionary *)params;
+// nil unless the params give screen points instead of an element.
+- (nullable NSDictionary *)performCoordinateTap:(NSDictionary *)params;
+- (nullable NSDictionary *)performCoordinateSwipe:(NSDictionary *)params;
+- (NSDictionary *)resultForAction:(NSString *)action paramsData:(NSData *)params;
+- (NSDictionary *)successResult:(NSDictionary *)data;
+- (NSDictionary *)errorResult:(nullable NSString *)message error:(nullable NSError *)error;
+- (NSString *)jsonStringFromDictionary:(NSDictionary *)dict;
+- (NSData *)jsonDataFromDictionary:(NSDictionary *)dict;
+- (NSString *)errorResponse:(NSString *)message error:(nullable NSError *)error;
+- (NSDictionary *)batchResultForActions:(NSString *)actionsJSON;
+- (NSDictionary *)waitUntilSettled:(NSDictionary *)params;
+- (NSDictionary *)performWaitFor:(NSDictionary *)params;
+- (BOOL)element:(XCUIElement *)element satisfies:(NSString *)condition value:(nullable id)value within:(NSTimeInterval)timeout;
+- (nullable NSDictionary *)hierarchyWithOptions:(NSDictionary *)options error:(NSError **)error;
+- (NSDictionary *)captureViewHierarchy;
+- (NSDictionary *)performQueryUI:(NSDictionary *)params;
+- (NSDictionary *)screenAnalysis;
+- (NSString *)identifyCurrentScreen;
+// Deep links into the running app before any relaunch; both report
+// "warm" or "cold" (ArkavoTestBridge+Lifecycle.m).
+- (NSDictionary *)performLogin:(nullable NSString *)data;
+- (NSString *)openScreenInApp:(NSString *)screen;
+- (nullable NSData *)snapshotRecord;
+- (nullable NSString *)screenInSnapshot:(NSData *)snapshot;
+
+@end
+
+// Field tags of the snapshot record, matching IOSSnapshotTag on the native side.
+typedef NS_ENUM(uint16_t, ArkavoSnapshotTag) {
+    ArkavoSnapshotDeviceId = 1,
+    ArkavoSnapshotBundleId = 2,
+    ArkavoSnapshotTimestampMs = 3,
+    ArkavoSnapshotClonePath = 4,
+    ArkavoSnapshotScreen = 5,
+    ArkavoSnapshotHierarchy = 6,
+};
+
+FOUNDATION_EXPORT NSData * _Nullable ArkavoSnapshotEncode(NSArray<NSNumber *> *tags, NSArray<NSData *> *values);
+FOUNDATION_EXPORT BOOL ArkavoSnapshotIsValid(NSData *snapshot);
+FOUNDATION_EXPORT NSData * _Nullable ArkavoSnapshotField(NSData *snapshot, uint16_t tag);
+
+// Times one operation into the histogram named "<kind>.<detail>" (just kind
+// when detail is NULL), and into an os_signpost interval when ARKAVO_SIGNPOSTS
+// is set. The histograms are the native bridge's own ios_metrics.c, so both
+// bridges report the same names at the same precision.
+typedef IOSMetricsSpan ArkavoMetricsSpan;
+
+static inline void ArkavoMetricsBegin(ArkavoMetricsSpan *span, const char *kind, const char * _Nullable detail) {
+    ios_metrics_begin(span, kind, detail);
+}
+
+static inline void ArkavoMetricsEnd(ArkavoMetricsSpan *span) {
+    ios_metrics_end(span);
+}
+
+// malloc'd copies handed across the C interface, timed as "ffi.copy".
+FOUNDATION_EXPORT char * _Nullable ArkavoCopyCString(NSString * _Nullable string);
+FOUNDATION_EXPORT void * _Nullable ArkavoCopyBytes(NSData *data);
+
+// How long a plain "wait" action lasts, or a negative value for any other
+// action or params that are not an object.
+FOUNDATION_EXPORT NSTimeInterval ArkavoPlainWaitDuration(NSString *action, id _Nullable params);
+// A plain wait touches no UI, so an entry point called off the main thread
+// times it on the calling thread and leaves the main queue to other
+// callers. Returns the reply once the wait is over, or nil (at once) for any
+// other action or when called on the main thread.
+FOUNDATION_EXPORT NSString * _Nullable ArkavoWaitOffMainThread(ArkavoTestBridge *bridge, NSString *action,
+                                                               NSData * _Nullable params);
+
+// XCUITest must be driven from the main thread, but the C interface is called
+// from whichever thread the Rust runner is on. Entry points run through this,
+// which also serializes them on the main queue. A caller blocking the main
+// thread while waiting on another thread's bridge call would deadlock, so the
+// host keeps the main run loop serviced instead.
+static inline void ArkavoRunOnMainThread(dispatch_block_t block) {
+    if ([NSThread isMainThread]) {
+        block();
+    } else {
+        dispatch_sync(dispatch_get_main_queue(), block);
+    }
+}
+
+NS_ASSUME_NONNULL_END
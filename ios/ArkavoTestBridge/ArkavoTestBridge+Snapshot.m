@@ -0,0 +1,124 @@
+//
+//  ArkavoTestBridge+Snapshot.m
+//  Reads and writes the snapshot records shared with the native simctl bridge
+//
+
+#import "ArkavoTestBridge+Private.h"
+
+// Mirrors ios_snapshot_format.h in the Rust crate: a 16-byte header followed
+// by a table of 12-byte entries, every integer little-endian.
+static const char kSnapshotMagic[4] = {'A', 'R', 'K', 'S'};
+static const uint16_t kSnapshotVersion = 1;
+static const NSUInteger kHeaderSize = 16;
+static const NSUInteger kEntrySize = 12;
+
+static void putU16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t getU16(const uint8_t *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+NSData *ArkavoSnapshotEncode(NSArray<NSNumber *> *tags, NSArray<NSData *> *values) {
+    NSUInteger count = MIN(tags.count, values.count);
+    NSUInteger size = kHeaderSize + count * kEntrySize;
+    for (NSUInteger i = 0; i < count; i++) size += values[i].length;
+    if (count > UINT16_MAX || size > UINT32_MAX) return nil;
+
+    NSMutableData *record = [NSMutableData dataWithLength:size];
+    uint8_t *bytes = record.mutableBytes;
+    memcpy(bytes, kSnapshotMagic, sizeof(kSnapshotMagic));
+    putU16(bytes + 4, kSnapshotVersion);
+    putU16(bytes + 6, (uint16_t)count);
+    putU32(bytes + 8, (uint32_t)size);
+
+    NSUInteger offset = kHeaderSize + count * kEntrySize;
+    for (NSUInteger i = 0; i < count; i++) {
+        uint8_t *entry = bytes + kHeaderSize + i * kEntrySize;
+        putU16(entry, tags[i].unsignedShortValue);
+        putU32(entry + 4, (uint32_t)offset);
+        putU32(entry + 8, (uint32_t)values[i].length);
+        memcpy(bytes + offset, values[i].bytes, values[i].length);
+        offset += values[i].length;
+    }
+    return record;
+}
+
+BOOL ArkavoSnapshotIsValid(NSData *snapshot) {
+    const uint8_t *bytes = snapshot.bytes;
+    NSUInteger size = snapshot.length;
+    if (size < kHeaderSize || memcmp(bytes, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return NO;
+    if (getU16(bytes + 4) != kSnapshotVersion || getU32(bytes + 8) != size) return NO;
+
+    NSUInteger count = getU16(bytes + 6);
+    NSUInteger tableEnd = kHeaderSize + count * kEntrySize;
+    if (tableEnd > size) return NO;
+    for (NSUInteger i = 0; i < count; i++) {
+        const uint8_t *entry = bytes + kHeaderSize + i * kEntrySize;
+        NSUInteger offset = getU32(entry + 4);
+        NSUInteger length = getU32(entry + 8);
+        if (offset < tableEnd || offset > size || length > size - offset) return NO;
+    }
+    return YES;
+}
+
+// The returned data points into the record rather than copying the field.
+NSData *ArkavoSnapshotField(NSData *snapshot, uint16_t tag) {
+    if (!ArkavoSnapshotIsValid(snapshot)) return nil;
+
+    const uint8_t *bytes = snapshot.bytes;
+    NSUInteger count = getU16(bytes + 6);
+    for (NSUInteger i = 0; i < count; i++) {
+        const uint8_t *entry = bytes + kHeaderSize + i * kEntrySize;
+        if (getU16(entry) == tag) {
+            return [snapshot subdataWithRange:NSMakeRange(getU32(entry + 4), getU32(entry + 8))];
+        }
+    }
+    return nil;
+}
+
+@implementation ArkavoTestBridge (Snapshot)
+
+// The test runner cannot reach its target's data container, so a snapshot
+// records where the app was rather than what it had stored.
+- (NSData *)snapshotRecord {
+    NSMutableArray<NSNumber *> *tags = [NSMutableArray array];
+    NSMutableArray<NSData *> *values = [NSMutableArray array];
+
+    NSString *device = NSProcessInfo.processInfo.environment[@"SIMULATOR_UDID"];
+    if (device.length > 0) {
+        [tags addObject:@(ArkavoSnapshotDeviceId)];
+        [values addObject:[device dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+
+    uint8_t timestamp[8];
+    uint64_t milliseconds = (uint64_t)([[NSDate date] timeIntervalSince1970] * 1000.0);
+    for (int i = 0; i < 8; i++) timestamp[i] = (uint8_t)(milliseconds >> (8 * i));
+    [tags addObject:@(ArkavoSnapshotTimestampMs)];
+    [values addObject:[NSData dataWithBytes:timestamp length:sizeof(timestamp)]];
+
+    [tags addObject:@(ArkavoSnapshotScreen)];
+    [values addObject:[[self identifyCurrentScreen] dataUsingEncoding:NSUTF8StringEncoding]];
+
+    [tags addObject:@(ArkavoSnapshotHierarchy)];
+    [values addObject:[self jsonDataFromDictionary:[self captureViewHierarchy]]];
+
+    return ArkavoSnapshotEncode(tags, values);
+}
+
+- (nullable NSString *)screenInSnapshot:(NSData *)snapshot {
+    NSData *screen = ArkavoSnapshotField(snapshot, ArkavoSnapshotScreen);
+    return screen ? [[NSString alloc] initWithData:screen encoding:NSUTF8StringEncoding] : nil;
+}
+
+@end
@@ -0,0 +1,116 @@
+//
+//  ArkavoTestBridge+Typing.m
+//  Text entry that skips redundant focus taps and pastes long text
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <UIKit/UIKit.h>
+
+// typeText: synthesizes one key event per character, so past a few dozen
+// characters a single paste is faster, and it takes any Unicode the software
+// keyboard could not produce.
+static const NSUInteger kPasteThreshold = 64;
+static const NSTimeInterval kPasteMenuTimeout = 2.0;
+static const NSTimeInterval kPasteMenuPress = 0.6;
+// The field's value can trail the menu tap by a frame or two.
+static const NSTimeInterval kPasteLandTimeout = 0.5;
+static const NSTimeInterval kPastePoll = 0.05;
+
+typedef NS_ENUM(NSInteger, ArkavoPasteOutcome) {
+    ArkavoPasteLanded,
+    // Nothing reached the field, so typing the text instead is safe.
+    ArkavoPasteMissed,
+    // The field changed without taking the text; typing as well could
+    // leave it in there twice.
+    ArkavoPasteGarbled,
+};
+
+// Not in XCUIElementAttributes on iOS, but answered by the element's
+// snapshot; treated as unfocused wherever it is missing.
+static BOOL hasKeyboardFocus(XCUIElement *element) {
+    @try {
+        return [[element valueForKey:@"hasKeyboardFocus"] boolValue];
+    } @catch (NSException *exception) {
+        return NO;
+    }
+}
+
+static NSString *fieldValue(XCUIElement *element) {
+    id value = element.value;
+    return [value isKindOfClass:[NSString class]] ? value : @"";
+}
+
+@implementation ArkavoTestBridge (Typing)
+
+// Pastes through the edit menu, as a user would, so the app never shows the
+// paste permission prompt. What the pasteboard held before is put back,
+// since it belongs to the simulator's user and not to this action.
+- (ArkavoPasteOutcome)pasteText:(NSString *)text into:(XCUIElement *)element {
+    UIPasteboard *pasteboard = UIPasteboard.generalPasteboard;
+    NSArray<NSDictionary<NSString *, id> *> *saved = pasteboard.items;
+    NSString *before = fieldValue(element);
+    pasteboard.string = text;
+
+    ArkavoPasteOutcome outcome = ArkavoPasteMissed;
+    [element pressForDuration:kPasteMenuPress];
+    XCUIElement *paste = self.app.menuItems[@"Paste"];
+    if ([paste waitForExistenceWithTimeout:kPasteMenuTimeout]) {
+        [paste tap];
+        NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:kPasteLandTimeout];
+        NSString *after = fieldValue(element);
+        while ([after isEqualToString:before] && deadline.timeIntervalSinceNow > 0) {
+            [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:kPastePoll]];
+            after = fieldValue(element);
+        }
+        if ([after containsString:text] && ![before containsString:text]) {
+            outcome = ArkavoPasteLanded;
+        } else if (![after isEqualToString:before]) {
+            outcome = ArkavoPasteGarbled;
+        }
+    }
+    pasteboard.items = saved;
+    return outcome;
+}
+
+- (NSDictionary *)performType:(NSDictionary *)params {
+    NSString *text = params[@"text"];
+    if (![text isKindOfClass:[NSString class]]) {
+        return [self errorResult:@"No text parameter found" error:nil];
+    }
+    XCUIElement *element = [self findElement:params];
+    if (!element.exists) {
+        return [self errorResult:@"Element not found" error:nil];
+    }
+
+    // Refused as the native bridge refuses it, where a C string would end
+    // at the NUL, so the action fails alike on either backend.
+    NSCharacterSet *nul = [NSCharacterSet characterSetWithRange:NSMakeRange(0, 1)];
+    if ([text rangeOfCharacterFromSet:nul].location != NSNotFound) {
+        return [self errorResult:@"Text must not contain NUL characters" error:nil];
+    }
+
+    // Secure fields report bullets for a value, so a paste into one could
+    // never be confirmed.
+    BOOL paste = (text.length >= kPasteThreshold || [params[@"paste"] boolValue]) &&
+                 element.elementType != XCUIElementTypeSecureTextField;
+    if (paste) {
+        ArkavoPasteOutcome outcome = [self pasteText:text into:element];
+        if (outcome == ArkavoPasteLanded) {
+            return [self successResult:@{@"action": @"type", @"method": @"paste", @"length": @(text.length)}];
+        }
+        if (outcome == ArkavoPasteGarbled) {
+            return [self errorResult:@"Paste changed the field without inserting the text" error:nil];
+        }
+    }
+
+    // Filling one form field after another mostly lands on the field that
+    // already has focus, where a second tap is a wasted round trip that
+    // also moves the caret.
+    if (!hasKeyboardFocus(element)) {
+        [element tap];
+    }
+    [element typeText:text];
+    return [self successResult:@{@"action": @"type", @"method": @"keys", @"length": @(text.length)}];
+}
+
+@end
@@ -0,0 +1,193 @@
+//
+//  ArkavoTestBridge+Wait.m
+//  Waits that end as soon as their condition holds instead of sleeping out
+//
+
+#import "ArkavoTestBridge+Private.h"
+#import <UIKit/UIKit.h>
+
+static const NSTimeInterval kDefaultQuietInterval = 0.5;
+static const NSTimeInterval kDefaultWaitTimeout = 5.0;
+// XCTNSPredicateExpectation re-evaluates its predicate about once a second;
+// checking this often ends a wait within a few frames of the condition
+// holding.
+static const NSTimeInterval kPollInterval = 0.05;
+static const size_t kSampleWidth = 96;
+static const size_t kTileSize = 16;
+
+// Hashing a small BGRA rendition per tile is enough to notice any visible
+// change while costing far less than comparing full screenshots.
+static NSData *tileHashes(CGImageRef image) {
+    size_t height = MAX((size_t)1, kSampleWidth * CGImageGetHeight(image) / MAX((size_t)1, CGImageGetWidth(image)));
+    NSMutableData *pixels = [NSMutableData dataWithLength:kSampleWidth * height * 4];
+    CGColorSpaceRef space = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    CGContextRef bitmap = CGBitmapContextCreate(pixels.mutableBytes, kSampleWidth, height, 8, kSampleWidth * 4, space,
+                                                (CGBitmapInfo)kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(space);
+    if (!bitmap) return nil;
+    CGContextDrawImage(bitmap, CGRectMake(0, 0, kSampleWidth, height), image);
+    CGContextRelease(bitmap);
+
+    size_t columns = (kSampleWidth + kTileSize - 1) / kTileSize;
+    size_t rows = (height + kTileSize - 1) / kTileSize;
+    NSMutableData *hashes = [NSMutableData dataWithLength:columns * rows * sizeof(uint64_t)];
+    uint64_t *tiles = hashes.mutableBytes;
+    for (size_t i = 0; i < columns * rows; i++) tiles[i] = 0xcbf29ce484222325ULL;
+
+    const uint8_t *bytes = pixels.bytes;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < kSampleWidth * 4; x++) {
+            uint64_t *tile = &tiles[(y / kTileSize) * columns + x / (kTileSize * 4)];
+            *tile = (*tile ^ bytes[y * kSampleWidth * 4 + x]) * 0x100000001b3ULL;
+        }
+    }
+    return hashes;
+}
+
+static NSTimeInterval uptime(void) {
+    return [NSProcessInfo processInfo].systemUptime;
+}
+
+static NSData *screenHashes(void) {
+    @autoreleasepool {
+        return tileHashes([XCUIScreen mainScreen].screenshot.image.CGImage);
+    }
+}
+
+// XCTWaiter runs the run loop while it waits, so a timer on it can check the
+// condition instead of the thread sleeping between checks; it stops at the
+// first check that holds.
+static BOOL waitUntil(NSTimeInterval timeout, NSTimeInterval interval, BOOL (^check)(void)) {
+    if (check()) return YES;
+    if (timeout <= 0) return NO;
+    XCTestExpectation *expectation = [[XCTestExpectation alloc] initWithDescription:@"arkavo wait"];
+    NSTimer *timer = [NSTimer timerWithTimeInterval:interval repeats:YES block:^(NSTimer *fired) {
+        if (check()) {
+            [fired invalidate];
+            [expectation fulfill];
+        }
+    }];
+    [[NSRunLoop currentRunLoop] addTimer:timer forMode:NSRunLoopCommonModes];
+    XCTWaiterResult result = [XCTWaiter waitForExpectations:@[expectation] timeout:timeout];
+    [timer invalidate];
+    return result == XCTWaiterResultCompleted;
+}
+
+// Element conditions as predicates over the element's own attributes, so
+// each poll is one snapshot query. nil for anything else.
+static NSPredicate *elementCondition(NSString *condition, id value) {
+    if ([condition isEqualToString:@"exists"]) return [NSPredicate predicateWithFormat:@"exists == true"];
+    if ([condition isEqualToString:@"not_exists"]) return [NSPredicate predicateWithFormat:@"exists == false"];
+    if ([condition isEqualToString:@"hittable"]) return [NSPredicate predicateWithFormat:@"hittable == true"];
+    if ([condition isEqualToString:@"enabled"]) return [NSPredicate predicateWithFormat:@"enabled == true"];
+    if ([condition isEqualToString:@"selected"]) return [NSPredicate predicateWithFormat:@"selected == true"];
+    if (!value) return nil;
+    if ([condition isEqualToString:@"value_equals"]) return [NSPredicate predicateWithFormat:@"value == %@", value];
+    if ([condition isEqualToString:@"label_equals"]) return [NSPredicate predicateWithFormat:@"label == %@", value];
+    return nil;
+}
+
+@implementation ArkavoTestBridge (Wait)
+
+// Samples the screen until it has held still for quiet; failed is set when
+// the screen could not be captured at all.
+- (BOOL)waitForQuiet:(NSTimeInterval)quiet timeout:(NSTimeInterval)timeout failed:(BOOL *)failed {
+    __block NSTimeInterval lastChange = uptime();
+    __block NSData *previous = nil;
+    __block BOOL unreadable = NO;
+    BOOL settled = waitUntil(timeout, MAX(quiet / 4.0, 0.02), ^BOOL {
+        NSTimeInterval now = uptime();
+        NSData *hashes = screenHashes();
+        if (!hashes) {
+            unreadable = YES;
+            return YES;
+        }
+        if (![hashes isEqualToData:previous]) lastChange = now;
+        previous = hashes;
+        // Only a sample taken after the quiet window proves the screen held
+        // still for all of it.
+        return now - lastChange >= quiet;
+    });
+    *failed = unreadable;
+    return settled && !unreadable;
+}
+
+- (BOOL)waitForScreenChange:(NSTimeInterval)timeout failed:(BOOL *)failed {
+    NSData *baseline = screenHashes();
+    if (!baseline) {
+        *failed = YES;
+        return NO;
+    }
+    return waitUntil(timeout, kPollInterval, ^BOOL {
+        NSData *hashes = screenHashes();
+        return hashes && ![hashes isEqualToData:baseline];
+    });
+}
+
+// Existence is left to waitForExistenceWithTimeout:, which XCUITest ends on
+// its own accessibility notifications; attribute conditions are checked once
+// the element exists, since reading them from a missing element raises.
+- (BOOL)element:(XCUIElement *)element satisfies:(NSString *)condition value:(id)value within:(NSTimeInterval)timeout {
+    NSPredicate *predicate = elementCondition(condition, value);
+    if (!predicate) {
+        [NSException raise:NSInvalidArgumentException format:@"Unknown wait condition %@", condition];
+    }
+
+    NSTimeInterval deadline = uptime() + timeout;
+    BOOL needsElement = ![condition isEqualToString:@"not_exists"];
+    if (needsElement && ![element waitForExistenceWithTimeout:timeout]) return NO;
+    if ([condition isEqualToString:@"exists"]) return YES;
+
+    return waitUntil(deadline - uptime(), kPollInterval, ^BOOL {
+        @try {
+            return [predicate evaluateWithObject:element];
+        } @catch (NSException *exception) {
+            // The element went away between checks; keep waiting for it.
+            return NO;
+        }
+    });
+}
+
+- (NSDictionary *)waitUntilSettled:(NSDictionary *)params {
+    NSTimeInterval timeout = [params[@"duration"] doubleValue] ?: 1.0;
+    NSTimeInterval quiet = params[@"quiet_ms"] ? [params[@"quiet_ms"] doubleValue] / 1000.0 : kDefaultQuietInterval;
+    NSTimeInterval started = uptime();
+    BOOL failed = NO;
+    BOOL settled = [self waitForQuiet:quiet timeout:timeout failed:&failed];
+    if (failed) return [self errorResult:@"Failed to sample screen" error:nil];
+
+    NSTimeInterval waited = uptime() - started;
+    return [self successResult:@{@"action": @"wait", @"until": @"settled", @"settled": @(settled),
+                                 @"waited_ms": @(round(waited * 1000.0))}];
+}
+
+// A condition that never holds is reported as satisfied: false rather than
+// an error, like unsettled waits and failed assertions.
+- (NSDictionary *)performWaitFor:(NSDictionary *)params {
+    NSString *condition = params[@"condition"];
+    if (![condition isKindOfClass:[NSString class]]) {
+        return [self errorResult:@"No condition parameter found" error:nil];
+    }
+    NSTimeInterval timeout = params[@"timeout"] ? [params[@"timeout"] doubleValue] : kDefaultWaitTimeout;
+    NSTimeInterval started = uptime();
+    BOOL failed = NO;
+    BOOL satisfied;
+
+    if ([condition isEqualToString:@"idle"]) {
+        NSTimeInterval quiet = params[@"quiet_ms"] ? [params[@"quiet_ms"] doubleValue] / 1000.0 : kDefaultQuietInterval;
+        satisfied = [self waitForQuiet:quiet timeout:timeout failed:&failed];
+    } else if ([condition isEqualToString:@"screen_changed"]) {
+        satisfied = [self waitForScreenChange:timeout failed:&failed];
+    } else if (elementCondition(condition, params[@"value"])) {
+        satisfied = [self element:[self findElement:params] satisfies:condition value:params[@"value"] within:timeout];
+    } else {
+        return [self errorResult:@"Unknown wait condition" error:nil];
+    }
+    if (failed) return [self errorResult:@"Failed to sample screen" error:nil];
+
+    NSTimeInterval waited = uptime() - started;
+    return [self successResult:@{@"action": @"wait_for", @"condition": condition, @"satisfied": @(satisfied),
+                                 @"waited_ms": @(round(waited * 1000.0))}];
+}
+
+@end
@@ -13,9 +13,15 @@ NS_ASSUME_NONNULL_BEGIN
 // Initialize bridge with test case
 - (instancetype)initWithTestCase:(XCTestCase *)testCase;
 
+// Initialize bridge for an app without an owning test case
+- (instancetype)initWithBundleIdentifier:(nullable NSString *)bundleIdentifier;
+
 // Execute UI actions
 - (NSString *)executeAction:(NSString *)action params:(NSString *)params;
 
+// Execute a sequence of actions, optionally stopping at the first failure
+- (NSString *)executeBatch:(NSString *)actionsJSON;
+
 // State management
 - (NSString *)getCurrentState;
 - (NSString *)mutateState:(NSString *)entity action:(NSString *)action data:(NSString *)data;
@@ -29,19 +35,74 @@ NS_ASSUME_NONNULL_BEGIN
 - (NSArray<NSString *> *)discoverAvailableActions;
 - (NSDictionary *)analyzeCurrentScreen;
 
+// Resident runner host: serve this bridge on a Unix socket, then keep the
+// main run loop turning until a client asks the host to shut down
+- (BOOL)serveAtPath:(NSString *)path error:(NSError **)error;
+- (void)runUntilShutdown;
+
 @end
 
+// Result bytes lent across the FFI boundary; valid until release(context).
+typedef struct {
+    const char* data;
+    size_t length;
+    void* context;
+    void (*release)(void* context);
+} IOSBridgeBuffer;
+
+typedef void* _Nullable (*IOSBridgeReserve)(void* context, size_t size);
+
+// Takes ownership of result, freed with ios_bridge_free_string.
+typedef void (*IOSBridgeCompletion)(void* context, uint64_t request_id, char* result);
+
+// Frame formats: 0 raw BGRA, 1 PNG, 2 JPEG. A zero crop size means the whole
+// screen; scale in (0, 1] is applied after cropping.
+typedef struct {
+    int format;
+    int crop_x;
+    int crop_y;
+    int crop_width;
+    int crop_height;
+    double scale;
+    int jpeg_quality;
+} IOSFrameRequest;
+
+typedef struct {
+    int format;
+    int width;
+    int height;
+    int bytes_per_row;
+    double captured_ms;
+} IOSFrameInfo;
+
 // C interface for FFI
 extern "C" {
     void* arkavo_bridge_create(void* xctest_case);
     void arkavo_bridge_destroy(void* bridge);
     
+    void* ios_bridge_create(const char* device_id, const char* bundle_id);
+    void ios_bridge_destroy(void* bridge);
+    
     char* ios_bridge_execute_action(void* bridge, const char* action, const char* params);
+    int ios_bridge_execute_batch(void* bridge, const char* actions_json, char** results_out);
+    uint64_t ios_bridge_submit_action(void* bridge, const char* action, const char* params,
+                                      IOSBridgeCompletion completion, void* context);
+    int ios_bridge_execute_action_buffer(void* bridge, const char* action, const char* params, IOSBridgeBuffer* out);
+    int ios_bridge_execute_batch_buffer(void* bridge, const char* actions_json, IOSBridgeBuffer* out);
     char* ios_bridge_get_current_state(void* bridge);
+    char* ios_bridge_get_state_delta(void* bridge);
+    char* ios_bridge_analyze_screen(void* bridge);
     char* ios_bridge_mutate_state(void* bridge, const char* entity, const char* action, const char* data);
     
     void* ios_bridge_create_snapshot(void* bridge, size_t* size);
-    void ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size);
+    int ios_bridge_create_snapshot_into(void* bridge, IOSBridgeReserve reserve, void* context);
+    int ios_bridge_capture_frame(void* bridge, const IOSFrameRequest* request, IOSBridgeReserve reserve,
+                                 void* context, IOSFrameInfo* info);
+    int ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size);
+    int ios_bridge_delete_snapshot(void* bridge, const void* data, size_t size);
+    // Per-operation latency histograms shared by every bridge; bridge may be NULL.
+    char* ios_bridge_get_metrics(void* bridge);
+    void ios_bridge_reset_metrics(void* bridge);
     
     void ios_bridge_free_string(char* s);
     void ios_bridge_free_data(void* data);
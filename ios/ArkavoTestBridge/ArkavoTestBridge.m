@@ -4,6 +4,7 @@
 //
 
 #import "ArkavoTestBridge.h"
+#import "ArkavoTestBridge+Private.h"
 #import <objc/runtime.h>
 
 @interface ArkavoTestBridge ()
@@ -24,17 +25,39 @@
     return self;
 }
 
+- (instancetype)initWithBundleIdentifier:(NSString *)bundleIdentifier {
+    self = [super init];
+    if (self) {
+        _app = bundleIdentifier ? [[XCUIApplication alloc] initWithBundleIdentifier:bundleIdentifier]
+                                : [[XCUIApplication alloc] init];
+        _stateSnapshots = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
 #pragma mark - Action Execution
 
 - (NSString *)executeAction:(NSString *)action params:(NSString *)params {
+    NSData *paramsData = [params dataUsingEncoding:NSUTF8StringEncoding];
+    return [self jsonStringFromDictionary:[self resultForAction:action paramsData:paramsData]];
+}
+
+- (NSDictionary *)resultForAction:(NSString *)action paramsData:(NSData *)params {
     NSError *error = nil;
-    NSDictionary *paramDict = [NSJSONSerialization JSONObjectWithData:[params dataUsingEncoding:NSUTF8StringEncoding]
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "json.parse", NULL);
+    NSDictionary *paramDict = [NSJSONSerialization JSONObjectWithData:params
                                                               options:0
                                                                 error:&error];
+    ArkavoMetricsEnd(&span);
     if (error) {
-        return [self errorResponse:@"Invalid JSON params" error:error];
+        return [self errorResult:@"Invalid JSON params" error:error];
     }
     
+    return [self resultForAction:action params:paramDict];
+}
+
+- (NSDictionary *)performAction:(NSString *)action params:(NSDictionary *)paramDict {
     @try {
         if ([action isEqualToString:@"tap"]) {
             return [self performTap:paramDict];
@@ -46,38 +69,38 @@
             return [self performWait:paramDict];
         } else if ([action isEqualToString:@"assert"]) {
             return [self performAssert:paramDict];
+        } else if ([action isEqualToString:@"wait_for"]) {
+            return [self performWaitFor:paramDict];
+        } else if ([action isEqualToString:@"query_ui"]) {
+            return [self performQueryUI:paramDict];
         } else {
-            return [self errorResponse:@"Unknown action" error:nil];
+            return [self errorResult:@"Unknown action" error:nil];
         }
     } @catch (NSException *exception) {
-        return [self errorResponse:exception.reason error:nil];
+        return [self errorResult:exception.reason error:nil];
+    } @finally {
+        // Any action may move what the recorded frames describe.
+        [self forgetResolvedFrames];
     }
 }
 
-- (NSString *)performTap:(NSDictionary *)params {
-    XCUIElement *element = [self findElement:params];
-    if (!element.exists) {
-        return [self errorResponse:@"Element not found" error:nil];
-    }
-    
-    [element tap];
-    return [self successResponse:@{@"action": @"tap", @"element": params[@"identifier"] ?: @"unknown"}];
-}
+- (NSDictionary *)performTap:(NSDictionary *)params {
+    NSDictionary *coordinateTap = [self performCoordinateTap:params] ?: [self performResolvedTap:params];
+    if (coordinateTap) return coordinateTap;
 
-- (NSString *)performType:(NSDictionary *)params {
     XCUIElement *element = [self findElement:params];
-    NSString *text = params[@"text"];
-    
     if (!element.exists) {
-        return [self errorResponse:@"Element not found" error:nil];
+        return [self errorResult:@"Element not found" error:nil];
     }
     
     [element tap];
-    [element typeText:text];
-    return [self successResponse:@{@"action": @"type", @"text": text}];
+    return [self successResult:@{@"action": @"tap", @"element": params[@"identifier"] ?: @"unknown"}];
 }
 
-- (NSString *)performSwipe:(NSDictionary *)params {
+- (NSDictionary *)performSwipe:(NSDictionary *)params {
+    NSDictionary *coordinateSwipe = [self performCoordinateSwipe:params];
+    if (coordinateSwipe) return coordinateSwipe;
+
     NSString *direction = params[@"direction"];
     XCUIElement *element = params[@"identifier"] ? [self findElement:params] : self.app;
     
@@ -91,21 +114,32 @@
         [element swipeRight];
     }
     
-    return [self successResponse:@{@"action": @"swipe", @"direction": direction}];
+    return [self successResult:@{@"action": @"swipe", @"direction": direction}];
 }
 
-- (NSString *)performWait:(NSDictionary *)params {
-    NSTimeInterval duration = [params[@"duration"] doubleValue] ?: 1.0;
+- (NSDictionary *)performWait:(NSDictionary *)params {
+    if ([params[@"until"] isEqual:@"settled"]) {
+        return [self waitUntilSettled:params];
+    }
+    // Batches and callers already on the main thread need the result before
+    // going on, so this blocks it; the C and host entry points serve plain
+    // waits off the main thread instead (ArkavoWaitOffMainThread).
+    NSTimeInterval duration = MAX(0.0, [params[@"duration"] doubleValue] ?: 1.0);
     [NSThread sleepForTimeInterval:duration];
-    return [self successResponse:@{@"action": @"wait", @"duration": @(duration)}];
+    return [self successResult:@{@"action": @"wait", @"duration": @(duration)}];
 }
 
-- (NSString *)performAssert:(NSDictionary *)params {
+- (NSDictionary *)performAssert:(NSDictionary *)params {
     XCUIElement *element = [self findElement:params];
     NSString *condition = params[@"condition"];
     
+    // With a timeout the assertion holds as soon as the condition does
+    // instead of sampling it once.
+    NSTimeInterval timeout = [params[@"timeout"] doubleValue];
     BOOL result = NO;
-    if ([condition isEqualToString:@"exists"]) {
+    if (timeout > 0) {
+        result = [self element:element satisfies:condition value:params[@"value"] within:timeout];
+    } else if ([condition isEqualToString:@"exists"]) {
         result = element.exists;
     } else if ([condition isEqualToString:@"enabled"]) {
         result = element.enabled;
@@ -113,33 +147,14 @@
         result = element.selected;
     }
     
-    return [self successResponse:@{@"action": @"assert", @"condition": condition, @"result": @(result)}];
-}
-
-#pragma mark - Element Finding
-
-- (XCUIElement *)findElement:(NSDictionary *)params {
-    NSString *identifier = params[@"identifier"];
-    NSString *type = params[@"type"] ?: @"any";
-    NSString *label = params[@"label"];
-    
-    XCUIElementQuery *query = self.app.descendants(matchingType:XCUIElementTypeAny);
-    
-    if (identifier) {
-        query = [query matchingIdentifier:identifier];
-    }
-    
-    if (label) {
-        NSPredicate *predicate = [NSPredicate predicateWithFormat:@"label == %@", label];
-        query = [query matchingPredicate:predicate];
-    }
-    
-    return query.firstMatch;
+    return [self successResult:@{@"action": @"assert", @"condition": condition, @"result": @(result)}];
 }
 
 #pragma mark - State Management
 
 - (NSString *)getCurrentState {
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "state", NULL);
     NSMutableDictionary *state = [NSMutableDictionary dictionary];
     
     // Get current view hierarchy
@@ -150,56 +165,24 @@
         state[@"appState"] = @([self.app performSelector:@selector(state)]);
     }
     
-    // Get current screen
-    state[@"currentScreen"] = [self identifyCurrentScreen];
-    
-    // Get visible elements
-    state[@"visibleElements"] = [self getVisibleElements];
+    // Screen name and visible elements come from the same snapshot pass
+    NSDictionary *analysis = [self screenAnalysis];
+    state[@"currentScreen"] = analysis[@"screen"] ?: [self identifyCurrentScreen];
+    state[@"visibleElements"] = analysis[@"visibleElements"] ?: @[];
     
-    return [self jsonStringFromDictionary:state];
+    NSString *json = [self jsonStringFromDictionary:state];
+    ArkavoMetricsEnd(&span);
+    return json;
 }
 
 - (NSString *)mutateState:(NSString *)entity action:(NSString *)action data:(NSString *)data {
-    // This would integrate with your app's internal APIs
-    // For now, we'll simulate state changes through UI
-    
     if ([entity isEqualToString:@"user"] && [action isEqualToString:@"login"]) {
-        // Simulate login through UI or deep link
-        [self.app terminate];
-        [self.app launchWithArguments:@[@"--test-user-logged-in"]];
-        return [self successResponse:@{@"entity": entity, @"action": action}];
+        return [self jsonStringFromDictionary:[self performLogin:data]];
     }
     
     return [self errorResponse:@"State mutation not implemented" error:nil];
 }
 
-- (NSDictionary *)captureViewHierarchy {
-    NSMutableDictionary *hierarchy = [NSMutableDictionary dictionary];
-    XCUIElement *rootElement = self.app;
-    
-    [self traverseElement:rootElement into:hierarchy];
-    
-    return hierarchy;
-}
-
-- (void)traverseElement:(XCUIElement *)element into:(NSMutableDictionary *)dict {
-    dict[@"type"] = @(element.elementType);
-    dict[@"identifier"] = element.identifier ?: @"";
-    dict[@"label"] = element.label ?: @"";
-    dict[@"enabled"] = @(element.enabled);
-    dict[@"selected"] = @(element.selected);
-    
-    if (element.children.count > 0) {
-        NSMutableArray *children = [NSMutableArray array];
-        for (XCUIElement *child in element.children.allElementsBoundByIndex) {
-            NSMutableDictionary *childDict = [NSMutableDictionary dictionary];
-            [self traverseElement:child into:childDict];
-            [children addObject:childDict];
-        }
-        dict[@"children"] = children;
-    }
-}
-
 - (NSString *)identifyCurrentScreen {
     // Use heuristics to identify current screen
     if ([self.app.navigationBars[@"Login"] exists]) {
@@ -211,140 +194,81 @@
     return @"UnknownScreen";
 }
 
-- (NSArray *)getVisibleElements {
-    NSMutableArray *elements = [NSMutableArray array];
-    
-    // Get all interactive elements
-    NSArray *elementTypes = @[
-        @(XCUIElementTypeButton),
-        @(XCUIElementTypeTextField),
-        @(XCUIElementTypeTextView),
-        @(XCUIElementTypeSwitch),
-        @(XCUIElementTypeSlider)
-    ];
-    
-    for (NSNumber *type in elementTypes) {
-        XCUIElementQuery *query = [self.app descendantsMatchingType:type.integerValue];
-        for (XCUIElement *element in query.allElementsBoundByIndex) {
-            if (element.exists && element.isHittable) {
-                [elements addObject:@{
-                    @"type": [self elementTypeString:element.elementType],
-                    @"identifier": element.identifier ?: @"",
-                    @"label": element.label ?: @"",
-                    @"value": element.value ?: @"",
-                    @"enabled": @(element.enabled)
-                }];
-            }
-        }
-    }
-    
-    return elements;
-}
-
 #pragma mark - Snapshot Management
 
 - (NSData *)createSnapshot {
-    NSMutableDictionary *snapshot = [NSMutableDictionary dictionary];
-    
-    // Capture UI state
-    snapshot[@"viewHierarchy"] = [self captureViewHierarchy];
-    snapshot[@"currentScreen"] = [self identifyCurrentScreen];
-    
-    // Capture app data (would need app cooperation)
-    snapshot[@"timestamp"] = @([[NSDate date] timeIntervalSince1970]);
-    
-    return [NSKeyedArchiver archivedDataWithRootObject:snapshot requiringSecureCoding:NO error:nil];
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "snapshot.create", NULL);
+    NSData *record = [self snapshotRecord];
+    ArkavoMetricsEnd(&span);
+    return record;
 }
 
 - (void)restoreSnapshot:(NSData *)snapshotData {
-    NSDictionary *snapshot = [NSKeyedUnarchiver unarchivedObjectOfClass:[NSDictionary class] 
-                                                               fromData:snapshotData 
-                                                                  error:nil];
-    
-    // Restore app to previous state
-    // This typically requires app cooperation or deep links
-    NSString *screen = snapshot[@"currentScreen"];
-    
-    // Navigate to the saved screen
-    [self navigateToScreen:screen];
+    // Without access to the app's data, restoring relaunches it on the
+    // screen the snapshot was taken on.
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "snapshot.restore", NULL);
+    NSString *screen = [self screenInSnapshot:snapshotData];
+    if (screen) {
+        [self navigateToScreen:screen];
+    }
+    ArkavoMetricsEnd(&span);
 }
 
 - (void)navigateToScreen:(NSString *)screenName {
-    // Implement navigation logic based on your app's structure
-    [self.app terminate];
-    [self.app launchWithArguments:@[@"--open-screen", screenName]];
+    [self openScreenInApp:screenName];
 }
 
 #pragma mark - AI-Driven Exploration
 
 - (NSArray<NSString *> *)discoverAvailableActions {
-    NSMutableArray *actions = [NSMutableArray array];
-    
-    // Find all tappable elements
-    XCUIElementQuery *buttons = self.app.buttons;
-    for (XCUIElement *button in buttons.allElementsBoundByIndex) {
-        if (button.exists && button.isHittable) {
-            [actions addObject:[NSString stringWithFormat:@"tap:%@", button.identifier ?: button.label]];
-        }
-    }
-    
-    // Find text fields
-    XCUIElementQuery *textFields = self.app.textFields;
-    for (XCUIElement *field in textFields.allElementsBoundByIndex) {
-        if (field.exists && field.isHittable) {
-            [actions addObject:[NSString stringWithFormat:@"type:%@", field.identifier ?: field.label]];
-        }
-    }
-    
-    // Add swipe actions
-    [actions addObjectsFromArray:@[@"swipe:up", @"swipe:down", @"swipe:left", @"swipe:right"]];
-    
-    return actions;
+    return [self screenAnalysis][@"availableActions"] ?: @[];
 }
 
 - (NSDictionary *)analyzeCurrentScreen {
-    return @{
-        @"screen": [self identifyCurrentScreen],
-        @"availableActions": [self discoverAvailableActions],
-        @"visibleElements": [self getVisibleElements],
-        @"elementCount": @(self.app.descendants(matchingType:XCUIElementTypeAny).count)
-    };
+    return [self screenAnalysis];
 }
 
 #pragma mark - Helper Methods
 
 - (NSString *)jsonStringFromDictionary:(NSDictionary *)dict {
+    return [[NSString alloc] initWithData:[self jsonDataFromDictionary:dict] encoding:NSUTF8StringEncoding];
+}
+
+- (NSData *)jsonDataFromDictionary:(NSDictionary *)dict {
     NSError *error;
+    ArkavoMetricsSpan span;
+    ArkavoMetricsBegin(&span, "json.encode", NULL);
     NSData *jsonData = [NSJSONSerialization dataWithJSONObject:dict options:0 error:&error];
+    ArkavoMetricsEnd(&span);
     if (error) {
-        return [self errorResponse:@"JSON serialization failed" error:error];
+        NSDictionary *failure = [self errorResult:@"JSON serialization failed" error:error];
+        return [NSJSONSerialization dataWithJSONObject:failure options:0 error:nil];
     }
-    return [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding];
+    return jsonData;
 }
 
 - (NSString *)successResponse:(NSDictionary *)data {
+    return [self jsonStringFromDictionary:[self successResult:data]];
+}
+
+- (NSString *)errorResponse:(NSString *)message error:(NSError *)error {
+    return [self jsonStringFromDictionary:[self errorResult:message error:error]];
+}
+
+- (NSDictionary *)successResult:(NSDictionary *)data {
     NSMutableDictionary *response = [NSMutableDictionary dictionaryWithDictionary:data];
     response[@"success"] = @YES;
-    return [self jsonStringFromDictionary:response];
+    return response;
 }
 
-- (NSString *)errorResponse:(NSString *)message error:(NSError *)error {
-    return [self jsonStringFromDictionary:@{
+- (NSDictionary *)errorResult:(NSString *)message error:(NSError *)error {
+    return @{
         @"success": @NO,
-        @"error": message,
+        @"error": message ?: @"Unknown error",
         @"details": error.localizedDescription ?: @""
-    }];
-}
-
-- (NSString *)elementTypeString:(XCUIElementType)type {
-    switch (type) {
-        case XCUIElementTypeButton: return @"button";
-        case XCUIElementTypeTextField: return @"textField";
-        case XCUIElementTypeTextView: return @"textView";
-        case XCUIElementTypeSwitch: return @"switch";
-        case XCUIElementTypeSlider: return @"slider";
-        default: return @"other";
-    }
+    };
 }
 
 @end
@@ -352,52 +276,102 @@
 #pragma mark - C Interface Implementation
 
 void* arkavo_bridge_create(void* xctest_case) {
-    XCTestCase *testCase = (__bridge XCTestCase *)xctest_case;
-    ArkavoTestBridge *bridge = [[ArkavoTestBridge alloc] initWithTestCase:testCase];
-    return (__bridge_retained void *)bridge;
+    __block void *handle = NULL;
+    ArkavoRunOnMainThread(^{
+        XCTestCase *testCase = (__bridge XCTestCase *)xctest_case;
+        ArkavoTestBridge *bridge = [[ArkavoTestBridge alloc] initWithTestCase:testCase];
+        handle = (__bridge_retained void *)bridge;
+    });
+    return handle;
 }
 
 void arkavo_bridge_destroy(void* bridge) {
-    ArkavoTestBridge *testBridge = (__bridge_transfer ArkavoTestBridge *)bridge;
-    testBridge = nil;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge_transfer ArkavoTestBridge *)bridge;
+        testBridge = nil;
+    });
+}
+
+// XCUITest drives the device in-process, so the device id only matters to the
+// simctl backend; it is accepted here to keep the C interface identical.
+void* ios_bridge_create(const char* device_id, const char* bundle_id) {
+    (void)device_id;
+    __block void *handle = NULL;
+    ArkavoRunOnMainThread(^{
+        NSString *bundleId = bundle_id ? [NSString stringWithUTF8String:bundle_id] : nil;
+        ArkavoTestBridge *bridge = [[ArkavoTestBridge alloc] initWithBundleIdentifier:bundleId];
+        handle = (__bridge_retained void *)bridge;
+    });
+    return handle;
+}
+
+void ios_bridge_destroy(void* bridge) {
+    arkavo_bridge_destroy(bridge);
 }
 
 char* ios_bridge_execute_action(void* bridge, const char* action, const char* params) {
     ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
     NSString *actionStr = [NSString stringWithUTF8String:action];
     NSString *paramsStr = [NSString stringWithUTF8String:params];
-    NSString *result = [testBridge executeAction:actionStr params:paramsStr];
-    return strdup([result UTF8String]);
+    NSString *waited = ArkavoWaitOffMainThread(testBridge, actionStr, [paramsStr dataUsingEncoding:NSUTF8StringEncoding]);
+    if (waited) return ArkavoCopyCString(waited);
+
+    __block char *result = NULL;
+    ArkavoRunOnMainThread(^{
+        result = ArkavoCopyCString([testBridge executeAction:actionStr params:paramsStr]);
+    });
+    return result;
 }
 
 char* ios_bridge_get_current_state(void* bridge) {
-    ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
-    NSString *state = [testBridge getCurrentState];
-    return strdup([state UTF8String]);
+    __block char *result = NULL;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+        result = ArkavoCopyCString([testBridge getCurrentState]);
+    });
+    return result;
 }
 
 char* ios_bridge_mutate_state(void* bridge, const char* entity, const char* action, const char* data) {
-    ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
-    NSString *entityStr = [NSString stringWithUTF8String:entity];
-    NSString *actionStr = [NSString stringWithUTF8String:action];
-    NSString *dataStr = [NSString stringWithUTF8String:data];
-    NSString *result = [testBridge mutateState:entityStr action:actionStr data:dataStr];
-    return strdup([result UTF8String]);
+    __block char *result = NULL;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+        NSString *entityStr = [NSString stringWithUTF8String:entity];
+        NSString *actionStr = [NSString stringWithUTF8String:action];
+        NSString *dataStr = [NSString stringWithUTF8String:data];
+        result = ArkavoCopyCString([testBridge mutateState:entityStr action:actionStr data:dataStr]);
+    });
+    return result;
 }
 
 void* ios_bridge_create_snapshot(void* bridge, size_t* size) {
-    ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
-    NSData *snapshot = [testBridge createSnapshot];
-    *size = snapshot.length;
-    void *buffer = malloc(snapshot.length);
-    memcpy(buffer, snapshot.bytes, snapshot.length);
+    __block void *buffer = NULL;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+        NSData *snapshot = [testBridge createSnapshot];
+        *size = snapshot.length;
+        buffer = ArkavoCopyBytes(snapshot);
+    });
     return buffer;
 }
 
-void ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size) {
-    ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+int ios_bridge_restore_snapshot(void* bridge, const void* data, size_t size) {
     NSData *snapshot = [NSData dataWithBytes:data length:size];
-    [testBridge restoreSnapshot:snapshot];
+    if (!ArkavoSnapshotIsValid(snapshot)) return -1;
+    ArkavoRunOnMainThread(^{
+        ArkavoTestBridge *testBridge = (__bridge ArkavoTestBridge *)bridge;
+        [testBridge restoreSnapshot:snapshot];
+    });
+    return 0;
+}
+
+// The test runner is sandboxed away from its target's data container, so its
+// snapshots are plain state records with nothing on disk to delete.
+int ios_bridge_delete_snapshot(void* bridge, const void* data, size_t size) {
+    (void)bridge;
+    (void)data;
+    (void)size;
+    return 0;
 }
 
 void ios_bridge_free_string(char* s) {
@@ -406,4 +380,4 @@ void ios_bridge_free_string(char* s) {
 
 void ios_bridge_free_data(void* data) {
     free(data);
-}
\ No newline at end of file
+}
@@ -17,7 +17,11 @@ mkdir -p ArkavoTestBridge.framework/Modules
 
 # Copy bridge files
 cp "$ARKAVO_PATH/ios/ArkavoTestBridge/ArkavoTestBridge.h" ArkavoTestBridge.framework/Headers/
-cp "$ARKAVO_PATH/ios/ArkavoTestBridge/ArkavoTestBridge.m" ArkavoTestBridge.framework/
+cp "$ARKAVO_PATH"/ios/ArkavoTestBridge/*.m "$ARKAVO_PATH"/ios/ArkavoTestBridge/ArkavoTestBridge+*.h ArkavoTestBridge.framework/
+# The bridge records into the native bridge's metrics histograms and
+# classifies screens with its analysis rules
+cp "$ARKAVO_PATH"/crates/arkavo-test/src/bridge/ios_metrics.[ch] "$ARKAVO_PATH"/crates/arkavo-test/src/bridge/ios_builder.[ch] \
+    "$ARKAVO_PATH"/crates/arkavo-test/src/bridge/ios_analysis.[ch] ArkavoTestBridge.framework/
 
 # Create module map
 cat > ArkavoTestBridge.framework/Modules/module.modulemap << EOF